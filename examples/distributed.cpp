@@ -0,0 +1,44 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <TenSores/DistributedTensor.hpp>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+
+using Matrix = TenSore::Tensor<double, 2>;
+
+int main (void)
+{
+  Matrix A = Matrix({200, 300});
+  Matrix B = Matrix({300, 100});
+  std::iota(A.begin(), A.end(), 0);
+  std::iota(B.rbegin(), B.rend(), 0);
+
+  TenSore::run_local(4, [&](TenSore::Transport& t)
+  {
+    // Both operands sharded along the inner dimension
+    TenSore::DistributedTensor<double, 2> dA (t, A, 1);
+    TenSore::DistributedTensor<double, 2> dB (t, B, 0);
+    auto dC = TenSore::matmul(dA, dB);
+    const double total = dC.sum();
+    if (t.rank() == 0)
+    {
+      std::cout << "Sum of product : " << total << '\n';
+    }
+  });
+}
@@ -0,0 +1,40 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <TenSores/DLPack.hpp>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+
+using Matrix = TenSore::Tensor<double, 2>;
+
+int main (void)
+{
+  Matrix M = Matrix({300, 200});
+  std::iota(M.begin(), M.end(), 0);
+
+  // Hand the buffer over, then import it back read-only
+  DLManagedTensor* managed = TenSore::to_dlpack(std::move(M));
+  const TenSore::DLPackView<const double, 2> in (managed);
+  const TenSore::TensorView<const double, 2> view = in;
+
+  std::cout << "Dimensions : " << in.dimensions()[0] << " x "
+            << in.dimensions()[1] << '\n';
+  std::cout << "Element    : " << in.at({ 299, 199 }) << '\n';
+  std::cout << "Sum        : "
+            << std::accumulate(view.begin(), view.end(), 0.0) << '\n';
+}
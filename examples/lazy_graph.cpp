@@ -0,0 +1,69 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include <TenSores/LazyGraph.hpp>
+#include <cstddef>
+#include <iostream>
+#include <numeric>
+
+using BigTensor = TenSore::Tensor<double, 3>;
+
+int main (void)
+{
+  BigTensor X = BigTensor({100, 100, 100});
+  BigTensor Y = BigTensor({100, 100, 100});
+  BigTensor Z = BigTensor({100, 100, 100});
+  std::iota(X.begin(), X.end(), 0);
+  std::iota(Y.rbegin(), Y.rend(), 0);
+
+  TenSore::LazyGraph<double, 3> G (X.dimensions());
+  auto x = G.input(X);
+  auto y = G.input(Y);
+
+  auto d = x - y;
+  auto unused = exp(d);
+  (void)unused;
+  G.output(sqrt(d * d + 1.0) / (x + y + 1.0), Z);
+
+  G.run();
+
+  std::cout << "Recorded nodes : " << G.node_count() << '\n';
+  std::cout << "Live nodes     : " << G.live_count() << '\n';
+  std::cout << "Scratch slots  : " << G.slot_count() << '\n';
+  std::cout << "Sum            : "
+            << std::accumulate(Z.begin(), Z.end(), 0.0) << '\n';
+
+  // Constants keep their own scratch slots across tiles
+  BigTensor C = BigTensor({100, 100, 100});
+  TenSore::LazyGraph<double, 3> H (X.dimensions());
+  auto u = H.input(X);
+  auto v = H.input(Y);
+  auto a = u * v;
+  auto b = u + v;
+  H.output(a * b + 2.0, C);
+  H.run();
+
+  for (std::size_t i = 0; i < C.size(); ++i) {
+    const double _x = X.begin()[i];
+    const double _y = Y.begin()[i];
+    if (C.begin()[i] != _x * _y * (_x + _y) + 2.0) {
+      std::cout << "Mismatch at    : " << i << '\n';
+      return 1;
+    }
+  }
+  std::cout << "Constant graph : ok\n";
+}
@@ -15,43 +15,38 @@
     You should have received a copy of the GNU General Public License
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
-#include <TenSores/Tensor.hpp>
+#include <TenSores/Partition.hpp>
 #include <cstddef>
-#include <functional>
 #include <iostream>
 #include <numeric>
-#include <thread>
+#include <span>
 #include <vector>
 
 using BigTensor = TenSore::Tensor<double, 4>;
 
-void psum (const BigTensor& T, double& res, std::size_t s, std::size_t e)
+void psum (std::span<const double> chunk, double& res)
 {
-  res = std::accumulate(T.begin() + s, T.begin() + e, 0.0);
+  res = std::accumulate(chunk.begin(), chunk.end(), 0.0);
   std::cout << "Partial sum : " << res << '\n';
 }
 
 int main (void)
 {
-  std::vector<std::thread> thread_pool;
   constexpr std::size_t thread_num = 8;
+  TenSore::ThreadPool thread_pool (thread_num);
 
   BigTensor T1 = BigTensor({100, 100, 100, 100});
-  const std::size_t tsz = T1.size();
   std::iota(T1.begin(), T1.end(), 0);
 
-  std::vector<double> results (thread_num);
+  const BigTensor& C1 = T1;
+  const auto chunks = TenSore::partition(C1, thread_num);
+  std::vector<double> results (chunks.size());
 
-  std::size_t chsz = tsz / thread_num;
-  for (std::size_t ti = 0; ti < thread_num; ti++)
+  TenSore::for_each_chunk(thread_pool, chunks, [&](auto chunk, std::size_t ti)
   {
-    std::size_t _s = ti * chsz;
-    std::size_t _e = (ti == thread_num - 1) ? tsz : _s + chsz;
-    thread_pool.emplace_back(psum, std::ref(T1), std::ref(results.at(ti)), _s, _e);
-  }
+    psum(chunk, results.at(ti));
+  });
 
-  for (auto& it : thread_pool)
-  {
-    it.join();
-  }
+  std::cout << "Total sum : "
+            << std::accumulate(results.begin(), results.end(), 0.0) << '\n';
 }
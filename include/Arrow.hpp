@@ -0,0 +1,921 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "NdIterator.hpp"
+#include "Tensor.hpp"
+#include "TensorView.hpp"
+#include "TextIO.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace TenSore {
+
+namespace detail {
+
+/**
+ * @brief Minimal flatbuffers encoder writing front to back
+ *
+ * @details
+ * Flatbuffers only require references to tables, vectors and strings to
+ * point forward, so a parent is written first with empty offset slots,
+ * and each child is appended later and patched into its slot. Each
+ * table is preceded by its vtable.
+ */
+class FlatBuilder
+{
+public:
+  /**
+   * @brief Field of a table: a scalar, an inline struct or an offset slot
+   */
+  struct Field
+  {
+    std::uint16_t m_Id;
+    std::size_t m_Size;
+    std::uint64_t m_Scalar = 0;
+    const void* m_Struct = nullptr;
+    bool m_Offset = false;
+  };
+
+  static Field scalar(std::uint16_t p_Id, std::size_t p_Size, std::uint64_t p_Value)
+  {
+    return Field{ p_Id, p_Size, p_Value, nullptr, false };
+  }
+
+  static Field structure(std::uint16_t p_Id, const void* p_Data, std::size_t p_Size)
+  {
+    return Field{ p_Id, p_Size, 0, p_Data, false };
+  }
+
+  static Field offset(std::uint16_t p_Id) { return Field{ p_Id, 4, 0, nullptr, true }; }
+
+  FlatBuilder() { m_Buffer.resize(4); }
+
+  /**
+   * @brief Slot of the root table's offset
+   */
+  static constexpr std::size_t root() noexcept { return 0; }
+
+  /**
+   * @brief Appends a table
+   *
+   * @return Position of the table, and the slots of its offset fields in
+   * the order they were given
+   */
+  std::pair<std::size_t, std::vector<std::size_t>> table(std::vector<Field> p_Fields)
+  {
+    std::uint16_t _max_id = 0;
+    for (const auto& it : p_Fields) {
+      _max_id = std::max(_max_id, it.m_Id);
+    }
+    const std::size_t _vtable_size = 4 + 2 * (std::size_t{ _max_id } + 1);
+    align(2);
+    const std::size_t _vtable = m_Buffer.size();
+    m_Buffer.resize(_vtable + _vtable_size);
+    align(8);
+    const std::size_t _table = m_Buffer.size();
+
+    std::vector<std::size_t> _order(p_Fields.size());
+    for (std::size_t i = 0; i < _order.size(); ++i) {
+      _order[i] = i;
+    }
+    std::stable_sort(_order.begin(), _order.end(), [&](std::size_t a, std::size_t b) {
+      return p_Fields[a].m_Size > p_Fields[b].m_Size;
+    });
+    std::vector<std::size_t> _positions(p_Fields.size());
+    std::size_t _cursor = 4;
+    for (const std::size_t i : _order) {
+      const std::size_t _align = std::min<std::size_t>(p_Fields[i].m_Size, 8);
+      _cursor = (_cursor + _align - 1) / _align * _align;
+      _positions[i] = _cursor;
+      _cursor += p_Fields[i].m_Size;
+    }
+    _cursor = (_cursor + 3) / 4 * 4;
+    m_Buffer.resize(_table + _cursor);
+    put<std::int32_t>(_table, static_cast<std::int32_t>(_table - _vtable));
+    put<std::uint16_t>(_vtable, static_cast<std::uint16_t>(_vtable_size));
+    put<std::uint16_t>(_vtable + 2, static_cast<std::uint16_t>(_cursor));
+
+    std::vector<std::size_t> _slots;
+    for (std::size_t i = 0; i < p_Fields.size(); ++i) {
+      const Field& _field = p_Fields[i];
+      const std::size_t _at = _table + _positions[i];
+      put<std::uint16_t>(_vtable + 4 + 2 * _field.m_Id,
+                         static_cast<std::uint16_t>(_positions[i]));
+      if (_field.m_Offset) {
+        _slots.push_back(_at);
+      } else if (_field.m_Struct) {
+        std::memcpy(m_Buffer.data() + _at, _field.m_Struct, _field.m_Size);
+      } else {
+        std::memcpy(m_Buffer.data() + _at, &_field.m_Scalar, _field.m_Size);
+      }
+    }
+    return { _table, _slots };
+  }
+
+  /**
+   * @brief Appends a vector of scalars or structs
+   *
+   * @param p_Data Elements
+   * @param p_Count Amount of elements
+   * @param p_Size Size of an element
+   * @param p_Align Alignment of an element
+   */
+  std::size_t vector(const void* p_Data,
+                     std::size_t p_Count,
+                     std::size_t p_Size,
+                     std::size_t p_Align)
+  {
+    const std::size_t _align = std::max<std::size_t>(p_Align, 4);
+    while ((m_Buffer.size() + 4) % _align != 0) {
+      m_Buffer.push_back(std::byte{ 0 });
+    }
+    const std::size_t _retval = m_Buffer.size();
+    m_Buffer.resize(_retval + 4 + p_Count * p_Size);
+    put<std::uint32_t>(_retval, static_cast<std::uint32_t>(p_Count));
+    if (p_Count) {
+      std::memcpy(m_Buffer.data() + _retval + 4, p_Data, p_Count * p_Size);
+    }
+    return _retval;
+  }
+
+  /**
+   * @brief Appends a vector of offsets
+   *
+   * @return Position of the vector and the slots of its elements
+   */
+  std::pair<std::size_t, std::vector<std::size_t>> offsets(std::size_t p_Count)
+  {
+    align(4);
+    const std::size_t _retval = m_Buffer.size();
+    m_Buffer.resize(_retval + 4 + 4 * p_Count);
+    put<std::uint32_t>(_retval, static_cast<std::uint32_t>(p_Count));
+    std::vector<std::size_t> _slots(p_Count);
+    for (std::size_t i = 0; i < p_Count; ++i) {
+      _slots[i] = _retval + 4 + 4 * i;
+    }
+    return { _retval, _slots };
+  }
+
+  std::size_t string(std::string_view p_Text)
+  {
+    align(4);
+    const std::size_t _retval = m_Buffer.size();
+    m_Buffer.resize(_retval + 4 + p_Text.size() + 1);
+    put<std::uint32_t>(_retval, static_cast<std::uint32_t>(p_Text.size()));
+    std::memcpy(m_Buffer.data() + _retval + 4, p_Text.data(), p_Text.size());
+    return _retval;
+  }
+
+  /**
+   * @brief Points an offset slot at a later object
+   */
+  void patch(std::size_t p_Slot, std::size_t p_Target)
+  {
+    put<std::uint32_t>(p_Slot, static_cast<std::uint32_t>(p_Target - p_Slot));
+  }
+
+  std::vector<std::byte>& buffer() noexcept { return m_Buffer; }
+
+private:
+  void align(std::size_t p_Align)
+  {
+    while (m_Buffer.size() % p_Align != 0) {
+      m_Buffer.push_back(std::byte{ 0 });
+    }
+  }
+
+  template<typename U>
+  void put(std::size_t p_Pos, U p_Value)
+  {
+    std::memcpy(m_Buffer.data() + p_Pos, &p_Value, sizeof(U));
+  }
+
+  std::vector<std::byte> m_Buffer;
+};
+
+/**
+ * @brief Bounds-checked flatbuffers decoder
+ */
+class FlatReader
+{
+public:
+  explicit FlatReader(std::span<const std::byte> p_Buffer) noexcept
+    : m_Buffer(p_Buffer)
+  {
+  }
+
+  template<typename U>
+  U read(std::size_t p_Pos) const
+  {
+    if (p_Pos + sizeof(U) > m_Buffer.size() || p_Pos + sizeof(U) < p_Pos) {
+      throw std::runtime_error("Malformed Arrow metadata");
+    }
+    U _retval;
+    std::memcpy(&_retval, m_Buffer.data() + p_Pos, sizeof(U));
+    return _retval;
+  }
+
+  std::size_t deref(std::size_t p_Pos) const { return p_Pos + read<std::uint32_t>(p_Pos); }
+
+  std::size_t root() const { return deref(0); }
+
+  /**
+   * @brief Position of a table's field, 0 when absent
+   */
+  std::size_t field(std::size_t p_Table, std::uint16_t p_Id) const
+  {
+    const std::size_t _vtable =
+      static_cast<std::size_t>(static_cast<std::ptrdiff_t>(p_Table) -
+                               read<std::int32_t>(p_Table));
+    const std::size_t _entry = 4 + 2 * std::size_t{ p_Id };
+    if (_entry + 2 > read<std::uint16_t>(_vtable)) {
+      return 0;
+    }
+    const std::uint16_t _offset = read<std::uint16_t>(_vtable + _entry);
+    return _offset ? p_Table + _offset : 0;
+  }
+
+  template<typename U>
+  U scalar(std::size_t p_Table, std::uint16_t p_Id, U p_Default = U{}) const
+  {
+    const std::size_t _field = field(p_Table, p_Id);
+    return _field ? read<U>(_field) : p_Default;
+  }
+
+  /**
+   * @brief Table, vector or string referenced by a field, 0 when absent
+   */
+  std::size_t child(std::size_t p_Table, std::uint16_t p_Id) const
+  {
+    const std::size_t _field = field(p_Table, p_Id);
+    return _field ? deref(_field) : 0;
+  }
+
+  std::size_t length(std::size_t p_Vector) const { return read<std::uint32_t>(p_Vector); }
+
+  std::string_view string(std::size_t p_String) const
+  {
+    const std::size_t _length = length(p_String);
+    if (p_String + 4 + _length > m_Buffer.size()) {
+      throw std::runtime_error("Malformed Arrow metadata");
+    }
+    return std::string_view(reinterpret_cast<const char*>(m_Buffer.data()) + p_String + 4,
+                            _length);
+  }
+
+private:
+  std::span<const std::byte> m_Buffer;
+};
+
+inline constexpr std::size_t k_ArrowAlignment = 64;
+inline constexpr std::int16_t k_ArrowMetadataV5 = 4;
+inline constexpr std::uint8_t k_ArrowHeaderSchema = 1;
+inline constexpr std::uint8_t k_ArrowHeaderRecordBatch = 3;
+inline constexpr std::uint8_t k_ArrowHeaderTensor = 4;
+inline constexpr std::uint8_t k_ArrowTypeInt = 2;
+inline constexpr std::uint8_t k_ArrowTypeFloatingPoint = 3;
+inline constexpr std::uint8_t k_ArrowTypeFixedSizeList = 16;
+inline constexpr std::string_view k_ArrowShapeKey = "TenSore:shape";
+
+struct ArrowBuffer
+{
+  std::int64_t m_Offset;
+  std::int64_t m_Length;
+};
+
+/**
+ * @brief Arrow type union tag of an element type
+ */
+template<typename T>
+constexpr std::uint8_t
+arrow_type_id() noexcept
+{
+  static_assert((std::is_integral_v<T> && !std::is_same_v<T, bool>) ||
+                  std::is_same_v<T, float> || std::is_same_v<T, double>,
+                "Type has no Arrow tensor equivalent");
+  return std::is_integral_v<T> ? k_ArrowTypeInt : k_ArrowTypeFloatingPoint;
+}
+
+/**
+ * @brief Writes the Int or FloatingPoint table of an element type
+ */
+template<typename T>
+std::size_t
+write_arrow_type(FlatBuilder& p_Builder)
+{
+  if constexpr (std::is_integral_v<T>) {
+    return p_Builder
+      .table({ FlatBuilder::scalar(0, 4, sizeof(T) * 8),
+               FlatBuilder::scalar(1, 1, std::is_signed_v<T>) })
+      .first;
+  } else {
+    return p_Builder.table({ FlatBuilder::scalar(0, 2, sizeof(T) == 4 ? 1 : 2) }).first;
+  }
+}
+
+template<typename T>
+void
+check_arrow_type(const FlatReader& p_Reader, std::uint8_t p_TypeId, std::size_t p_Type)
+{
+  bool _ok = p_TypeId == arrow_type_id<T>() && p_Type != 0;
+  if (_ok && p_TypeId == k_ArrowTypeInt) {
+    _ok = p_Reader.scalar<std::int32_t>(p_Type, 0) == static_cast<std::int32_t>(sizeof(T) * 8) &&
+          p_Reader.scalar<std::uint8_t>(p_Type, 1) == std::is_signed_v<T>;
+  } else if (_ok) {
+    _ok = p_Reader.scalar<std::int16_t>(p_Type, 0) == (sizeof(T) == 4 ? 1 : 2);
+  }
+  if (!_ok) {
+    throw std::invalid_argument("Arrow data holds another element type");
+  }
+}
+
+/**
+ * @brief Message root table with its header slot, header type and body size
+ */
+inline std::size_t
+write_arrow_message(FlatBuilder& p_Builder, std::uint8_t p_Header, std::int64_t p_BodyLength)
+{
+  const auto [_message, _slots] =
+    p_Builder.table({ FlatBuilder::scalar(0, 2, k_ArrowMetadataV5),
+                      FlatBuilder::scalar(1, 1, p_Header),
+                      FlatBuilder::offset(2),
+                      FlatBuilder::scalar(3, 8, static_cast<std::uint64_t>(p_BodyLength)) });
+  p_Builder.patch(FlatBuilder::root(), _message);
+  return _slots[0];
+}
+
+inline std::size_t
+padded(std::size_t p_Size) noexcept
+{
+  return (p_Size + k_ArrowAlignment - 1) / k_ArrowAlignment * k_ArrowAlignment;
+}
+
+/**
+ * @brief Sequential writer of encapsulated IPC messages
+ */
+class ArrowWriter
+{
+public:
+  explicit ArrowWriter(const std::string& p_Path)
+    : m_Fd(::open(p_Path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+  {
+    if (m_Fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "open");
+    }
+  }
+
+  ArrowWriter(const ArrowWriter&) = delete;
+  ArrowWriter& operator=(const ArrowWriter&) = delete;
+
+  ~ArrowWriter()
+  {
+    if (m_Fd >= 0) {
+      ::close(m_Fd);
+    }
+  }
+
+  /**
+   * @brief Writes continuation marker, metadata and body
+   *
+   * @details
+   * The metadata is padded so that the body starts 64-byte aligned, and
+   * the body is padded to a multiple of 64 bytes.
+   */
+  void message(std::vector<std::byte> p_Metadata, std::span<const std::byte> p_Body)
+  {
+    p_Metadata.resize(padded(p_Metadata.size() + 8) - 8);
+    const std::int32_t _prefix[2] = { -1, static_cast<std::int32_t>(p_Metadata.size()) };
+    write(_prefix, sizeof(_prefix));
+    write(p_Metadata.data(), p_Metadata.size());
+    write(p_Body.data(), p_Body.size());
+    static constexpr std::byte k_Zeros[k_ArrowAlignment] = {};
+    write(k_Zeros, padded(p_Body.size()) - p_Body.size());
+  }
+
+  /**
+   * @brief Writes the end-of-stream marker and closes the file
+   */
+  void close()
+  {
+    const std::int32_t _eos[2] = { -1, 0 };
+    write(_eos, sizeof(_eos));
+    const int _fd = std::exchange(m_Fd, -1);
+    if (::close(_fd) != 0) {
+      throw std::system_error(errno, std::generic_category(), "close");
+    }
+  }
+
+private:
+  void write(const void* p_Data, std::size_t p_Bytes)
+  {
+    const auto* _data = static_cast<const char*>(p_Data);
+    for (std::size_t _done = 0; _done < p_Bytes;) {
+      const ssize_t _n = ::write(m_Fd, _data + _done, p_Bytes - _done);
+      if (_n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (_n < 0) {
+        throw std::system_error(errno, std::generic_category(), "write");
+      }
+      _done += static_cast<std::size_t>(_n);
+    }
+  }
+
+  int m_Fd;
+};
+
+/**
+ * @brief Encapsulated message located in a mapped file
+ */
+struct ArrowMessage
+{
+  std::span<const std::byte> m_Metadata;
+  std::span<const std::byte> m_Body;
+  std::size_t m_Header;
+  std::uint8_t m_HeaderType;
+};
+
+/**
+ * @brief Parses the message at a position, advancing past it
+ *
+ * @details
+ * Accepts the legacy framing without continuation marker as well.
+ */
+inline ArrowMessage
+next_arrow_message(std::span<const std::byte> p_File, std::size_t& p_Pos)
+{
+  auto _int32 = [&](std::size_t p_At) {
+    if (p_At + 4 > p_File.size()) {
+      throw std::runtime_error("Truncated Arrow message");
+    }
+    std::int32_t _retval;
+    std::memcpy(&_retval, p_File.data() + p_At, 4);
+    return _retval;
+  };
+  std::int32_t _length = _int32(p_Pos);
+  p_Pos += 4;
+  if (_length == -1) {
+    _length = _int32(p_Pos);
+    p_Pos += 4;
+  }
+  if (_length <= 0 || p_Pos + static_cast<std::size_t>(_length) > p_File.size()) {
+    throw std::runtime_error("Truncated Arrow message");
+  }
+  ArrowMessage _retval;
+  _retval.m_Metadata = p_File.subspan(p_Pos, static_cast<std::size_t>(_length));
+  p_Pos += static_cast<std::size_t>(_length);
+  const FlatReader _reader(_retval.m_Metadata);
+  const std::size_t _message = _reader.root();
+  if (_reader.scalar<std::int16_t>(_message, 0) < k_ArrowMetadataV5) {
+    throw std::runtime_error("Unsupported Arrow metadata version");
+  }
+  _retval.m_HeaderType = _reader.scalar<std::uint8_t>(_message, 1);
+  _retval.m_Header = _reader.child(_message, 2);
+  const auto _body = _reader.scalar<std::int64_t>(_message, 3);
+  if (_body < 0 || p_Pos + static_cast<std::size_t>(_body) > p_File.size() || !_retval.m_Header) {
+    throw std::runtime_error("Truncated Arrow message");
+  }
+  _retval.m_Body = p_File.subspan(p_Pos, static_cast<std::size_t>(_body));
+  p_Pos += static_cast<std::size_t>(_body);
+  return _retval;
+}
+
+template<typename T>
+const T*
+arrow_buffer(const ArrowMessage& p_Message, const ArrowBuffer& p_Buffer, std::size_t p_Elements)
+{
+  if (p_Buffer.m_Offset < 0 || p_Buffer.m_Length < 0 ||
+      static_cast<std::size_t>(p_Buffer.m_Offset + p_Buffer.m_Length) > p_Message.m_Body.size() ||
+      static_cast<std::size_t>(p_Buffer.m_Length) < p_Elements * sizeof(T)) {
+    throw std::runtime_error("Arrow buffer out of bounds");
+  }
+  const std::byte* _data = p_Message.m_Body.data() + p_Buffer.m_Offset;
+  if (reinterpret_cast<std::uintptr_t>(_data) % alignof(T) != 0) {
+    throw std::runtime_error("Arrow buffer is misaligned");
+  }
+  return reinterpret_cast<const T*>(_data);
+}
+
+}
+
+/**
+ * @class ArrowView
+ * @brief Read-only view of a tensor inside a mapped Arrow file
+ *
+ * @tparam T The type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * Copies share the mapping, which is released with the last of them.
+ */
+template<typename T, std::size_t Rank>
+class ArrowView
+{
+public:
+  ArrowView() = delete;
+
+  ArrowView(std::shared_ptr<const detail::MappedFile> p_File, TensorView<const T, Rank> p_View)
+    : m_File(std::move(p_File))
+    , m_View(p_View)
+  {
+  }
+
+  const TensorView<const T, Rank>& view() const noexcept { return m_View; }
+
+  operator TensorView<const T, Rank>() const noexcept { return m_View; }
+
+  std::size_t size() const noexcept { return m_View.size(); }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_View.dimensions();
+  }
+
+  const T& at(const std::array<std::size_t, Rank>& p_Dims) const { return m_View.at(p_Dims); }
+
+  const T& operator()(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return m_View(p_Dims);
+  }
+
+  /**
+   * @brief Copies the elements into an ordinary tensor
+   */
+  Tensor<T, Rank> to_tensor() const
+  {
+    std::array<std::size_t, Rank> _dims = m_View.dimensions();
+    Tensor<T, Rank> _retval(std::move(_dims));
+    copy_view(m_View, TensorView<T, Rank>(_retval));
+    return _retval;
+  }
+
+private:
+  std::shared_ptr<const detail::MappedFile> m_File;
+  TensorView<const T, Rank> m_View;
+};
+
+/**
+ * @brief Writes a tensor as an Arrow IPC Tensor message
+ *
+ * @param p_Path File to write, replaced if it exists
+ * @param p_Tensor Tensor to write
+ *
+ * @details
+ * The message carries the dimensions as shape and Tensor's
+ * first-dimension-fastest layout as byte strides, so coordinates agree
+ * with Arrow's; the body is the tensor's storage, written as is.
+ */
+template<typename T, std::size_t Rank, Allocator A>
+void
+write_arrow_tensor(const std::string& p_Path, const Tensor<T, Rank, A>& p_Tensor)
+{
+  using namespace detail;
+  const std::size_t _bytes = p_Tensor.size() * sizeof(T);
+  FlatBuilder _builder;
+  const std::size_t _header_slot =
+    write_arrow_message(_builder, k_ArrowHeaderTensor, static_cast<std::int64_t>(padded(_bytes)));
+  const ArrowBuffer _data{ 0, static_cast<std::int64_t>(_bytes) };
+  const auto [_tensor, _slots] =
+    _builder.table({ FlatBuilder::scalar(0, 1, arrow_type_id<T>()),
+                     FlatBuilder::offset(1),
+                     FlatBuilder::offset(2),
+                     FlatBuilder::offset(3),
+                     FlatBuilder::structure(4, &_data, sizeof(_data)) });
+  _builder.patch(_header_slot, _tensor);
+  _builder.patch(_slots[0], write_arrow_type<T>(_builder));
+  const auto [_shape, _dims] = _builder.offsets(Rank);
+  _builder.patch(_slots[1], _shape);
+  for (std::size_t i = 0; i < Rank; ++i) {
+    const auto [_dim, _] = _builder.table({ FlatBuilder::scalar(0, 8, p_Tensor.dimensions()[i]) });
+    _builder.patch(_dims[i], _dim);
+  }
+  std::array<std::int64_t, Rank> _strides;
+  const auto _elements = dense_strides(p_Tensor.dimensions());
+  for (std::size_t i = 0; i < Rank; ++i) {
+    _strides[i] = static_cast<std::int64_t>(_elements[i] * sizeof(T));
+  }
+  _builder.patch(_slots[2], _builder.vector(_strides.data(), Rank, 8, 8));
+
+  ArrowWriter _writer(p_Path);
+  _writer.message(std::move(_builder.buffer()),
+                  std::as_bytes(std::span(p_Tensor.storage(), p_Tensor.size())));
+  _writer.close();
+}
+
+/**
+ * @brief Maps a file holding an Arrow IPC Tensor message
+ *
+ * @param p_Path File to map
+ *
+ * @return View of the tensor in the mapping, without copying
+ *
+ * @details
+ * Accepts any strides that are multiples of the element size, so tensors
+ * written row-major by other Arrow implementations are viewed in place.
+ * Throws std::invalid_argument if the element type or rank differ.
+ */
+template<typename T, std::size_t Rank>
+ArrowView<T, Rank>
+read_arrow_tensor(const std::string& p_Path)
+{
+  using namespace detail;
+  auto _file = std::make_shared<const MappedFile>(p_Path);
+  const auto _bytes = std::as_bytes(std::span(_file->text()));
+  std::size_t _pos = 0;
+  const ArrowMessage _message = next_arrow_message(_bytes, _pos);
+  if (_message.m_HeaderType != k_ArrowHeaderTensor) {
+    throw std::runtime_error("Not an Arrow tensor message");
+  }
+  const FlatReader _reader(_message.m_Metadata);
+  const std::size_t _tensor = _message.m_Header;
+  check_arrow_type<T>(_reader, _reader.scalar<std::uint8_t>(_tensor, 0), _reader.child(_tensor, 1));
+
+  const std::size_t _shape = _reader.child(_tensor, 2);
+  if (!_shape || _reader.length(_shape) != Rank) {
+    throw std::invalid_argument("Arrow tensor has another rank");
+  }
+  std::array<std::size_t, Rank> _dims;
+  std::size_t _size = 1;
+  for (std::size_t i = 0; i < Rank; ++i) {
+    const auto _dim = _reader.scalar<std::int64_t>(_reader.deref(_shape + 4 + 4 * i), 0);
+    if (_dim < 0) {
+      throw std::runtime_error("Malformed Arrow metadata");
+    }
+    _dims[i] = static_cast<std::size_t>(_dim);
+    _size *= _dims[i];
+  }
+  std::array<std::ptrdiff_t, Rank> _strides;
+  const std::size_t _stride_vector = _reader.child(_tensor, 3);
+  std::size_t _extent = _size ? 1 : 0;
+  if (_stride_vector) {
+    if (_reader.length(_stride_vector) != Rank) {
+      throw std::runtime_error("Malformed Arrow metadata");
+    }
+    for (std::size_t i = 0; i < Rank; ++i) {
+      const auto _stride = _reader.read<std::int64_t>(_stride_vector + 4 + 8 * i);
+      if (_stride < 0 || _stride % static_cast<std::int64_t>(sizeof(T)) != 0) {
+        throw std::runtime_error("Unsupported Arrow tensor strides");
+      }
+      _strides[i] = static_cast<std::ptrdiff_t>(_stride / static_cast<std::int64_t>(sizeof(T)));
+      if (_dims[i] && _size) {
+        _extent += (_dims[i] - 1) * static_cast<std::size_t>(_strides[i]);
+      }
+    }
+  } else {
+    std::ptrdiff_t _step = 1;
+    for (std::size_t i = Rank; i-- > 0;) {
+      _strides[i] = _step;
+      _step *= static_cast<std::ptrdiff_t>(_dims[i]);
+    }
+    _extent = _size;
+  }
+  const std::size_t _data = _reader.field(_tensor, 4);
+  if (!_data) {
+    throw std::runtime_error("Malformed Arrow metadata");
+  }
+  const ArrowBuffer _buffer{ _reader.read<std::int64_t>(_data),
+                             _reader.read<std::int64_t>(_data + 8) };
+  const T* _elements = arrow_buffer<T>(_message, _buffer, _extent);
+  return ArrowView<T, Rank>(std::move(_file),
+                            TensorView<const T, Rank>(_elements, _dims, _strides));
+}
+
+/**
+ * @brief Writes a tensor as an Arrow IPC stream of one FixedSizeList column
+ *
+ * @param p_Path File to write, replaced if it exists
+ * @param p_Tensor Tensor to write
+ * @param p_Column Name of the column
+ *
+ * @details
+ * Record i is the hyperplane i along the outermost dimension, a list of
+ * the `size() / dimensions()[Rank - 1]` elements that are contiguous in
+ * storage, so the column's values buffer is the tensor's storage as is.
+ * The full dimensions are kept in the field's metadata under
+ * "TenSore:shape". The stream holds a Schema message, one RecordBatch
+ * message and the end-of-stream marker.
+ */
+template<typename T, std::size_t Rank, Allocator A>
+void
+write_arrow_stream(const std::string& p_Path,
+                   const Tensor<T, Rank, A>& p_Tensor,
+                   std::string_view p_Column = "tensor")
+{
+  using namespace detail;
+  const std::size_t _records = p_Tensor.dimensions()[Rank - 1];
+  const std::size_t _list = _records ? p_Tensor.size() / _records : 0;
+  std::string _shape;
+  for (std::size_t i = 0; i < Rank; ++i) {
+    _shape += (i ? "," : "") + std::to_string(p_Tensor.dimensions()[i]);
+  }
+
+  ArrowWriter _writer(p_Path);
+  {
+    FlatBuilder _builder;
+    const std::size_t _header = write_arrow_message(_builder, k_ArrowHeaderSchema, 0);
+    const auto [_schema, _schema_slots] =
+      _builder.table({ FlatBuilder::scalar(0, 2, 0), FlatBuilder::offset(1) });
+    _builder.patch(_header, _schema);
+    const auto [_fields, _field_slots] = _builder.offsets(1);
+    _builder.patch(_schema_slots[0], _fields);
+    const auto [_field, _slots] =
+      _builder.table({ FlatBuilder::offset(0),
+                       FlatBuilder::scalar(1, 1, 0),
+                       FlatBuilder::scalar(2, 1, k_ArrowTypeFixedSizeList),
+                       FlatBuilder::offset(3),
+                       FlatBuilder::offset(5),
+                       FlatBuilder::offset(6) });
+    _builder.patch(_field_slots[0], _field);
+    _builder.patch(_slots[0], _builder.string(p_Column));
+    _builder.patch(_slots[1], _builder.table({ FlatBuilder::scalar(0, 4, _list) }).first);
+    const auto [_children, _child_slots] = _builder.offsets(1);
+    _builder.patch(_slots[2], _children);
+    const auto [_metadata, _metadata_slots] = _builder.offsets(1);
+    _builder.patch(_slots[3], _metadata);
+
+    const auto [_item, _item_slots] =
+      _builder.table({ FlatBuilder::offset(0),
+                       FlatBuilder::scalar(1, 1, 0),
+                       FlatBuilder::scalar(2, 1, arrow_type_id<T>()),
+                       FlatBuilder::offset(3),
+                       FlatBuilder::offset(5) });
+    _builder.patch(_child_slots[0], _item);
+    _builder.patch(_item_slots[0], _builder.string("item"));
+    _builder.patch(_item_slots[1], write_arrow_type<T>(_builder));
+    _builder.patch(_item_slots[2], _builder.offsets(0).first);
+
+    const auto [_pair, _pair_slots] =
+      _builder.table({ FlatBuilder::offset(0), FlatBuilder::offset(1) });
+    _builder.patch(_metadata_slots[0], _pair);
+    _builder.patch(_pair_slots[0], _builder.string(k_ArrowShapeKey));
+    _builder.patch(_pair_slots[1], _builder.string(_shape));
+    _writer.message(std::move(_builder.buffer()), {});
+  }
+  {
+    const std::size_t _bytes = p_Tensor.size() * sizeof(T);
+    FlatBuilder _builder;
+    const std::size_t _header = write_arrow_message(
+      _builder, k_ArrowHeaderRecordBatch, static_cast<std::int64_t>(padded(_bytes)));
+    const auto [_batch, _slots] = _builder.table(
+      { FlatBuilder::scalar(0, 8, _records), FlatBuilder::offset(1), FlatBuilder::offset(2) });
+    _builder.patch(_header, _batch);
+    const std::int64_t _nodes[4] = { static_cast<std::int64_t>(_records), 0,
+                                     static_cast<std::int64_t>(p_Tensor.size()), 0 };
+    _builder.patch(_slots[0], _builder.vector(_nodes, 2, 16, 8));
+    const ArrowBuffer _buffers[3] = {
+      { 0, 0 }, { 0, 0 }, { 0, static_cast<std::int64_t>(_bytes) }
+    };
+    _builder.patch(_slots[1], _builder.vector(_buffers, 3, 16, 8));
+    _writer.message(std::move(_builder.buffer()),
+                    std::as_bytes(std::span(p_Tensor.storage(), p_Tensor.size())));
+  }
+  _writer.close();
+}
+
+/**
+ * @brief Maps an Arrow IPC stream written by write_arrow_stream()
+ *
+ * @param p_Path File to map
+ *
+ * @return View of the tensor in the mapping, without copying
+ *
+ * @details
+ * Reads the first record batch of a single non-nullable FixedSizeList
+ * column. Without "TenSore:shape" metadata, a rank 2 tensor of
+ * (list size, records) is assumed. Throws std::invalid_argument if the
+ * element type or rank differ.
+ */
+template<typename T, std::size_t Rank>
+ArrowView<T, Rank>
+read_arrow_stream(const std::string& p_Path)
+{
+  using namespace detail;
+  auto _file = std::make_shared<const MappedFile>(p_Path);
+  const auto _bytes = std::as_bytes(std::span(_file->text()));
+  std::size_t _pos = 0;
+
+  const ArrowMessage _schema = next_arrow_message(_bytes, _pos);
+  if (_schema.m_HeaderType != k_ArrowHeaderSchema) {
+    throw std::runtime_error("Arrow stream does not start with a schema");
+  }
+  const FlatReader _reader(_schema.m_Metadata);
+  const std::size_t _fields = _reader.child(_schema.m_Header, 1);
+  if (!_fields || _reader.length(_fields) != 1) {
+    throw std::invalid_argument("Arrow stream must hold exactly one column");
+  }
+  const std::size_t _field = _reader.deref(_fields + 4);
+  const std::size_t _list_type = _reader.child(_field, 3);
+  const std::size_t _children = _reader.child(_field, 5);
+  if (_reader.scalar<std::uint8_t>(_field, 2) != k_ArrowTypeFixedSizeList || !_list_type ||
+      !_children || _reader.length(_children) != 1) {
+    throw std::invalid_argument("Arrow column is not a fixed-size list");
+  }
+  const std::size_t _item = _reader.deref(_children + 4);
+  check_arrow_type<T>(_reader, _reader.scalar<std::uint8_t>(_item, 2), _reader.child(_item, 3));
+  const auto _list = static_cast<std::size_t>(_reader.scalar<std::int32_t>(_list_type, 0));
+
+  std::array<std::size_t, Rank> _dims{};
+  bool _shaped = false;
+  if (const std::size_t _metadata = _reader.child(_field, 6)) {
+    for (std::size_t i = 0; i < _reader.length(_metadata); ++i) {
+      const std::size_t _pair = _reader.deref(_metadata + 4 + 4 * i);
+      if (_reader.string(_reader.child(_pair, 0)) != k_ArrowShapeKey) {
+        continue;
+      }
+      const std::string_view _text = _reader.string(_reader.child(_pair, 1));
+      const char* _it = _text.data();
+      const char* const _end = _it + _text.size();
+      std::size_t _count = 0;
+      while (_it < _end) {
+        std::size_t _value;
+        const auto _result = std::from_chars(_it, _end, _value);
+        if (_result.ec != std::errc() || _count == Rank) {
+          throw std::invalid_argument("Arrow tensor has another rank");
+        }
+        _dims[_count++] = _value;
+        _it = _result.ptr + 1;
+      }
+      if (_count != Rank) {
+        throw std::invalid_argument("Arrow tensor has another rank");
+      }
+      _shaped = true;
+    }
+  }
+
+  const ArrowMessage _message = next_arrow_message(_bytes, _pos);
+  if (_message.m_HeaderType != k_ArrowHeaderRecordBatch) {
+    throw std::runtime_error("Arrow stream holds no record batch");
+  }
+  const FlatReader _batch_reader(_message.m_Metadata);
+  const std::size_t _batch = _message.m_Header;
+  const auto _records = static_cast<std::size_t>(_batch_reader.scalar<std::int64_t>(_batch, 0));
+  if (_batch_reader.field(_batch, 3)) {
+    throw std::runtime_error("Compressed Arrow record batches are not supported");
+  }
+  const std::size_t _nodes = _batch_reader.child(_batch, 1);
+  const std::size_t _buffers = _batch_reader.child(_batch, 2);
+  if (!_nodes || !_buffers || _batch_reader.length(_nodes) != 2 ||
+      _batch_reader.length(_buffers) != 3) {
+    throw std::runtime_error("Malformed Arrow record batch");
+  }
+  for (std::size_t i = 0; i < 2; ++i) {
+    if (_batch_reader.read<std::int64_t>(_nodes + 4 + 16 * i + 8) != 0) {
+      throw std::runtime_error("Arrow column holds nulls");
+    }
+  }
+  if (!_shaped) {
+    if constexpr (Rank == 2) {
+      _dims = { _list, _records };
+    } else {
+      throw std::invalid_argument("Arrow stream lacks the tensor's dimensions");
+    }
+  }
+  std::size_t _size = 1;
+  for (const auto& it : _dims) {
+    _size *= it;
+  }
+  if (_dims[Rank - 1] != _records || _size != _records * _list) {
+    throw std::runtime_error("Arrow tensor dimensions do not match the column");
+  }
+  const ArrowBuffer _values{ _batch_reader.read<std::int64_t>(_buffers + 4 + 32),
+                             _batch_reader.read<std::int64_t>(_buffers + 4 + 40) };
+  const T* _elements = arrow_buffer<T>(_message, _values, _size);
+  return ArrowView<T, Rank>(std::move(_file),
+                            TensorView<const T, Rank>(_elements, _dims, dense_strides(_dims)));
+}
+
+}
@@ -0,0 +1,783 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Tensor.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @brief Operations recordable on a Tape
+ */
+enum class TapeOp : std::uint8_t
+{
+  Leaf,
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Neg,
+  Exp,
+  Log,
+  Tanh,
+  Relu,
+  Sum,
+  MatMul,
+  Transpose,
+  Reshape,
+  Checkpoint
+};
+
+/**
+ * @class Tape
+ * @brief Tape of operations for reverse-mode automatic differentiation
+ *
+ * @tparam T The type of value, a floating point type
+ *
+ * @details
+ * Operations on Tape::Var compute their value eagerly and append a node to
+ * the tape; backward() walks the tape in reverse and accumulates gradients
+ * into a buffer allocated next to every node's value. Shapes are dynamic so
+ * that reductions and reshapes may change rank; dimension 0 is the fastest
+ * one, matching Tensor's layout, and matrices are indexed (row, column).
+ *
+ * Element-wise operations broadcast operands of different shapes: the
+ * shorter shape is padded with unit outer dimensions and unit dimensions
+ * are stretched. Broadcast gradients are summed back into the operand.
+ *
+ * reset() rewinds the tape without releasing node storage: recording the
+ * same sequence of operations again reuses the value and gradient buffers,
+ * so a training loop allocates only on its first iteration. checkpoint()
+ * records a segment without keeping its intermediates and recomputes them
+ * during backward().
+ */
+template<typename T>
+class Tape
+{
+public:
+  using Shape = std::vector<std::size_t>;
+
+  /**
+   * @brief Handle of a value recorded on a tape
+   */
+  class Var
+  {
+  public:
+    Var() = delete;
+
+    std::size_t id() const noexcept { return m_Id; }
+
+    Tape& tape() const noexcept { return *m_Tape; }
+
+    const Shape& shape() const { return m_Tape->node(m_Id).m_Shape; }
+
+    std::span<const T> value() const { return m_Tape->node(m_Id).m_Value; }
+
+    std::span<const T> grad() const { return m_Tape->node(m_Id).m_Grad; }
+
+    /**
+     * @brief Value as a tensor of a given rank
+     */
+    template<std::size_t Rank>
+    Tensor<T, Rank> to_tensor() const
+    {
+      return m_Tape->template export_buffer<Rank>(m_Id, false);
+    }
+
+    /**
+     * @brief Gradient as a tensor of a given rank
+     */
+    template<std::size_t Rank>
+    Tensor<T, Rank> grad_tensor() const
+    {
+      return m_Tape->template export_buffer<Rank>(m_Id, true);
+    }
+
+    friend Var operator+(Var a, Var b) { return record_binary(TapeOp::Add, a, b); }
+    friend Var operator-(Var a, Var b) { return record_binary(TapeOp::Sub, a, b); }
+    friend Var operator*(Var a, Var b) { return record_binary(TapeOp::Mul, a, b); }
+    friend Var operator/(Var a, Var b) { return record_binary(TapeOp::Div, a, b); }
+    friend Var operator+(Var a, T b) { return a + a.m_Tape->scalar(b); }
+    friend Var operator-(Var a, T b) { return a - a.m_Tape->scalar(b); }
+    friend Var operator*(Var a, T b) { return a * a.m_Tape->scalar(b); }
+    friend Var operator/(Var a, T b) { return a / a.m_Tape->scalar(b); }
+    friend Var operator+(T a, Var b) { return b.m_Tape->scalar(a) + b; }
+    friend Var operator-(T a, Var b) { return b.m_Tape->scalar(a) - b; }
+    friend Var operator*(T a, Var b) { return b.m_Tape->scalar(a) * b; }
+    friend Var operator/(T a, Var b) { return b.m_Tape->scalar(a) / b; }
+    friend Var operator-(Var a) { return record_unary(TapeOp::Neg, a); }
+    friend Var exp(Var a) { return record_unary(TapeOp::Exp, a); }
+    friend Var log(Var a) { return record_unary(TapeOp::Log, a); }
+    friend Var tanh(Var a) { return record_unary(TapeOp::Tanh, a); }
+    friend Var relu(Var a) { return record_unary(TapeOp::Relu, a); }
+
+    /**
+     * @brief Sum of all elements, a single-element value
+     */
+    friend Var sum(Var a) { return record_reduce(a, false); }
+
+    /**
+     * @brief Sum along an axis, which is removed from the shape
+     */
+    friend Var sum(Var a, std::size_t p_Axis)
+    {
+      return record_reduce(a, p_Axis, false);
+    }
+
+    /**
+     * @brief Mean of all elements, a single-element value
+     */
+    friend Var mean(Var a) { return record_reduce(a, true); }
+
+    /**
+     * @brief Mean along an axis, which is removed from the shape
+     */
+    friend Var mean(Var a, std::size_t p_Axis)
+    {
+      return record_reduce(a, p_Axis, true);
+    }
+
+    /**
+     * @brief Matrix product of (m, k) and (k, n) matrices
+     */
+    friend Var matmul(Var a, Var b) { return record_matmul(a, b); }
+
+    /**
+     * @brief Transpose of a matrix
+     */
+    friend Var transpose(Var a) { return record_transpose(a); }
+
+    /**
+     * @brief Same elements with another shape of equal size
+     */
+    friend Var reshape(Var a, Shape p_Shape)
+    {
+      return record_reshape(a, std::move(p_Shape));
+    }
+
+  private:
+    friend class Tape;
+
+    Var(Tape* p_Tape, std::size_t p_Id)
+      : m_Tape(p_Tape)
+      , m_Id(p_Id)
+    {
+    }
+
+    static Var record_binary(TapeOp p_Op, Var a, Var b)
+    {
+      return a.m_Tape->binary(p_Op, a, b);
+    }
+
+    static Var record_unary(TapeOp p_Op, Var a)
+    {
+      return a.m_Tape->unary(p_Op, a);
+    }
+
+    static Var record_reduce(Var a, std::size_t p_Axis, bool p_Mean)
+    {
+      return a.m_Tape->reduce(a, p_Axis, p_Mean);
+    }
+
+    static Var record_reduce(Var a, bool p_Mean)
+    {
+      return a.m_Tape->reduce(a, k_All, p_Mean);
+    }
+
+    static Var record_matmul(Var a, Var b) { return a.m_Tape->matmul(a, b); }
+
+    static Var record_transpose(Var a) { return a.m_Tape->transpose(a); }
+
+    static Var record_reshape(Var a, Shape p_Shape)
+    {
+      return a.m_Tape->reshape(a, std::move(p_Shape));
+    }
+
+    Tape* m_Tape;
+    std::size_t m_Id;
+  };
+
+  /**
+   * @brief Segment of operations recomputed by checkpoint()
+   */
+  using Segment = std::function<Var(Tape&, Var)>;
+
+  Tape() = default;
+  Tape(const Tape&) = delete;
+  Tape& operator=(const Tape&) = delete;
+
+  /**
+   * @brief Records a differentiable leaf with the values of a tensor
+   *
+   * @param p_Tensor Values of the leaf, copied onto the tape
+   */
+  template<std::size_t Rank, Allocator A>
+  Var variable(const Tensor<T, Rank, A>& p_Tensor)
+  {
+    const auto& _dims = p_Tensor.dimensions();
+    const std::size_t _id = emplace(TapeOp::Leaf, Shape(_dims.begin(), _dims.end()));
+    std::copy_n(p_Tensor.storage(), p_Tensor.size(), m_Nodes[_id].m_Value.data());
+    return Var(this, _id);
+  }
+
+  /**
+   * @brief Records a differentiable leaf from raw values
+   *
+   * @param p_Shape Shape of the leaf
+   * @param p_Values Values in storage order
+   */
+  Var variable(const Shape& p_Shape, std::span<const T> p_Values)
+  {
+    const std::size_t _id = emplace(TapeOp::Leaf, p_Shape);
+    if (p_Values.size() != m_Nodes[_id].m_Value.size()) {
+      throw std::invalid_argument("Amount of values does not match the shape");
+    }
+    std::copy(p_Values.begin(), p_Values.end(), m_Nodes[_id].m_Value.begin());
+    return Var(this, _id);
+  }
+
+  /**
+   * @brief Records a single-element constant
+   */
+  Var scalar(T p_Value)
+  {
+    const std::size_t _id = emplace(TapeOp::Leaf, Shape{ 1 });
+    m_Nodes[_id].m_Value[0] = p_Value;
+    return Var(this, _id);
+  }
+
+  /**
+   * @brief Records a segment whose intermediates are recomputed on backward()
+   *
+   * @param p_Segment Operations from one value to another, recorded by the
+   * segment on the tape it is given
+   * @param p_Input Input of the segment
+   *
+   * @return Output of the segment
+   */
+  Var checkpoint(Segment p_Segment, Var p_Input)
+  {
+    Tape _inner;
+    const Var _x = _inner.variable(p_Input.shape(), p_Input.value());
+    const Var _y = p_Segment(_inner, _x);
+    const std::size_t _id = emplace(TapeOp::Checkpoint, _y.shape(), p_Input.m_Id);
+    const auto _value = _y.value();
+    std::copy(_value.begin(), _value.end(), m_Nodes[_id].m_Value.begin());
+    m_Nodes[_id].m_Segment = std::move(p_Segment);
+    return Var(this, _id);
+  }
+
+  /**
+   * @brief Computes gradients of a single-element value
+   *
+   * @param p_Loss Value to differentiate
+   *
+   * @details
+   * Gradients of all recorded nodes are zeroed first.
+   */
+  void backward(Var p_Loss)
+  {
+    if (node(p_Loss.m_Id).m_Value.size() != 1) {
+      throw std::invalid_argument("Loss of backward() must have one element");
+    }
+    const T _seed = 1;
+    backward(p_Loss, std::span<const T>(&_seed, 1));
+  }
+
+  /**
+   * @brief Computes vector-Jacobian products for a seed gradient
+   *
+   * @param p_Output Value to differentiate
+   * @param p_Seed Gradient of the output, in storage order
+   */
+  void backward(Var p_Output, std::span<const T> p_Seed)
+  {
+    Node& _out = node(p_Output.m_Id);
+    if (p_Seed.size() != _out.m_Grad.size()) {
+      throw std::invalid_argument("Seed does not match the output shape");
+    }
+    for (std::size_t i = 0; i < m_Cursor; ++i) {
+      std::fill(m_Nodes[i].m_Grad.begin(), m_Nodes[i].m_Grad.end(), T{});
+    }
+    std::copy(p_Seed.begin(), p_Seed.end(), _out.m_Grad.begin());
+    for (std::size_t i = p_Output.m_Id + 1; i-- > 0;) {
+      propagate(i);
+    }
+  }
+
+  /**
+   * @brief Rewinds the tape, keeping node storage for the next recording
+   */
+  void reset() noexcept { m_Cursor = 0; }
+
+  /**
+   * @brief Amount of nodes recorded since the last reset()
+   */
+  std::size_t size() const noexcept { return m_Cursor; }
+
+private:
+  static constexpr std::size_t k_None = std::numeric_limits<std::size_t>::max();
+  static constexpr std::size_t k_All = std::numeric_limits<std::size_t>::max();
+
+  struct Node
+  {
+    TapeOp m_Op = TapeOp::Leaf;
+    Shape m_Shape;
+    std::vector<T> m_Value;
+    std::vector<T> m_Grad;
+    std::size_t m_Lhs = k_None;
+    std::size_t m_Rhs = k_None;
+    std::size_t m_Axis = k_All;
+    T m_Scale = 1;
+    Segment m_Segment;
+  };
+
+  Node& node(std::size_t p_Id)
+  {
+    if (p_Id >= m_Cursor) {
+      throw std::out_of_range("Variable is not recorded on the tape");
+    }
+    return m_Nodes[p_Id];
+  }
+
+  static std::size_t count(const Shape& p_Shape) noexcept
+  {
+    std::size_t _retval = 1;
+    for (const auto& it : p_Shape) {
+      _retval *= it;
+    }
+    return _retval;
+  }
+
+  std::size_t emplace(TapeOp p_Op,
+                      Shape p_Shape,
+                      std::size_t p_Lhs = k_None,
+                      std::size_t p_Rhs = k_None)
+  {
+    if (m_Cursor == m_Nodes.size()) {
+      m_Nodes.emplace_back();
+    }
+    Node& _node = m_Nodes[m_Cursor];
+    const std::size_t _size = count(p_Shape);
+    _node.m_Op = p_Op;
+    _node.m_Shape = std::move(p_Shape);
+    _node.m_Value.resize(_size);
+    _node.m_Grad.resize(_size);
+    _node.m_Lhs = p_Lhs;
+    _node.m_Rhs = p_Rhs;
+    _node.m_Axis = k_All;
+    _node.m_Scale = 1;
+    _node.m_Segment = nullptr;
+    return m_Cursor++;
+  }
+
+  template<std::size_t Rank>
+  Tensor<T, Rank> export_buffer(std::size_t p_Id, bool p_Grad)
+  {
+    const Node& _node = node(p_Id);
+    std::array<std::size_t, Rank> _dims;
+    _dims.fill(1);
+    if (_node.m_Shape.size() > Rank) {
+      throw std::invalid_argument("Value has a higher rank than requested");
+    }
+    std::copy(_node.m_Shape.begin(), _node.m_Shape.end(), _dims.begin());
+    Tensor<T, Rank> _retval(std::move(_dims));
+    const auto& _src = p_Grad ? _node.m_Grad : _node.m_Value;
+    std::copy(_src.begin(), _src.end(), _retval.storage());
+    return _retval;
+  }
+
+  /**
+   * @brief Visits output elements with offsets of both broadcast operands
+   */
+  template<typename F>
+  static void broadcast(const Shape& p_Out,
+                        const Shape& p_Lhs,
+                        const Shape& p_Rhs,
+                        F&& p_Fn)
+  {
+    const std::size_t _rank = p_Out.size();
+    std::vector<std::size_t> _coords(_rank, 0);
+    std::vector<std::ptrdiff_t> _sa(_rank, 0), _sb(_rank, 0);
+    std::ptrdiff_t _ma = 1, _mb = 1;
+    for (std::size_t d = 0; d < _rank; ++d) {
+      const std::size_t _da = d < p_Lhs.size() ? p_Lhs[d] : 1;
+      const std::size_t _db = d < p_Rhs.size() ? p_Rhs[d] : 1;
+      _sa[d] = _da == 1 ? 0 : _ma;
+      _sb[d] = _db == 1 ? 0 : _mb;
+      _ma *= static_cast<std::ptrdiff_t>(_da);
+      _mb *= static_cast<std::ptrdiff_t>(_db);
+    }
+    const std::size_t _size = count(p_Out);
+    std::ptrdiff_t _ia = 0, _ib = 0;
+    for (std::size_t i = 0; i < _size; ++i) {
+      p_Fn(i, static_cast<std::size_t>(_ia), static_cast<std::size_t>(_ib));
+      for (std::size_t d = 0; d < _rank; ++d) {
+        _ia += _sa[d];
+        _ib += _sb[d];
+        if (++_coords[d] < p_Out[d]) {
+          break;
+        }
+        _ia -= _sa[d] * static_cast<std::ptrdiff_t>(p_Out[d]);
+        _ib -= _sb[d] * static_cast<std::ptrdiff_t>(p_Out[d]);
+        _coords[d] = 0;
+      }
+    }
+  }
+
+  static Shape broadcast_shape(const Shape& a, const Shape& b)
+  {
+    Shape _retval(std::max(a.size(), b.size()), 1);
+    for (std::size_t d = 0; d < _retval.size(); ++d) {
+      const std::size_t _da = d < a.size() ? a[d] : 1;
+      const std::size_t _db = d < b.size() ? b[d] : 1;
+      if (_da != _db && _da != 1 && _db != 1) {
+        throw std::invalid_argument("Shapes cannot be broadcast together");
+      }
+      _retval[d] = std::max(_da, _db);
+    }
+    return _retval;
+  }
+
+  Var binary(TapeOp p_Op, Var a, Var b)
+  {
+    if (a.m_Tape != this || b.m_Tape != this) {
+      throw std::invalid_argument("Variables belong to different tapes");
+    }
+    Shape _shape = broadcast_shape(node(a.m_Id).m_Shape, node(b.m_Id).m_Shape);
+    const std::size_t _id = emplace(p_Op, std::move(_shape), a.m_Id, b.m_Id);
+    Node& _out = m_Nodes[_id];
+    const T* _a = m_Nodes[a.m_Id].m_Value.data();
+    const T* _b = m_Nodes[b.m_Id].m_Value.data();
+    T* _y = _out.m_Value.data();
+    auto _run = [&](auto f) {
+      if (m_Nodes[a.m_Id].m_Shape == m_Nodes[b.m_Id].m_Shape) {
+        for (std::size_t i = 0; i < _out.m_Value.size(); ++i) {
+          _y[i] = f(_a[i], _b[i]);
+        }
+      } else {
+        broadcast(_out.m_Shape,
+                  m_Nodes[a.m_Id].m_Shape,
+                  m_Nodes[b.m_Id].m_Shape,
+                  [&](std::size_t i, std::size_t ia, std::size_t ib) {
+                    _y[i] = f(_a[ia], _b[ib]);
+                  });
+      }
+    };
+    switch (p_Op) {
+      case TapeOp::Add: _run([](T x, T y) { return x + y; }); break;
+      case TapeOp::Sub: _run([](T x, T y) { return x - y; }); break;
+      case TapeOp::Mul: _run([](T x, T y) { return x * y; }); break;
+      default: _run([](T x, T y) { return x / y; }); break;
+    }
+    return Var(this, _id);
+  }
+
+  Var unary(TapeOp p_Op, Var a)
+  {
+    const std::size_t _id = emplace(p_Op, node(a.m_Id).m_Shape, a.m_Id);
+    const std::vector<T>& _x = m_Nodes[a.m_Id].m_Value;
+    std::vector<T>& _y = m_Nodes[_id].m_Value;
+    for (std::size_t i = 0; i < _x.size(); ++i) {
+      switch (p_Op) {
+        case TapeOp::Neg: _y[i] = -_x[i]; break;
+        case TapeOp::Exp: _y[i] = std::exp(_x[i]); break;
+        case TapeOp::Log: _y[i] = std::log(_x[i]); break;
+        case TapeOp::Tanh: _y[i] = std::tanh(_x[i]); break;
+        default: _y[i] = _x[i] > T{} ? _x[i] : T{}; break;
+      }
+    }
+    return Var(this, _id);
+  }
+
+  /**
+   * @brief Inner extent, axis extent and outer extent around an axis
+   *
+   * @details
+   * The inner extent is the product of the dimensions below the axis,
+   * which vary fastest, and the outer one of those above it.
+   */
+  static std::array<std::size_t, 3> around(const Shape& p_Shape, std::size_t p_Axis)
+  {
+    std::array<std::size_t, 3> _retval = { 1, p_Shape[p_Axis], 1 };
+    for (std::size_t d = 0; d < p_Shape.size(); ++d) {
+      if (d < p_Axis) {
+        _retval[0] *= p_Shape[d];
+      }
+      if (d > p_Axis) {
+        _retval[2] *= p_Shape[d];
+      }
+    }
+    return _retval;
+  }
+
+  Var reduce(Var a, std::size_t p_Axis, bool p_Mean)
+  {
+    const Shape _in = node(a.m_Id).m_Shape;
+    Shape _shape{ 1 };
+    if (p_Axis != k_All) {
+      if (p_Axis >= _in.size()) {
+        throw std::out_of_range("Axis out of bounds");
+      }
+      _shape = _in;
+      _shape.erase(_shape.begin() + static_cast<std::ptrdiff_t>(p_Axis));
+      if (_shape.empty()) {
+        _shape.push_back(1);
+      }
+    }
+    const std::size_t _id = emplace(TapeOp::Sum, std::move(_shape), a.m_Id);
+    Node& _out = m_Nodes[_id];
+    const std::vector<T>& _x = m_Nodes[a.m_Id].m_Value;
+    _out.m_Axis = p_Axis;
+    if (p_Axis == k_All) {
+      _out.m_Scale = p_Mean ? T(1) / static_cast<T>(_x.size()) : T(1);
+      T _acc{};
+      for (const auto& it : _x) {
+        _acc += it;
+      }
+      _out.m_Value[0] = _acc * _out.m_Scale;
+      return Var(this, _id);
+    }
+    const auto [_inner, _extent, _outer] = around(_in, p_Axis);
+    _out.m_Scale = p_Mean ? T(1) / static_cast<T>(_extent) : T(1);
+    std::fill(_out.m_Value.begin(), _out.m_Value.end(), T{});
+    for (std::size_t o = 0; o < _outer; ++o) {
+      for (std::size_t k = 0; k < _extent; ++k) {
+        const T* _src = _x.data() + (o * _extent + k) * _inner;
+        T* _dst = _out.m_Value.data() + o * _inner;
+        for (std::size_t i = 0; i < _inner; ++i) {
+          _dst[i] += _src[i] * _out.m_Scale;
+        }
+      }
+    }
+    return Var(this, _id);
+  }
+
+  /**
+   * @brief C(m, n) += op(A) * op(B) with column-major operands
+   */
+  static void gemm(bool p_TransA,
+                   bool p_TransB,
+                   std::size_t m,
+                   std::size_t n,
+                   std::size_t k,
+                   const T* a,
+                   const T* b,
+                   T* c)
+  {
+    for (std::size_t j = 0; j < n; ++j) {
+      for (std::size_t p = 0; p < k; ++p) {
+        const T _b = p_TransB ? b[j + p * n] : b[p + j * k];
+        if (!p_TransA) {
+          const T* _a = a + p * m;
+          T* _c = c + j * m;
+          for (std::size_t i = 0; i < m; ++i) {
+            _c[i] += _a[i] * _b;
+          }
+        } else {
+          for (std::size_t i = 0; i < m; ++i) {
+            c[i + j * m] += a[p + i * k] * _b;
+          }
+        }
+      }
+    }
+  }
+
+  Var matmul(Var a, Var b)
+  {
+    const Shape& _sa = node(a.m_Id).m_Shape;
+    const Shape& _sb = node(b.m_Id).m_Shape;
+    if (_sa.size() != 2 || _sb.size() != 2 || _sa[1] != _sb[0]) {
+      throw std::invalid_argument("Misaligned dimensions in matmul");
+    }
+    const std::size_t m = _sa[0], k = _sa[1], n = _sb[1];
+    const std::size_t _id = emplace(TapeOp::MatMul, Shape{ m, n }, a.m_Id, b.m_Id);
+    std::fill(m_Nodes[_id].m_Value.begin(), m_Nodes[_id].m_Value.end(), T{});
+    gemm(false,
+         false,
+         m,
+         n,
+         k,
+         m_Nodes[a.m_Id].m_Value.data(),
+         m_Nodes[b.m_Id].m_Value.data(),
+         m_Nodes[_id].m_Value.data());
+    return Var(this, _id);
+  }
+
+  Var transpose(Var a)
+  {
+    const Shape _sa = node(a.m_Id).m_Shape;
+    if (_sa.size() != 2) {
+      throw std::invalid_argument("Transpose requires a matrix");
+    }
+    const std::size_t _id = emplace(TapeOp::Transpose, Shape{ _sa[1], _sa[0] }, a.m_Id);
+    const T* _x = m_Nodes[a.m_Id].m_Value.data();
+    T* _y = m_Nodes[_id].m_Value.data();
+    for (std::size_t j = 0; j < _sa[1]; ++j) {
+      for (std::size_t i = 0; i < _sa[0]; ++i) {
+        _y[j + i * _sa[1]] = _x[i + j * _sa[0]];
+      }
+    }
+    return Var(this, _id);
+  }
+
+  Var reshape(Var a, Shape p_Shape)
+  {
+    if (count(p_Shape) != node(a.m_Id).m_Value.size()) {
+      throw std::invalid_argument("Reshape must preserve the amount of elements");
+    }
+    const std::size_t _id = emplace(TapeOp::Reshape, std::move(p_Shape), a.m_Id);
+    std::copy(m_Nodes[a.m_Id].m_Value.begin(),
+              m_Nodes[a.m_Id].m_Value.end(),
+              m_Nodes[_id].m_Value.begin());
+    return Var(this, _id);
+  }
+
+  void propagate(std::size_t p_Id)
+  {
+    Node& _n = m_Nodes[p_Id];
+    const std::vector<T>& _g = _n.m_Grad;
+    switch (_n.m_Op) {
+      case TapeOp::Leaf:
+        return;
+      case TapeOp::Add:
+      case TapeOp::Sub:
+      case TapeOp::Mul:
+      case TapeOp::Div: {
+        Node& _a = m_Nodes[_n.m_Lhs];
+        Node& _b = m_Nodes[_n.m_Rhs];
+        const TapeOp _op = _n.m_Op;
+        auto _step = [&](std::size_t i, std::size_t ia, std::size_t ib) {
+          const T _x = _a.m_Value[ia], _y = _b.m_Value[ib];
+          switch (_op) {
+            case TapeOp::Add: _a.m_Grad[ia] += _g[i]; _b.m_Grad[ib] += _g[i]; break;
+            case TapeOp::Sub: _a.m_Grad[ia] += _g[i]; _b.m_Grad[ib] -= _g[i]; break;
+            case TapeOp::Mul:
+              _a.m_Grad[ia] += _g[i] * _y;
+              _b.m_Grad[ib] += _g[i] * _x;
+              break;
+            default:
+              _a.m_Grad[ia] += _g[i] / _y;
+              _b.m_Grad[ib] -= _g[i] * _x / (_y * _y);
+              break;
+          }
+        };
+        if (_a.m_Shape == _b.m_Shape) {
+          for (std::size_t i = 0; i < _g.size(); ++i) {
+            _step(i, i, i);
+          }
+        } else {
+          broadcast(_n.m_Shape, _a.m_Shape, _b.m_Shape, _step);
+        }
+        return;
+      }
+      case TapeOp::Neg:
+      case TapeOp::Exp:
+      case TapeOp::Log:
+      case TapeOp::Tanh:
+      case TapeOp::Relu: {
+        Node& _a = m_Nodes[_n.m_Lhs];
+        for (std::size_t i = 0; i < _g.size(); ++i) {
+          switch (_n.m_Op) {
+            case TapeOp::Neg: _a.m_Grad[i] -= _g[i]; break;
+            case TapeOp::Exp: _a.m_Grad[i] += _g[i] * _n.m_Value[i]; break;
+            case TapeOp::Log: _a.m_Grad[i] += _g[i] / _a.m_Value[i]; break;
+            case TapeOp::Tanh:
+              _a.m_Grad[i] += _g[i] * (T(1) - _n.m_Value[i] * _n.m_Value[i]);
+              break;
+            default: _a.m_Grad[i] += _a.m_Value[i] > T{} ? _g[i] : T{}; break;
+          }
+        }
+        return;
+      }
+      case TapeOp::Sum: {
+        Node& _a = m_Nodes[_n.m_Lhs];
+        if (_n.m_Axis == k_All) {
+          for (auto& it : _a.m_Grad) {
+            it += _g[0] * _n.m_Scale;
+          }
+          return;
+        }
+        const auto [_inner, _extent, _outer] = around(_a.m_Shape, _n.m_Axis);
+        for (std::size_t o = 0; o < _outer; ++o) {
+          for (std::size_t k = 0; k < _extent; ++k) {
+            T* _dst = _a.m_Grad.data() + (o * _extent + k) * _inner;
+            const T* _src = _g.data() + o * _inner;
+            for (std::size_t i = 0; i < _inner; ++i) {
+              _dst[i] += _src[i] * _n.m_Scale;
+            }
+          }
+        }
+        return;
+      }
+      case TapeOp::MatMul: {
+        Node& _a = m_Nodes[_n.m_Lhs];
+        Node& _b = m_Nodes[_n.m_Rhs];
+        const std::size_t m = _a.m_Shape[0], k = _a.m_Shape[1], n = _b.m_Shape[1];
+        gemm(false, true, m, k, n, _g.data(), _b.m_Value.data(), _a.m_Grad.data());
+        gemm(true, false, k, n, m, _a.m_Value.data(), _g.data(), _b.m_Grad.data());
+        return;
+      }
+      case TapeOp::Transpose: {
+        Node& _a = m_Nodes[_n.m_Lhs];
+        const std::size_t _rows = _a.m_Shape[0], _cols = _a.m_Shape[1];
+        for (std::size_t j = 0; j < _cols; ++j) {
+          for (std::size_t i = 0; i < _rows; ++i) {
+            _a.m_Grad[i + j * _rows] += _g[j + i * _cols];
+          }
+        }
+        return;
+      }
+      case TapeOp::Reshape: {
+        Node& _a = m_Nodes[_n.m_Lhs];
+        for (std::size_t i = 0; i < _g.size(); ++i) {
+          _a.m_Grad[i] += _g[i];
+        }
+        return;
+      }
+      case TapeOp::Checkpoint: {
+        Node& _a = m_Nodes[_n.m_Lhs];
+        Tape _inner;
+        const Var _x = _inner.variable(_a.m_Shape, _a.m_Value);
+        const Var _y = _n.m_Segment(_inner, _x);
+        _inner.backward(_y, _g);
+        const auto _dx = _x.grad();
+        for (std::size_t i = 0; i < _dx.size(); ++i) {
+          _a.m_Grad[i] += _dx[i];
+        }
+        return;
+      }
+    }
+  }
+
+  std::vector<Node> m_Nodes;
+  std::size_t m_Cursor = 0;
+};
+
+}
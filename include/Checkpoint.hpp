@@ -0,0 +1,400 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Tensor.hpp"
+#include "TrackedTensor.hpp"
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TenSore {
+
+namespace detail {
+
+inline constexpr char k_CheckpointMagic[8] = { 'T', 'S', 'C', 'K', 'P', 'T', 0, 1 };
+inline constexpr std::uint32_t k_SegmentMagic = 0x31474553; // "SEG1"
+
+/**
+ * @brief Word-wise checksum guarding checkpoint segments against torn writes
+ */
+inline std::uint64_t
+checksum(std::span<const std::byte> p_Data, std::uint64_t p_Seed = 0) noexcept
+{
+  constexpr std::uint64_t k_Prime = 0x9e3779b97f4a7c15ull;
+  std::uint64_t _hash = p_Seed ^ (p_Data.size() * k_Prime);
+  std::size_t i = 0;
+  for (; i + 8 <= p_Data.size(); i += 8) {
+    std::uint64_t _word;
+    std::memcpy(&_word, p_Data.data() + i, 8);
+    _hash = (_hash ^ _word) * k_Prime;
+    _hash ^= _hash >> 29;
+  }
+  for (; i < p_Data.size(); ++i) {
+    _hash = (_hash ^ static_cast<std::uint64_t>(p_Data[i])) * k_Prime;
+  }
+  return _hash ^ (_hash >> 32);
+}
+
+inline void
+pwrite_all(int p_Fd, const void* p_Data, std::size_t p_Bytes, std::size_t p_Offset)
+{
+  const auto* _data = static_cast<const char*>(p_Data);
+  for (std::size_t _done = 0; _done < p_Bytes;) {
+    const ssize_t _n = ::pwrite(
+      p_Fd, _data + _done, p_Bytes - _done, static_cast<off_t>(p_Offset + _done));
+    if (_n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (_n < 0) {
+      throw std::system_error(errno, std::generic_category(), "pwrite");
+    }
+    _done += static_cast<std::size_t>(_n);
+  }
+}
+
+/**
+ * @return Whether all bytes were read, false at end of file
+ */
+inline bool
+pread_all(int p_Fd, void* p_Data, std::size_t p_Bytes, std::size_t p_Offset)
+{
+  auto* _data = static_cast<char*>(p_Data);
+  for (std::size_t _done = 0; _done < p_Bytes;) {
+    const ssize_t _n = ::pread(
+      p_Fd, _data + _done, p_Bytes - _done, static_cast<off_t>(p_Offset + _done));
+    if (_n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (_n < 0) {
+      throw std::system_error(errno, std::generic_category(), "pread");
+    }
+    if (_n == 0) {
+      return false;
+    }
+    _done += static_cast<std::size_t>(_n);
+  }
+  return true;
+}
+
+struct SegmentHeader
+{
+  std::uint32_t m_Magic;
+  std::uint32_t m_Full;
+  std::uint64_t m_Generation;
+  std::uint64_t m_Count;
+};
+
+}
+
+/**
+ * @class CheckpointWriter
+ * @brief Persists a TrackedTensor, writing only blocks dirtied since the
+ * previous checkpoint
+ *
+ * @tparam T Trivially copyable type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * The file is a header followed by a log of segments. The first segment
+ * holds every block; each later one holds the blocks dirty at the time of
+ * its checkpoint, with their indices and a checksum, and is synced before
+ * write() returns. A segment cut short by a crash fails its checksum and
+ * is ignored by read_checkpoint(), which thus restores the last complete
+ * checkpoint. Once the log outgrows the tensor by the compaction ratio,
+ * the next checkpoint writes a fresh file and renames it over the old one.
+ *
+ * Writers of the tensor must be paused while write() runs.
+ */
+template<typename T, std::size_t Rank>
+class CheckpointWriter
+{
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Checkpoints store trivially copyable types only");
+
+public:
+  CheckpointWriter() = delete;
+
+  /**
+   * @brief Constructor of a writer
+   *
+   * @param p_Path File to write, replaced by the first checkpoint
+   * @param p_CompactRatio Log size, relative to the tensor, that triggers a
+   * full checkpoint
+   */
+  explicit CheckpointWriter(std::string p_Path, double p_CompactRatio = 2.0)
+    : m_Path(std::move(p_Path))
+    , m_CompactRatio(p_CompactRatio)
+  {
+  }
+
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  ~CheckpointWriter()
+  {
+    if (m_Fd >= 0) {
+      ::close(m_Fd);
+    }
+  }
+
+  /**
+   * @brief Number of the last written checkpoint, 0 before the first
+   */
+  std::uint64_t generation() const noexcept { return m_Generation; }
+
+  /**
+   * @brief Size of the checkpoint file
+   */
+  std::size_t file_bytes() const noexcept { return m_Offset; }
+
+  /**
+   * @brief Writes a checkpoint and clears the tensor's dirty bitmap
+   *
+   * @param p_Tensor Tensor to persist
+   *
+   * @return Bytes written
+   */
+  template<Allocator A>
+  std::size_t write(TrackedTensor<T, Rank, A>& p_Tensor)
+  {
+    std::vector<std::size_t> _blocks = p_Tensor.dirty().take();
+    try {
+      const double _tensor_bytes = static_cast<double>(p_Tensor.size() * sizeof(T));
+      const bool _full = m_Fd < 0 || p_Tensor.dimensions() != m_DimensionsData ||
+                         p_Tensor.block_elements() != m_BlockElements ||
+                         static_cast<double>(m_Offset) > m_CompactRatio * _tensor_bytes;
+      if (_full) {
+        _blocks.resize(p_Tensor.block_count());
+        std::iota(_blocks.begin(), _blocks.end(), std::size_t{ 0 });
+        return write_full(p_Tensor, _blocks);
+      }
+      return _blocks.empty() ? 0 : append(p_Tensor, _blocks, false);
+    } catch (...) {
+      for (const std::size_t _block : _blocks) {
+        p_Tensor.dirty().mark(_block);
+      }
+      throw;
+    }
+  }
+
+private:
+  template<Allocator A>
+  std::size_t write_full(const TrackedTensor<T, Rank, A>& p_Tensor,
+                         const std::vector<std::size_t>& p_Blocks)
+  {
+    std::string _temporary = m_Path + ".XXXXXX";
+    const int _fd = ::mkstemp(_temporary.data());
+    if (_fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "mkstemp");
+    }
+    const int _old = std::exchange(m_Fd, _fd);
+    const std::size_t _old_offset = m_Offset;
+    const std::uint64_t _old_generation = m_Generation;
+    try {
+      std::vector<std::uint64_t> _header(3 + Rank);
+      _header[0] = sizeof(T);
+      _header[1] = Rank;
+      _header[2] = p_Tensor.block_elements();
+      std::copy(p_Tensor.dimensions().begin(), p_Tensor.dimensions().end(), _header.begin() + 3);
+      detail::pwrite_all(_fd, detail::k_CheckpointMagic, sizeof(detail::k_CheckpointMagic), 0);
+      detail::pwrite_all(_fd, _header.data(), _header.size() * 8, 8);
+      m_Offset = 8 + _header.size() * 8;
+      append(p_Tensor, p_Blocks, true);
+      if (::fchmod(_fd, 0644) != 0 || ::rename(_temporary.c_str(), m_Path.c_str()) != 0) {
+        throw std::system_error(errno, std::generic_category(), "rename");
+      }
+    } catch (...) {
+      ::close(_fd);
+      ::unlink(_temporary.c_str());
+      m_Fd = _old;
+      m_Offset = _old_offset;
+      m_Generation = _old_generation;
+      throw;
+    }
+    if (_old >= 0) {
+      ::close(_old);
+    }
+    m_DimensionsData = p_Tensor.dimensions();
+    m_BlockElements = p_Tensor.block_elements();
+    return m_Offset;
+  }
+
+  template<Allocator A>
+  std::size_t append(const TrackedTensor<T, Rank, A>& p_Tensor,
+                     const std::vector<std::size_t>& p_Blocks,
+                     bool p_Full)
+  {
+    const detail::SegmentHeader _header{
+      detail::k_SegmentMagic, p_Full, m_Generation + 1, p_Blocks.size()
+    };
+    const std::vector<std::uint64_t> _indices(p_Blocks.begin(), p_Blocks.end());
+    std::uint64_t _checksum =
+      detail::checksum(std::as_bytes(std::span(_indices)), _header.m_Generation);
+    std::size_t _offset = m_Offset;
+    detail::pwrite_all(m_Fd, &_header, sizeof(_header), _offset);
+    _offset += sizeof(_header);
+    detail::pwrite_all(m_Fd, _indices.data(), _indices.size() * 8, _offset);
+    _offset += _indices.size() * 8;
+    for (const std::size_t _block : p_Blocks) {
+      const auto _bytes = std::as_bytes(p_Tensor.block(_block));
+      _checksum = detail::checksum(_bytes, _checksum);
+      detail::pwrite_all(m_Fd, _bytes.data(), _bytes.size(), _offset);
+      _offset += _bytes.size();
+    }
+    detail::pwrite_all(m_Fd, &_checksum, sizeof(_checksum), _offset);
+    _offset += sizeof(_checksum);
+    if (::fdatasync(m_Fd) != 0) {
+      throw std::system_error(errno, std::generic_category(), "fdatasync");
+    }
+    const std::size_t _written = _offset - m_Offset;
+    m_Offset = _offset;
+    ++m_Generation;
+    return _written;
+  }
+
+  std::string m_Path;
+  double m_CompactRatio;
+  int m_Fd = -1;
+  std::size_t m_Offset = 0;
+  std::uint64_t m_Generation = 0;
+  std::array<std::size_t, Rank> m_DimensionsData{};
+  std::size_t m_BlockElements = 0;
+};
+
+/**
+ * @brief Restores the last complete checkpoint of a file
+ *
+ * @param p_Path File written by CheckpointWriter
+ *
+ * @return Tensor as of that checkpoint
+ *
+ * @details
+ * Throws std::invalid_argument if the file holds another element size or
+ * rank, and std::runtime_error if not even the full checkpoint is intact.
+ */
+template<typename T, std::size_t Rank>
+Tensor<T, Rank>
+read_checkpoint(const std::string& p_Path)
+{
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Checkpoints store trivially copyable types only");
+  const int _fd = ::open(p_Path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (_fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "open");
+  }
+  struct Closer
+  {
+    int m_Fd;
+    ~Closer() { ::close(m_Fd); }
+  } _closer{ _fd };
+
+  char _magic[8];
+  std::array<std::uint64_t, 3 + Rank> _header;
+  if (!detail::pread_all(_fd, _magic, 8, 0) ||
+      std::memcmp(_magic, detail::k_CheckpointMagic, 8) != 0 ||
+      !detail::pread_all(_fd, _header.data(), 24, 8)) {
+    throw std::runtime_error("Not a checkpoint file");
+  }
+  if (_header[0] != sizeof(T) || _header[1] != Rank) {
+    throw std::invalid_argument("Checkpoint holds another element type or rank");
+  }
+  if (!detail::pread_all(_fd, _header.data() + 3, Rank * 8, 32)) {
+    throw std::runtime_error("Not a checkpoint file");
+  }
+  const std::size_t _block_elements = _header[2];
+  std::array<std::size_t, Rank> _dims;
+  std::copy(_header.begin() + 3, _header.end(), _dims.begin());
+  Tensor<T, Rank> _retval(std::move(_dims));
+  const std::size_t _blocks =
+    _block_elements ? (_retval.size() + _block_elements - 1) / _block_elements : 0;
+
+  std::size_t _offset = 32 + Rank * 8;
+  std::vector<T> _staging;
+  for (bool _first = true;; _first = false) {
+    detail::SegmentHeader _segment;
+    if (!detail::pread_all(_fd, &_segment, sizeof(_segment), _offset) ||
+        _segment.m_Magic != detail::k_SegmentMagic || _segment.m_Count > _blocks ||
+        _segment.m_Full != _first) {
+      break;
+    }
+    std::vector<std::uint64_t> _indices(_segment.m_Count);
+    std::size_t _position = _offset + sizeof(_segment);
+    if (!detail::pread_all(_fd, _indices.data(), _indices.size() * 8, _position)) {
+      break;
+    }
+    _position += _indices.size() * 8;
+    std::uint64_t _checksum =
+      detail::checksum(std::as_bytes(std::span(_indices)), _segment.m_Generation);
+    std::size_t _elements = 0;
+    bool _valid = true;
+    for (const std::uint64_t _block : _indices) {
+      if (_block >= _blocks) {
+        _valid = false;
+        break;
+      }
+      _elements += std::min(_block_elements, _retval.size() - _block * _block_elements);
+    }
+    _staging.resize(_elements);
+    std::uint64_t _stored;
+    if (!_valid ||
+        !detail::pread_all(_fd, _staging.data(), _elements * sizeof(T), _position) ||
+        !detail::pread_all(_fd, &_stored, 8, _position + _elements * sizeof(T))) {
+      break;
+    }
+    std::size_t _source = 0;
+    for (const std::uint64_t _block : _indices) {
+      const std::size_t _count =
+        std::min(_block_elements, _retval.size() - _block * _block_elements);
+      _checksum = detail::checksum(
+        std::as_bytes(std::span(_staging.data() + _source, _count)), _checksum);
+      _source += _count;
+    }
+    if (_checksum != _stored) {
+      break;
+    }
+    _source = 0;
+    for (const std::uint64_t _block : _indices) {
+      const std::size_t _first_element = _block * _block_elements;
+      const std::size_t _count = std::min(_block_elements, _retval.size() - _first_element);
+      std::copy_n(_staging.data() + _source, _count, _retval.storage() + _first_element);
+      _source += _count;
+    }
+    _offset = _position + _elements * sizeof(T) + 8;
+  }
+  if (_offset == 32 + Rank * 8) {
+    throw std::runtime_error("Checkpoint file holds no complete checkpoint");
+  }
+  return _retval;
+}
+
+}
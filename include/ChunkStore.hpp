@@ -0,0 +1,560 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Codec.hpp"
+#include "NdIterator.hpp"
+#include "Tensor.hpp"
+#include "TensorView.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TenSore {
+
+namespace detail {
+
+/**
+ * @brief Whole contents of a file, or nothing if it does not exist
+ */
+inline std::optional<std::vector<std::byte>>
+read_file(const std::string& p_Path)
+{
+  const int _fd = ::open(p_Path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (_fd < 0) {
+    if (errno == ENOENT) {
+      return std::nullopt;
+    }
+    throw std::system_error(errno, std::generic_category(), "open");
+  }
+  std::vector<std::byte> _retval;
+  struct stat _stat;
+  if (::fstat(_fd, &_stat) == 0) {
+    _retval.reserve(static_cast<std::size_t>(_stat.st_size));
+  }
+  std::byte _buffer[65536];
+  for (;;) {
+    const ssize_t _n = ::read(_fd, _buffer, sizeof(_buffer));
+    if (_n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (_n < 0) {
+      const int _error = errno;
+      ::close(_fd);
+      throw std::system_error(_error, std::generic_category(), "read");
+    }
+    if (_n == 0) {
+      break;
+    }
+    _retval.insert(_retval.end(), _buffer, _buffer + _n);
+  }
+  ::close(_fd);
+  return _retval;
+}
+
+/**
+ * @brief Replaces a file atomically
+ *
+ * @param p_Directory Directory of the file
+ * @param p_Name Name of the file
+ * @param p_Bytes New contents
+ *
+ * @details
+ * Writes a temporary file in the same directory and renames it over the
+ * target, so readers see either the old or the new contents in full.
+ */
+inline void
+write_file_atomic(const std::string& p_Directory,
+                  const std::string& p_Name,
+                  std::span<const std::byte> p_Bytes)
+{
+  std::string _temporary = p_Directory + "/." + p_Name + ".XXXXXX";
+  const int _fd = ::mkstemp(_temporary.data());
+  if (_fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "mkstemp");
+  }
+  auto _fail = [&](const char* p_Call) {
+    const int _error = errno;
+    ::close(_fd);
+    ::unlink(_temporary.c_str());
+    throw std::system_error(_error, std::generic_category(), p_Call);
+  };
+  for (std::size_t _done = 0; _done < p_Bytes.size();) {
+    const ssize_t _n = ::write(_fd, p_Bytes.data() + _done, p_Bytes.size() - _done);
+    if (_n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (_n < 0) {
+      _fail("write");
+    }
+    _done += static_cast<std::size_t>(_n);
+  }
+  if (::fchmod(_fd, 0644) != 0) {
+    _fail("fchmod");
+  }
+  ::close(_fd);
+  if (::rename(_temporary.c_str(), (p_Directory + "/" + p_Name).c_str()) != 0) {
+    const int _error = errno;
+    ::unlink(_temporary.c_str());
+    throw std::system_error(_error, std::generic_category(), "rename");
+  }
+}
+
+/**
+ * @brief Text following `"key":` in a flat JSON object
+ */
+inline std::string_view
+json_value(std::string_view p_Json, std::string_view p_Key)
+{
+  const std::string _quoted = "\"" + std::string(p_Key) + "\"";
+  std::size_t _pos = p_Json.find(_quoted);
+  if (_pos != std::string_view::npos) {
+    _pos = p_Json.find_first_not_of(" \t\r\n", _pos + _quoted.size());
+  }
+  if (_pos == std::string_view::npos || p_Json[_pos] != ':') {
+    throw std::runtime_error("Chunk store metadata lacks \"" + std::string(p_Key) + "\"");
+  }
+  _pos = p_Json.find_first_not_of(" \t\r\n", _pos + 1);
+  return _pos == std::string_view::npos ? std::string_view() : p_Json.substr(_pos);
+}
+
+template<std::size_t Rank>
+std::array<std::size_t, Rank>
+json_sizes(std::string_view p_Json, std::string_view p_Key)
+{
+  std::string_view _text = json_value(p_Json, p_Key);
+  std::array<std::size_t, Rank> _retval{};
+  std::size_t _count = 0;
+  if (_text.empty() || _text.front() != '[') {
+    throw std::runtime_error("Malformed chunk store metadata");
+  }
+  const char* _it = _text.data() + 1;
+  const char* _end = _text.data() + _text.size();
+  for (;;) {
+    while (_it != _end && (*_it == ' ' || *_it == ',' || *_it == '\n' || *_it == '\t')) {
+      ++_it;
+    }
+    if (_it != _end && *_it == ']') {
+      break;
+    }
+    std::size_t _value;
+    const auto _result = std::from_chars(_it, _end, _value);
+    if (_result.ec != std::errc() || _count == Rank) {
+      throw std::invalid_argument("Chunk store has a different rank");
+    }
+    _retval[_count++] = _value;
+    _it = _result.ptr;
+  }
+  if (_count != Rank) {
+    throw std::invalid_argument("Chunk store has a different rank");
+  }
+  return _retval;
+}
+
+inline std::string
+json_string(std::string_view p_Json, std::string_view p_Key)
+{
+  const std::string_view _text = json_value(p_Json, p_Key);
+  const std::size_t _close = _text.find('"', 1);
+  if (_text.empty() || _text.front() != '"' || _close == std::string_view::npos) {
+    throw std::runtime_error("Malformed chunk store metadata");
+  }
+  return std::string(_text.substr(1, _close - 1));
+}
+
+}
+
+/**
+ * @class ChunkStore
+ * @brief Tensor stored in a directory, one file per rectangular chunk
+ *
+ * @tparam T Arithmetic type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * The layout follows Zarr version 2: a `.zarray` JSON file describes the
+ * shape, chunk shape and dtype, and chunk (i, j, ...) of the chunk grid
+ * lives in the file `i.j....`, holding the full (padded at the borders)
+ * chunk in Fortran order, which is Tensor's first-dimension-fastest order.
+ * Uncompressed stores are readable by Zarr; compressed ones use the
+ * in-tree codec (see codec::) and name it `"tensore"`. Chunks that were
+ * never written read as zeros.
+ *
+ * Every chunk file is replaced atomically, so concurrent writers of
+ * disjoint chunks, and readers racing with them, are safe. Writers of
+ * different regions within one chunk are not.
+ */
+template<typename T, std::size_t Rank>
+class ChunkStore
+{
+  static_assert(std::is_arithmetic_v<T>, "Chunk stores hold arithmetic types only");
+
+public:
+  ChunkStore() = delete;
+
+  /**
+   * @brief Creates a store, replacing the metadata of an existing one
+   *
+   * @param p_Path Directory of the store, created if missing
+   * @param p_Dimensions Dimensions of the tensor
+   * @param p_ChunkDimensions Dimensions of a chunk
+   * @param p_Compress Whether chunks are compressed
+   */
+  static ChunkStore create(const std::string& p_Path,
+                           const std::array<std::size_t, Rank>& p_Dimensions,
+                           const std::array<std::size_t, Rank>& p_ChunkDimensions,
+                           bool p_Compress = true)
+  {
+    if (::mkdir(p_Path.c_str(), 0755) != 0 && errno != EEXIST) {
+      throw std::system_error(errno, std::generic_category(), "mkdir");
+    }
+    ChunkStore _retval(p_Path, p_Dimensions, p_ChunkDimensions, p_Compress);
+    const std::string _metadata = _retval.metadata();
+    detail::write_file_atomic(p_Path, ".zarray", std::as_bytes(std::span(_metadata)));
+    return _retval;
+  }
+
+  /**
+   * @brief Opens an existing store
+   *
+   * @param p_Path Directory of the store
+   *
+   * @details
+   * Throws std::invalid_argument if the store's rank or dtype differ from
+   * the ones of this class.
+   */
+  static ChunkStore open(const std::string& p_Path)
+  {
+    const auto _bytes = detail::read_file(p_Path + "/.zarray");
+    if (!_bytes) {
+      throw std::runtime_error("No chunk store at " + p_Path);
+    }
+    const std::string _json(reinterpret_cast<const char*>(_bytes->data()), _bytes->size());
+    if (detail::json_string(_json, "dtype") != dtype()) {
+      throw std::invalid_argument("Chunk store has a different element type");
+    }
+    if (detail::json_string(_json, "order") != "F") {
+      throw std::invalid_argument("Only Fortran-ordered chunk stores are supported");
+    }
+    const std::string_view _compressor = detail::json_value(_json, "compressor");
+    bool _compress = false;
+    if (_compressor.starts_with("{")) {
+      if (detail::json_string(_compressor, "id") != "tensore") {
+        throw std::invalid_argument("Unsupported chunk compressor");
+      }
+      _compress = true;
+    } else if (!_compressor.starts_with("null")) {
+      throw std::runtime_error("Malformed chunk store metadata");
+    }
+    return ChunkStore(p_Path,
+                      detail::json_sizes<Rank>(_json, "shape"),
+                      detail::json_sizes<Rank>(_json, "chunks"),
+                      _compress);
+  }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_DimensionsData;
+  }
+
+  const std::array<std::size_t, Rank>& chunk_dimensions() const noexcept
+  {
+    return m_ChunkDimensions;
+  }
+
+  /**
+   * @brief Amount of chunks along each dimension
+   */
+  const std::array<std::size_t, Rank>& chunk_grid() const noexcept { return m_Grid; }
+
+  bool compressed() const noexcept { return m_Compress; }
+
+  const std::string& path() const noexcept { return m_Path; }
+
+  /**
+   * @brief Reads a chunk
+   *
+   * @param p_Chunk Coordinates of the chunk in the chunk grid
+   *
+   * @return Elements of the full chunk in Fortran order
+   */
+  std::vector<T> read_chunk(const std::array<std::size_t, Rank>& p_Chunk) const
+  {
+    std::vector<T> _retval(m_ChunkSize, T{});
+    const auto _bytes = detail::read_file(m_Path + "/" + chunk_name(p_Chunk));
+    if (!_bytes) {
+      return _retval;
+    }
+    const auto _out = std::as_writable_bytes(std::span(_retval));
+    if (m_Compress) {
+      codec::decompress(*_bytes, _out, sizeof(T));
+    } else if (_bytes->size() == _out.size()) {
+      std::copy(_bytes->begin(), _bytes->end(), _out.begin());
+    } else {
+      throw std::runtime_error("Chunk file has the wrong size");
+    }
+    return _retval;
+  }
+
+  /**
+   * @brief Replaces a chunk atomically
+   *
+   * @param p_Chunk Coordinates of the chunk in the chunk grid
+   * @param p_Data Elements of the full chunk in Fortran order
+   */
+  void write_chunk(const std::array<std::size_t, Rank>& p_Chunk,
+                   std::span<const T> p_Data) const
+  {
+    if (p_Data.size() != m_ChunkSize) {
+      throw std::invalid_argument("Chunk data has the wrong size");
+    }
+    const std::string _name = chunk_name(p_Chunk);
+    if (m_Compress) {
+      detail::write_file_atomic(
+        m_Path, _name, codec::compress(std::as_bytes(p_Data), sizeof(T)));
+    } else {
+      detail::write_file_atomic(m_Path, _name, std::as_bytes(p_Data));
+    }
+  }
+
+  /**
+   * @brief Reads a rectangular region
+   *
+   * @param p_Offsets Coordinates of the first element of the region
+   * @param p_Extents Dimensions of the region
+   * @param p_Pool Pool reading the overlapping chunks in parallel
+   *
+   * @return Tensor holding the region
+   */
+  Tensor<T, Rank> read(const std::array<std::size_t, Rank>& p_Offsets,
+                       const std::array<std::size_t, Rank>& p_Extents,
+                       ThreadPool& p_Pool = ThreadPool::global()) const
+  {
+    std::array<std::size_t, Rank> _dims = p_Extents;
+    Tensor<T, Rank> _retval(std::move(_dims));
+    const TensorView<T, Rank> _out(_retval);
+    for_each_overlap(
+      p_Offsets, p_Extents, p_Pool, [&](const auto& p_Chunk, const auto& p_Box) {
+        const std::vector<T> _data = read_chunk(p_Chunk);
+        copy_view(chunk_view(_data.data()).subview(p_Box.m_InChunk, p_Box.m_Extents),
+                  _out.subview(p_Box.m_InRegion, p_Box.m_Extents));
+      });
+    return _retval;
+  }
+
+  /**
+   * @brief Reads the whole tensor
+   */
+  Tensor<T, Rank> read(ThreadPool& p_Pool = ThreadPool::global()) const
+  {
+    return read(std::array<std::size_t, Rank>{}, m_DimensionsData, p_Pool);
+  }
+
+  /**
+   * @brief Writes a rectangular region
+   *
+   * @param p_Offsets Coordinates in the store of the region's first element
+   * @param p_Region Elements of the region
+   * @param p_Pool Pool writing the overlapping chunks in parallel
+   *
+   * @details
+   * Chunks covered only partly by the region are read, merged and written
+   * back.
+   */
+  void write(const std::array<std::size_t, Rank>& p_Offsets,
+             const TensorView<const T, Rank>& p_Region,
+             ThreadPool& p_Pool = ThreadPool::global()) const
+  {
+    for_each_overlap(
+      p_Offsets,
+      p_Region.dimensions(),
+      p_Pool,
+      [&](const auto& p_Chunk, const auto& p_Box) {
+        std::vector<T> _data = p_Box.m_Whole ? std::vector<T>(m_ChunkSize, T{})
+                                             : read_chunk(p_Chunk);
+        copy_view(p_Region.subview(p_Box.m_InRegion, p_Box.m_Extents),
+                  chunk_view(_data.data()).subview(p_Box.m_InChunk, p_Box.m_Extents));
+        write_chunk(p_Chunk, _data);
+      });
+  }
+
+  /**
+   * @brief Writes the whole tensor
+   */
+  void write(const TensorView<const T, Rank>& p_Tensor,
+             ThreadPool& p_Pool = ThreadPool::global()) const
+  {
+    if (p_Tensor.dimensions() != m_DimensionsData) {
+      throw std::invalid_argument("Mismatched dimensions of tensor and store");
+    }
+    write(std::array<std::size_t, Rank>{}, p_Tensor, p_Pool);
+  }
+
+  /**
+   * @brief Name of the element type in Zarr's dtype notation
+   */
+  static std::string dtype()
+  {
+    const char _kind = std::is_same_v<T, bool>       ? 'b'
+                       : std::is_floating_point_v<T> ? 'f'
+                       : std::is_signed_v<T>         ? 'i'
+                                                     : 'u';
+    const char _order = sizeof(T) == 1                            ? '|'
+                        : std::endian::native == std::endian::little ? '<'
+                                                                     : '>';
+    return std::string{ _order, _kind } + std::to_string(sizeof(T));
+  }
+
+private:
+  /**
+   * @brief Intersection of a region with a chunk
+   */
+  struct Box
+  {
+    std::array<std::size_t, Rank> m_InChunk;
+    std::array<std::size_t, Rank> m_InRegion;
+    std::array<std::size_t, Rank> m_Extents;
+    bool m_Whole;
+  };
+
+  ChunkStore(const std::string& p_Path,
+             const std::array<std::size_t, Rank>& p_Dimensions,
+             const std::array<std::size_t, Rank>& p_ChunkDimensions,
+             bool p_Compress)
+    : m_Path(p_Path)
+    , m_DimensionsData(p_Dimensions)
+    , m_ChunkDimensions(p_ChunkDimensions)
+    , m_Compress(p_Compress)
+  {
+    m_ChunkSize = 1;
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (m_ChunkDimensions[i] == 0) {
+        throw std::invalid_argument("Chunk dimensions must be positive");
+      }
+      m_Grid[i] = (m_DimensionsData[i] + m_ChunkDimensions[i] - 1) / m_ChunkDimensions[i];
+      m_ChunkSize *= m_ChunkDimensions[i];
+    }
+  }
+
+  std::string metadata() const
+  {
+    auto _list = [](const std::array<std::size_t, Rank>& p_Values) {
+      std::string _retval = "[";
+      for (std::size_t i = 0; i < Rank; ++i) {
+        _retval += (i ? ", " : "") + std::to_string(p_Values[i]);
+      }
+      return _retval + "]";
+    };
+    return "{\n"
+           "    \"zarr_format\": 2,\n"
+           "    \"shape\": " + _list(m_DimensionsData) + ",\n"
+           "    \"chunks\": " + _list(m_ChunkDimensions) + ",\n"
+           "    \"dtype\": \"" + dtype() + "\",\n"
+           "    \"compressor\": " + (m_Compress ? "{\"id\": \"tensore\"}" : "null") + ",\n"
+           "    \"fill_value\": 0,\n"
+           "    \"order\": \"F\",\n"
+           "    \"filters\": null\n"
+           "}\n";
+  }
+
+  std::string chunk_name(const std::array<std::size_t, Rank>& p_Chunk) const
+  {
+    std::string _retval;
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (p_Chunk[i] >= m_Grid[i]) {
+        throw std::out_of_range("Chunk out of bounds");
+      }
+      _retval += (i ? "." : "") + std::to_string(p_Chunk[i]);
+    }
+    return _retval;
+  }
+
+  template<typename U>
+  TensorView<U, Rank> chunk_view(U* p_Data) const noexcept
+  {
+    return TensorView<U, Rank>(p_Data, m_ChunkDimensions, dense_strides(m_ChunkDimensions));
+  }
+
+  /**
+   * @brief Runs `p_Fn(chunk, box)` for every chunk overlapping a region
+   */
+  template<typename F>
+  void for_each_overlap(const std::array<std::size_t, Rank>& p_Offsets,
+                        const std::array<std::size_t, Rank>& p_Extents,
+                        ThreadPool& p_Pool,
+                        F&& p_Fn) const
+  {
+    std::array<std::size_t, Rank> _first;
+    std::array<std::size_t, Rank> _count;
+    std::size_t _total = 1;
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (p_Offsets[i] + p_Extents[i] > m_DimensionsData[i]) {
+        throw std::out_of_range("Region out of bounds");
+      }
+      if (p_Extents[i] == 0) {
+        return;
+      }
+      _first[i] = p_Offsets[i] / m_ChunkDimensions[i];
+      _count[i] = (p_Offsets[i] + p_Extents[i] - 1) / m_ChunkDimensions[i] - _first[i] + 1;
+      _total *= _count[i];
+    }
+    p_Pool.parallel_for(_total, [&](std::size_t n) {
+      std::array<std::size_t, Rank> _chunk;
+      Box _box;
+      _box.m_Whole = true;
+      for (std::size_t i = 0; i < Rank; ++i) {
+        _chunk[i] = _first[i] + n % _count[i];
+        n /= _count[i];
+        const std::size_t _begin = _chunk[i] * m_ChunkDimensions[i];
+        const std::size_t _end =
+          std::min(_begin + m_ChunkDimensions[i], m_DimensionsData[i]);
+        const std::size_t _lo = std::max(_begin, p_Offsets[i]);
+        const std::size_t _hi = std::min(_end, p_Offsets[i] + p_Extents[i]);
+        _box.m_InChunk[i] = _lo - _begin;
+        _box.m_InRegion[i] = _lo - p_Offsets[i];
+        _box.m_Extents[i] = _hi - _lo;
+        _box.m_Whole = _box.m_Whole && _lo == _begin && _hi == _end;
+      }
+      p_Fn(_chunk, _box);
+    });
+  }
+
+  std::string m_Path;
+  std::array<std::size_t, Rank> m_DimensionsData;
+  std::array<std::size_t, Rank> m_ChunkDimensions;
+  std::array<std::size_t, Rank> m_Grid;
+  std::size_t m_ChunkSize;
+  bool m_Compress;
+};
+
+}
@@ -0,0 +1,353 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @brief Building blocks of the in-tree compression codec
+ *
+ * @details
+ * Numeric data is first delta-encoded element-wise (on bit patterns, so
+ * it is exact for floating point too), then byte-shuffled so that bytes
+ * of equal significance are adjacent, and finally compressed by a small
+ * LZ77 coder in the style of LZ4. On smooth or sparse data the first two
+ * steps turn the high-order bytes into long runs of zeros, which the
+ * last step collapses.
+ */
+namespace codec {
+
+namespace detail {
+
+template<std::size_t Size>
+struct UnsignedOf;
+
+template<>
+struct UnsignedOf<1>
+{
+  using type = std::uint8_t;
+};
+
+template<>
+struct UnsignedOf<2>
+{
+  using type = std::uint16_t;
+};
+
+template<>
+struct UnsignedOf<4>
+{
+  using type = std::uint32_t;
+};
+
+template<>
+struct UnsignedOf<8>
+{
+  using type = std::uint64_t;
+};
+
+inline void
+put_length(std::vector<std::byte>& p_Out, std::size_t p_Length)
+{
+  for (; p_Length >= 255; p_Length -= 255) {
+    p_Out.push_back(std::byte{ 255 });
+  }
+  p_Out.push_back(static_cast<std::byte>(p_Length));
+}
+
+inline std::size_t
+get_length(std::span<const std::byte> p_In, std::size_t& p_Pos)
+{
+  std::size_t _retval = 0;
+  for (;;) {
+    if (p_Pos >= p_In.size()) {
+      throw std::runtime_error("Truncated compressed stream");
+    }
+    const auto _byte = static_cast<std::size_t>(p_In[p_Pos++]);
+    _retval += _byte;
+    if (_byte != 255) {
+      return _retval;
+    }
+  }
+}
+
+}
+
+/**
+ * @brief Replaces every element by its difference to the previous one
+ *
+ * @details
+ * Differences are taken on the bit patterns as unsigned integers, with
+ * wrap-around, so decoding is exact for any type.
+ */
+template<std::size_t Size>
+void
+delta_encode(std::span<std::byte> p_Data) noexcept
+{
+  using U = typename detail::UnsignedOf<Size>::type;
+  U _previous = 0;
+  for (std::size_t i = 0; i + Size <= p_Data.size(); i += Size) {
+    U _value;
+    std::memcpy(&_value, p_Data.data() + i, Size);
+    const U _delta = static_cast<U>(_value - _previous);
+    _previous = _value;
+    std::memcpy(p_Data.data() + i, &_delta, Size);
+  }
+}
+
+template<std::size_t Size>
+void
+delta_decode(std::span<std::byte> p_Data) noexcept
+{
+  using U = typename detail::UnsignedOf<Size>::type;
+  U _previous = 0;
+  for (std::size_t i = 0; i + Size <= p_Data.size(); i += Size) {
+    U _delta;
+    std::memcpy(&_delta, p_Data.data() + i, Size);
+    _previous = static_cast<U>(_previous + _delta);
+    std::memcpy(p_Data.data() + i, &_previous, Size);
+  }
+}
+
+/**
+ * @brief Groups byte k of every element together, for every k
+ *
+ * @param p_In Elements of `p_ElementSize` bytes each
+ * @param p_Out Destination of the same size
+ *
+ * @details
+ * Trailing bytes that do not form a whole element are copied as they are.
+ */
+inline void
+byte_shuffle(std::span<const std::byte> p_In,
+             std::span<std::byte> p_Out,
+             std::size_t p_ElementSize) noexcept
+{
+  const std::size_t _count = p_In.size() / p_ElementSize;
+  for (std::size_t b = 0; b < p_ElementSize; ++b) {
+    std::byte* _plane = p_Out.data() + b * _count;
+    for (std::size_t i = 0; i < _count; ++i) {
+      _plane[i] = p_In[i * p_ElementSize + b];
+    }
+  }
+  const std::size_t _whole = _count * p_ElementSize;
+  std::copy(p_In.begin() + _whole, p_In.end(), p_Out.begin() + _whole);
+}
+
+inline void
+byte_unshuffle(std::span<const std::byte> p_In,
+               std::span<std::byte> p_Out,
+               std::size_t p_ElementSize) noexcept
+{
+  const std::size_t _count = p_In.size() / p_ElementSize;
+  for (std::size_t b = 0; b < p_ElementSize; ++b) {
+    const std::byte* _plane = p_In.data() + b * _count;
+    for (std::size_t i = 0; i < _count; ++i) {
+      p_Out[i * p_ElementSize + b] = _plane[i];
+    }
+  }
+  const std::size_t _whole = _count * p_ElementSize;
+  std::copy(p_In.begin() + _whole, p_In.end(), p_Out.begin() + _whole);
+}
+
+/**
+ * @brief LZ77 compression with a single-probe hash table
+ *
+ * @details
+ * The stream is a sequence of tokens, each a literal run followed by a
+ * back-reference. The token byte holds both lengths in its nibbles (a
+ * nibble of 15 continues in following bytes, 255 meaning "more"); the
+ * back-reference is a 16-bit little-endian distance and a length of at
+ * least 4. The last token carries literals only. Overlapping references
+ * encode runs.
+ */
+inline std::vector<std::byte>
+lz_compress(std::span<const std::byte> p_In)
+{
+  constexpr std::size_t k_HashBits = 12;
+  constexpr std::size_t k_MinMatch = 4;
+  constexpr std::size_t k_MaxDistance = 65535;
+
+  std::vector<std::byte> _out;
+  _out.reserve(p_In.size() / 2 + 16);
+  std::array<std::uint32_t, std::size_t{ 1 } << k_HashBits> _table;
+  _table.fill(0xffffffffu);
+
+  auto _hash = [&](std::size_t p_Pos) {
+    std::uint32_t _word;
+    std::memcpy(&_word, p_In.data() + p_Pos, 4);
+    return (_word * 2654435761u) >> (32 - k_HashBits);
+  };
+
+  auto _emit = [&](std::size_t p_LiteralStart,
+                   std::size_t p_LiteralLength,
+                   std::size_t p_Distance,
+                   std::size_t p_MatchLength) {
+    const std::size_t _match = p_MatchLength ? p_MatchLength - k_MinMatch : 0;
+    const auto _token = static_cast<std::uint8_t>(
+      (std::min<std::size_t>(p_LiteralLength, 15) << 4) |
+      std::min<std::size_t>(_match, 15));
+    _out.push_back(static_cast<std::byte>(_token));
+    if (p_LiteralLength >= 15) {
+      detail::put_length(_out, p_LiteralLength - 15);
+    }
+    _out.insert(_out.end(),
+                p_In.begin() + p_LiteralStart,
+                p_In.begin() + p_LiteralStart + p_LiteralLength);
+    if (p_MatchLength) {
+      _out.push_back(static_cast<std::byte>(p_Distance & 0xff));
+      _out.push_back(static_cast<std::byte>(p_Distance >> 8));
+      if (_match >= 15) {
+        detail::put_length(_out, _match - 15);
+      }
+    }
+  };
+
+  std::size_t _anchor = 0;
+  std::size_t i = 0;
+  while (i + k_MinMatch <= p_In.size()) {
+    const auto _h = _hash(i);
+    const std::size_t _candidate = _table[_h];
+    _table[_h] = static_cast<std::uint32_t>(i);
+    if (_candidate != 0xffffffffu && i - _candidate <= k_MaxDistance &&
+        std::memcmp(p_In.data() + _candidate, p_In.data() + i, k_MinMatch) == 0) {
+      std::size_t _length = k_MinMatch;
+      while (i + _length < p_In.size() &&
+             p_In[_candidate + _length] == p_In[i + _length]) {
+        ++_length;
+      }
+      _emit(_anchor, i - _anchor, i - _candidate, _length);
+      i += _length;
+      _anchor = i;
+    } else {
+      ++i;
+    }
+  }
+  _emit(_anchor, p_In.size() - _anchor, 0, 0);
+  return _out;
+}
+
+/**
+ * @brief Inverse of lz_compress()
+ *
+ * @param p_In Compressed stream
+ * @param p_Out Destination, exactly the size of the original data
+ *
+ * @details
+ * Throws std::runtime_error on malformed input instead of reading or
+ * writing out of bounds.
+ */
+inline void
+lz_decompress(std::span<const std::byte> p_In, std::span<std::byte> p_Out)
+{
+  std::size_t _in = 0;
+  std::size_t _out = 0;
+  while (_in < p_In.size()) {
+    const auto _token = static_cast<std::uint8_t>(p_In[_in++]);
+    std::size_t _literals = _token >> 4;
+    if (_literals == 15) {
+      _literals += detail::get_length(p_In, _in);
+    }
+    if (_in + _literals > p_In.size() || _out + _literals > p_Out.size()) {
+      throw std::runtime_error("Corrupted compressed stream");
+    }
+    std::memcpy(p_Out.data() + _out, p_In.data() + _in, _literals);
+    _in += _literals;
+    _out += _literals;
+    if (_in == p_In.size()) {
+      break;
+    }
+    if (_in + 2 > p_In.size()) {
+      throw std::runtime_error("Truncated compressed stream");
+    }
+    const std::size_t _distance = static_cast<std::size_t>(p_In[_in]) |
+                                  (static_cast<std::size_t>(p_In[_in + 1]) << 8);
+    _in += 2;
+    std::size_t _length = (_token & 0x0f) + 4;
+    if ((_token & 0x0f) == 15) {
+      _length += detail::get_length(p_In, _in);
+    }
+    if (_distance == 0 || _distance > _out || _out + _length > p_Out.size()) {
+      throw std::runtime_error("Corrupted compressed stream");
+    }
+    for (std::size_t k = 0; k < _length; ++k, ++_out) {
+      p_Out[_out] = p_Out[_out - _distance];
+    }
+  }
+  if (_out != p_Out.size()) {
+    throw std::runtime_error("Compressed stream has the wrong length");
+  }
+}
+
+/**
+ * @brief Delta, byte shuffle and LZ in one call
+ *
+ * @param p_In Elements of `p_ElementSize` bytes each
+ */
+inline std::vector<std::byte>
+compress(std::span<const std::byte> p_In, std::size_t p_ElementSize)
+{
+  std::vector<std::byte> _work(p_In.begin(), p_In.end());
+  if (p_ElementSize == 1) {
+    delta_encode<1>(_work);
+  } else if (p_ElementSize == 2) {
+    delta_encode<2>(_work);
+  } else if (p_ElementSize == 4) {
+    delta_encode<4>(_work);
+  } else if (p_ElementSize == 8) {
+    delta_encode<8>(_work);
+  }
+  std::vector<std::byte> _shuffled(_work.size());
+  byte_shuffle(_work, _shuffled, p_ElementSize);
+  return lz_compress(_shuffled);
+}
+
+/**
+ * @brief Inverse of compress()
+ */
+inline void
+decompress(std::span<const std::byte> p_In,
+           std::span<std::byte> p_Out,
+           std::size_t p_ElementSize)
+{
+  std::vector<std::byte> _shuffled(p_Out.size());
+  lz_decompress(p_In, _shuffled);
+  byte_unshuffle(_shuffled, p_Out, p_ElementSize);
+  if (p_ElementSize == 1) {
+    delta_decode<1>(p_Out);
+  } else if (p_ElementSize == 2) {
+    delta_decode<2>(p_Out);
+  } else if (p_ElementSize == 4) {
+    delta_decode<4>(p_Out);
+  } else if (p_ElementSize == 8) {
+    delta_decode<8>(p_Out);
+  }
+}
+
+}
+
+}
@@ -0,0 +1,390 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Codec.hpp"
+#include "Layout.hpp"
+#include "Tensor.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @class CompressedTensor
+ * @brief Tensor kept compressed in memory, for rarely read data
+ *
+ * @tparam T Trivially copyable type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * Elements are split into fixed-size chunks in Tensor's linear order,
+ * each compressed independently with the in-tree codec (see codec::).
+ * Access decompresses the owning chunk into a small LRU cache; modified
+ * chunks are recompressed when evicted or on flush(). Chunks that do not
+ * compress are stored raw.
+ *
+ * Every member function that reads or changes the chunks or the cache
+ * takes an internal mutex. References returned by at() and operator[]
+ * point into the cache and stay valid only until the next access that
+ * evicts their chunk. Using them while another thread accesses the
+ * tensor is a data race, so concurrent code must go through get() and
+ * set().
+ */
+template<typename T, std::size_t Rank>
+class CompressedTensor
+{
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Compressed tensors store trivially copyable types only");
+
+public:
+  CompressedTensor() = delete;
+
+  /**
+   * @brief A constructor with an rvalue array
+   *
+   * @param p_Dimensions Array of dimensions
+   * @param p_ChunkElements Elements per independently compressed chunk
+   * @param p_CacheChunks Amount of decompressed chunks kept
+   */
+  CompressedTensor(std::array<std::size_t, Rank>&& p_Dimensions,
+                   std::size_t p_ChunkElements = 16384,
+                   std::size_t p_CacheChunks = 8)
+    : m_DimensionsData(std::move(p_Dimensions))
+    , m_ChunkElements(p_ChunkElements)
+    , m_CacheChunks(p_CacheChunks)
+  {
+    if (m_ChunkElements == 0 || m_CacheChunks == 0) {
+      throw std::invalid_argument("Chunk and cache sizes must be positive");
+    }
+    m_Size = 1;
+    for (const auto& it : m_DimensionsData) {
+      m_Size *= it;
+    }
+    m_Chunks.resize((m_Size + m_ChunkElements - 1) / m_ChunkElements);
+    for (std::size_t i = 0; i < m_Chunks.size(); ++i) {
+      if (i > 0 && chunk_size(i) == m_ChunkElements) {
+        m_Chunks[i] = m_Chunks[0];
+        continue;
+      }
+      std::vector<T> _zeros(chunk_size(i), T{});
+      store(i, _zeros);
+    }
+  }
+
+  /**
+   * @brief Compresses a tensor
+   *
+   * @param p_Tensor Tensor to be compressed
+   */
+  template<Allocator A>
+  explicit CompressedTensor(const Tensor<T, Rank, A>& p_Tensor,
+                            std::size_t p_ChunkElements = 16384,
+                            std::size_t p_CacheChunks = 8)
+    : m_DimensionsData(p_Tensor.dimensions())
+    , m_Size(p_Tensor.size())
+    , m_ChunkElements(p_ChunkElements)
+    , m_CacheChunks(p_CacheChunks)
+  {
+    if (m_ChunkElements == 0 || m_CacheChunks == 0) {
+      throw std::invalid_argument("Chunk and cache sizes must be positive");
+    }
+    m_Chunks.resize((m_Size + m_ChunkElements - 1) / m_ChunkElements);
+    for (std::size_t i = 0; i < m_Chunks.size(); ++i) {
+      store(i,
+            std::span<const T>(p_Tensor.storage() + i * m_ChunkElements,
+                               chunk_size(i)));
+    }
+  }
+
+  CompressedTensor(const CompressedTensor& p_Other)
+    : m_DimensionsData(p_Other.m_DimensionsData)
+    , m_Size(p_Other.m_Size)
+    , m_ChunkElements(p_Other.m_ChunkElements)
+    , m_CacheChunks(p_Other.m_CacheChunks)
+  {
+    std::lock_guard<std::mutex> lock(p_Other.m_Mutex);
+    p_Other.flush_locked();
+    m_Chunks = p_Other.m_Chunks;
+  }
+
+  CompressedTensor& operator=(const CompressedTensor& p_Other)
+  {
+    if (this != &p_Other) {
+      CompressedTensor _copy(p_Other);
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      m_DimensionsData = _copy.m_DimensionsData;
+      m_Size = _copy.m_Size;
+      m_ChunkElements = _copy.m_ChunkElements;
+      m_CacheChunks = _copy.m_CacheChunks;
+      m_Chunks = std::move(_copy.m_Chunks);
+      m_Cache.clear();
+    }
+    return *this;
+  }
+
+  std::size_t size() const noexcept { return m_Size; }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_DimensionsData;
+  }
+
+  std::size_t chunk_count() const noexcept { return m_Chunks.size(); }
+
+  /**
+   * @brief Bytes held by compressed chunks
+   *
+   * @details
+   * Reflects dirty cached chunks only after flush().
+   */
+  std::size_t compressed_bytes() const
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::size_t _retval = 0;
+    for (const auto& it : m_Chunks) {
+      _retval += it.m_Bytes.size();
+    }
+    return _retval;
+  }
+
+  /**
+   * @brief Uncompressed size over compressed size
+   */
+  double ratio() const
+  {
+    const std::size_t _compressed = compressed_bytes();
+    return _compressed ? static_cast<double>(m_Size * sizeof(T)) / _compressed
+                       : 1.0;
+  }
+
+  /**
+   * @brief Reads an element
+   *
+   * @param N Global index to access
+   */
+  T get(std::size_t N) const
+  {
+    check(N);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return chunk(N / m_ChunkElements)[N % m_ChunkElements];
+  }
+
+  /**
+   * @brief Writes an element
+   *
+   * @param N Global index to access
+   * @param p_Value Value to be stored
+   */
+  void set(std::size_t N, const T& p_Value)
+  {
+    check(N);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Cached& _cached = cached(N / m_ChunkElements);
+    _cached.m_Dirty = true;
+    _cached.m_Data[N % m_ChunkElements] = p_Value;
+  }
+
+  /**
+   * @brief Element access operator
+   *
+   * @param N Global index to access
+   *
+   * @return Element at index, see class details on its lifetime
+   */
+  T& operator[](std::size_t N)
+  {
+    check(N);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Cached& _cached = cached(N / m_ChunkElements);
+    _cached.m_Dirty = true;
+    return _cached.m_Data[N % m_ChunkElements];
+  }
+
+  const T& operator[](std::size_t N) const
+  {
+    check(N);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return chunk(N / m_ChunkElements)[N % m_ChunkElements];
+  }
+
+  T& at(const std::array<std::size_t, Rank>& p_Dims)
+  {
+    return (*this)[calculateIndex(p_Dims)];
+  }
+
+  const T& at(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return (*this)[calculateIndex(p_Dims)];
+  }
+
+  /**
+   * @brief Recompresses every modified cached chunk
+   */
+  void flush() const
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    flush_locked();
+  }
+
+  /**
+   * @brief Visits every chunk in order, decompressed
+   *
+   * @param p_Fn Callable invoked with a std::span<const T> and the index
+   * of its first element
+   *
+   * @details
+   * Streams through a private buffer, leaving the cache untouched.
+   */
+  template<typename F>
+  void for_each_chunk(F&& p_Fn) const
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    flush_locked();
+    std::vector<T> _buffer(m_ChunkElements);
+    for (std::size_t i = 0; i < m_Chunks.size(); ++i) {
+      const std::span<T> _chunk(_buffer.data(), chunk_size(i));
+      load(i, _chunk);
+      p_Fn(std::span<const T>(_chunk), i * m_ChunkElements);
+    }
+  }
+
+  /**
+   * @brief Decompresses into an ordinary tensor
+   */
+  Tensor<T, Rank> to_tensor() const
+  {
+    std::array<std::size_t, Rank> _dims = m_DimensionsData;
+    Tensor<T, Rank> _retval(std::move(_dims));
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    flush_locked();
+    for (std::size_t i = 0; i < m_Chunks.size(); ++i) {
+      load(i,
+           std::span<T>(_retval.storage() + i * m_ChunkElements, chunk_size(i)));
+    }
+    return _retval;
+  }
+
+private:
+  struct Chunk
+  {
+    std::vector<std::byte> m_Bytes;
+    bool m_Raw = false;
+  };
+
+  struct Cached
+  {
+    std::size_t m_Index;
+    std::vector<T> m_Data;
+    bool m_Dirty = false;
+  };
+
+  void check(std::size_t N) const
+  {
+    if (N >= size()) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+  }
+
+  std::size_t chunk_size(std::size_t p_Index) const noexcept
+  {
+    return std::min(m_ChunkElements, m_Size - p_Index * m_ChunkElements);
+  }
+
+  void store(std::size_t p_Index, std::span<const T> p_Data) const
+  {
+    const auto _raw = std::as_bytes(p_Data);
+    Chunk& _chunk = m_Chunks[p_Index];
+    _chunk.m_Bytes = codec::compress(_raw, sizeof(T));
+    _chunk.m_Raw = _chunk.m_Bytes.size() >= _raw.size();
+    if (_chunk.m_Raw) {
+      _chunk.m_Bytes.assign(_raw.begin(), _raw.end());
+    }
+    _chunk.m_Bytes.shrink_to_fit();
+  }
+
+  void load(std::size_t p_Index, std::span<T> p_Out) const
+  {
+    const Chunk& _chunk = m_Chunks[p_Index];
+    const auto _out = std::as_writable_bytes(p_Out);
+    if (_chunk.m_Raw) {
+      std::memcpy(_out.data(), _chunk.m_Bytes.data(), _out.size());
+    } else {
+      codec::decompress(_chunk.m_Bytes, _out, sizeof(T));
+    }
+  }
+
+  /**
+   * @brief Cached chunk, most recently used first
+   */
+  Cached& cached(std::size_t p_Index) const
+  {
+    for (auto it = m_Cache.begin(); it != m_Cache.end(); ++it) {
+      if (it->m_Index == p_Index) {
+        m_Cache.splice(m_Cache.begin(), m_Cache, it);
+        return m_Cache.front();
+      }
+    }
+    if (m_Cache.size() >= m_CacheChunks) {
+      Cached& _victim = m_Cache.back();
+      if (_victim.m_Dirty) {
+        store(_victim.m_Index, _victim.m_Data);
+      }
+      m_Cache.pop_back();
+    }
+    Cached _entry{ p_Index, std::vector<T>(chunk_size(p_Index)), false };
+    load(p_Index, _entry.m_Data);
+    m_Cache.push_front(std::move(_entry));
+    return m_Cache.front();
+  }
+
+  const T* chunk(std::size_t p_Index) const { return cached(p_Index).m_Data.data(); }
+
+  void flush_locked() const
+  {
+    for (auto& it : m_Cache) {
+      if (it.m_Dirty) {
+        store(it.m_Index, it.m_Data);
+        it.m_Dirty = false;
+      }
+    }
+  }
+
+  std::size_t calculateIndex(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return detail::checked_index(p_Dims, m_DimensionsData);
+  }
+
+  std::array<std::size_t, Rank> m_DimensionsData;
+  std::size_t m_Size = 0;
+  std::size_t m_ChunkElements;
+  std::size_t m_CacheChunks;
+  mutable std::vector<Chunk> m_Chunks;
+  mutable std::list<Cached> m_Cache;
+  mutable std::mutex m_Mutex;
+};
+
+}
@@ -0,0 +1,424 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Tensor.hpp"
+#include "TensorView.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <initializer_list>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace TenSore {
+
+namespace detail {
+
+/**
+ * @brief Elements below which a copy is not worth splitting
+ */
+inline constexpr std::size_t k_MinCopyTask = std::size_t{ 1 } << 16;
+
+/**
+ * @brief Dimensions of the concatenation of views along an axis
+ */
+template<typename T, std::size_t Rank>
+std::array<std::size_t, Rank>
+concat_dimensions(const std::vector<TensorView<T, Rank>>& p_Parts, std::size_t p_Axis)
+{
+  if (p_Axis >= Rank) {
+    throw std::out_of_range("Axis out of bounds");
+  }
+  if (p_Parts.empty()) {
+    throw std::invalid_argument("Nothing to concatenate");
+  }
+  std::array<std::size_t, Rank> _retval = p_Parts.front().dimensions();
+  _retval[p_Axis] = 0;
+  for (const auto& it : p_Parts) {
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (i != p_Axis && it.dimensions()[i] != _retval[i]) {
+        throw std::invalid_argument("Mismatched dimensions of views");
+      }
+    }
+    _retval[p_Axis] += it.dimensions()[p_Axis];
+  }
+  return _retval;
+}
+
+/**
+ * @brief View with an axis of extent 1 inserted
+ */
+template<typename T, std::size_t Rank>
+TensorView<T, Rank + 1>
+unsqueeze(const TensorView<T, Rank>& p_View, std::size_t p_Axis)
+{
+  if (p_Axis > Rank) {
+    throw std::out_of_range("Axis out of bounds");
+  }
+  std::array<std::size_t, Rank + 1> _dims;
+  std::array<std::ptrdiff_t, Rank + 1> _strides;
+  for (std::size_t i = 0, j = 0; i <= Rank; ++i) {
+    if (i == p_Axis) {
+      _dims[i] = 1;
+      _strides[i] = 0;
+    } else {
+      _dims[i] = p_View.dimensions()[j];
+      _strides[i] = p_View.strides()[j];
+      ++j;
+    }
+  }
+  return TensorView<T, Rank + 1>(p_View.storage(), _dims, _strides);
+}
+
+/**
+ * @brief Copies views into consecutive ranges along an axis of a target
+ *
+ * @details
+ * A contiguous part lands in a contiguous target as one block of
+ * `part extent * product of the inner dimensions` elements per index of
+ * the outer dimensions, each copied at once; other parts go through
+ * copy_view(). Large parts are split along the outermost dimension, or
+ * into element ranges when that is the axis itself, so every task writes
+ * its own region of the target.
+ */
+template<typename U, typename T, std::size_t Rank>
+void
+concat(const std::vector<TensorView<U, Rank>>& p_Parts,
+       std::size_t p_Axis,
+       const TensorView<T, Rank>& p_To,
+       ThreadPool& p_Pool)
+{
+  if (concat_dimensions(p_Parts, p_Axis) != p_To.dimensions()) {
+    throw std::invalid_argument("Mismatched dimensions of views");
+  }
+  std::size_t _inner = 1;
+  for (std::size_t i = 0; i < p_Axis; ++i) {
+    _inner *= p_To.dimensions()[i];
+  }
+  std::size_t _middle = 1;
+  if constexpr (Rank > 1) {
+    for (std::size_t i = p_Axis + 1; i < Rank - 1; ++i) {
+      _middle *= p_To.dimensions()[i];
+    }
+  }
+  const bool _outermost = p_Axis + 1 == Rank;
+
+  struct Job
+  {
+    std::size_t m_Part;
+    std::size_t m_Offset;
+    std::size_t m_First;
+    std::size_t m_Last;
+  };
+  std::vector<Job> _jobs;
+  std::size_t _offset = 0;
+  std::size_t _total = 0;
+  for (std::size_t p = 0; p < p_Parts.size(); ++p) {
+    const auto& _part = p_Parts[p];
+    const bool _blocks = _part.contiguous() && p_To.contiguous();
+    // Along the outermost axis a contiguous part is one block, split into
+    // element ranges; otherwise jobs take ranges of the outermost dimension.
+    const std::size_t _range =
+      _outermost ? (_blocks ? _part.size() : 1) : _part.dimensions()[Rank - 1];
+    const std::size_t _pieces =
+      std::clamp<std::size_t>(_part.size() / k_MinCopyTask, 1, std::max<std::size_t>(_range, 1));
+    for (std::size_t i = 0; i < _pieces; ++i) {
+      _jobs.push_back(Job{ p, _offset, _range * i / _pieces, _range * (i + 1) / _pieces });
+    }
+    _offset += _part.dimensions()[p_Axis];
+    _total += _part.size();
+  }
+
+  auto _run = [&](const Job& p_Job) {
+    const auto& _part = p_Parts[p_Job.m_Part];
+    const std::size_t _extent = _part.dimensions()[p_Axis];
+    if (_part.size() == 0 || p_Job.m_First == p_Job.m_Last) {
+      return;
+    }
+    if (_part.contiguous() && p_To.contiguous()) {
+      const std::size_t _block = _inner * _extent;
+      const std::size_t _stride = _inner * p_To.dimensions()[p_Axis];
+      T* const _to = p_To.storage() + _inner * p_Job.m_Offset;
+      if (_outermost) {
+        std::copy(_part.storage() + p_Job.m_First,
+                  _part.storage() + p_Job.m_Last,
+                  _to + p_Job.m_First);
+        return;
+      }
+      for (std::size_t o = p_Job.m_First * _middle; o < p_Job.m_Last * _middle; ++o) {
+        std::copy_n(_part.storage() + o * _block, _block, _to + o * _stride);
+      }
+      return;
+    }
+    std::array<std::size_t, Rank> _from_offsets{};
+    std::array<std::size_t, Rank> _to_offsets{};
+    std::array<std::size_t, Rank> _extents = _part.dimensions();
+    _to_offsets[p_Axis] = p_Job.m_Offset;
+    if (!_outermost) {
+      _from_offsets[Rank - 1] = _to_offsets[Rank - 1] = p_Job.m_First;
+      _extents[Rank - 1] = p_Job.m_Last - p_Job.m_First;
+    }
+    copy_view(_part.subview(_from_offsets, _extents), p_To.subview(_to_offsets, _extents));
+  };
+
+  if (_jobs.size() > 1 && _total >= 2 * k_MinCopyTask && p_Pool.size() > 1) {
+    p_Pool.parallel_for(_jobs.size(), [&](std::size_t i) { _run(_jobs[i]); });
+  } else {
+    for (const auto& it : _jobs) {
+      _run(it);
+    }
+  }
+}
+
+template<typename T, std::size_t Rank, typename... S>
+std::vector<TensorView<const T, Rank>>
+const_views(const S&... p_Parts)
+{
+  return std::vector<TensorView<const T, Rank>>{ TensorView<const T, Rank>(as_view(p_Parts))... };
+}
+
+template<typename S>
+inline constexpr std::size_t view_rank_of =
+  std::tuple_size_v<std::remove_cvref_t<decltype(std::declval<view_t<const S>>().dimensions())>>;
+
+}
+
+/**
+ * @brief Concatenates views along an axis into a caller-provided target
+ *
+ * @param p_Target Tensor or view whose dimensions are those of the parts,
+ * with the sum of their extents along the axis
+ * @param p_Axis Axis along which to concatenate
+ * @param p_Parts Views of equal dimensions except along the axis, not
+ * overlapping the target
+ * @param p_Pool Pool copying in parallel for large outputs
+ */
+template<typename D, typename T, std::size_t Rank>
+  requires ViewLike<std::remove_reference_t<D>>
+void
+concat_into(D&& p_Target,
+            std::size_t p_Axis,
+            const std::vector<TensorView<T, Rank>>& p_Parts,
+            ThreadPool& p_Pool = ThreadPool::global())
+{
+  detail::concat(p_Parts, p_Axis, as_view(p_Target), p_Pool);
+}
+
+/**
+ * @brief Concatenates tensors or views along an axis into a
+ * caller-provided target, on the global pool
+ */
+template<typename D, typename S, typename... Ss>
+  requires ViewLike<std::remove_reference_t<D>> && ViewLike<const S> && (ViewLike<const Ss> && ...)
+void
+concat_into(D&& p_Target, std::size_t p_Axis, const S& p_Part, const Ss&... p_Parts)
+{
+  using T = std::ranges::range_value_t<view_t<const S>>;
+  concat_into(std::forward<D>(p_Target),
+              p_Axis,
+              detail::const_views<T, detail::view_rank_of<S>>(p_Part, p_Parts...));
+}
+
+/**
+ * @brief Concatenates views along an axis
+ *
+ * @return Tensor with the dimensions of the parts, with the sum of their
+ * extents along the axis; the output is allocated once and filled by
+ * block copies
+ */
+template<typename T, std::size_t Rank>
+Tensor<std::remove_const_t<T>, Rank>
+concat(std::size_t p_Axis,
+       const std::vector<TensorView<T, Rank>>& p_Parts,
+       ThreadPool& p_Pool = ThreadPool::global())
+{
+  std::array<std::size_t, Rank> _dims = detail::concat_dimensions(p_Parts, p_Axis);
+  Tensor<std::remove_const_t<T>, Rank> _retval(std::move(_dims));
+  detail::concat(p_Parts, p_Axis, as_view(_retval), p_Pool);
+  return _retval;
+}
+
+/**
+ * @brief Concatenates tensors or views along an axis, on the global pool
+ *
+ * @details
+ * `concat(1, a, b, c)` joins matrices side by side.
+ */
+template<typename S, typename... Ss>
+  requires ViewLike<const S> && (ViewLike<const Ss> && ...)
+auto
+concat(std::size_t p_Axis, const S& p_Part, const Ss&... p_Parts)
+{
+  using T = std::ranges::range_value_t<view_t<const S>>;
+  return concat(p_Axis, detail::const_views<T, detail::view_rank_of<S>>(p_Part, p_Parts...));
+}
+
+/**
+ * @brief Stacks views of equal dimensions along a new axis into a
+ * caller-provided target
+ *
+ * @param p_Target Tensor or view of rank `Rank + 1`, with the parts'
+ * dimensions and the amount of parts inserted at the axis
+ * @param p_Axis Position of the new axis, from 0 to Rank
+ * @param p_Parts Views of equal dimensions
+ * @param p_Pool Pool copying in parallel for large outputs
+ */
+template<typename D, typename T, std::size_t Rank>
+  requires ViewLike<std::remove_reference_t<D>>
+void
+stack_into(D&& p_Target,
+           std::size_t p_Axis,
+           const std::vector<TensorView<T, Rank>>& p_Parts,
+           ThreadPool& p_Pool = ThreadPool::global())
+{
+  std::vector<TensorView<T, Rank + 1>> _parts;
+  _parts.reserve(p_Parts.size());
+  for (const auto& it : p_Parts) {
+    _parts.push_back(detail::unsqueeze(it, p_Axis));
+  }
+  detail::concat(_parts, p_Axis, as_view(p_Target), p_Pool);
+}
+
+/**
+ * @brief Stacks tensors or views along a new axis into a caller-provided
+ * target, on the global pool
+ */
+template<typename D, typename S, typename... Ss>
+  requires ViewLike<std::remove_reference_t<D>> && ViewLike<const S> && (ViewLike<const Ss> && ...)
+void
+stack_into(D&& p_Target, std::size_t p_Axis, const S& p_Part, const Ss&... p_Parts)
+{
+  using T = std::ranges::range_value_t<view_t<const S>>;
+  stack_into(std::forward<D>(p_Target),
+             p_Axis,
+             detail::const_views<T, detail::view_rank_of<S>>(p_Part, p_Parts...));
+}
+
+/**
+ * @brief Stacks views of equal dimensions along a new axis
+ *
+ * @return Tensor of rank `Rank + 1`, with the amount of parts inserted
+ * into the parts' dimensions at the axis
+ */
+template<typename T, std::size_t Rank>
+Tensor<std::remove_const_t<T>, Rank + 1>
+stack(std::size_t p_Axis,
+      const std::vector<TensorView<T, Rank>>& p_Parts,
+      ThreadPool& p_Pool = ThreadPool::global())
+{
+  if (p_Axis > Rank) {
+    throw std::out_of_range("Axis out of bounds");
+  }
+  if (p_Parts.empty()) {
+    throw std::invalid_argument("Nothing to stack");
+  }
+  std::array<std::size_t, Rank + 1> _dims;
+  for (std::size_t i = 0, j = 0; i <= Rank; ++i) {
+    _dims[i] = i == p_Axis ? p_Parts.size() : p_Parts.front().dimensions()[j++];
+  }
+  Tensor<std::remove_const_t<T>, Rank + 1> _retval(std::move(_dims));
+  stack_into(_retval, p_Axis, p_Parts, p_Pool);
+  return _retval;
+}
+
+/**
+ * @brief Stacks tensors or views along a new axis, on the global pool
+ *
+ * @details
+ * `stack(2, a, b)` makes a tensor of rank 3 out of two matrices, with
+ * `a` at index 0 of the last axis.
+ */
+template<typename S, typename... Ss>
+  requires ViewLike<const S> && (ViewLike<const Ss> && ...)
+auto
+stack(std::size_t p_Axis, const S& p_Part, const Ss&... p_Parts)
+{
+  using T = std::ranges::range_value_t<view_t<const S>>;
+  return stack(p_Axis, detail::const_views<T, detail::view_rank_of<S>>(p_Part, p_Parts...));
+}
+
+/**
+ * @brief Splits a view along an axis into parts of given extents
+ *
+ * @param p_View View to split
+ * @param p_Axis Axis along which to split
+ * @param p_Sizes Extents of the parts along the axis, summing up to the
+ * view's extent
+ *
+ * @return Views of the parts, without copying; concat() of them along
+ * the axis restores the source
+ *
+ * @see split_along for parts of equal extents
+ */
+template<typename T, std::size_t Rank, typename R = std::initializer_list<std::size_t>>
+  requires std::ranges::input_range<const R> && std::integral<std::ranges::range_value_t<const R>>
+std::vector<TensorView<T, Rank>>
+split(TensorView<T, Rank> p_View, std::size_t p_Axis, const R& p_Sizes)
+{
+  if (p_Axis >= Rank) {
+    throw std::out_of_range("Axis out of bounds");
+  }
+  std::vector<TensorView<T, Rank>> _retval;
+  std::array<std::size_t, Rank> _offsets{};
+  std::array<std::size_t, Rank> _extents = p_View.dimensions();
+  for (const auto it : p_Sizes) {
+    if constexpr (std::signed_integral<std::ranges::range_value_t<const R>>) {
+      if (it < 0) {
+        throw std::invalid_argument("Sizes of parts must not be negative");
+      }
+    }
+    _extents[p_Axis] = static_cast<std::size_t>(it);
+    if (_extents[p_Axis] > p_View.dimensions()[p_Axis] - _offsets[p_Axis]) {
+      throw std::invalid_argument("Sizes of parts exceed the extent of the axis");
+    }
+    _retval.push_back(p_View.subview(_offsets, _extents));
+    _offsets[p_Axis] += _extents[p_Axis];
+  }
+  if (_offsets[p_Axis] != p_View.dimensions()[p_Axis]) {
+    throw std::invalid_argument("Sizes of parts do not cover the axis");
+  }
+  return _retval;
+}
+
+template<typename T,
+         std::size_t Rank,
+         Allocator A,
+         typename R = std::initializer_list<std::size_t>>
+std::vector<TensorView<T, Rank>>
+split(Tensor<T, Rank, A>& p_Tensor, std::size_t p_Axis, const R& p_Sizes)
+{
+  return split(as_view(p_Tensor), p_Axis, p_Sizes);
+}
+
+template<typename T,
+         std::size_t Rank,
+         Allocator A,
+         typename R = std::initializer_list<std::size_t>>
+std::vector<TensorView<const T, Rank>>
+split(const Tensor<T, Rank, A>& p_Tensor, std::size_t p_Axis, const R& p_Sizes)
+{
+  return split(as_view(p_Tensor), p_Axis, p_Sizes);
+}
+
+}
@@ -0,0 +1,377 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "NdIterator.hpp"
+#include "Tensor.hpp"
+#include "TensorView.hpp"
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Definitions of the DLPack ABI, version 0.8 (https://github.com/dmlc/dlpack).
+ * They define the include guard of dlpack.h, so that including the
+ * original header afterwards is harmless; if it was included before,
+ * its definitions are used instead.
+ */
+#ifndef DLPACK_DLPACK_H_
+#define DLPACK_DLPACK_H_
+
+#define DLPACK_VERSION 80
+#define DLPACK_ABI_VERSION 1
+
+extern "C" {
+
+typedef enum
+{
+  kDLCPU = 1,
+  kDLCUDA = 2,
+  kDLCUDAHost = 3,
+  kDLOpenCL = 4,
+  kDLVulkan = 7,
+  kDLMetal = 8,
+  kDLVPI = 9,
+  kDLROCM = 10,
+  kDLROCMHost = 11,
+  kDLExtDev = 12,
+  kDLCUDAManaged = 13,
+  kDLOneAPI = 14,
+  kDLWebGPU = 15,
+  kDLHexagon = 16,
+} DLDeviceType;
+
+typedef struct
+{
+  DLDeviceType device_type;
+  int32_t device_id;
+} DLDevice;
+
+typedef enum
+{
+  kDLInt = 0U,
+  kDLUInt = 1U,
+  kDLFloat = 2U,
+  kDLOpaqueHandle = 3U,
+  kDLBfloat = 4U,
+  kDLComplex = 5U,
+  kDLBool = 6U,
+} DLDataTypeCode;
+
+typedef struct
+{
+  uint8_t code;
+  uint8_t bits;
+  uint16_t lanes;
+} DLDataType;
+
+typedef struct
+{
+  void* data;
+  DLDevice device;
+  int32_t ndim;
+  DLDataType dtype;
+  int64_t* shape;
+  int64_t* strides;
+  uint64_t byte_offset;
+} DLTensor;
+
+typedef struct DLManagedTensor
+{
+  DLTensor dl_tensor;
+  void* manager_ctx;
+  void (*deleter)(struct DLManagedTensor* self);
+} DLManagedTensor;
+}
+
+#endif
+
+namespace TenSore {
+
+/**
+ * @brief DLPack type descriptor of an element type
+ */
+template<typename T>
+constexpr DLDataType
+dlpack_dtype() noexcept
+{
+  using U = std::remove_cv_t<T>;
+  constexpr auto _bits = static_cast<std::uint8_t>(sizeof(U) * 8);
+  if constexpr (std::is_same_v<U, bool>) {
+    return DLDataType{ kDLBool, 8, 1 };
+  } else if constexpr (std::is_integral_v<U>) {
+    return DLDataType{ std::is_signed_v<U> ? std::uint8_t{ kDLInt } : std::uint8_t{ kDLUInt },
+                       _bits,
+                       1 };
+  } else if constexpr (std::is_floating_point_v<U>) {
+    return DLDataType{ kDLFloat, _bits, 1 };
+  } else if constexpr (std::is_same_v<U, std::complex<float>> ||
+                       std::is_same_v<U, std::complex<double>>) {
+    return DLDataType{ kDLComplex, _bits, 1 };
+  } else {
+    static_assert(sizeof(U) == 0, "Type has no DLPack equivalent");
+  }
+}
+
+namespace detail {
+
+/**
+ * @brief Manager context of an exported tensor: the owner of its memory
+ * and the shape and strides arrays the DLTensor points to
+ */
+template<typename Owner, std::size_t Rank>
+struct DLPackContext
+{
+  Owner m_Owner;
+  std::array<std::int64_t, Rank> m_Shape;
+  std::array<std::int64_t, Rank> m_Strides;
+  DLManagedTensor m_Managed;
+};
+
+template<typename Owner, typename T, std::size_t Rank>
+DLManagedTensor*
+make_managed(Owner&& p_Owner,
+             T* p_Data,
+             const std::array<std::size_t, Rank>& p_Dimensions,
+             const std::array<std::ptrdiff_t, Rank>& p_Strides)
+{
+  using Context = DLPackContext<std::remove_cvref_t<Owner>, Rank>;
+  auto* _context = new Context{ std::forward<Owner>(p_Owner), {}, {}, {} };
+  for (std::size_t i = 0; i < Rank; ++i) {
+    _context->m_Shape[i] = static_cast<std::int64_t>(p_Dimensions[i]);
+    _context->m_Strides[i] = static_cast<std::int64_t>(p_Strides[i]);
+  }
+  DLTensor& _tensor = _context->m_Managed.dl_tensor;
+  _tensor.data = const_cast<std::remove_const_t<T>*>(p_Data);
+  _tensor.device = DLDevice{ kDLCPU, 0 };
+  _tensor.ndim = static_cast<std::int32_t>(Rank);
+  _tensor.dtype = dlpack_dtype<T>();
+  _tensor.shape = _context->m_Shape.data();
+  _tensor.strides = _context->m_Strides.data();
+  _tensor.byte_offset = 0;
+  _context->m_Managed.manager_ctx = _context;
+  _context->m_Managed.deleter = [](DLManagedTensor* p_Self) {
+    delete static_cast<Context*>(p_Self->manager_ctx);
+  };
+  return &_context->m_Managed;
+}
+
+}
+
+/**
+ * @brief Exports a tensor, handing its buffer over to the consumer
+ *
+ * @param p_Tensor Tensor to export, moved from without copying elements
+ *
+ * @return Managed tensor whose deleter frees the buffer
+ *
+ * @details
+ * Shape and strides are Tensor's dimensions and its first-dimension-fastest
+ * strides, so element (i, j, ...) is the same on both sides; consumers
+ * that expect row-major data see a Fortran-ordered array.
+ */
+template<typename T, std::size_t Rank, Allocator A>
+DLManagedTensor*
+to_dlpack(Tensor<T, Rank, A>&& p_Tensor)
+{
+  const auto _dims = p_Tensor.dimensions();
+  auto _owner = std::make_unique<Tensor<T, Rank, A>>(std::move(p_Tensor));
+  T* const _data = _owner->storage();
+  return detail::make_managed(std::move(_owner), _data, _dims, dense_strides(_dims));
+}
+
+/**
+ * @brief Exports a shared tensor, keeping it alive until the consumer
+ * releases the export
+ */
+template<typename T, std::size_t Rank, Allocator A>
+DLManagedTensor*
+to_dlpack(std::shared_ptr<Tensor<T, Rank, A>> p_Tensor)
+{
+  if (!p_Tensor) {
+    throw std::invalid_argument("Cannot export a null tensor");
+  }
+  const auto _dims = p_Tensor->dimensions();
+  T* const _data = p_Tensor->storage();
+  return detail::make_managed(std::move(p_Tensor), _data, _dims, dense_strides(_dims));
+}
+
+/**
+ * @brief Exports a view
+ *
+ * @param p_View View to export, with its strides
+ * @param p_Owner Object kept alive until the consumer releases the export;
+ * without one, the viewed memory must outlive the export
+ */
+template<typename T, std::size_t Rank>
+DLManagedTensor*
+to_dlpack(const TensorView<T, Rank>& p_View, std::shared_ptr<const void> p_Owner = {})
+{
+  return detail::make_managed(
+    std::move(p_Owner), p_View.storage(), p_View.dimensions(), p_View.strides());
+}
+
+/**
+ * @class DLPackView
+ * @brief View of an imported DLPack tensor that owns the import
+ *
+ * @tparam T The type of value, const-qualified for read-only access
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * Calls the producer's deleter when destroyed, unless release() handed
+ * the managed tensor back. A read-only import of a producer's matrix:
+ *
+ *     const DLPackView<const double, 2> _in(p_Managed);
+ *     const TensorView<const double, 2> _view = _in;
+ *     const double _sum = std::accumulate(_view.begin(), _view.end(), 0.0);
+ */
+template<typename T, std::size_t Rank>
+class DLPackView
+{
+public:
+  DLPackView() = delete;
+
+  /**
+   * @brief Takes over a managed tensor
+   *
+   * @param p_Managed Managed tensor from a producer
+   *
+   * @details
+   * Throws std::invalid_argument, leaving ownership with the caller, if
+   * the element type, rank or device does not match or the memory is not
+   * accessible from the host. Missing strides mean a compact row-major
+   * tensor, as DLPack specifies.
+   */
+  explicit DLPackView(DLManagedTensor* p_Managed)
+  {
+    if (!p_Managed) {
+      throw std::invalid_argument("Cannot import a null tensor");
+    }
+    const DLTensor& _tensor = p_Managed->dl_tensor;
+    const DLDataType _expected = dlpack_dtype<T>();
+    if (_tensor.dtype.code != _expected.code || _tensor.dtype.bits != _expected.bits ||
+        _tensor.dtype.lanes != _expected.lanes) {
+      throw std::invalid_argument("DLPack tensor holds another element type");
+    }
+    if (_tensor.ndim != static_cast<std::int32_t>(Rank)) {
+      throw std::invalid_argument("DLPack tensor has another rank");
+    }
+    if (_tensor.device.device_type != kDLCPU &&
+        _tensor.device.device_type != kDLCUDAHost &&
+        _tensor.device.device_type != kDLROCMHost &&
+        _tensor.device.device_type != kDLCUDAManaged) {
+      throw std::invalid_argument("DLPack tensor is not accessible from the host");
+    }
+    std::array<std::size_t, Rank> _dims;
+    std::array<std::ptrdiff_t, Rank> _strides;
+    std::ptrdiff_t _compact = 1;
+    for (std::size_t i = Rank; i-- > 0;) {
+      _dims[i] = static_cast<std::size_t>(_tensor.shape[i]);
+      _strides[i] = _tensor.strides ? static_cast<std::ptrdiff_t>(_tensor.strides[i])
+                                    : _compact;
+      _compact *= static_cast<std::ptrdiff_t>(_dims[i]);
+    }
+    auto* _data = reinterpret_cast<T*>(static_cast<std::byte*>(_tensor.data) +
+                                       _tensor.byte_offset);
+    m_View = TensorView<T, Rank>(_data, _dims, _strides);
+    m_Managed = p_Managed;
+  }
+
+  DLPackView(const DLPackView&) = delete;
+  DLPackView& operator=(const DLPackView&) = delete;
+
+  DLPackView(DLPackView&& p_Other) noexcept
+    : m_Managed(std::exchange(p_Other.m_Managed, nullptr))
+    , m_View(p_Other.m_View)
+  {
+  }
+
+  DLPackView& operator=(DLPackView&& p_Other) noexcept
+  {
+    if (this != &p_Other) {
+      reset();
+      m_Managed = std::exchange(p_Other.m_Managed, nullptr);
+      m_View = p_Other.m_View;
+    }
+    return *this;
+  }
+
+  ~DLPackView() { reset(); }
+
+  const TensorView<T, Rank>& view() const noexcept { return m_View; }
+
+  operator TensorView<T, Rank>() const noexcept { return m_View; }
+
+  operator TensorView<const T, Rank>() const noexcept
+    requires(!std::is_const_v<T>)
+  {
+    return m_View;
+  }
+
+  std::size_t size() const noexcept { return m_View.size(); }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_View.dimensions();
+  }
+
+  T& at(const std::array<std::size_t, Rank>& p_Dims) const { return m_View.at(p_Dims); }
+
+  T& operator()(const std::array<std::size_t, Rank>& p_Dims) const { return m_View(p_Dims); }
+
+  /**
+   * @brief Gives the managed tensor back without calling its deleter
+   */
+  DLManagedTensor* release() noexcept
+  {
+    m_View = TensorView<T, Rank>();
+    return std::exchange(m_Managed, nullptr);
+  }
+
+private:
+  void reset() noexcept
+  {
+    if (m_Managed && m_Managed->deleter) {
+      m_Managed->deleter(m_Managed);
+    }
+    m_Managed = nullptr;
+  }
+
+  DLManagedTensor* m_Managed = nullptr;
+  TensorView<T, Rank> m_View;
+};
+
+/**
+ * @brief Imports a managed tensor without copying
+ *
+ * @see DLPackView::DLPackView
+ */
+template<typename T, std::size_t Rank>
+DLPackView<T, Rank>
+from_dlpack(DLManagedTensor* p_Managed)
+{
+  return DLPackView<T, Rank>(p_Managed);
+}
+
+}
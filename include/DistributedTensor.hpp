@@ -0,0 +1,483 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "TensorView.hpp"
+#include "Transport.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @brief Sizes of a block distribution of `p_Total` items over `p_Parts`
+ */
+inline std::vector<std::size_t>
+block_counts(std::size_t p_Total, std::size_t p_Parts)
+{
+  std::vector<std::size_t> _retval(p_Parts);
+  for (std::size_t i = 0; i < p_Parts; ++i) {
+    _retval[i] = p_Total * (i + 1) / p_Parts - p_Total * i / p_Parts;
+  }
+  return _retval;
+}
+
+/**
+ * @brief Copies a buffer from a root rank to every rank
+ *
+ * @details
+ * Binomial tree: log2(size) rounds.
+ */
+template<typename T>
+void
+broadcast(Transport& p_Transport, std::span<T> p_Data, std::size_t p_Root = 0)
+{
+  static_assert(std::is_trivially_copyable_v<T>);
+  const std::size_t _size = p_Transport.size();
+  const std::size_t _relative = (p_Transport.rank() + _size - p_Root) % _size;
+  std::size_t _mask = 1;
+  while (_mask < _size) {
+    if (_relative & _mask) {
+      p_Transport.recv(
+        (_relative - _mask + p_Root) % _size, p_Data.data(), p_Data.size_bytes());
+      break;
+    }
+    _mask <<= 1;
+  }
+  for (_mask >>= 1; _mask > 0; _mask >>= 1) {
+    if (_relative + _mask < _size) {
+      p_Transport.send(
+        (_relative + _mask + p_Root) % _size, p_Data.data(), p_Data.size_bytes());
+    }
+  }
+}
+
+/**
+ * @brief Concatenates a block from every rank, in rank order, on all ranks
+ *
+ * @param p_Local Block of this rank
+ * @param p_Counts Size of every rank's block
+ *
+ * @details
+ * Ring algorithm: size - 1 steps, each moving one block per rank.
+ */
+template<typename T>
+std::vector<T>
+all_gather(Transport& p_Transport,
+           std::span<const T> p_Local,
+           const std::vector<std::size_t>& p_Counts)
+{
+  static_assert(std::is_trivially_copyable_v<T>);
+  const std::size_t _size = p_Transport.size();
+  const std::size_t _rank = p_Transport.rank();
+  if (p_Counts.size() != _size || p_Counts[_rank] != p_Local.size()) {
+    throw std::invalid_argument("Block sizes do not match the job");
+  }
+  std::vector<std::size_t> _offsets(_size + 1, 0);
+  std::partial_sum(p_Counts.begin(), p_Counts.end(), _offsets.begin() + 1);
+  std::vector<T> _retval(_offsets.back());
+  std::copy(p_Local.begin(), p_Local.end(), _retval.begin() + _offsets[_rank]);
+  const std::size_t _next = (_rank + 1) % _size;
+  const std::size_t _prev = (_rank + _size - 1) % _size;
+  for (std::size_t s = 0; s + 1 < _size; ++s) {
+    const std::size_t _out = (_rank + _size - s) % _size;
+    const std::size_t _in = (_rank + _size - s - 1) % _size;
+    p_Transport.sendrecv(_next,
+                         _retval.data() + _offsets[_out],
+                         p_Counts[_out] * sizeof(T),
+                         _prev,
+                         _retval.data() + _offsets[_in],
+                         p_Counts[_in] * sizeof(T));
+  }
+  return _retval;
+}
+
+/**
+ * @brief all_gather() of blocks whose sizes are not known in advance
+ */
+template<typename T>
+std::vector<T>
+all_gather(Transport& p_Transport, std::span<const T> p_Local)
+{
+  const std::uint64_t _count = p_Local.size();
+  const auto _counts64 = all_gather<std::uint64_t>(
+    p_Transport,
+    std::span<const std::uint64_t>(&_count, 1),
+    std::vector<std::size_t>(p_Transport.size(), 1));
+  return all_gather(
+    p_Transport, p_Local, std::vector<std::size_t>(_counts64.begin(), _counts64.end()));
+}
+
+/**
+ * @brief Element-wise reduction of equally sized buffers, scattered
+ *
+ * @param p_Data Buffer of this rank, the same size on all ranks
+ * @param p_Counts Size of the block every rank receives, summing to the
+ * size of p_Data
+ * @param p_Op Associative and commutative binary operation
+ *
+ * @return Block of this rank, reduced over all ranks
+ *
+ * @details
+ * Ring algorithm: size - 1 steps, each moving one block per rank, so
+ * every rank sends and receives (size - 1) / size of the buffer.
+ */
+template<typename T, typename Op = std::plus<>>
+std::vector<T>
+reduce_scatter(Transport& p_Transport,
+               std::span<const T> p_Data,
+               const std::vector<std::size_t>& p_Counts,
+               Op p_Op = {})
+{
+  static_assert(std::is_trivially_copyable_v<T>);
+  const std::size_t _size = p_Transport.size();
+  const std::size_t _rank = p_Transport.rank();
+  std::vector<std::size_t> _offsets(_size + 1, 0);
+  if (p_Counts.size() != _size) {
+    throw std::invalid_argument("Block sizes do not match the job");
+  }
+  std::partial_sum(p_Counts.begin(), p_Counts.end(), _offsets.begin() + 1);
+  if (_offsets.back() != p_Data.size()) {
+    throw std::invalid_argument("Block sizes do not cover the buffer");
+  }
+  std::vector<T> _work(p_Data.begin(), p_Data.end());
+  const std::size_t _largest = *std::max_element(p_Counts.begin(), p_Counts.end());
+  std::vector<T> _incoming(_largest);
+  const std::size_t _next = (_rank + 1) % _size;
+  const std::size_t _prev = (_rank + _size - 1) % _size;
+  for (std::size_t s = 0; s + 1 < _size; ++s) {
+    const std::size_t _out = (_rank + 2 * _size - s - 1) % _size;
+    const std::size_t _in = (_rank + 2 * _size - s - 2) % _size;
+    p_Transport.sendrecv(_next,
+                         _work.data() + _offsets[_out],
+                         p_Counts[_out] * sizeof(T),
+                         _prev,
+                         _incoming.data(),
+                         p_Counts[_in] * sizeof(T));
+    T* _block = _work.data() + _offsets[_in];
+    for (std::size_t i = 0; i < p_Counts[_in]; ++i) {
+      _block[i] = p_Op(_block[i], _incoming[i]);
+    }
+  }
+  return std::vector<T>(_work.begin() + _offsets[_rank],
+                        _work.begin() + _offsets[_rank + 1]);
+}
+
+/**
+ * @brief Element-wise reduction of equally sized buffers, in place on all
+ * ranks
+ *
+ * @details
+ * reduce_scatter() followed by all_gather(): bandwidth-optimal for large
+ * buffers.
+ */
+template<typename T, typename Op = std::plus<>>
+void
+all_reduce(Transport& p_Transport, std::span<T> p_Data, Op p_Op = {})
+{
+  const auto _counts = block_counts(p_Data.size(), p_Transport.size());
+  const auto _block =
+    reduce_scatter(p_Transport, std::span<const T>(p_Data), _counts, p_Op);
+  const auto _all = all_gather(p_Transport, std::span<const T>(_block), _counts);
+  std::copy(_all.begin(), _all.end(), p_Data.begin());
+}
+
+/**
+ * @class DistributedTensor
+ * @brief Tensor sharded along one dimension across the ranks of a job
+ *
+ * @tparam T The type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * Every rank holds an ordinary Tensor with a contiguous block of the
+ * sharded dimension: rank r owns indices
+ * [extent * r / size, extent * (r + 1) / size).
+ */
+template<typename T, std::size_t Rank>
+class DistributedTensor
+{
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Distributed tensors hold trivially copyable types only");
+
+public:
+  DistributedTensor() = delete;
+
+  /**
+   * @brief Constructor of a value-initialized distributed tensor
+   *
+   * @param p_Transport Transport of the job, must outlive the tensor
+   * @param p_Dimensions Global dimensions
+   * @param p_Axis Sharded dimension
+   */
+  DistributedTensor(Transport& p_Transport,
+                    const std::array<std::size_t, Rank>& p_Dimensions,
+                    std::size_t p_Axis)
+    : m_Transport(&p_Transport)
+    , m_Dimensions(p_Dimensions)
+    , m_Axis(p_Axis)
+    , m_Local(local_dimensions(p_Transport, p_Dimensions, p_Axis))
+  {
+  }
+
+  /**
+   * @brief Shards a tensor every rank holds in full
+   *
+   * @param p_Global Identical on all ranks, e.g. after broadcast()
+   */
+  template<Allocator A>
+  DistributedTensor(Transport& p_Transport,
+                    const Tensor<T, Rank, A>& p_Global,
+                    std::size_t p_Axis)
+    : DistributedTensor(p_Transport, p_Global.dimensions(), p_Axis)
+  {
+    copy_view(slab(as_view(p_Global), offset(), m_Local.dimensions()[m_Axis]),
+              as_view(m_Local));
+  }
+
+  /**
+   * @brief Adopts the local shard of this rank
+   *
+   * @param p_Local Shard with the dimensions this rank owns
+   */
+  DistributedTensor(Transport& p_Transport,
+                    const std::array<std::size_t, Rank>& p_Dimensions,
+                    std::size_t p_Axis,
+                    Tensor<T, Rank> p_Local)
+    : m_Transport(&p_Transport)
+    , m_Dimensions(p_Dimensions)
+    , m_Axis(p_Axis)
+    , m_Local(std::move(p_Local))
+  {
+    if (m_Local.dimensions() != local_dimensions(p_Transport, p_Dimensions, p_Axis)) {
+      throw std::invalid_argument("Local shard does not match the distribution");
+    }
+  }
+
+  Transport& transport() const noexcept { return *m_Transport; }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_Dimensions;
+  }
+
+  std::size_t axis() const noexcept { return m_Axis; }
+
+  /**
+   * @brief Shard held by this rank
+   */
+  Tensor<T, Rank>& local() noexcept { return m_Local; }
+
+  const Tensor<T, Rank>& local() const noexcept { return m_Local; }
+
+  /**
+   * @brief Global index of the first element of the shard along axis()
+   */
+  std::size_t offset() const noexcept
+  {
+    return m_Dimensions[m_Axis] * m_Transport->rank() / m_Transport->size();
+  }
+
+  /**
+   * @brief Assembles the global tensor on every rank
+   */
+  Tensor<T, Rank> gather() const
+  {
+    const std::size_t _size = m_Transport->size();
+    const std::size_t _slice = slice_size();
+    const auto _extents = block_counts(m_Dimensions[m_Axis], _size);
+    std::vector<std::size_t> _counts(_size);
+    for (std::size_t r = 0; r < _size; ++r) {
+      _counts[r] = _extents[r] * _slice;
+    }
+    const auto _all = all_gather(
+      *m_Transport, std::span<const T>(m_Local.storage(), m_Local.size()), _counts);
+
+    std::array<std::size_t, Rank> _dims = m_Dimensions;
+    Tensor<T, Rank> _retval(std::move(_dims));
+    std::size_t _position = 0;
+    std::size_t _first = 0;
+    for (std::size_t r = 0; r < _size; ++r) {
+      std::array<std::size_t, Rank> _block = m_Dimensions;
+      _block[m_Axis] = _extents[r];
+      const TensorView<const T, Rank> _source(
+        _all.data() + _position, _block, dense_strides(_block));
+      copy_view(_source, slab(as_view(_retval), _first, _extents[r]));
+      _position += _counts[r];
+      _first += _extents[r];
+    }
+    return _retval;
+  }
+
+  /**
+   * @brief Reduction of all elements, returned on every rank
+   *
+   * @param p_Init Initial value, applied once
+   * @param p_Op Associative and commutative binary operation
+   */
+  template<typename Op = std::plus<>>
+  T reduce(T p_Init = T{}, Op p_Op = {}) const
+  {
+    T _acc{};
+    const bool _has = m_Local.size() > 0;
+    if (_has) {
+      _acc = std::accumulate(m_Local.storage() + 1,
+                             m_Local.storage() + m_Local.size(),
+                             m_Local.storage()[0],
+                             p_Op);
+    }
+    const auto _partials =
+      all_gather(*m_Transport, std::span<const T>(&_acc, _has ? 1 : 0));
+    return std::accumulate(_partials.begin(), _partials.end(), p_Init, p_Op);
+  }
+
+  T sum() const { return reduce(T{}, std::plus<>{}); }
+
+private:
+  static std::array<std::size_t, Rank> local_dimensions(
+    const Transport& p_Transport,
+    std::array<std::size_t, Rank> p_Dimensions,
+    std::size_t p_Axis)
+  {
+    if (p_Axis >= Rank) {
+      throw std::out_of_range("Axis out of bounds");
+    }
+    p_Dimensions[p_Axis] = block_counts(p_Dimensions[p_Axis],
+                                        p_Transport.size())[p_Transport.rank()];
+    return p_Dimensions;
+  }
+
+  std::size_t slice_size() const noexcept
+  {
+    std::size_t _retval = 1;
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (i != m_Axis) {
+        _retval *= m_Dimensions[i];
+      }
+    }
+    return _retval;
+  }
+
+  template<typename U>
+  TensorView<U, Rank> slab(TensorView<U, Rank> p_View,
+                           std::size_t p_First,
+                           std::size_t p_Extent) const
+  {
+    std::array<std::size_t, Rank> _offsets{};
+    std::array<std::size_t, Rank> _extents = p_View.dimensions();
+    _offsets[m_Axis] = p_First;
+    _extents[m_Axis] = p_Extent;
+    return p_View.subview(_offsets, _extents);
+  }
+
+  static void copy_view(TensorView<const T, Rank> p_From, TensorView<T, Rank> p_To)
+  {
+    auto _to = p_To.begin();
+    for (const T& it : p_From) {
+      *_to = it;
+      ++_to;
+    }
+  }
+
+  Transport* m_Transport;
+  std::array<std::size_t, Rank> m_Dimensions;
+  std::size_t m_Axis;
+  Tensor<T, Rank> m_Local;
+};
+
+namespace detail {
+
+/**
+ * @brief C(m, n) += A(m, k) * B(k, n) with column-major operands
+ */
+template<typename T>
+void
+gemm(std::size_t m, std::size_t n, std::size_t k, const T* a, const T* b, T* c)
+{
+  for (std::size_t j = 0; j < n; ++j) {
+    for (std::size_t p = 0; p < k; ++p) {
+      const T _b = b[p + j * k];
+      const T* _a = a + p * m;
+      T* _c = c + j * m;
+      for (std::size_t i = 0; i < m; ++i) {
+        _c[i] += _a[i] * _b;
+      }
+    }
+  }
+}
+
+}
+
+/**
+ * @brief Distributed matrix product
+ *
+ * @details
+ * - A sharded along its inner dimension (1) and B along its inner
+ *   dimension (0): every rank multiplies its shards, and the partial
+ *   products are summed with reduce_scatter(), giving C sharded by
+ *   columns. Only C crosses the network.
+ * - Otherwise A is resharded by rows if needed, B is gathered, and every
+ *   rank computes its rows of C locally, giving C sharded by rows.
+ */
+template<typename T>
+DistributedTensor<T, 2>
+matmul(const DistributedTensor<T, 2>& a, const DistributedTensor<T, 2>& b)
+{
+  const std::size_t m = a.dimensions()[0];
+  const std::size_t k = a.dimensions()[1];
+  const std::size_t n = b.dimensions()[1];
+  if (b.dimensions()[0] != k) {
+    throw std::invalid_argument("Misaligned dimensions in matmul");
+  }
+  Transport& _transport = a.transport();
+
+  if (a.axis() == 1 && b.axis() == 0) {
+    const std::size_t _k = a.local().dimensions()[1];
+    std::vector<T> _partial(m * n, T{});
+    detail::gemm(m, n, _k, a.local().storage(), b.local().storage(), _partial.data());
+    auto _counts = block_counts(n, _transport.size());
+    for (auto& it : _counts) {
+      it *= m;
+    }
+    const auto _block =
+      reduce_scatter(_transport, std::span<const T>(_partial), _counts);
+    Tensor<T, 2> _local({ m, _block.size() / std::max<std::size_t>(m, 1) });
+    std::copy(_block.begin(), _block.end(), _local.storage());
+    return DistributedTensor<T, 2>(_transport, { m, n }, 1, std::move(_local));
+  }
+
+  if (a.axis() != 0) {
+    return matmul(DistributedTensor<T, 2>(_transport, a.gather(), 0), b);
+  }
+  const Tensor<T, 2> _b = b.gather();
+  const std::size_t _m = a.local().dimensions()[0];
+  Tensor<T, 2> _local({ _m, n });
+  detail::gemm(_m, n, k, a.local().storage(), _b.storage(), _local.storage());
+  return DistributedTensor<T, 2>(_transport, { m, n }, 0, std::move(_local));
+}
+
+}
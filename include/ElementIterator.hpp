@@ -0,0 +1,240 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace TenSore {
+
+/**
+ * @class ElementReference
+ * @brief Proxy to one element of a container that acts on writes
+ *
+ * @tparam C Container with `const T& operator[](std::size_t) const` and a
+ * mutable `T& operator[](std::size_t)` that records the write
+ * @tparam T The type of value contained in the container
+ *
+ * @details
+ * Reading goes through the const element access and assigning through
+ * the mutable one, so a container that pages or tracks blocks only sees
+ * a modification when one really happens. Proxies are returned by value,
+ * so range-for loops bind them with `auto&&`; get() reads the element
+ * where the implicit conversion does not apply and operator-> reads
+ * members of a class type.
+ */
+template<typename C, typename T>
+class ElementReference
+{
+public:
+  ElementReference(C* p_Container, std::size_t p_Index) noexcept
+    : m_Container(p_Container)
+    , m_Index(p_Index)
+  {
+  }
+
+  ElementReference(const ElementReference&) = default;
+
+  /**
+   * @brief Reads the referenced element without marking it modified
+   */
+  const T& get() const { return std::as_const(*m_Container)[m_Index]; }
+
+  const T* operator->() const { return &get(); }
+
+  operator T() const { return get(); }
+
+  const ElementReference& operator=(const T& p_Value) const
+  {
+    (*m_Container)[m_Index] = p_Value;
+    return *this;
+  }
+
+  /**
+   * @brief Assigns the referenced value, not the reference
+   */
+  const ElementReference& operator=(const ElementReference& p_Other) const
+  {
+    return *this = static_cast<T>(p_Other);
+  }
+
+  const ElementReference& operator+=(const T& p_Value) const
+  {
+    return *this = static_cast<T>(*this) + p_Value;
+  }
+
+  const ElementReference& operator-=(const T& p_Value) const
+  {
+    return *this = static_cast<T>(*this) - p_Value;
+  }
+
+  const ElementReference& operator*=(const T& p_Value) const
+  {
+    return *this = static_cast<T>(*this) * p_Value;
+  }
+
+  const ElementReference& operator/=(const T& p_Value) const
+  {
+    return *this = static_cast<T>(*this) / p_Value;
+  }
+
+  friend void swap(const ElementReference& a, const ElementReference& b)
+  {
+    T _tmp = a;
+    a = static_cast<T>(b);
+    b = _tmp;
+  }
+
+private:
+  C* m_Container;
+  std::size_t m_Index;
+};
+
+/**
+ * @class ElementIterator
+ * @brief Random access iterator over a container's element access
+ *
+ * @tparam C Container, see ElementReference
+ * @tparam T The type of value contained in the container
+ * @tparam Const Whether the iterator is read-only
+ *
+ * @details
+ * Dereferencing a read-only iterator yields `const T&`, a mutable one
+ * yields an ElementReference proxy.
+ */
+template<typename C, typename T, bool Const>
+class ElementIterator
+{
+  using ContainerPtr = std::conditional_t<Const, const C*, C*>;
+
+public:
+  using iterator_concept = std::random_access_iterator_tag;
+  using iterator_category = std::random_access_iterator_tag;
+  using value_type = T;
+  using difference_type = std::ptrdiff_t;
+  using reference = std::conditional_t<Const, const T&, ElementReference<C, T>>;
+
+  ElementIterator() = default;
+
+  ElementIterator(ContainerPtr p_Container, std::size_t p_Index) noexcept
+    : m_Container(p_Container)
+    , m_Index(p_Index)
+  {
+  }
+
+  operator ElementIterator<C, T, true>() const noexcept
+    requires(!Const)
+  {
+    return ElementIterator<C, T, true>(m_Container, m_Index);
+  }
+
+  reference operator*() const { return (*this)[0]; }
+
+  const T* operator->() const
+    requires Const
+  {
+    return &(*m_Container)[m_Index];
+  }
+
+  reference operator[](difference_type n) const
+  {
+    if constexpr (Const) {
+      return (*m_Container)[m_Index + n];
+    } else {
+      return reference(m_Container, m_Index + n);
+    }
+  }
+
+  ElementIterator& operator++() noexcept
+  {
+    ++m_Index;
+    return *this;
+  }
+
+  ElementIterator operator++(int) noexcept
+  {
+    ElementIterator _tmp = *this;
+    ++m_Index;
+    return _tmp;
+  }
+
+  ElementIterator& operator--() noexcept
+  {
+    --m_Index;
+    return *this;
+  }
+
+  ElementIterator operator--(int) noexcept
+  {
+    ElementIterator _tmp = *this;
+    --m_Index;
+    return _tmp;
+  }
+
+  ElementIterator& operator+=(difference_type n) noexcept
+  {
+    m_Index += n;
+    return *this;
+  }
+
+  ElementIterator& operator-=(difference_type n) noexcept
+  {
+    m_Index -= n;
+    return *this;
+  }
+
+  friend ElementIterator operator+(ElementIterator it, difference_type n) noexcept
+  {
+    return it += n;
+  }
+
+  friend ElementIterator operator+(difference_type n, ElementIterator it) noexcept
+  {
+    return it += n;
+  }
+
+  friend ElementIterator operator-(ElementIterator it, difference_type n) noexcept
+  {
+    return it -= n;
+  }
+
+  friend difference_type operator-(const ElementIterator& a,
+                                   const ElementIterator& b) noexcept
+  {
+    return static_cast<difference_type>(a.m_Index) -
+           static_cast<difference_type>(b.m_Index);
+  }
+
+  friend bool operator==(const ElementIterator& a, const ElementIterator& b) noexcept
+  {
+    return a.m_Index == b.m_Index;
+  }
+
+  friend auto operator<=>(const ElementIterator& a, const ElementIterator& b) noexcept
+  {
+    return a.m_Index <=> b.m_Index;
+  }
+
+private:
+  ContainerPtr m_Container = nullptr;
+  std::size_t m_Index = 0;
+};
+
+}
@@ -0,0 +1,542 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Layout.hpp"
+#include "TensorView.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @brief Marker of an extent known only at run time
+ */
+inline constexpr std::size_t dynamic_extent = std::dynamic_extent;
+
+/**
+ * @class Extents
+ * @brief Dimensions of a tensor, each known at compile time or at run time
+ *
+ * @tparam E Extent of each dimension, or dynamic_extent
+ *
+ * @details
+ * Mirrors std::extents: only dynamic extents are stored.
+ */
+template<std::size_t... E>
+class Extents
+{
+public:
+  static constexpr std::size_t rank = sizeof...(E);
+  static constexpr std::size_t rank_dynamic =
+    ((E == dynamic_extent ? 1 : 0) + ... + 0);
+
+  /**
+   * @brief Extent of a dimension known at compile time, or dynamic_extent
+   */
+  static constexpr std::size_t static_extent(std::size_t p_Dim) noexcept
+  {
+    constexpr std::size_t _extents[] = { E..., 0 };
+    return _extents[p_Dim];
+  }
+
+  /**
+   * @brief Total amount of elements, if all extents are static
+   */
+  static constexpr std::size_t static_size =
+    rank_dynamic == 0 ? (std::size_t{ 1 } * ... * E) : dynamic_extent;
+
+  constexpr Extents() noexcept
+    requires(rank_dynamic == 0)
+  = default;
+
+  /**
+   * @brief Constructor from all extents
+   *
+   * @param p_Dimensions Extent of every dimension; static ones are validated
+   */
+  constexpr explicit Extents(const std::array<std::size_t, rank>& p_Dimensions)
+  {
+    for (std::size_t i = 0, j = 0; i < rank; ++i) {
+      if (static_extent(i) == dynamic_extent) {
+        m_Dynamic[j++] = p_Dimensions[i];
+      } else if (static_extent(i) != p_Dimensions[i]) {
+        throw std::invalid_argument("Dimension contradicts a static extent");
+      }
+    }
+  }
+
+  /**
+   * @brief Extent of a dimension
+   */
+  constexpr std::size_t extent(std::size_t p_Dim) const noexcept
+  {
+    if (static_extent(p_Dim) != dynamic_extent) {
+      return static_extent(p_Dim);
+    }
+    std::size_t _j = 0;
+    for (std::size_t i = 0; i < p_Dim; ++i) {
+      _j += static_extent(i) == dynamic_extent;
+    }
+    return m_Dynamic[_j];
+  }
+
+  /**
+   * @brief Extents of all dimensions
+   */
+  constexpr std::array<std::size_t, rank> dimensions() const noexcept
+  {
+    std::array<std::size_t, rank> _retval{};
+    for (std::size_t i = 0; i < rank; ++i) {
+      _retval[i] = extent(i);
+    }
+    return _retval;
+  }
+
+  /**
+   * @brief Total amount of elements
+   */
+  constexpr std::size_t size() const noexcept
+  {
+    if constexpr (rank_dynamic == 0) {
+      return static_size;
+    } else {
+      std::size_t _retval = 1;
+      for (std::size_t i = 0; i < rank; ++i) {
+        _retval *= extent(i);
+      }
+      return _retval;
+    }
+  }
+
+  friend constexpr bool operator==(const Extents& a, const Extents& b) noexcept
+  {
+    return a.m_Dynamic == b.m_Dynamic;
+  }
+
+private:
+  std::array<std::size_t, rank_dynamic> m_Dynamic{};
+};
+
+namespace detail {
+
+constexpr bool
+extents_compatible(std::size_t a, std::size_t b) noexcept
+{
+  return a == dynamic_extent || b == dynamic_extent || a == b;
+}
+
+constexpr std::size_t
+extents_merge(std::size_t a, std::size_t b) noexcept
+{
+  return a == dynamic_extent ? b : a;
+}
+
+template<typename A, typename B>
+struct CompatibleExtents : std::false_type
+{};
+
+template<std::size_t... A, std::size_t... B>
+  requires(sizeof...(A) == sizeof...(B))
+struct CompatibleExtents<Extents<A...>, Extents<B...>>
+  : std::bool_constant<(extents_compatible(A, B) && ...)>
+{
+  using type = Extents<extents_merge(A, B)...>;
+};
+
+template<typename E, std::size_t Axis, typename Seq>
+struct DropAxis;
+
+template<typename E, std::size_t Axis, std::size_t... I>
+struct DropAxis<E, Axis, std::index_sequence<I...>>
+{
+  using type = Extents<E::static_extent(I < Axis ? I : I + 1)...>;
+};
+
+template<typename A, typename B>
+struct ConcatExtents;
+
+template<std::size_t... A, std::size_t... B>
+struct ConcatExtents<Extents<A...>, Extents<B...>>
+{
+  using type = Extents<A..., B...>;
+};
+
+}
+
+/**
+ * @brief Whether two extents may describe the same shape
+ *
+ * @details
+ * True if ranks match and every pair of static extents agrees.
+ */
+template<typename A, typename B>
+inline constexpr bool compatible_extents_v =
+  detail::CompatibleExtents<A, B>::value;
+
+/**
+ * @class ShapedTensor
+ * @brief Tensor whose shape is checked at compile time where it is known
+ *
+ * @tparam T The type of value contained in a tensor
+ * @tparam E Extents of a tensor, see Extents
+ *
+ * @details
+ * When all extents are static the elements live inline in a std::array
+ * and kernels run loops with constant trip counts, which the compiler
+ * unrolls; otherwise they live in a std::vector. Operations between
+ * ShapedTensor's fail to compile on contradicting static extents and
+ * throw std::invalid_argument on contradicting dynamic ones.
+ * Layout is first-dimension-fastest, as in Tensor.
+ */
+template<typename T, typename E>
+class ShapedTensor;
+
+template<typename T, std::size_t... E>
+class ShapedTensor<T, Extents<E...>>
+{
+public:
+  using extents_type = Extents<E...>;
+  static constexpr std::size_t Rank = extents_type::rank;
+
+  /**
+   * @brief Constructor of a fully static tensor
+   */
+  ShapedTensor()
+    requires(extents_type::rank_dynamic == 0)
+  {
+    m_Data.fill(T{});
+  }
+
+  /**
+   * @brief Constructor from all extents
+   *
+   * @param p_Dimensions Extent of every dimension; static ones are validated
+   */
+  explicit ShapedTensor(const std::array<std::size_t, Rank>& p_Dimensions)
+    : m_Extents(p_Dimensions)
+  {
+    if constexpr (extents_type::rank_dynamic == 0) {
+      m_Data.fill(T{});
+    } else {
+      m_Data.resize(m_Extents.size());
+    }
+  }
+
+  /**
+   * @brief Constructor copying a runtime-shaped tensor
+   *
+   * @param p_Tensor Tensor whose dimensions must agree with static extents
+   */
+  template<Allocator A>
+  explicit ShapedTensor(const Tensor<T, Rank, A>& p_Tensor)
+    : ShapedTensor(p_Tensor.dimensions())
+  {
+    std::copy_n(p_Tensor.storage(), size(), storage());
+  }
+
+  const extents_type& extents() const noexcept { return m_Extents; }
+
+  std::array<std::size_t, Rank> dimensions() const noexcept
+  {
+    return m_Extents.dimensions();
+  }
+
+  constexpr std::size_t size() const noexcept { return m_Extents.size(); }
+
+  T* storage() noexcept { return m_Data.data(); }
+
+  const T* storage() const noexcept { return m_Data.data(); }
+
+  T* begin() noexcept { return storage(); }
+  T* end() noexcept { return storage() + size(); }
+  const T* begin() const noexcept { return storage(); }
+  const T* end() const noexcept { return storage() + size(); }
+
+  T& operator[](std::size_t N) { return m_Data[N]; }
+
+  const T& operator[](std::size_t N) const { return m_Data[N]; }
+
+  /**
+   * @brief Element access with calculated index
+   *
+   * @param p_Dims Dimension coordinates to access.
+   *
+   * @return Element at calculated index
+   */
+  T& at(const std::array<std::size_t, Rank>& p_Dims)
+  {
+    return m_Data[calculateIndex(p_Dims)];
+  }
+
+  const T& at(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return m_Data[calculateIndex(p_Dims)];
+  }
+
+  /**
+   * @brief Element access with compile-time coordinates, checked against
+   * static extents at compile time
+   */
+  template<std::size_t... p_Dims>
+  T& at()
+  {
+    static_assert(sizeof...(p_Dims) == Rank,
+                  "Misaligned dimensions in tensor's `at` operator");
+    static_assert(((p_Dims < E) && ...), "Index out of static bounds");
+    return at({ { p_Dims... } });
+  }
+
+  operator TensorView<T, Rank>() noexcept
+  {
+    return TensorView<T, Rank>(
+      storage(), dimensions(), dense_strides(dimensions()));
+  }
+
+  operator TensorView<const T, Rank>() const noexcept
+  {
+    return TensorView<const T, Rank>(
+      storage(), dimensions(), dense_strides(dimensions()));
+  }
+
+  /**
+   * @brief Copy into a runtime-shaped tensor
+   */
+  Tensor<T, Rank> to_tensor() const
+  {
+    Tensor<T, Rank> _retval(dimensions());
+    std::copy_n(storage(), size(), _retval.storage());
+    return _retval;
+  }
+
+private:
+  std::size_t calculateIndex(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return detail::checked_index(p_Dims, dimensions());
+  }
+
+  using storage_type = std::conditional_t<
+    extents_type::rank_dynamic == 0,
+    std::array<T, std::max<std::size_t>(extents_type::static_size, 1)>,
+    std::vector<T>>;
+
+  extents_type m_Extents;
+  storage_type m_Data;
+};
+
+namespace detail {
+
+template<typename EA, typename EB>
+typename CompatibleExtents<EA, EB>::type
+merged_extents(const EA& a, const EB& b)
+{
+  using R = typename CompatibleExtents<EA, EB>::type;
+  const auto _da = a.dimensions();
+  if (_da != b.dimensions()) {
+    throw std::invalid_argument("Misaligned dimensions of tensors");
+  }
+  if constexpr (R::rank_dynamic == 0) {
+    return R();
+  } else {
+    return R(_da);
+  }
+}
+
+/**
+ * @brief Product of the static extents of dimensions [p_First, p_Last),
+ * or dynamic_extent if one of them is dynamic
+ */
+template<typename E>
+constexpr std::size_t
+static_product(std::size_t p_First, std::size_t p_Last) noexcept
+{
+  std::size_t _retval = 1;
+  for (std::size_t i = p_First; i < p_Last; ++i) {
+    if (E::static_extent(i) == dynamic_extent) {
+      return dynamic_extent;
+    }
+    _retval *= E::static_extent(i);
+  }
+  return _retval;
+}
+
+/**
+ * @brief Loop bound: a compile-time constant when the extent is static,
+ * the run-time value otherwise
+ */
+template<std::size_t S>
+constexpr auto
+trip_count(std::size_t p_Runtime) noexcept
+{
+  if constexpr (S == dynamic_extent) {
+    return p_Runtime;
+  } else {
+    return std::integral_constant<std::size_t, S>{};
+  }
+}
+
+template<typename T, typename EA, typename EB, typename F>
+auto
+elementwise(const ShapedTensor<T, EA>& a, const ShapedTensor<T, EB>& b, F f)
+{
+  static_assert(compatible_extents_v<EA, EB>,
+                "Static extents of operands contradict each other");
+  using R = typename CompatibleExtents<EA, EB>::type;
+  const R _extents = merged_extents(a.extents(), b.extents());
+  ShapedTensor<T, R> _retval(_extents.dimensions());
+  if constexpr (R::rank_dynamic == 0) {
+    for (std::size_t i = 0; i < R::static_size; ++i) {
+      _retval[i] = f(a[i], b[i]);
+    }
+  } else {
+    const std::size_t _size = _extents.size();
+    for (std::size_t i = 0; i < _size; ++i) {
+      _retval[i] = f(a[i], b[i]);
+    }
+  }
+  return _retval;
+}
+
+}
+
+template<typename T, typename EA, typename EB>
+auto
+operator+(const ShapedTensor<T, EA>& a, const ShapedTensor<T, EB>& b)
+{
+  return detail::elementwise(a, b, [](T x, T y) { return x + y; });
+}
+
+template<typename T, typename EA, typename EB>
+auto
+operator-(const ShapedTensor<T, EA>& a, const ShapedTensor<T, EB>& b)
+{
+  return detail::elementwise(a, b, [](T x, T y) { return x - y; });
+}
+
+/**
+ * @brief Element-wise (Hadamard) product
+ */
+template<typename T, typename EA, typename EB>
+auto
+operator*(const ShapedTensor<T, EA>& a, const ShapedTensor<T, EB>& b)
+{
+  return detail::elementwise(a, b, [](T x, T y) { return x * y; });
+}
+
+/**
+ * @brief Contraction of one axis of each operand
+ *
+ * @tparam AxisA Contracted axis of `a`
+ * @tparam AxisB Contracted axis of `b`
+ *
+ * @return Tensor with the remaining axes of `a` followed by those of `b`
+ */
+template<std::size_t AxisA, std::size_t AxisB, typename T, typename EA, typename EB>
+auto
+contract(const ShapedTensor<T, EA>& a, const ShapedTensor<T, EB>& b)
+{
+  static_assert(AxisA < EA::rank && AxisB < EB::rank, "Axis out of bounds");
+  static_assert(detail::extents_compatible(EA::static_extent(AxisA),
+                                           EB::static_extent(AxisB)),
+                "Static extents of contracted axes contradict each other");
+  using RA = typename detail::
+    DropAxis<EA, AxisA, std::make_index_sequence<EA::rank - 1>>::type;
+  using RB = typename detail::
+    DropAxis<EB, AxisB, std::make_index_sequence<EB::rank - 1>>::type;
+  using R = typename detail::ConcatExtents<RA, RB>::type;
+
+  const auto _da = a.dimensions();
+  const auto _db = b.dimensions();
+  if (_da[AxisA] != _db[AxisB]) {
+    throw std::invalid_argument("Misaligned dimensions of contracted axes");
+  }
+  std::array<std::size_t, R::rank> _dims{};
+  std::size_t _j = 0;
+  std::size_t _dynInnerA = 1, _dynOuterA = 1, _dynInnerB = 1, _dynOuterB = 1;
+  for (std::size_t i = 0; i < EA::rank; ++i) {
+    if (i != AxisA) {
+      _dims[_j++] = _da[i];
+    }
+    if (i < AxisA) {
+      _dynInnerA *= _da[i];
+    }
+    if (i > AxisA) {
+      _dynOuterA *= _da[i];
+    }
+  }
+  for (std::size_t i = 0; i < EB::rank; ++i) {
+    if (i != AxisB) {
+      _dims[_j++] = _db[i];
+    }
+    if (i < AxisB) {
+      _dynInnerB *= _db[i];
+    }
+    if (i > AxisB) {
+      _dynOuterB *= _db[i];
+    }
+  }
+  // Static extents become compile-time loop bounds
+  const auto _innerA = detail::trip_count<detail::static_product<EA>(0, AxisA)>(_dynInnerA);
+  const auto _outerA =
+    detail::trip_count<detail::static_product<EA>(AxisA + 1, EA::rank)>(_dynOuterA);
+  const auto _innerB = detail::trip_count<detail::static_product<EB>(0, AxisB)>(_dynInnerB);
+  const auto _outerB =
+    detail::trip_count<detail::static_product<EB>(AxisB + 1, EB::rank)>(_dynOuterB);
+  const auto _k = detail::trip_count<EA::static_extent(AxisA) != dynamic_extent
+                                       ? EA::static_extent(AxisA)
+                                       : EB::static_extent(AxisB)>(_da[AxisA]);
+  const std::size_t _restA = _innerA * _outerA;
+
+  ShapedTensor<T, R> _retval(_dims);
+  T* _c = _retval.storage();
+  for (std::size_t ob = 0; ob < _outerB; ++ob) {
+    for (std::size_t ib = 0; ib < _innerB; ++ib) {
+      T* _col = _c + _restA * (ib + _innerB * ob);
+      for (std::size_t k = 0; k < _k; ++k) {
+        const T _bv = b[ib + _innerB * (k + _k * ob)];
+        for (std::size_t oa = 0; oa < _outerA; ++oa) {
+          const T* _arow = a.storage() + _innerA * (_k * oa + k);
+          T* _crow = _col + _innerA * oa;
+          for (std::size_t ia = 0; ia < _innerA; ++ia) {
+            _crow[ia] += _arow[ia] * _bv;
+          }
+        }
+      }
+    }
+  }
+  return _retval;
+}
+
+/**
+ * @brief Matrix product of (m, k) and (k, n) matrices
+ */
+template<typename T, typename EA, typename EB>
+  requires(EA::rank == 2 && EB::rank == 2)
+auto
+matmul(const ShapedTensor<T, EA>& a, const ShapedTensor<T, EB>& b)
+{
+  return contract<1, 0>(a, b);
+}
+
+}
@@ -0,0 +1,711 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Tensor.hpp"
+#include "TensorView.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace TenSore {
+
+/**
+ * @brief Reduction of scatter() overwriting the target element
+ */
+struct Assign
+{
+  template<typename T, typename U>
+  constexpr T operator()(const T&, const U& p_Value) const
+  {
+    return static_cast<T>(p_Value);
+  }
+};
+
+/**
+ * @brief A concept for contiguous ranges of indices, like std::vector<int>
+ *
+ * @details
+ * Tensors and views are excluded: as indices they hold one index per
+ * element, as gather() and scatter() take them. Wrap a tensor in a
+ * std::span to use it as a plain list of indices.
+ */
+template<typename R>
+concept IndexRange = std::ranges::contiguous_range<const R> &&
+                     std::integral<std::ranges::range_value_t<R>> && !ViewLike<const R>;
+
+namespace detail {
+
+/**
+ * @brief Elements below which an operation is not worth splitting
+ */
+inline constexpr std::size_t k_MinIndexTask = std::size_t{ 1 } << 15;
+
+inline std::size_t
+index_tasks(ThreadPool& p_Pool, std::size_t p_Work)
+{
+  return std::max<std::size_t>(1, std::min(p_Pool.size(), p_Work / k_MinIndexTask));
+}
+
+template<typename R>
+auto
+index_span(const R& p_Indices) noexcept
+{
+  return std::span<const std::ranges::range_value_t<R>>(std::ranges::data(p_Indices),
+                                                         std::ranges::size(p_Indices));
+}
+
+/**
+ * @brief Throws std::out_of_range unless every index is below an extent
+ *
+ * @details
+ * Negative indices convert to huge unsigned values and are rejected too.
+ * The loop has no early exit, so that it vectorizes.
+ */
+template<typename I>
+void
+check_indices(std::span<const I> p_Indices, std::size_t p_Extent)
+{
+  bool _bad = false;
+  for (const I it : p_Indices) {
+    _bad |= static_cast<std::size_t>(it) >= p_Extent;
+  }
+  if (_bad) {
+    throw std::out_of_range("Index out of bounds");
+  }
+}
+
+template<typename I, std::size_t Rank>
+void
+check_indices(const TensorView<I, Rank>& p_Indices, std::size_t p_Extent)
+{
+  if (p_Indices.contiguous()) {
+    check_indices(std::span<const std::remove_const_t<I>>(p_Indices.span()), p_Extent);
+    return;
+  }
+  for (const auto& it : p_Indices) {
+    if (static_cast<std::size_t>(it) >= p_Extent) {
+      throw std::out_of_range("Index out of bounds");
+    }
+  }
+}
+
+template<std::size_t Rank>
+void
+check_axis(std::size_t p_Axis)
+{
+  if (p_Axis >= Rank) {
+    throw std::out_of_range("Axis out of bounds");
+  }
+}
+
+/**
+ * @brief Longest axis other than the given one, Rank if there is none
+ */
+template<std::size_t Rank>
+std::size_t
+other_axis(const std::array<std::size_t, Rank>& p_Dimensions, std::size_t p_Axis) noexcept
+{
+  std::size_t _retval = Rank;
+  for (std::size_t i = 0; i < Rank; ++i) {
+    if (i != p_Axis && (_retval == Rank || p_Dimensions[i] > p_Dimensions[_retval])) {
+      _retval = i;
+    }
+  }
+  return _retval;
+}
+
+/**
+ * @brief Gathers `p_Out[i] = p_Source[p_Indices[i]]` from a contiguous lane
+ *
+ * @details
+ * With AVX2, 32-bit elements are loaded eight (or, with 64-bit indices,
+ * four) at a time by hardware gathers, which beat scalar loads at that
+ * width; wider elements fill too few lanes for gathers to pay off and
+ * take the scalar loop.
+ */
+template<typename T, typename I>
+void
+gather_lane(const T* p_Source,
+            std::size_t p_Extent,
+            const I* p_Indices,
+            T* p_Out,
+            std::size_t p_Count) noexcept
+{
+  std::size_t i = 0;
+#if defined(__AVX2__)
+  if constexpr (sizeof(T) == 4 && std::is_trivially_copyable_v<T>) {
+    const auto* _base = reinterpret_cast<const int*>(p_Source);
+    if constexpr (sizeof(I) == 4) {
+      if (p_Extent <= static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())) {
+        for (; i + 8 <= p_Count; i += 8) {
+          const __m256i _index =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_Indices + i));
+          _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_Out + i),
+                              _mm256_i32gather_epi32(_base, _index, 4));
+        }
+      }
+    } else if constexpr (sizeof(I) == 8) {
+      for (; i + 4 <= p_Count; i += 4) {
+        const __m256i _index =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p_Indices + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p_Out + i),
+                         _mm256_i64gather_epi32(_base, _index, 4));
+      }
+    }
+  }
+#endif
+  (void)p_Extent;
+  for (; i < p_Count; ++i) {
+    p_Out[i] = p_Source[static_cast<std::size_t>(p_Indices[i])];
+  }
+}
+
+/**
+ * @brief Applies `to = p_Fn(to, from)` to pairs of elements of two views
+ * of equal dimensions, lane by lane along dimension 0
+ */
+template<typename T, typename U, std::size_t Rank, typename F>
+void
+for_each_pair(const TensorView<T, Rank>& p_To, const TensorView<U, Rank>& p_From, F& p_Fn)
+{
+  const std::size_t _size = p_To.size();
+  if (_size == 0) {
+    return;
+  }
+  const auto& _dims = p_To.dimensions();
+  const std::size_t _run = _dims[0];
+  const std::ptrdiff_t _to_step = p_To.strides()[0];
+  const std::ptrdiff_t _from_step = p_From.strides()[0];
+  std::array<std::size_t, Rank> _coords{};
+  std::ptrdiff_t _to = 0;
+  std::ptrdiff_t _from = 0;
+  for (std::size_t _lane = 0; _lane < _size / _run; ++_lane) {
+    T* _dst = p_To.storage() + _to;
+    const U* _src = p_From.storage() + _from;
+    for (std::ptrdiff_t i = 0; i < static_cast<std::ptrdiff_t>(_run); ++i) {
+      _dst[i * _to_step] = p_Fn(_dst[i * _to_step], _src[i * _from_step]);
+    }
+    for (std::size_t d = 1; d < Rank; ++d) {
+      _to += p_To.strides()[d];
+      _from += p_From.strides()[d];
+      if (++_coords[d] < _dims[d]) {
+        break;
+      }
+      _to -= p_To.strides()[d] * static_cast<std::ptrdiff_t>(_dims[d]);
+      _from -= p_From.strides()[d] * static_cast<std::ptrdiff_t>(_dims[d]);
+      _coords[d] = 0;
+    }
+  }
+}
+
+template<typename U, typename I, typename T, std::size_t Rank>
+void
+index_select(const TensorView<U, Rank>& p_From,
+             std::size_t p_Axis,
+             std::span<const I> p_Indices,
+             const TensorView<T, Rank>& p_To,
+             ThreadPool& p_Pool)
+{
+  check_axis<Rank>(p_Axis);
+  const std::size_t _count = p_Indices.size();
+  std::array<std::size_t, Rank> _dims = p_From.dimensions();
+  _dims[p_Axis] = _count;
+  if (_dims != p_To.dimensions()) {
+    throw std::invalid_argument("Mismatched dimensions of views");
+  }
+  check_indices(p_Indices, p_From.dimensions()[p_Axis]);
+  if (p_To.size() == 0) {
+    return;
+  }
+  auto _index = [&](std::size_t j) { return static_cast<std::size_t>(p_Indices[j]); };
+
+  // Along axis 0 slabs are single elements: block copies only pay off for
+  // long runs of consecutive indices, gathers do better otherwise.
+  std::size_t _runs = 0;
+  for (std::size_t j = 0; j < _count; ++j) {
+    _runs += j == 0 || _index(j) != _index(j - 1) + 1;
+  }
+  const bool _blocks = p_Axis != 0 || _count >= 8 * _runs;
+
+  const std::size_t _other = other_axis(_dims, p_Axis);
+  auto _work = [&](std::size_t p_First,
+                   std::size_t p_Last,
+                   std::size_t p_Begin,
+                   std::size_t p_End) {
+    std::array<std::size_t, Rank> _from_offsets{};
+    std::array<std::size_t, Rank> _to_offsets{};
+    std::array<std::size_t, Rank> _extents = _dims;
+    if (_other < Rank) {
+      _from_offsets[_other] = _to_offsets[_other] = p_Begin;
+      _extents[_other] = p_End - p_Begin;
+    }
+    if (_blocks) {
+      for (std::size_t j = p_First; j < p_Last;) {
+        std::size_t k = j + 1;
+        while (k < p_Last && _index(k) == _index(k - 1) + 1) {
+          ++k;
+        }
+        _from_offsets[p_Axis] = _index(j);
+        _to_offsets[p_Axis] = j;
+        _extents[p_Axis] = k - j;
+        copy_view(p_From.subview(_from_offsets, _extents), p_To.subview(_to_offsets, _extents));
+        j = k;
+      }
+      return;
+    }
+    _extents[0] = p_From.dimensions()[0];
+    const auto _from = p_From.subview(_from_offsets, _extents);
+    _to_offsets[0] = p_First;
+    _extents[0] = p_Last - p_First;
+    const auto _to = p_To.subview(_to_offsets, _extents);
+    const I* _indices = p_Indices.data() + p_First;
+    for (std::size_t l = 0; l < _to.lane_count(0); ++l) {
+      const auto _src = _from.lane(0, l);
+      const auto _dst = _to.lane(0, l);
+      if (_src.strides()[0] == 1 && _dst.strides()[0] == 1) {
+        gather_lane(_src.storage(), _src.size(), _indices, _dst.storage(), _dst.size());
+      } else {
+        for (std::size_t i = 0; i < _dst.size(); ++i) {
+          _dst.storage()[static_cast<std::ptrdiff_t>(i) * _dst.strides()[0]] =
+            _src.storage()[static_cast<std::ptrdiff_t>(_indices[i]) * _src.strides()[0]];
+        }
+      }
+    }
+  };
+
+  const std::size_t _tasks = index_tasks(p_Pool, p_To.size());
+  const std::size_t _other_extent = _other < Rank ? _dims[_other] : 1;
+  if (_tasks == 1) {
+    _work(0, _count, 0, _other_extent);
+  } else if (_count >= _tasks || _other_extent < _tasks) {
+    p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+      _work(_count * t / _tasks, _count * (t + 1) / _tasks, 0, _other_extent);
+    });
+  } else {
+    p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+      _work(0, _count, _other_extent * t / _tasks, _other_extent * (t + 1) / _tasks);
+    });
+  }
+}
+
+template<typename U, typename I, typename T, std::size_t Rank>
+void
+gather(const TensorView<U, Rank>& p_From,
+       std::size_t p_Axis,
+       const TensorView<I, Rank>& p_Index,
+       const TensorView<T, Rank>& p_To,
+       ThreadPool& p_Pool)
+{
+  check_axis<Rank>(p_Axis);
+  if (p_Index.dimensions() != p_To.dimensions()) {
+    throw std::invalid_argument("Mismatched dimensions of views");
+  }
+  std::array<std::size_t, Rank> _extents = p_Index.dimensions();
+  for (std::size_t i = 0; i < Rank; ++i) {
+    if (i != p_Axis && _extents[i] > p_From.dimensions()[i]) {
+      throw std::invalid_argument("Mismatched dimensions of views");
+    }
+  }
+  const std::size_t _extent = p_From.dimensions()[p_Axis];
+  check_indices(p_Index, _extent);
+  if (p_To.size() == 0) {
+    return;
+  }
+  _extents[p_Axis] = _extent;
+  const auto _from = p_From.subview({}, _extents);
+  const std::size_t _lanes = p_To.lane_count(p_Axis);
+  const std::size_t _length = p_To.dimensions()[p_Axis];
+
+  auto _work = [&](std::size_t p_First,
+                   std::size_t p_Last,
+                   std::size_t p_Begin,
+                   std::size_t p_End) {
+    for (std::size_t l = p_First; l < p_Last; ++l) {
+      const auto _src = _from.lane(p_Axis, l);
+      const auto _index = p_Index.lane(p_Axis, l);
+      const auto _dst = p_To.lane(p_Axis, l);
+      if (_src.strides()[0] == 1 && _index.strides()[0] == 1 && _dst.strides()[0] == 1) {
+        gather_lane(_src.storage(),
+                    _extent,
+                    _index.storage() + p_Begin,
+                    _dst.storage() + p_Begin,
+                    p_End - p_Begin);
+        continue;
+      }
+      for (std::size_t i = p_Begin; i < p_End; ++i) {
+        const auto _at = static_cast<std::ptrdiff_t>(
+          _index.storage()[static_cast<std::ptrdiff_t>(i) * _index.strides()[0]]);
+        _dst.storage()[static_cast<std::ptrdiff_t>(i) * _dst.strides()[0]] =
+          _src.storage()[_at * _src.strides()[0]];
+      }
+    }
+  };
+
+  const std::size_t _tasks = index_tasks(p_Pool, p_To.size());
+  if (_tasks == 1) {
+    _work(0, _lanes, 0, _length);
+  } else if (_lanes >= _tasks) {
+    p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+      _work(_lanes * t / _tasks, _lanes * (t + 1) / _tasks, 0, _length);
+    });
+  } else {
+    p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+      _work(0, _lanes, _length * t / _tasks, _length * (t + 1) / _tasks);
+    });
+  }
+}
+
+template<typename T, typename I, typename U, std::size_t Rank, typename Op>
+void
+scatter(const TensorView<T, Rank>& p_To,
+        std::size_t p_Axis,
+        std::span<const I> p_Indices,
+        const TensorView<U, Rank>& p_Values,
+        Op& p_Op,
+        ThreadPool& p_Pool)
+{
+  check_axis<Rank>(p_Axis);
+  const std::size_t _count = p_Indices.size();
+  std::array<std::size_t, Rank> _dims = p_To.dimensions();
+  _dims[p_Axis] = _count;
+  if (_dims != p_Values.dimensions()) {
+    throw std::invalid_argument("Mismatched dimensions of views");
+  }
+  const std::size_t _extent = p_To.dimensions()[p_Axis];
+  check_indices(p_Indices, _extent);
+  if (p_Values.size() == 0) {
+    return;
+  }
+  auto _index = [&](std::size_t j) { return static_cast<std::size_t>(p_Indices[j]); };
+
+  // Each task owns the targets of a range of indices (p_Low, p_High) and a
+  // range along another axis, and applies the updates to them in order,
+  // so tasks never touch the same element and duplicates reduce in order.
+  const std::size_t _other = other_axis(_dims, p_Axis);
+  auto _work = [&](std::size_t p_Begin,
+                   std::size_t p_End,
+                   std::size_t p_Low,
+                   std::size_t p_High) {
+    std::array<std::size_t, Rank> _to_offsets{};
+    std::array<std::size_t, Rank> _from_offsets{};
+    std::array<std::size_t, Rank> _extents = _dims;
+    if (_other < Rank) {
+      _to_offsets[_other] = _from_offsets[_other] = p_Begin;
+      _extents[_other] = p_End - p_Begin;
+    }
+    auto _owned = [&](std::size_t j) { return _index(j) >= p_Low && _index(j) < p_High; };
+    for (std::size_t j = 0; j < _count;) {
+      if (!_owned(j)) {
+        ++j;
+        continue;
+      }
+      std::size_t k = j + 1;
+      while (k < _count && _index(k) == _index(k - 1) + 1 && _owned(k)) {
+        ++k;
+      }
+      _to_offsets[p_Axis] = _index(j);
+      _from_offsets[p_Axis] = j;
+      _extents[p_Axis] = k - j;
+      const auto _to = p_To.subview(_to_offsets, _extents);
+      const auto _from = p_Values.subview(_from_offsets, _extents);
+      if constexpr (std::is_same_v<Op, Assign> && std::is_same_v<std::remove_const_t<U>, T>) {
+        copy_view(_from, _to);
+      } else {
+        for_each_pair(_to, _from, p_Op);
+      }
+      j = k;
+    }
+  };
+
+  const std::size_t _tasks = index_tasks(p_Pool, p_Values.size());
+  const std::size_t _other_extent = _other < Rank ? _dims[_other] : 1;
+  if (_tasks == 1) {
+    _work(0, _other_extent, 0, _extent);
+  } else if (_other_extent >= _tasks) {
+    p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+      _work(_other_extent * t / _tasks, _other_extent * (t + 1) / _tasks, 0, _extent);
+    });
+  } else {
+    p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+      _work(0, _other_extent, _extent * t / _tasks, _extent * (t + 1) / _tasks);
+    });
+  }
+}
+
+template<typename T, typename I, typename U, std::size_t Rank, typename Op>
+void
+scatter(const TensorView<T, Rank>& p_To,
+        std::size_t p_Axis,
+        const TensorView<I, Rank>& p_Index,
+        const TensorView<U, Rank>& p_Values,
+        Op& p_Op,
+        ThreadPool& p_Pool)
+{
+  check_axis<Rank>(p_Axis);
+  std::array<std::size_t, Rank> _extents = p_Index.dimensions();
+  for (std::size_t i = 0; i < Rank; ++i) {
+    if (_extents[i] > p_Values.dimensions()[i] ||
+        (i != p_Axis && _extents[i] > p_To.dimensions()[i])) {
+      throw std::invalid_argument("Mismatched dimensions of views");
+    }
+  }
+  const std::size_t _extent = p_To.dimensions()[p_Axis];
+  check_indices(p_Index, _extent);
+  if (p_Index.size() == 0) {
+    return;
+  }
+  const auto _values = p_Values.subview({}, _extents);
+  const std::size_t _length = _extents[p_Axis];
+  _extents[p_Axis] = _extent;
+  const auto _target = p_To.subview({}, _extents);
+  const std::size_t _lanes = p_Index.lane_count(p_Axis);
+
+  // Updates only collide within a lane, so tasks own whole lanes, or,
+  // when there are too few, ranges of target indices within every lane.
+  auto _work = [&](std::size_t p_First,
+                   std::size_t p_Last,
+                   std::size_t p_Low,
+                   std::size_t p_High) {
+    for (std::size_t l = p_First; l < p_Last; ++l) {
+      const auto _index = p_Index.lane(p_Axis, l);
+      const auto _from = _values.lane(p_Axis, l);
+      const auto _to = _target.lane(p_Axis, l);
+      for (std::size_t i = 0; i < _length; ++i) {
+        const auto _at = static_cast<std::size_t>(
+          _index.storage()[static_cast<std::ptrdiff_t>(i) * _index.strides()[0]]);
+        if (_at >= p_Low && _at < p_High) {
+          T& _dst = _to.storage()[static_cast<std::ptrdiff_t>(_at) * _to.strides()[0]];
+          _dst = p_Op(_dst, _from.storage()[static_cast<std::ptrdiff_t>(i) * _from.strides()[0]]);
+        }
+      }
+    }
+  };
+
+  const std::size_t _tasks = index_tasks(p_Pool, p_Index.size());
+  if (_tasks == 1) {
+    _work(0, _lanes, 0, _extent);
+  } else if (_lanes >= _tasks) {
+    p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+      _work(_lanes * t / _tasks, _lanes * (t + 1) / _tasks, 0, _extent);
+    });
+  } else {
+    p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+      _work(0, _lanes, _extent * t / _tasks, _extent * (t + 1) / _tasks);
+    });
+  }
+}
+
+}
+
+/**
+ * @brief Copies the hyperplanes at given indices along an axis
+ *
+ * @param p_Source Tensor or view to select from
+ * @param p_Axis Axis of the indices
+ * @param p_Indices Contiguous range of indices, in any order, repeats allowed
+ * @param p_Target Tensor or view receiving the hyperplanes, with the
+ * source's dimensions except `p_Indices.size()` along the axis
+ * @param p_Pool Pool copying in parallel for large outputs
+ *
+ * @details
+ * `target[..., j, ...] = source[..., p_Indices[j], ...]`. Embedding lookup
+ * is index_select() of columns along the last axis of a table. Runs of
+ * consecutive indices are copied as one block, which along the last axis
+ * of a tensor is a single memcpy-like copy. Along axis 0 short runs are
+ * gathered element by element instead. Throws std::out_of_range on
+ * indices outside the axis before writing anything.
+ */
+template<typename S, IndexRange R, typename D>
+  requires ViewLike<const S> && ViewLike<std::remove_reference_t<D>>
+void
+index_select(const S& p_Source,
+             std::size_t p_Axis,
+             const R& p_Indices,
+             D&& p_Target,
+             ThreadPool& p_Pool = ThreadPool::global())
+{
+  detail::index_select(
+    as_view(p_Source), p_Axis, detail::index_span(p_Indices), as_view(p_Target), p_Pool);
+}
+
+/**
+ * @brief Copies the hyperplanes at given indices along an axis into a
+ * new tensor
+ *
+ * @return Tensor with the source's dimensions except `p_Indices.size()`
+ * along the axis
+ */
+template<typename S, IndexRange R>
+  requires ViewLike<const S>
+auto
+index_select(const S& p_Source,
+             std::size_t p_Axis,
+             const R& p_Indices,
+             ThreadPool& p_Pool = ThreadPool::global())
+{
+  const auto _from = as_view(p_Source);
+  using T = std::ranges::range_value_t<decltype(_from)>;
+  constexpr std::size_t Rank = std::tuple_size_v<std::remove_cvref_t<decltype(_from.dimensions())>>;
+  detail::check_axis<Rank>(p_Axis);
+  std::array<std::size_t, Rank> _dims = _from.dimensions();
+  _dims[p_Axis] = std::ranges::size(p_Indices);
+  Tensor<T, Rank> _retval(std::move(_dims));
+  detail::index_select(_from, p_Axis, detail::index_span(p_Indices), as_view(_retval), p_Pool);
+  return _retval;
+}
+
+/**
+ * @brief Gathers elements along an axis at per-element indices
+ *
+ * @param p_Source Tensor or view to gather from
+ * @param p_Axis Axis of the indices
+ * @param p_Index Tensor or view of integral indices; along the other axes
+ * it may not exceed the source
+ * @param p_Target Tensor or view receiving the elements, of the index's
+ * dimensions
+ * @param p_Pool Pool gathering in parallel for large outputs
+ *
+ * @details
+ * For axis 1 of a matrix, `target(i, j) = source(i, index(i, j))`, and
+ * likewise for other axes and ranks. Lanes contiguous along the axis
+ * are loaded with hardware gathers where available. Throws
+ * std::out_of_range on indices outside the axis before writing anything.
+ */
+template<typename S, typename X, typename D>
+  requires ViewLike<const S> && ViewLike<const X> &&
+           ViewLike<std::remove_reference_t<D>>
+void
+gather(const S& p_Source,
+       std::size_t p_Axis,
+       const X& p_Index,
+       D&& p_Target,
+       ThreadPool& p_Pool = ThreadPool::global())
+{
+  detail::gather(as_view(p_Source), p_Axis, as_view(p_Index), as_view(p_Target), p_Pool);
+}
+
+/**
+ * @brief Gathers elements along an axis at per-element indices into a
+ * new tensor
+ *
+ * @return Tensor of the index's dimensions
+ */
+template<typename S, typename X>
+  requires ViewLike<const S> && ViewLike<const X>
+auto
+gather(const S& p_Source,
+       std::size_t p_Axis,
+       const X& p_Index,
+       ThreadPool& p_Pool = ThreadPool::global())
+{
+  const auto _from = as_view(p_Source);
+  const auto _index = as_view(p_Index);
+  using T = std::ranges::range_value_t<decltype(_from)>;
+  constexpr std::size_t Rank = std::tuple_size_v<std::remove_cvref_t<decltype(_from.dimensions())>>;
+  std::array<std::size_t, Rank> _dims = _index.dimensions();
+  Tensor<T, Rank> _retval(std::move(_dims));
+  detail::gather(_from, p_Axis, _index, as_view(_retval), p_Pool);
+  return _retval;
+}
+
+/**
+ * @brief Updates the hyperplanes at given indices along an axis
+ *
+ * @param p_Target Tensor or view to update
+ * @param p_Axis Axis of the indices
+ * @param p_Indices Contiguous range of indices, in any order, repeats allowed
+ * @param p_Values Tensor or view of the updates, with the target's
+ * dimensions except `p_Indices.size()` along the axis
+ * @param p_Op Reduction `T(const T& current, const U& value)`, e.g.
+ * std::plus<>{} to accumulate; Assign overwrites. Called concurrently.
+ * @param p_Pool Pool updating in parallel for large updates
+ *
+ * @details
+ * The inverse of index_select(): `target[..., p_Indices[j], ...] =
+ * p_Op(target[..., p_Indices[j], ...], values[..., j, ...])` for every j in
+ * order, so repeated indices are reduced in order (the last one wins with
+ * Assign); this is the sparse update of an embedding table. Tasks own
+ * disjoint parts of the target, slices along another axis or ranges of
+ * indices, so no element is updated by two threads and no atomics are
+ * needed. Runs of consecutive indices are updated as one block. Throws
+ * std::out_of_range on indices outside the axis before writing anything.
+ */
+template<typename D, IndexRange R, typename S, typename Op = Assign>
+  requires ViewLike<std::remove_reference_t<D>> && ViewLike<const S>
+void
+scatter(D&& p_Target,
+        std::size_t p_Axis,
+        const R& p_Indices,
+        const S& p_Values,
+        Op p_Op = {},
+        ThreadPool& p_Pool = ThreadPool::global())
+{
+  detail::scatter(
+    as_view(p_Target), p_Axis, detail::index_span(p_Indices), as_view(p_Values), p_Op, p_Pool);
+}
+
+/**
+ * @brief Updates elements along an axis at per-element indices
+ *
+ * @param p_Target Tensor or view to update
+ * @param p_Axis Axis of the indices
+ * @param p_Index Tensor or view of integral indices; along the other axes
+ * it may not exceed the target, and along no axis the values
+ * @param p_Values Tensor or view of the updates
+ * @param p_Op Reduction `T(const T& current, const U& value)`; Assign
+ * overwrites. Called concurrently.
+ * @param p_Pool Pool updating in parallel for large updates
+ *
+ * @details
+ * The inverse of gather(): for axis 1 of a matrix,
+ * `target(i, index(i, j)) = p_Op(target(i, index(i, j)), values(i, j))`.
+ * Updates collide only within a lane along the axis, so tasks own whole
+ * lanes, or ranges of target indices when there are fewer lanes than
+ * tasks; each lane is processed in order. Throws std::out_of_range on
+ * indices outside the axis before writing anything.
+ */
+template<typename D, typename X, typename S, typename Op = Assign>
+  requires ViewLike<std::remove_reference_t<D>> && ViewLike<const X> &&
+           ViewLike<const S>
+void
+scatter(D&& p_Target,
+        std::size_t p_Axis,
+        const X& p_Index,
+        const S& p_Values,
+        Op p_Op = {},
+        ThreadPool& p_Pool = ThreadPool::global())
+{
+  detail::scatter(as_view(p_Target), p_Axis, as_view(p_Index), as_view(p_Values), p_Op, p_Pool);
+}
+
+}
@@ -0,0 +1,283 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Tensor.hpp"
+#include "TensorView.hpp"
+#include "ThreadPool.hpp"
+#include "TrackedTensor.hpp"
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace TenSore {
+
+namespace detail {
+
+inline constexpr std::uint64_t k_Prime1 = 11400714785074694791ull;
+inline constexpr std::uint64_t k_Prime2 = 14029467366897019727ull;
+inline constexpr std::uint64_t k_Prime3 = 1609587929392839161ull;
+inline constexpr std::uint64_t k_Prime4 = 9650029242287828579ull;
+inline constexpr std::uint64_t k_Prime5 = 2870177450012600261ull;
+
+inline std::uint64_t
+hash_round(std::uint64_t p_Acc, std::uint64_t p_Input) noexcept
+{
+  return std::rotl(p_Acc + p_Input * k_Prime2, 31) * k_Prime1;
+}
+
+inline std::uint64_t
+hash_merge(std::uint64_t p_Acc, std::uint64_t p_Lane) noexcept
+{
+  return (p_Acc ^ hash_round(0, p_Lane)) * k_Prime1 + k_Prime4;
+}
+
+template<typename U>
+U
+load(const std::byte* p_Data) noexcept
+{
+  U _retval;
+  std::memcpy(&_retval, p_Data, sizeof(U));
+  return _retval;
+}
+
+}
+
+/**
+ * @brief 64-bit hash of a byte range (XXH64)
+ *
+ * @param p_Data Bytes to hash
+ * @param p_Seed Seed, chaining hashes of several ranges
+ *
+ * @details
+ * Four independent accumulators consume 32 bytes per step, so the loop
+ * runs at several bytes per cycle. Words are read in host byte order,
+ * which matches the reference implementation on little-endian hosts.
+ */
+inline std::uint64_t
+hash_bytes(std::span<const std::byte> p_Data, std::uint64_t p_Seed = 0) noexcept
+{
+  using namespace detail;
+  const std::byte* _it = p_Data.data();
+  const std::byte* const _end = _it + p_Data.size();
+  std::uint64_t _hash;
+  if (p_Data.size() >= 32) {
+    std::uint64_t _lanes[4] = {
+      p_Seed + k_Prime1 + k_Prime2, p_Seed + k_Prime2, p_Seed, p_Seed - k_Prime1
+    };
+    for (; _it + 32 <= _end; _it += 32) {
+      for (std::size_t i = 0; i < 4; ++i) {
+        _lanes[i] = hash_round(_lanes[i], load<std::uint64_t>(_it + 8 * i));
+      }
+    }
+    _hash = std::rotl(_lanes[0], 1) + std::rotl(_lanes[1], 7) +
+            std::rotl(_lanes[2], 12) + std::rotl(_lanes[3], 18);
+    for (const auto _lane : _lanes) {
+      _hash = hash_merge(_hash, _lane);
+    }
+  } else {
+    _hash = p_Seed + k_Prime5;
+  }
+  _hash += p_Data.size();
+  for (; _it + 8 <= _end; _it += 8) {
+    _hash ^= hash_round(0, load<std::uint64_t>(_it));
+    _hash = std::rotl(_hash, 27) * k_Prime1 + k_Prime4;
+  }
+  if (_it + 4 <= _end) {
+    _hash ^= load<std::uint32_t>(_it) * k_Prime1;
+    _hash = std::rotl(_hash, 23) * k_Prime2 + k_Prime3;
+    _it += 4;
+  }
+  for (; _it < _end; ++_it) {
+    _hash ^= static_cast<std::uint64_t>(*_it) * k_Prime5;
+    _hash = std::rotl(_hash, 11) * k_Prime1;
+  }
+  _hash ^= _hash >> 33;
+  _hash *= k_Prime2;
+  _hash ^= _hash >> 29;
+  _hash *= k_Prime3;
+  return _hash ^ (_hash >> 32);
+}
+
+/**
+ * @brief Hash of the bit pattern of a trivially copyable value
+ */
+template<typename U>
+  requires std::is_trivially_copyable_v<U>
+std::uint64_t
+hash_value(const U& p_Value, std::uint64_t p_Seed = 0) noexcept
+{
+  return hash_bytes(std::as_bytes(std::span(&p_Value, 1)), p_Seed);
+}
+
+namespace detail {
+
+/**
+ * @brief Combines dimensions and per-block hashes into a content hash
+ */
+template<typename T, std::size_t Rank>
+std::uint64_t
+combine_blocks(const std::array<std::size_t, Rank>& p_Dimensions,
+               std::span<const std::uint64_t> p_Blocks) noexcept
+{
+  const std::array<std::uint64_t, 2> _type{ sizeof(T), Rank };
+  std::uint64_t _seed = hash_value(_type);
+  _seed = hash_bytes(std::as_bytes(std::span(p_Dimensions)), _seed);
+  return hash_bytes(std::as_bytes(p_Blocks), _seed);
+}
+
+}
+
+/**
+ * @brief Hash of a tensor's dimensions and elements
+ *
+ * @param p_View Tensor or view to hash
+ * @param p_BlockElements Elements per independently hashed block
+ * @param p_Pool Pool hashing blocks in parallel for large tensors
+ *
+ * @return Hash equal for tensors of equal rank, dimensions, element size
+ * and bit patterns
+ *
+ * @details
+ * Elements are hashed in blocks of `p_BlockElements` in linear order and
+ * the block hashes are hashed again together with the dimensions. With
+ * the same block size the result equals IncrementalHash::value() of a
+ * TrackedTensor, which updates it by rehashing modified blocks only.
+ * Non-contiguous views are copied block by block first.
+ */
+template<typename T, std::size_t Rank>
+std::uint64_t
+content_hash(const TensorView<T, Rank>& p_View,
+             std::size_t p_BlockElements = 16384,
+             ThreadPool& p_Pool = ThreadPool::global())
+{
+  using U = std::remove_const_t<T>;
+  static_assert(std::is_trivially_copyable_v<U>,
+                "Content hashes cover trivially copyable types only");
+  if (p_BlockElements == 0) {
+    throw std::invalid_argument("Block size must be positive");
+  }
+  const std::size_t _size = p_View.size();
+  std::vector<std::uint64_t> _hashes((_size + p_BlockElements - 1) / p_BlockElements);
+  if (p_View.contiguous()) {
+    auto _hash_block = [&](std::size_t b) {
+      const std::size_t _first = b * p_BlockElements;
+      _hashes[b] = hash_bytes(std::as_bytes(std::span<const U>(
+        p_View.storage() + _first, std::min(p_BlockElements, _size - _first))));
+    };
+    constexpr std::size_t k_ParallelBlocks = 64;
+    if (_hashes.size() >= k_ParallelBlocks && p_Pool.size() > 1) {
+      const std::size_t _tasks = p_Pool.size();
+      p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+        for (std::size_t b = t; b < _hashes.size(); b += _tasks) {
+          _hash_block(b);
+        }
+      });
+    } else {
+      for (std::size_t b = 0; b < _hashes.size(); ++b) {
+        _hash_block(b);
+      }
+    }
+  } else {
+    std::vector<U> _buffer;
+    _buffer.reserve(std::min(p_BlockElements, _size));
+    std::size_t _block = 0;
+    for (const U& it : p_View) {
+      _buffer.push_back(it);
+      if (_buffer.size() == p_BlockElements) {
+        _hashes[_block++] = hash_bytes(std::as_bytes(std::span(_buffer)));
+        _buffer.clear();
+      }
+    }
+    if (!_buffer.empty()) {
+      _hashes[_block] = hash_bytes(std::as_bytes(std::span(_buffer)));
+    }
+  }
+  return detail::combine_blocks<U, Rank>(p_View.dimensions(), _hashes);
+}
+
+template<typename T, std::size_t Rank, Allocator A>
+std::uint64_t
+content_hash(const Tensor<T, Rank, A>& p_Tensor,
+             std::size_t p_BlockElements = 16384,
+             ThreadPool& p_Pool = ThreadPool::global())
+{
+  return content_hash(TensorView<const T, Rank>(p_Tensor), p_BlockElements, p_Pool);
+}
+
+/**
+ * @class IncrementalHash
+ * @brief Content hash of a TrackedTensor, updated from its dirty blocks
+ *
+ * @details
+ * Owns a dirty channel of the tensor and a hash per block; value()
+ * rehashes the blocks modified since the previous call and recombines,
+ * so it costs time proportional to the modifications plus the amount of
+ * blocks. The tensor must outlive this object and must not be accessed
+ * concurrently with value().
+ */
+template<typename T, std::size_t Rank, Allocator A = std::allocator<T>>
+class IncrementalHash
+{
+public:
+  IncrementalHash() = delete;
+
+  explicit IncrementalHash(TrackedTensor<T, Rank, A>& p_Tensor)
+    : m_Tensor(&p_Tensor)
+    , m_Channel(p_Tensor.add_channel())
+    , m_Hashes(p_Tensor.block_count())
+  {
+  }
+
+  /**
+   * @brief Current hash, equal to content_hash(tensor, block_elements())
+   */
+  std::uint64_t value()
+  {
+    const auto _blocks = m_Tensor->dirty(m_Channel).take();
+    for (const std::size_t _block : _blocks) {
+      m_Hashes[_block] = hash_bytes(std::as_bytes(m_Tensor->block(_block)));
+    }
+    m_Rehashed += _blocks.size();
+    if (!_blocks.empty() || !m_Valid) {
+      m_Value = detail::combine_blocks<T, Rank>(m_Tensor->dimensions(), m_Hashes);
+      m_Valid = true;
+    }
+    return m_Value;
+  }
+
+  /**
+   * @brief Blocks rehashed so far, for telling incremental from full work
+   */
+  std::size_t rehashed_blocks() const noexcept { return m_Rehashed; }
+
+private:
+  TrackedTensor<T, Rank, A>* m_Tensor;
+  std::size_t m_Channel;
+  std::vector<std::uint64_t> m_Hashes;
+  std::uint64_t m_Value = 0;
+  bool m_Valid = false;
+  std::size_t m_Rehashed = 0;
+};
+
+}
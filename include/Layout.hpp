@@ -0,0 +1,473 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+namespace TenSore {
+
+namespace detail {
+
+/**
+ * @brief Mask selecting the bits of one dimension in a Morton code
+ */
+template<std::size_t Rank>
+constexpr std::uint64_t
+morton_mask(std::size_t p_Dimension) noexcept
+{
+  std::uint64_t _mask = 0;
+  for (std::size_t i = p_Dimension; i < 64; i += Rank) {
+    _mask |= std::uint64_t{ 1 } << i;
+  }
+  return _mask;
+}
+
+/**
+ * @brief Spreads the bits of a value to every Rank'th position
+ *
+ * @details
+ * Uses PDEP when BMI2 is available, the shift-and-mask sequences for
+ * ranks 2 and 3, and a bit loop otherwise.
+ */
+template<std::size_t Rank>
+inline std::uint64_t
+spread_bits(std::uint64_t x) noexcept
+{
+#if defined(__BMI2__)
+  return _pdep_u64(x, morton_mask<Rank>(0));
+#else
+  if constexpr (Rank == 1) {
+    return x;
+  } else if constexpr (Rank == 2) {
+    x &= 0x00000000ffffffffull;
+    x = (x | (x << 16)) & 0x0000ffff0000ffffull;
+    x = (x | (x << 8)) & 0x00ff00ff00ff00ffull;
+    x = (x | (x << 4)) & 0x0f0f0f0f0f0f0f0full;
+    x = (x | (x << 2)) & 0x3333333333333333ull;
+    x = (x | (x << 1)) & 0x5555555555555555ull;
+    return x;
+  } else if constexpr (Rank == 3) {
+    x &= 0x1fffffull;
+    x = (x | (x << 32)) & 0x1f00000000ffffull;
+    x = (x | (x << 16)) & 0x1f0000ff0000ffull;
+    x = (x | (x << 8)) & 0x100f00f00f00f00full;
+    x = (x | (x << 4)) & 0x10c30c30c30c30c3ull;
+    x = (x | (x << 2)) & 0x1249249249249249ull;
+    return x;
+  } else {
+    std::uint64_t _retval = 0;
+    for (std::size_t i = 0; i * Rank < 64 && x != 0; ++i, x >>= 1) {
+      _retval |= (x & 1) << (i * Rank);
+    }
+    return _retval;
+  }
+#endif
+}
+
+/**
+ * @brief Inverse of spread_bits()
+ */
+template<std::size_t Rank>
+inline std::uint64_t
+compact_bits(std::uint64_t x) noexcept
+{
+#if defined(__BMI2__)
+  return _pext_u64(x, morton_mask<Rank>(0));
+#else
+  if constexpr (Rank == 1) {
+    return x;
+  } else if constexpr (Rank == 2) {
+    x &= 0x5555555555555555ull;
+    x = (x | (x >> 1)) & 0x3333333333333333ull;
+    x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0full;
+    x = (x | (x >> 4)) & 0x00ff00ff00ff00ffull;
+    x = (x | (x >> 8)) & 0x0000ffff0000ffffull;
+    x = (x | (x >> 16)) & 0x00000000ffffffffull;
+    return x;
+  } else if constexpr (Rank == 3) {
+    x &= 0x1249249249249249ull;
+    x = (x | (x >> 2)) & 0x10c30c30c30c30c3ull;
+    x = (x | (x >> 4)) & 0x100f00f00f00f00full;
+    x = (x | (x >> 8)) & 0x1f0000ff0000ffull;
+    x = (x | (x >> 16)) & 0x1f00000000ffffull;
+    x = (x | (x >> 32)) & 0x1fffffull;
+    return x;
+  } else {
+    std::uint64_t _retval = 0;
+    for (std::size_t i = 0; i * Rank < 64; ++i) {
+      _retval |= ((x >> (i * Rank)) & 1) << i;
+    }
+    return _retval;
+  }
+#endif
+}
+
+/**
+ * @brief Linear index of a block in a first-dimension-fastest block grid
+ */
+template<std::size_t Rank>
+constexpr std::size_t
+linear_index(const std::array<std::size_t, Rank>& p_Coords,
+             const std::array<std::size_t, Rank>& p_Dimensions) noexcept
+{
+  std::size_t _index = 0;
+  std::size_t _multiplier = 1;
+  for (std::size_t i = 0; i < Rank; ++i) {
+    _index += p_Coords[i] * _multiplier;
+    _multiplier *= p_Dimensions[i];
+  }
+  return _index;
+}
+
+/**
+ * @brief Linear index of an element in a first-dimension-fastest tensor
+ *
+ * @details
+ * Throws std::out_of_range when a coordinate is out of its dimension.
+ */
+template<std::size_t Rank>
+constexpr std::size_t
+checked_index(const std::array<std::size_t, Rank>& p_Coords,
+              const std::array<std::size_t, Rank>& p_Dimensions)
+{
+  for (std::size_t i = 0; i < Rank; ++i) {
+    if (p_Coords[i] >= p_Dimensions[i]) {
+      throw std::out_of_range("Index out of bounds");
+    }
+  }
+  return linear_index(p_Coords, p_Dimensions);
+}
+
+template<std::size_t Rank>
+constexpr std::array<std::size_t, Rank>
+linear_coordinates(std::size_t p_Index,
+                   const std::array<std::size_t, Rank>& p_Dimensions) noexcept
+{
+  std::array<std::size_t, Rank> _coords{};
+  for (std::size_t i = 0; i < Rank; ++i) {
+    _coords[i] = p_Index % p_Dimensions[i];
+    p_Index /= p_Dimensions[i];
+  }
+  return _coords;
+}
+
+}
+
+/**
+ * @brief Mapping from coordinates to storage offsets
+ *
+ * @details
+ * A layout policy provides `Mapping<Rank>`, constructed from dimensions.
+ * required_size() may exceed the element count when the layout pads the
+ * grid; offsets at such positions have coordinates outside of it.
+ */
+template<typename M, std::size_t Rank>
+concept LayoutMapping =
+  std::constructible_from<M, const std::array<std::size_t, Rank>&> &&
+  requires(const M m,
+           const std::array<std::size_t, Rank>& coords,
+           std::size_t offset) {
+    { m.dimensions() } -> std::convertible_to<std::array<std::size_t, Rank>>;
+    { m.required_size() } -> std::convertible_to<std::size_t>;
+    { m.offset(coords) } -> std::convertible_to<std::size_t>;
+    { m.coordinates(offset) } -> std::same_as<std::array<std::size_t, Rank>>;
+  };
+
+/**
+ * @brief Tensor's own first-dimension-fastest layout
+ */
+struct LinearLayout
+{
+  template<std::size_t Rank>
+  class Mapping
+  {
+  public:
+    explicit Mapping(const std::array<std::size_t, Rank>& p_Dimensions)
+      : m_Dimensions(p_Dimensions)
+    {
+    }
+
+    const std::array<std::size_t, Rank>& dimensions() const noexcept
+    {
+      return m_Dimensions;
+    }
+
+    std::size_t required_size() const noexcept
+    {
+      std::size_t _retval = 1;
+      for (const auto& it : m_Dimensions) {
+        _retval *= it;
+      }
+      return _retval;
+    }
+
+    std::size_t offset(const std::array<std::size_t, Rank>& p_Coords) const noexcept
+    {
+      return detail::linear_index(p_Coords, m_Dimensions);
+    }
+
+    std::array<std::size_t, Rank> coordinates(std::size_t p_Offset) const noexcept
+    {
+      return detail::linear_coordinates(p_Offset, m_Dimensions);
+    }
+
+  private:
+    std::array<std::size_t, Rank> m_Dimensions;
+  };
+};
+
+/**
+ * @brief Blocked layout of fixed-size tiles
+ *
+ * @tparam Tile Extent of a tile along each dimension
+ *
+ * @details
+ * Tiles are laid out first-dimension-fastest, and so are the elements
+ * inside a tile. Each dimension is padded up to a multiple of its tile
+ * extent; power-of-two extents turn the index arithmetic into shifts.
+ */
+template<std::size_t... Tile>
+struct TiledLayout
+{
+  template<std::size_t Rank>
+  class Mapping
+  {
+    static_assert(sizeof...(Tile) == Rank,
+                  "Tile must have an extent for every dimension");
+    static_assert(((Tile > 0) && ...), "Tile extents must be positive");
+
+    static constexpr std::array<std::size_t, Rank> s_Tile{ { Tile... } };
+    static constexpr std::size_t s_TileSize = (Tile * ...);
+
+  public:
+    explicit Mapping(const std::array<std::size_t, Rank>& p_Dimensions)
+      : m_Dimensions(p_Dimensions)
+    {
+      for (std::size_t i = 0; i < Rank; ++i) {
+        m_Blocks[i] = (m_Dimensions[i] + s_Tile[i] - 1) / s_Tile[i];
+      }
+    }
+
+    const std::array<std::size_t, Rank>& dimensions() const noexcept
+    {
+      return m_Dimensions;
+    }
+
+    static constexpr std::array<std::size_t, Rank> tile() noexcept
+    {
+      return s_Tile;
+    }
+
+    std::size_t required_size() const noexcept
+    {
+      std::size_t _retval = s_TileSize;
+      for (const auto& it : m_Blocks) {
+        _retval *= it;
+      }
+      return _retval;
+    }
+
+    std::size_t offset(const std::array<std::size_t, Rank>& p_Coords) const noexcept
+    {
+      std::array<std::size_t, Rank> _block;
+      std::array<std::size_t, Rank> _inner;
+      for (std::size_t i = 0; i < Rank; ++i) {
+        _block[i] = p_Coords[i] / s_Tile[i];
+        _inner[i] = p_Coords[i] % s_Tile[i];
+      }
+      return detail::linear_index(_block, m_Blocks) * s_TileSize +
+             detail::linear_index(_inner, s_Tile);
+    }
+
+    std::array<std::size_t, Rank> coordinates(std::size_t p_Offset) const noexcept
+    {
+      const auto _block = detail::linear_coordinates(p_Offset / s_TileSize, m_Blocks);
+      const auto _inner = detail::linear_coordinates(p_Offset % s_TileSize, s_Tile);
+      std::array<std::size_t, Rank> _retval;
+      for (std::size_t i = 0; i < Rank; ++i) {
+        _retval[i] = _block[i] * s_Tile[i] + _inner[i];
+      }
+      return _retval;
+    }
+
+  private:
+    std::array<std::size_t, Rank> m_Dimensions;
+    std::array<std::size_t, Rank> m_Blocks;
+  };
+};
+
+/**
+ * @brief Morton (Z-order) layout, without padding
+ *
+ * @details
+ * Elements are ordered along a Z-order curve inside cubic blocks whose
+ * side is a power of two, so the whole grid is a single curve for
+ * power-of-two cubes. Only blocks lying entirely inside the grid are
+ * used, laid out first-dimension-fastest; the side is the largest one
+ * whose blocks cover at least 7/8 of the elements. The remaining edge
+ * elements follow the blocks in plain first-dimension-fastest order, one
+ * slab per dimension. required_size() always equals the element count,
+ * so the worst-case storage overhead is zero, and at most 1/8 of the
+ * elements sit outside the curve.
+ */
+struct MortonLayout
+{
+  template<std::size_t Rank>
+  class Mapping
+  {
+    static_assert(Rank > 0, "Morton layout requires at least one dimension");
+
+  public:
+    explicit Mapping(const std::array<std::size_t, Rank>& p_Dimensions)
+      : m_Dimensions(p_Dimensions)
+    {
+      std::size_t _min = m_Dimensions[0];
+      std::size_t _size = 1;
+      for (const auto& it : m_Dimensions) {
+        _min = it < _min ? it : _min;
+        _size *= it;
+      }
+      m_Bits = _min > 1 ? std::bit_width(_min) - 1 : 0;
+      if (m_Bits * Rank > 63) {
+        m_Bits = 63 / Rank;
+      }
+      for (;; --m_Bits) {
+        m_Head = 1;
+        for (std::size_t i = 0; i < Rank; ++i) {
+          m_Blocks[i] = m_Dimensions[i] >> m_Bits;
+          m_Head *= m_Blocks[i] << m_Bits;
+        }
+        if (m_Bits == 0 || m_Head >= _size - _size / 8) {
+          break;
+        }
+      }
+      std::size_t _start = m_Head;
+      for (std::size_t k = 0; k < Rank; ++k) {
+        m_Slabs[k] = _start;
+        _start += slab_size(k);
+      }
+    }
+
+    const std::array<std::size_t, Rank>& dimensions() const noexcept
+    {
+      return m_Dimensions;
+    }
+
+    /**
+     * @brief Side of a Morton block, a power of two
+     */
+    std::size_t block_side() const noexcept { return std::size_t{ 1 } << m_Bits; }
+
+    std::size_t required_size() const noexcept
+    {
+      return m_Slabs[Rank - 1] + slab_size(Rank - 1);
+    }
+
+    std::size_t offset(const std::array<std::size_t, Rank>& p_Coords) const noexcept
+    {
+      std::size_t k = Rank;
+      for (std::size_t i = 0; i < Rank; ++i) {
+        if (p_Coords[i] >= m_Blocks[i] << m_Bits) {
+          k = i;
+        }
+      }
+      if (k < Rank) {
+        std::array<std::size_t, Rank> _local = p_Coords;
+        _local[k] -= m_Blocks[k] << m_Bits;
+        return m_Slabs[k] + detail::linear_index(_local, slab(k));
+      }
+      const std::size_t _mask = (std::size_t{ 1 } << m_Bits) - 1;
+      std::array<std::size_t, Rank> _block;
+      std::uint64_t _code = 0;
+      for (std::size_t i = 0; i < Rank; ++i) {
+        _block[i] = p_Coords[i] >> m_Bits;
+        _code |= detail::spread_bits<Rank>(p_Coords[i] & _mask) << i;
+      }
+      return (detail::linear_index(_block, m_Blocks) << (m_Bits * Rank)) |
+             static_cast<std::size_t>(_code);
+    }
+
+    std::array<std::size_t, Rank> coordinates(std::size_t p_Offset) const noexcept
+    {
+      std::array<std::size_t, Rank> _retval;
+      if (p_Offset >= m_Head) {
+        for (std::size_t k = 0; k < Rank; ++k) {
+          if (p_Offset < m_Slabs[k] + slab_size(k)) {
+            _retval = detail::linear_coordinates(p_Offset - m_Slabs[k], slab(k));
+            _retval[k] += m_Blocks[k] << m_Bits;
+            return _retval;
+          }
+        }
+      }
+      const std::uint64_t _code =
+        p_Offset & ((std::size_t{ 1 } << (m_Bits * Rank)) - 1);
+      const auto _block =
+        detail::linear_coordinates(p_Offset >> (m_Bits * Rank), m_Blocks);
+      for (std::size_t i = 0; i < Rank; ++i) {
+        _retval[i] = (_block[i] << m_Bits) |
+                     static_cast<std::size_t>(
+                       detail::compact_bits<Rank>(_code >> i));
+      }
+      return _retval;
+    }
+
+  private:
+    /**
+     * @brief Dimensions of the edge slab past the blocks along dimension k
+     *
+     * @details
+     * The slab spans the full grid below k and the blocked part above it,
+     * so the slabs partition the elements not covered by blocks.
+     */
+    std::array<std::size_t, Rank> slab(std::size_t k) const noexcept
+    {
+      std::array<std::size_t, Rank> _retval = m_Dimensions;
+      _retval[k] -= m_Blocks[k] << m_Bits;
+      for (std::size_t i = k + 1; i < Rank; ++i) {
+        _retval[i] = m_Blocks[i] << m_Bits;
+      }
+      return _retval;
+    }
+
+    std::size_t slab_size(std::size_t k) const noexcept
+    {
+      std::size_t _retval = 1;
+      for (const auto& it : slab(k)) {
+        _retval *= it;
+      }
+      return _retval;
+    }
+
+    std::array<std::size_t, Rank> m_Dimensions;
+    std::array<std::size_t, Rank> m_Blocks;
+    std::array<std::size_t, Rank> m_Slabs;
+    std::size_t m_Bits;
+    std::size_t m_Head;
+  };
+};
+
+}
@@ -0,0 +1,262 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Layout.hpp"
+#include "TensorView.hpp"
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @class LayoutTensor
+ * @brief Tensor stored in a non-linear layout
+ *
+ * @tparam T The type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ * @tparam Layout Layout policy, e.g. TiledLayout<32, 32> or MortonLayout
+ * @tparam A The type of allocator used in a tensor
+ *
+ * @details
+ * Coordinate access has the same semantics as Tensor's, only the storage
+ * order differs. Iteration visits elements in storage order, yielding
+ * coordinates alongside values, so kernels that only need to touch every
+ * element once do so sequentially in memory. Padding added by the layout
+ * is value-initialized and never visited.
+ */
+template<typename T,
+         std::size_t Rank,
+         typename Layout,
+         Allocator A = std::allocator<T>>
+class LayoutTensor
+{
+public:
+  using Mapping = typename Layout::template Mapping<Rank>;
+
+  static_assert(LayoutMapping<Mapping, Rank>,
+                "Layout does not provide a valid mapping");
+
+  /**
+   * @class BasicIterator
+   * @brief Storage-order traversal skipping layout padding
+   */
+  template<typename U>
+  class BasicIterator
+  {
+  public:
+    using iterator_concept = std::input_iterator_tag;
+    using value_type = Indexed<U, Rank>;
+    using reference = Indexed<U, Rank>;
+    using difference_type = std::ptrdiff_t;
+
+    BasicIterator() = default;
+
+    BasicIterator(U* p_Data, const Mapping* p_Mapping)
+      : m_Data(p_Data)
+      , m_Mapping(p_Mapping)
+      , m_End(p_Mapping->required_size())
+    {
+      settle();
+    }
+
+    reference operator*() const { return { m_Coords, m_Data[m_Offset] }; }
+
+    BasicIterator& operator++()
+    {
+      ++m_Offset;
+      settle();
+      return *this;
+    }
+
+    void operator++(int) { ++*this; }
+
+    friend bool operator==(const BasicIterator& it, std::default_sentinel_t) noexcept
+    {
+      return it.m_Offset >= it.m_End;
+    }
+
+  private:
+    void settle()
+    {
+      for (; m_Offset < m_End; ++m_Offset) {
+        m_Coords = m_Mapping->coordinates(m_Offset);
+        bool _inside = true;
+        for (std::size_t i = 0; i < Rank; ++i) {
+          _inside &= m_Coords[i] < m_Mapping->dimensions()[i];
+        }
+        if (_inside) {
+          return;
+        }
+      }
+    }
+
+    U* m_Data = nullptr;
+    const Mapping* m_Mapping = nullptr;
+    std::size_t m_Offset = 0;
+    std::size_t m_End = 0;
+    std::array<std::size_t, Rank> m_Coords{};
+  };
+
+  using Iterator = BasicIterator<T>;
+  using ConstIterator = BasicIterator<const T>;
+
+  LayoutTensor() = delete;
+
+  /**
+   * @brief A constructor with an rvalue array
+   *
+   * @param p_Dimensions Array of dimensions
+   */
+  LayoutTensor(std::array<std::size_t, Rank>&& p_Dimensions)
+    : m_Mapping(p_Dimensions)
+    , m_Data(m_Mapping.required_size())
+  {
+    m_Size = 1;
+    for (const auto& it : p_Dimensions) {
+      m_Size *= it;
+    }
+  }
+
+  /**
+   * @brief Converts a linear tensor into this layout
+   *
+   * @details
+   * Walks the destination in storage order, so writes are sequential and
+   * reads are confined to one tile of the source at a time.
+   *
+   * @param p_Tensor Tensor to be copied from
+   */
+  template<Allocator B>
+  explicit LayoutTensor(const Tensor<T, Rank, B>& p_Tensor)
+    : LayoutTensor(std::array<std::size_t, Rank>(p_Tensor.dimensions()))
+  {
+    const T* _src = p_Tensor.storage();
+    const auto& _dims = dimensions();
+    for (auto [coords, value] : *this) {
+      value = _src[detail::linear_index(coords, _dims)];
+    }
+  }
+
+  std::size_t size() const noexcept { return m_Size; }
+
+  /**
+   * @brief Amount of elements in storage, including padding
+   */
+  std::size_t storage_size() const noexcept { return m_Data.size(); }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_Mapping.dimensions();
+  }
+
+  const Mapping& mapping() const noexcept { return m_Mapping; }
+
+  T* storage() noexcept { return m_Data.data(); }
+
+  const T* storage() const noexcept { return m_Data.data(); }
+
+  /**
+   * @brief Element access with calculated index
+   *
+   * @param p_Dims Dimension coordinates to access.
+   *
+   * @return Element at calculated index
+   */
+  T& at(const std::array<std::size_t, Rank>& p_Dims)
+  {
+    check(p_Dims);
+    return m_Data[m_Mapping.offset(p_Dims)];
+  }
+
+  const T& at(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    check(p_Dims);
+    return m_Data[m_Mapping.offset(p_Dims)];
+  }
+
+  template<std::size_t... p_Dimensions>
+  T& operator()()
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Misaligned dimensions in tensor's `()` operator");
+    return at({ { p_Dimensions... } });
+  }
+
+  template<std::size_t... p_Dimensions>
+  const T& operator()() const
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Misaligned dimensions in tensor's `()` operator");
+    return at({ { p_Dimensions... } });
+  }
+
+  T& operator()(const std::array<std::size_t, Rank>& p_Dims) { return at(p_Dims); }
+
+  const T& operator()(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return at(p_Dims);
+  }
+
+  Iterator begin() { return Iterator(m_Data.data(), &m_Mapping); }
+  ConstIterator begin() const { return ConstIterator(m_Data.data(), &m_Mapping); }
+  std::default_sentinel_t end() const noexcept { return {}; }
+
+  /**
+   * @brief Converts back into the linear layout
+   */
+  Tensor<T, Rank> to_tensor() const
+  {
+    std::array<std::size_t, Rank> _dims = dimensions();
+    Tensor<T, Rank> _retval(std::move(_dims));
+    T* _dst = _retval.storage();
+    for (auto [coords, value] : *this) {
+      _dst[detail::linear_index(coords, dimensions())] = value;
+    }
+    return _retval;
+  }
+
+private:
+  void check(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (p_Dims[i] >= dimensions()[i]) {
+        throw std::out_of_range("Index out of bounds");
+      }
+    }
+  }
+
+  Mapping m_Mapping;
+  std::vector<T, A> m_Data;
+  std::size_t m_Size;
+};
+
+/**
+ * @brief Converts a linear tensor into another layout
+ */
+template<typename Layout, typename T, std::size_t Rank, Allocator A>
+LayoutTensor<T, Rank, Layout>
+to_layout(const Tensor<T, Rank, A>& p_Tensor)
+{
+  return LayoutTensor<T, Rank, Layout>(p_Tensor);
+}
+
+}
@@ -0,0 +1,555 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "TensorView.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @brief Element-wise operations recordable in a LazyGraph
+ */
+enum class LazyOp : std::uint8_t
+{
+  Input,
+  Constant,
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Min,
+  Max,
+  Neg,
+  Abs,
+  Sqrt,
+  Exp,
+  Log
+};
+
+/**
+ * @class LazyGraph
+ * @brief Deferred element-wise computation over tensors of one shape
+ *
+ * @tparam T The type of value
+ * @tparam Rank Rank of all tensors in the graph
+ *
+ * @details
+ * Operations on LazyGraph::Expr record nodes of a DAG instead of
+ * computing. Identical nodes are merged as they are recorded (common
+ * subexpression elimination, with commutative operands canonicalized)
+ * and operations on constants are folded. On compile() nodes that do not
+ * reach an output are dropped, and the remaining ones are fused into a
+ * single pass over tiles of the tensors: each node holds a tile-sized
+ * scratch slot, and slots are recycled as soon as the last consumer of a
+ * node has run, so intermediates never occupy a full tensor. Tiles are
+ * scheduled onto a ThreadPool.
+ *
+ * The graph stores pointers to bound tensors: they must outlive it and
+ * must not be resized while it is in use.
+ */
+template<typename T, std::size_t Rank>
+class LazyGraph
+{
+public:
+  /**
+   * @brief Handle of a recorded node
+   */
+  class Expr
+  {
+  public:
+    Expr() = delete;
+
+    std::size_t id() const noexcept { return m_Id; }
+
+    LazyGraph& graph() const noexcept { return *m_Graph; }
+
+    friend Expr operator+(Expr a, Expr b) { return binary(LazyOp::Add, a, b); }
+    friend Expr operator-(Expr a, Expr b) { return binary(LazyOp::Sub, a, b); }
+    friend Expr operator*(Expr a, Expr b) { return binary(LazyOp::Mul, a, b); }
+    friend Expr operator/(Expr a, Expr b) { return binary(LazyOp::Div, a, b); }
+    friend Expr operator+(Expr a, T b) { return a + a.m_Graph->constant(b); }
+    friend Expr operator-(Expr a, T b) { return a - a.m_Graph->constant(b); }
+    friend Expr operator*(Expr a, T b) { return a * a.m_Graph->constant(b); }
+    friend Expr operator/(Expr a, T b) { return a / a.m_Graph->constant(b); }
+    friend Expr operator+(T a, Expr b) { return b.m_Graph->constant(a) + b; }
+    friend Expr operator-(T a, Expr b) { return b.m_Graph->constant(a) - b; }
+    friend Expr operator*(T a, Expr b) { return b.m_Graph->constant(a) * b; }
+    friend Expr operator/(T a, Expr b) { return b.m_Graph->constant(a) / b; }
+    friend Expr operator-(Expr a) { return unary(LazyOp::Neg, a); }
+    friend Expr min(Expr a, Expr b) { return binary(LazyOp::Min, a, b); }
+    friend Expr max(Expr a, Expr b) { return binary(LazyOp::Max, a, b); }
+    friend Expr abs(Expr a) { return unary(LazyOp::Abs, a); }
+    friend Expr sqrt(Expr a) { return unary(LazyOp::Sqrt, a); }
+    friend Expr exp(Expr a) { return unary(LazyOp::Exp, a); }
+    friend Expr log(Expr a) { return unary(LazyOp::Log, a); }
+
+  private:
+    friend class LazyGraph;
+
+    Expr(LazyGraph* p_Graph, std::size_t p_Id)
+      : m_Graph(p_Graph)
+      , m_Id(p_Id)
+    {
+    }
+
+    static Expr binary(LazyOp p_Op, Expr a, Expr b)
+    {
+      if (a.m_Graph != b.m_Graph) {
+        throw std::invalid_argument("Expressions belong to different graphs");
+      }
+      return Expr(a.m_Graph, a.m_Graph->record(p_Op, a.m_Id, b.m_Id));
+    }
+
+    static Expr unary(LazyOp p_Op, Expr a)
+    {
+      return Expr(a.m_Graph, a.m_Graph->record(p_Op, a.m_Id, k_None));
+    }
+
+    LazyGraph* m_Graph;
+    std::size_t m_Id;
+  };
+
+  LazyGraph() = delete;
+
+  /**
+   * @brief Constructor of a graph
+   *
+   * @param p_Dimensions Dimensions shared by all tensors of the graph
+   * @param p_Tile Elements per fused tile
+   */
+  explicit LazyGraph(const std::array<std::size_t, Rank>& p_Dimensions,
+                     std::size_t p_Tile = 2048)
+    : m_DimensionsData(p_Dimensions)
+    , m_Tile(std::max<std::size_t>(p_Tile, 1))
+  {
+    m_Size = 1;
+    for (const auto& it : m_DimensionsData) {
+      m_Size *= it;
+    }
+  }
+
+  LazyGraph(const LazyGraph&) = delete;
+  LazyGraph& operator=(const LazyGraph&) = delete;
+
+  /**
+   * @brief Binds a tensor as a graph input
+   *
+   * @param p_Tensor Tensor read on every run()
+   *
+   * @return Expression of the tensor's elements
+   */
+  template<Allocator A>
+  Expr input(const Tensor<T, Rank, A>& p_Tensor)
+  {
+    return input(as_view(p_Tensor));
+  }
+
+  /**
+   * @brief Binds a contiguous mdspan as a graph input
+   */
+  template<MdspanLike M>
+  Expr input(const M& p_Span)
+  {
+    return input(TensorView<const T, Rank>(as_view(p_Span)));
+  }
+
+  /**
+   * @brief Binds a contiguous view as a graph input
+   *
+   * @param p_View View read on every run()
+   *
+   * @return Expression of the view's elements
+   */
+  Expr input(TensorView<const T, Rank> p_View)
+  {
+    check_dimensions(p_View.dimensions());
+    const T* _data = p_View.span().data();
+    for (std::size_t i = 0; i < m_Inputs.size(); ++i) {
+      if (m_Inputs[i] == _data) {
+        return Expr(this, m_InputNodes[i]);
+      }
+    }
+    m_Inputs.push_back(_data);
+    m_InputNodes.push_back(
+      push({ LazyOp::Input, k_None, k_None, T{}, m_Inputs.size() - 1 }));
+    return Expr(this, m_InputNodes.back());
+  }
+
+  /**
+   * @brief Records a constant broadcast to the graph's shape
+   *
+   * @param p_Value Value of the constant
+   */
+  Expr constant(T p_Value)
+  {
+    // Equal values share a node, but -0.0 must not stand in for 0.0 and
+    // NaNs, which compare unordered, are never shared.
+    bool _negative = false;
+    if constexpr (std::is_floating_point_v<T>) {
+      if (std::isnan(p_Value)) {
+        return Expr(this, push({ LazyOp::Constant, k_None, k_None, p_Value, k_None }));
+      }
+      _negative = std::signbit(p_Value);
+    }
+    const std::pair<bool, T> _key(_negative, p_Value);
+    auto _it = m_Constants.find(_key);
+    if (_it != m_Constants.end()) {
+      return Expr(this, _it->second);
+    }
+    const std::size_t _id =
+      push({ LazyOp::Constant, k_None, k_None, p_Value, k_None });
+    m_Constants.emplace(_key, _id);
+    return Expr(this, _id);
+  }
+
+  /**
+   * @brief Marks an expression to be written into a tensor on run()
+   *
+   * @param p_Expr Expression to evaluate
+   * @param p_Tensor Destination, may also be bound as an input
+   *
+   * @details
+   * Outputs are written tile by tile in the order they were marked, after
+   * all nodes of a tile were evaluated; an output that is a bare input
+   * overwritten by an earlier output observes the overwritten values.
+   */
+  template<Allocator A>
+  void output(Expr p_Expr, Tensor<T, Rank, A>& p_Tensor)
+  {
+    output(p_Expr, as_view(p_Tensor));
+  }
+
+  /**
+   * @brief Marks an expression to be written into a contiguous mdspan on run()
+   */
+  template<MdspanLike M>
+  void output(Expr p_Expr, const M& p_Span)
+  {
+    output(p_Expr, as_view(p_Span));
+  }
+
+  /**
+   * @brief Marks an expression to be written into a contiguous view on run()
+   */
+  void output(Expr p_Expr, TensorView<T, Rank> p_View)
+  {
+    if (p_Expr.m_Graph != this) {
+      throw std::invalid_argument("Expression belongs to a different graph");
+    }
+    check_dimensions(p_View.dimensions());
+    m_Outputs.emplace_back(p_Expr.m_Id, p_View.span().data());
+    m_Compiled = false;
+  }
+
+  /**
+   * @brief Optimizes the recorded graph into a fused schedule
+   *
+   * @details
+   * Called implicitly by run() when the graph changed since last compile.
+   */
+  void compile()
+  {
+    const std::size_t _count = m_Nodes.size();
+    std::vector<bool> _live(_count, false);
+    for (const auto& it : m_Outputs) {
+      _live[it.first] = true;
+    }
+    for (std::size_t i = _count; i-- > 0;) {
+      if (_live[i]) {
+        const Node& _node = m_Nodes[i];
+        if (_node.m_Lhs != k_None) _live[_node.m_Lhs] = true;
+        if (_node.m_Rhs != k_None) _live[_node.m_Rhs] = true;
+      }
+    }
+
+    constexpr std::size_t _forever = std::numeric_limits<std::size_t>::max();
+    std::vector<std::size_t> _lastUse(_count, 0);
+    for (std::size_t i = 0; i < _count; ++i) {
+      if (_live[i]) {
+        if (m_Nodes[i].m_Lhs != k_None) _lastUse[m_Nodes[i].m_Lhs] = i;
+        if (m_Nodes[i].m_Rhs != k_None) _lastUse[m_Nodes[i].m_Rhs] = i;
+      }
+    }
+    for (const auto& it : m_Outputs) {
+      _lastUse[it.first] = _forever;
+    }
+
+    m_Steps.clear();
+    m_ConstantSlots.clear();
+    m_Operands.assign(_count, Operand{});
+    m_LiveCount = 0;
+    std::vector<std::size_t> _free;
+    std::size_t _slots = 0;
+    // Constants are filled once per tile range, so their slots come first
+    // and are never recycled for step outputs.
+    for (std::size_t i = 0; i < _count; ++i) {
+      if (_live[i] && m_Nodes[i].m_Op == LazyOp::Constant) {
+        m_Operands[i] = { false, _slots++ };
+        m_ConstantSlots.emplace_back(m_Operands[i].m_Index, m_Nodes[i].m_Constant);
+      }
+    }
+    auto _acquire = [&]() {
+      if (_free.empty()) {
+        return _slots++;
+      }
+      const std::size_t _slot = _free.back();
+      _free.pop_back();
+      return _slot;
+    };
+
+    for (std::size_t i = 0; i < _count; ++i) {
+      if (!_live[i]) {
+        continue;
+      }
+      ++m_LiveCount;
+      const Node& _node = m_Nodes[i];
+      if (_node.m_Op == LazyOp::Input) {
+        m_Operands[i] = { true, _node.m_Input };
+        continue;
+      }
+      if (_node.m_Op == LazyOp::Constant) {
+        continue;
+      }
+      Step _step{ _node.m_Op, m_Operands[_node.m_Lhs], Operand{}, 0 };
+      if (_node.m_Rhs != k_None) {
+        _step.m_Rhs = m_Operands[_node.m_Rhs];
+      }
+      for (std::size_t _operand : { _node.m_Lhs, _node.m_Rhs }) {
+        if (_operand != k_None && _lastUse[_operand] == i &&
+            m_Nodes[_operand].m_Op != LazyOp::Input &&
+            m_Nodes[_operand].m_Op != LazyOp::Constant &&
+            std::find(_free.begin(), _free.end(), m_Operands[_operand].m_Index) ==
+              _free.end()) {
+          _free.push_back(m_Operands[_operand].m_Index);
+        }
+      }
+      _step.m_Out = _acquire();
+      m_Operands[i] = { false, _step.m_Out };
+      m_Steps.push_back(_step);
+    }
+    m_SlotCount = _slots;
+    m_Compiled = true;
+  }
+
+  /**
+   * @brief Evaluates all outputs
+   *
+   * @param p_Pool Pool on which tiles are scheduled
+   */
+  void run(ThreadPool& p_Pool = ThreadPool::global())
+  {
+    if (!m_Compiled) {
+      compile();
+    }
+    const std::size_t _tiles = (m_Size + m_Tile - 1) / m_Tile;
+    const std::size_t _workers = std::min(p_Pool.size(), _tiles);
+    if (_workers <= 1) {
+      execute(0, _tiles);
+      return;
+    }
+    p_Pool.parallel_for(_workers, [&](std::size_t w) {
+      execute(_tiles * w / _workers, _tiles * (w + 1) / _workers);
+    });
+  }
+
+  /**
+   * @brief Amount of recorded nodes, after CSE and constant folding
+   */
+  std::size_t node_count() const noexcept { return m_Nodes.size(); }
+
+  /**
+   * @brief Amount of nodes reaching an output, after the last compile()
+   */
+  std::size_t live_count() const noexcept { return m_LiveCount; }
+
+  /**
+   * @brief Amount of tile-sized scratch slots per worker, after the last compile()
+   */
+  std::size_t slot_count() const noexcept { return m_SlotCount; }
+
+private:
+  static constexpr std::size_t k_None = std::numeric_limits<std::size_t>::max();
+
+  struct Node
+  {
+    LazyOp m_Op;
+    std::size_t m_Lhs;
+    std::size_t m_Rhs;
+    T m_Constant;
+    std::size_t m_Input;
+  };
+
+  struct Operand
+  {
+    bool m_IsInput = false;
+    std::size_t m_Index = 0;
+  };
+
+  struct Step
+  {
+    LazyOp m_Op;
+    Operand m_Lhs;
+    Operand m_Rhs;
+    std::size_t m_Out;
+  };
+
+  void check_dimensions(const std::array<std::size_t, Rank>& p_Dimensions) const
+  {
+    if (p_Dimensions != m_DimensionsData) {
+      throw std::invalid_argument("Tensor dimensions do not match the graph");
+    }
+  }
+
+  std::size_t push(const Node& p_Node)
+  {
+    m_Nodes.push_back(p_Node);
+    m_Compiled = false;
+    return m_Nodes.size() - 1;
+  }
+
+  static bool commutative(LazyOp p_Op) noexcept
+  {
+    return p_Op == LazyOp::Add || p_Op == LazyOp::Mul || p_Op == LazyOp::Min ||
+           p_Op == LazyOp::Max;
+  }
+
+  std::size_t record(LazyOp p_Op, std::size_t p_Lhs, std::size_t p_Rhs)
+  {
+    if (commutative(p_Op) && p_Rhs < p_Lhs) {
+      std::swap(p_Lhs, p_Rhs);
+    }
+    const bool _foldable =
+      m_Nodes[p_Lhs].m_Op == LazyOp::Constant &&
+      (p_Rhs == k_None || m_Nodes[p_Rhs].m_Op == LazyOp::Constant);
+    if (_foldable) {
+      const T _rhs = p_Rhs == k_None ? T{} : m_Nodes[p_Rhs].m_Constant;
+      return constant(apply(p_Op, m_Nodes[p_Lhs].m_Constant, _rhs)).m_Id;
+    }
+    const auto _key = std::make_tuple(p_Op, p_Lhs, p_Rhs);
+    auto _it = m_Memo.find(_key);
+    if (_it != m_Memo.end()) {
+      return _it->second;
+    }
+    const std::size_t _id = push({ p_Op, p_Lhs, p_Rhs, T{}, k_None });
+    m_Memo.emplace(_key, _id);
+    return _id;
+  }
+
+  static T apply(LazyOp p_Op, T a, T b)
+  {
+    switch (p_Op) {
+      case LazyOp::Add: return a + b;
+      case LazyOp::Sub: return a - b;
+      case LazyOp::Mul: return a * b;
+      case LazyOp::Div: return a / b;
+      case LazyOp::Min: return std::min(a, b);
+      case LazyOp::Max: return std::max(a, b);
+      case LazyOp::Neg: return -a;
+      case LazyOp::Abs: return a < T{} ? -a : a;
+      case LazyOp::Sqrt: return static_cast<T>(std::sqrt(a));
+      case LazyOp::Exp: return static_cast<T>(std::exp(a));
+      case LazyOp::Log: return static_cast<T>(std::log(a));
+      default: return a;
+    }
+  }
+
+  template<typename F>
+  static void kernel(const T* a, const T* b, T* out, std::size_t n, F f)
+  {
+    for (std::size_t i = 0; i < n; ++i) {
+      out[i] = f(a[i], b[i]);
+    }
+  }
+
+  static void run_step(LazyOp p_Op, const T* a, const T* b, T* out, std::size_t n)
+  {
+    switch (p_Op) {
+      case LazyOp::Add: kernel(a, b, out, n, [](T x, T y) { return x + y; }); break;
+      case LazyOp::Sub: kernel(a, b, out, n, [](T x, T y) { return x - y; }); break;
+      case LazyOp::Mul: kernel(a, b, out, n, [](T x, T y) { return x * y; }); break;
+      case LazyOp::Div: kernel(a, b, out, n, [](T x, T y) { return x / y; }); break;
+      case LazyOp::Min: kernel(a, b, out, n, [](T x, T y) { return y < x ? y : x; }); break;
+      case LazyOp::Max: kernel(a, b, out, n, [](T x, T y) { return x < y ? y : x; }); break;
+      default:
+        for (std::size_t i = 0; i < n; ++i) {
+          out[i] = apply(p_Op, a[i], T{});
+        }
+    }
+  }
+
+  void execute(std::size_t p_First, std::size_t p_Last) const
+  {
+    std::vector<T> _scratch(m_SlotCount * m_Tile);
+    for (const auto& [_slot, _value] : m_ConstantSlots) {
+      std::fill_n(_scratch.data() + _slot * m_Tile, m_Tile, _value);
+    }
+    for (std::size_t t = p_First; t < p_Last; ++t) {
+      const std::size_t _offset = t * m_Tile;
+      const std::size_t _n = std::min(m_Tile, m_Size - _offset);
+      auto _resolve = [&](const Operand& p_Operand) -> const T* {
+        if (p_Operand.m_IsInput) {
+          return m_Inputs[p_Operand.m_Index] + _offset;
+        }
+        return _scratch.data() + p_Operand.m_Index * m_Tile;
+      };
+      for (const Step& _step : m_Steps) {
+        const T* _lhs = _resolve(_step.m_Lhs);
+        const T* _rhs = _resolve(_step.m_Rhs);
+        run_step(_step.m_Op, _lhs, _rhs, _scratch.data() + _step.m_Out * m_Tile, _n);
+      }
+      for (const auto& [_node, _dst] : m_Outputs) {
+        const T* _src = _resolve(m_Operands[_node]);
+        if (_src != _dst + _offset) {
+          std::copy_n(_src, _n, _dst + _offset);
+        }
+      }
+    }
+  }
+
+  std::array<std::size_t, Rank> m_DimensionsData;
+  std::size_t m_Size;
+  std::size_t m_Tile;
+  std::vector<Node> m_Nodes;
+  std::map<std::tuple<LazyOp, std::size_t, std::size_t>, std::size_t> m_Memo;
+  std::map<std::pair<bool, T>, std::size_t> m_Constants;
+  std::vector<const T*> m_Inputs;
+  std::vector<std::size_t> m_InputNodes;
+  std::vector<std::pair<std::size_t, T*>> m_Outputs;
+
+  bool m_Compiled = false;
+  std::vector<Step> m_Steps;
+  std::vector<Operand> m_Operands;
+  std::vector<std::pair<std::size_t, T>> m_ConstantSlots;
+  std::size_t m_SlotCount = 0;
+  std::size_t m_LiveCount = 0;
+};
+
+}
@@ -0,0 +1,787 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Layout.hpp"
+#include "Tensor.hpp"
+#include "TensorView.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace TenSore {
+
+/**
+ * @class Mask
+ * @brief Bit-packed boolean tensor
+ *
+ * @tparam Rank Dimensions of a mask (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * Bit i of word i / 64 is the element at linear index i, in Tensor's
+ * first-dimension-fastest order, so a mask takes an eighth of a
+ * Tensor<bool>. Bits past size() are kept zero, which count(), the
+ * bitwise operators and comparisons rely on.
+ */
+template<std::size_t Rank>
+class Mask
+{
+public:
+  Mask() = delete;
+
+  /**
+   * @brief A template constructor for initializer list
+   *
+   * @tparam p_Dimensions Dimensions of a mask,
+   * amount of dimesnions provided must be equal to Rank
+   */
+  template<std::size_t... p_Dimensions>
+  Mask()
+    : Mask(std::array<std::size_t, Rank>{ { p_Dimensions... } })
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Misaligned dimensions of mask in a constructor");
+  }
+
+  /**
+   * @brief A constructor with an rvalue array
+   *
+   * @param p_Dimensions Array of dimensions
+   * @param p_Value Value of every element
+   */
+  Mask(std::array<std::size_t, Rank>&& p_Dimensions, bool p_Value = false)
+    : m_DimensionsData(std::move(p_Dimensions))
+  {
+    m_Size = 1;
+    for (const auto& it : m_DimensionsData) {
+      m_Size *= it;
+    }
+    m_Words.assign((m_Size + 63) / 64, p_Value ? ~std::uint64_t{ 0 } : 0);
+    clear_tail();
+  }
+
+  std::size_t size() const noexcept { return m_Size; }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_DimensionsData;
+  }
+
+  /**
+   * @brief Packed bits, 64 elements per word
+   *
+   * @details
+   * Writers must keep the bits past size() zero.
+   */
+  std::span<std::uint64_t> words() noexcept { return m_Words; }
+
+  std::span<const std::uint64_t> words() const noexcept { return m_Words; }
+
+  /**
+   * @brief Element access operator with linear index
+   *
+   * @param N Index of element
+   */
+  bool operator[](std::size_t N) const
+  {
+    if (N >= m_Size) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+    return (m_Words[N / 64] >> (N % 64)) & 1;
+  }
+
+  /**
+   * @brief Element access with calculated index
+   *
+   * @param p_Dims Dimension coordinates to access.
+   */
+  bool at(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return (*this)[calculateIndex(p_Dims)];
+  }
+
+  bool operator()(const std::array<std::size_t, Rank>& p_Dims) const { return at(p_Dims); }
+
+  /**
+   * @brief Sets an element with linear index
+   *
+   * @param N Index of element
+   * @param p_Value New value
+   */
+  void set(std::size_t N, bool p_Value = true)
+  {
+    if (N >= m_Size) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+    const std::uint64_t _bit = std::uint64_t{ 1 } << (N % 64);
+    m_Words[N / 64] = p_Value ? m_Words[N / 64] | _bit : m_Words[N / 64] & ~_bit;
+  }
+
+  void set(const std::array<std::size_t, Rank>& p_Dims, bool p_Value = true)
+  {
+    set(calculateIndex(p_Dims), p_Value);
+  }
+
+  /**
+   * @brief Amount of set elements
+   */
+  std::size_t count() const noexcept
+  {
+    std::size_t _retval = 0;
+    for (const auto it : m_Words) {
+      _retval += static_cast<std::size_t>(std::popcount(it));
+    }
+    return _retval;
+  }
+
+  bool any() const noexcept
+  {
+    return std::any_of(m_Words.begin(), m_Words.end(), [](std::uint64_t w) { return w != 0; });
+  }
+
+  bool all() const noexcept { return count() == m_Size; }
+
+  bool none() const noexcept { return !any(); }
+
+  Mask& operator&=(const Mask& p_Other)
+  {
+    return combine(p_Other, [](std::uint64_t a, std::uint64_t b) { return a & b; });
+  }
+
+  Mask& operator|=(const Mask& p_Other)
+  {
+    return combine(p_Other, [](std::uint64_t a, std::uint64_t b) { return a | b; });
+  }
+
+  Mask& operator^=(const Mask& p_Other)
+  {
+    return combine(p_Other, [](std::uint64_t a, std::uint64_t b) { return a ^ b; });
+  }
+
+  Mask operator~() const
+  {
+    Mask _retval(*this);
+    for (auto& it : _retval.m_Words) {
+      it = ~it;
+    }
+    _retval.clear_tail();
+    return _retval;
+  }
+
+  friend Mask operator&(Mask a, const Mask& b) { return a &= b; }
+
+  friend Mask operator|(Mask a, const Mask& b) { return a |= b; }
+
+  friend Mask operator^(Mask a, const Mask& b) { return a ^= b; }
+
+  friend bool operator==(const Mask& a, const Mask& b) noexcept
+  {
+    return a.m_DimensionsData == b.m_DimensionsData && a.m_Words == b.m_Words;
+  }
+
+private:
+  std::size_t calculateIndex(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return detail::checked_index(p_Dims, m_DimensionsData);
+  }
+
+  template<typename F>
+  Mask& combine(const Mask& p_Other, F p_Fn)
+  {
+    if (m_DimensionsData != p_Other.m_DimensionsData) {
+      throw std::invalid_argument("Mismatched dimensions of masks");
+    }
+    for (std::size_t i = 0; i < m_Words.size(); ++i) {
+      m_Words[i] = p_Fn(m_Words[i], p_Other.m_Words[i]);
+    }
+    return *this;
+  }
+
+  void clear_tail() noexcept
+  {
+    if (m_Size % 64) {
+      m_Words.back() &= (std::uint64_t{ 1 } << (m_Size % 64)) - 1;
+    }
+  }
+
+  std::array<std::size_t, Rank> m_DimensionsData;
+  std::size_t m_Size;
+  std::vector<std::uint64_t> m_Words;
+};
+
+namespace detail {
+
+/**
+ * @brief Elements below which a mask kernel is not worth splitting
+ */
+inline constexpr std::size_t k_MinMaskTask = std::size_t{ 1 } << 16;
+
+template<typename V>
+inline constexpr std::size_t view_rank =
+  std::tuple_size_v<std::remove_cvref_t<decltype(std::declval<view_t<V>>().dimensions())>>;
+
+/**
+ * @brief Runs `p_Fn(first, last)` over ranges of words in parallel
+ */
+template<typename F>
+void
+for_each_words(ThreadPool& p_Pool, std::size_t p_Words, F&& p_Fn)
+{
+  const std::size_t _tasks =
+    std::max<std::size_t>(1, std::min(p_Pool.size(), p_Words * 64 / k_MinMaskTask));
+  if (_tasks == 1) {
+    p_Fn(std::size_t{ 0 }, p_Words);
+    return;
+  }
+  p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+    p_Fn(p_Words * t / _tasks, p_Words * (t + 1) / _tasks);
+  });
+}
+
+/**
+ * @brief Elements of a view in linear order: the view's own storage when
+ * contiguous, a packed copy otherwise
+ */
+template<typename T, std::size_t Rank>
+class Packed
+{
+public:
+  explicit Packed(const TensorView<T, Rank>& p_View)
+  {
+    if (p_View.contiguous()) {
+      m_Data = p_View.storage();
+      return;
+    }
+    std::array<std::size_t, Rank> _dims = p_View.dimensions();
+    m_Copy.emplace(std::move(_dims));
+    copy_view(p_View, TensorView<std::remove_const_t<T>, Rank>(*m_Copy));
+    m_Data = m_Copy->storage();
+  }
+
+  const std::remove_const_t<T>* data() const noexcept { return m_Data; }
+
+private:
+  std::optional<Tensor<std::remove_const_t<T>, Rank>> m_Copy;
+  const std::remove_const_t<T>* m_Data;
+};
+
+/**
+ * @brief Operand of a mask kernel: packed elements or a broadcast scalar
+ */
+template<typename V, std::size_t Rank>
+auto
+operand(const V& p_Value, const std::array<std::size_t, Rank>& p_Dimensions)
+{
+  if constexpr (ViewLike<const V>) {
+    const auto _view = as_view(p_Value);
+    if (_view.dimensions() != p_Dimensions) {
+      throw std::invalid_argument("Mismatched dimensions of views");
+    }
+    return Packed(_view);
+  } else {
+    return p_Value;
+  }
+}
+
+/**
+ * @brief Element type of where(): that of the first tensor operand, or
+ * the common type of two scalars
+ */
+template<typename A, typename B>
+auto
+where_type() noexcept
+{
+  if constexpr (ViewLike<const A>) {
+    return std::type_identity<std::ranges::range_value_t<view_t<const A>>>{};
+  } else if constexpr (ViewLike<const B>) {
+    return std::type_identity<std::ranges::range_value_t<view_t<const B>>>{};
+  } else {
+    return std::type_identity<std::common_type_t<A, B>>{};
+  }
+}
+
+template<typename O>
+decltype(auto)
+element(const O& p_Operand, std::size_t p_Index) noexcept
+{
+  if constexpr (requires { p_Operand.data(); }) {
+    return p_Operand.data()[p_Index];
+  } else {
+    return p_Operand;
+  }
+}
+
+/**
+ * @brief AVX comparison predicate of a transparent comparator, -1 if none
+ */
+template<typename P>
+inline constexpr int avx_compare = -1;
+
+#if defined(__AVX2__)
+template<>
+inline constexpr int avx_compare<std::less<>> = _CMP_LT_OQ;
+template<>
+inline constexpr int avx_compare<std::less_equal<>> = _CMP_LE_OQ;
+template<>
+inline constexpr int avx_compare<std::greater<>> = _CMP_GT_OQ;
+template<>
+inline constexpr int avx_compare<std::greater_equal<>> = _CMP_GE_OQ;
+template<>
+inline constexpr int avx_compare<std::equal_to<>> = _CMP_EQ_OQ;
+template<>
+inline constexpr int avx_compare<std::not_equal_to<>> = _CMP_NEQ_UQ;
+
+/**
+ * @brief Whether an operand compares the same in T as in the scalar loop
+ *
+ * @details
+ * True for elements of T, and for scalars whose conversion to T keeps
+ * their value; a double 0.1 against float elements is compared in double
+ * by the loop, so it must not be rounded into a broadcast float.
+ */
+template<typename T, typename O>
+bool
+exact_operand(const O& p_Operand) noexcept
+{
+  if constexpr (requires { p_Operand.data(); }) {
+    return true;
+  } else if constexpr (std::is_same_v<std::common_type_t<T, O>, T>) {
+    return true;
+  } else {
+    return p_Operand >= std::numeric_limits<T>::lowest() &&
+           p_Operand <= std::numeric_limits<T>::max() &&
+           static_cast<O>(static_cast<T>(p_Operand)) == p_Operand;
+  }
+}
+
+/**
+ * @brief Compares 64 floating-point elements with AVX, returning their bits
+ */
+template<int Cmp, typename T, typename L, typename R>
+std::uint64_t
+compare_word(const L& p_Lhs, const R& p_Rhs, std::size_t p_First) noexcept
+{
+  std::uint64_t _bits = 0;
+  constexpr std::size_t k_Lanes = 32 / sizeof(T);
+  for (std::size_t j = 0; j < 64; j += k_Lanes) {
+    auto _load = [&](const auto& p_Operand) {
+      if constexpr (std::is_same_v<T, float>) {
+        if constexpr (requires { p_Operand.data(); }) {
+          return _mm256_loadu_ps(p_Operand.data() + p_First + j);
+        } else {
+          return _mm256_set1_ps(static_cast<float>(p_Operand));
+        }
+      } else {
+        if constexpr (requires { p_Operand.data(); }) {
+          return _mm256_loadu_pd(p_Operand.data() + p_First + j);
+        } else {
+          return _mm256_set1_pd(static_cast<double>(p_Operand));
+        }
+      }
+    };
+    int _lanes;
+    if constexpr (std::is_same_v<T, float>) {
+      _lanes = _mm256_movemask_ps(_mm256_cmp_ps(_load(p_Lhs), _load(p_Rhs), Cmp));
+    } else {
+      _lanes = _mm256_movemask_pd(_mm256_cmp_pd(_load(p_Lhs), _load(p_Rhs), Cmp));
+    }
+    _bits |= static_cast<std::uint64_t>(static_cast<unsigned>(_lanes)) << j;
+  }
+  return _bits;
+}
+#endif
+
+/**
+ * @brief Fills the words of a mask from a predicate of element pairs
+ */
+template<typename T, typename L, typename R, typename P, std::size_t Rank>
+void
+compare_into(const L& p_Lhs, const R& p_Rhs, P& p_Pred, Mask<Rank>& p_Mask, ThreadPool& p_Pool)
+{
+  const std::size_t _size = p_Mask.size();
+  const auto _words = p_Mask.words();
+#if defined(__AVX2__)
+  // The vector path takes elements of T only, and scalars that T holds
+  // exactly, so bits never depend on the build flags or the position.
+  constexpr bool k_Vector = [] {
+    if constexpr (!std::is_same_v<T, float> && !std::is_same_v<T, double>) {
+      return false;
+    } else if constexpr (requires(const R& r) { r.data(); }) {
+      return std::is_same_v<std::remove_cvref_t<decltype(*std::declval<const R&>().data())>,
+                            T>;
+    } else {
+      return std::is_arithmetic_v<R>;
+    }
+  }();
+  bool _vector = false;
+  if constexpr (k_Vector) {
+    _vector = exact_operand<T>(p_Rhs);
+  }
+#endif
+  for_each_words(p_Pool, _words.size(), [&](std::size_t p_First, std::size_t p_Last) {
+    for (std::size_t w = p_First; w < p_Last; ++w) {
+      const std::size_t _base = w * 64;
+      const std::size_t _count = std::min<std::size_t>(64, _size - _base);
+#if defined(__AVX2__)
+      if constexpr (avx_compare<P> >= 0 && k_Vector) {
+        if (_count == 64 && _vector) {
+          _words[w] = compare_word<avx_compare<P>, T>(p_Lhs, p_Rhs, _base);
+          continue;
+        }
+      }
+#endif
+      std::uint64_t _bits = 0;
+      for (std::size_t j = 0; j < _count; ++j) {
+        _bits |= static_cast<std::uint64_t>(
+                   static_cast<bool>(p_Pred(element(p_Lhs, _base + j), element(p_Rhs, _base + j))))
+                 << j;
+      }
+      _words[w] = _bits;
+    }
+  });
+}
+
+/**
+ * @brief Positions of the set bits of every byte, as 4-bit fields
+ */
+inline constexpr std::array<std::uint32_t, 256> k_LeftPack = [] {
+  std::array<std::uint32_t, 256> _retval{};
+  for (std::uint32_t m = 0; m < 256; ++m) {
+    for (std::uint32_t j = 0, k = 0; j < 8; ++j) {
+      if ((m >> j) & 1) {
+        _retval[m] |= j << (4 * k++);
+      }
+    }
+  }
+  return _retval;
+}();
+
+/**
+ * @brief Copies the elements selected by a range of words to an output
+ *
+ * @param p_Capacity Elements the output may take, never exceeded
+ *
+ * @return Amount of elements copied
+ *
+ * @details
+ * Full words are block copies. With AVX2, 32-bit elements are left-packed
+ * eight at a time by a permutation looked up from each mask byte, which
+ * costs the same whatever the density; otherwise set bits are visited
+ * one by one, in time proportional to their amount.
+ */
+template<typename T>
+std::size_t
+compress_words(const T* p_Source,
+               std::size_t p_Size,
+               const std::uint64_t* p_Words,
+               std::size_t p_First,
+               std::size_t p_Last,
+               T* p_Out,
+               std::size_t p_Capacity) noexcept
+{
+  std::size_t _count = 0;
+  for (std::size_t w = p_First; w < p_Last; ++w) {
+    std::uint64_t _bits = p_Words[w];
+    const T* const _src = p_Source + w * 64;
+    if (_bits == ~std::uint64_t{ 0 }) {
+      std::copy_n(_src, 64, p_Out + _count);
+      _count += 64;
+      continue;
+    }
+    std::size_t _offset = 0;
+#if defined(__AVX2__)
+    if constexpr (sizeof(T) == 4 && std::is_trivially_copyable_v<T>) {
+      const __m256i _shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+      for (; _bits && _count + 8 <= p_Capacity && w * 64 + _offset + 8 <= p_Size;
+           _offset += 8, _bits >>= 8) {
+        const auto _byte = static_cast<std::uint32_t>(_bits & 0xff);
+        if (!_byte) {
+          continue;
+        }
+        const __m256i _order = _mm256_and_si256(
+          _mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(k_LeftPack[_byte])), _shifts),
+          _mm256_set1_epi32(0xf));
+        const __m256i _values =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_src + _offset));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p_Out + _count),
+                            _mm256_permutevar8x32_epi32(_values, _order));
+        _count += static_cast<std::size_t>(std::popcount(_byte));
+      }
+    }
+#endif
+    (void)p_Size;
+    (void)p_Capacity;
+    while (_bits) {
+      p_Out[_count++] = _src[_offset + static_cast<std::size_t>(std::countr_zero(_bits))];
+      _bits &= _bits - 1;
+    }
+  }
+  return _count;
+}
+
+}
+
+/**
+ * @brief Mask of a predicate of element pairs
+ *
+ * @param p_Lhs Tensor or view
+ * @param p_Rhs Tensor or view of the same dimensions, or a scalar
+ * compared with every element
+ * @param p_Pred Binary predicate, called concurrently
+ * @param p_Pool Pool comparing in parallel for large tensors
+ *
+ * @details
+ * Each task fills whole words, 64 comparisons per store. With AVX2,
+ * float and double compared by the transparent std::less<> and its
+ * siblings run eight or four lanes per instruction; other predicates and
+ * types compile to a branchless loop. Non-contiguous views are packed
+ * first.
+ */
+template<typename S, typename V, typename P>
+  requires ViewLike<const S>
+auto
+compare(const S& p_Lhs, const V& p_Rhs, P p_Pred, ThreadPool& p_Pool = ThreadPool::global())
+{
+  const auto _view = as_view(p_Lhs);
+  using T = std::ranges::range_value_t<decltype(_view)>;
+  constexpr std::size_t Rank = detail::view_rank<const S>;
+  std::array<std::size_t, Rank> _dims = _view.dimensions();
+  Mask<Rank> _retval(std::move(_dims));
+  const detail::Packed _lhs(_view);
+  const auto _rhs = detail::operand(p_Rhs, _view.dimensions());
+  detail::compare_into<T>(_lhs, _rhs, p_Pred, _retval, p_Pool);
+  return _retval;
+}
+
+/**
+ * @brief Mask of a unary predicate
+ */
+template<typename S, typename P>
+  requires ViewLike<const S>
+auto
+mask_if(const S& p_Source, P p_Pred, ThreadPool& p_Pool = ThreadPool::global())
+{
+  using T = std::ranges::range_value_t<view_t<const S>>;
+  return compare(
+    p_Source, T{}, [&p_Pred](const T& x, const T&) { return p_Pred(x); }, p_Pool);
+}
+
+template<typename S, typename V>
+  requires ViewLike<const S>
+auto
+lt(const S& p_Lhs, const V& p_Rhs, ThreadPool& p_Pool = ThreadPool::global())
+{
+  return compare(p_Lhs, p_Rhs, std::less<>{}, p_Pool);
+}
+
+template<typename S, typename V>
+  requires ViewLike<const S>
+auto
+le(const S& p_Lhs, const V& p_Rhs, ThreadPool& p_Pool = ThreadPool::global())
+{
+  return compare(p_Lhs, p_Rhs, std::less_equal<>{}, p_Pool);
+}
+
+template<typename S, typename V>
+  requires ViewLike<const S>
+auto
+gt(const S& p_Lhs, const V& p_Rhs, ThreadPool& p_Pool = ThreadPool::global())
+{
+  return compare(p_Lhs, p_Rhs, std::greater<>{}, p_Pool);
+}
+
+template<typename S, typename V>
+  requires ViewLike<const S>
+auto
+ge(const S& p_Lhs, const V& p_Rhs, ThreadPool& p_Pool = ThreadPool::global())
+{
+  return compare(p_Lhs, p_Rhs, std::greater_equal<>{}, p_Pool);
+}
+
+template<typename S, typename V>
+  requires ViewLike<const S>
+auto
+eq(const S& p_Lhs, const V& p_Rhs, ThreadPool& p_Pool = ThreadPool::global())
+{
+  return compare(p_Lhs, p_Rhs, std::equal_to<>{}, p_Pool);
+}
+
+template<typename S, typename V>
+  requires ViewLike<const S>
+auto
+ne(const S& p_Lhs, const V& p_Rhs, ThreadPool& p_Pool = ThreadPool::global())
+{
+  return compare(p_Lhs, p_Rhs, std::not_equal_to<>{}, p_Pool);
+}
+
+/**
+ * @brief Elementwise choice between two operands
+ *
+ * @param p_Mask Mask choosing `p_True` where set
+ * @param p_True Tensor or view of the mask's dimensions, or a scalar
+ * @param p_False Tensor or view of the mask's dimensions, or a scalar
+ * @param p_Pool Pool selecting in parallel for large masks
+ *
+ * @return Tensor with `p_True` where the mask is set and `p_False`
+ * elsewhere
+ *
+ * @details
+ * The element type is that of the first tensor operand, or the common
+ * type of two scalars. The selection is branchless, so it vectorizes
+ * into blends whatever the mask's pattern.
+ */
+template<std::size_t Rank, typename A, typename B>
+auto
+where(const Mask<Rank>& p_Mask,
+      const A& p_True,
+      const B& p_False,
+      ThreadPool& p_Pool = ThreadPool::global())
+{
+  using T = typename decltype(detail::where_type<A, B>())::type;
+  const auto _true = detail::operand(p_True, p_Mask.dimensions());
+  const auto _false = detail::operand(p_False, p_Mask.dimensions());
+  std::array<std::size_t, Rank> _dims = p_Mask.dimensions();
+  Tensor<T, Rank> _retval(std::move(_dims));
+  T* const _out = _retval.storage();
+  const auto _words = p_Mask.words();
+  const std::size_t _size = p_Mask.size();
+  detail::for_each_words(p_Pool, _words.size(), [&](std::size_t p_First, std::size_t p_Last) {
+    for (std::size_t w = p_First; w < p_Last; ++w) {
+      const std::uint64_t _bits = _words[w];
+      const std::size_t _base = w * 64;
+      const std::size_t _count = std::min<std::size_t>(64, _size - _base);
+      for (std::size_t j = 0; j < _count; ++j) {
+        const T _a = static_cast<T>(detail::element(_true, _base + j));
+        const T _b = static_cast<T>(detail::element(_false, _base + j));
+        _out[_base + j] = (_bits >> j) & 1 ? _a : _b;
+      }
+    }
+  });
+  return _retval;
+}
+
+/**
+ * @brief Copies the elements selected by a mask to a contiguous output
+ *
+ * @param p_Source Tensor or view of the mask's dimensions
+ * @param p_Mask Mask selecting the elements
+ * @param p_Out Output, at least `p_Mask.count()` elements long
+ * @param p_Pool Pool compressing in parallel for large masks
+ *
+ * @return Amount of elements written
+ *
+ * @details
+ * Elements keep their linear order. Tasks first count the set bits of
+ * their ranges of words in parallel; an exclusive prefix sum of the
+ * counts gives each task the offset of its output, so the tasks then
+ * compress independently, each into its own part of the output.
+ */
+template<typename S, typename T, std::size_t Rank>
+  requires ViewLike<const S>
+std::size_t
+compress(const S& p_Source,
+         const Mask<Rank>& p_Mask,
+         std::span<T> p_Out,
+         ThreadPool& p_Pool = ThreadPool::global())
+{
+  const auto _view = as_view(p_Source);
+  if (_view.dimensions() != p_Mask.dimensions()) {
+    throw std::invalid_argument("Mismatched dimensions of views");
+  }
+  const detail::Packed _source(_view);
+  const auto _words = p_Mask.words();
+  const std::size_t _tasks = std::max<std::size_t>(
+    1, std::min(p_Pool.size(), _words.size() * 64 / detail::k_MinMaskTask));
+  std::vector<std::size_t> _offsets(_tasks + 1, 0);
+  auto _range = [&](std::size_t t) {
+    return std::pair(_words.size() * t / _tasks, _words.size() * (t + 1) / _tasks);
+  };
+  auto _count = [&](std::size_t t) {
+    const auto [_first, _last] = _range(t);
+    std::size_t _retval = 0;
+    for (std::size_t w = _first; w < _last; ++w) {
+      _retval += static_cast<std::size_t>(std::popcount(_words[w]));
+    }
+    _offsets[t + 1] = _retval;
+  };
+  if (_tasks == 1) {
+    _count(0);
+  } else {
+    p_Pool.parallel_for(_tasks, _count);
+  }
+  for (std::size_t t = 0; t < _tasks; ++t) {
+    _offsets[t + 1] += _offsets[t];
+  }
+  if (_offsets[_tasks] > p_Out.size()) {
+    throw std::invalid_argument("Output is too small for the selected elements");
+  }
+  auto _compress = [&](std::size_t t) {
+    const auto [_first, _last] = _range(t);
+    detail::compress_words(_source.data(),
+                           p_Mask.size(),
+                           _words.data(),
+                           _first,
+                           _last,
+                           p_Out.data() + _offsets[t],
+                           _offsets[t + 1] - _offsets[t]);
+  };
+  if (_tasks == 1) {
+    _compress(0);
+  } else {
+    p_Pool.parallel_for(_tasks, _compress);
+  }
+  return _offsets[_tasks];
+}
+
+/**
+ * @brief Elements selected by a mask, in linear order
+ *
+ * @return Vector of `p_Mask.count()` elements
+ *
+ * @see compress
+ */
+template<typename S, std::size_t Rank>
+  requires ViewLike<const S>
+auto
+masked_select(const S& p_Source,
+              const Mask<Rank>& p_Mask,
+              ThreadPool& p_Pool = ThreadPool::global())
+{
+  using T = std::ranges::range_value_t<view_t<const S>>;
+  Tensor<T, 1> _retval({ p_Mask.count() });
+  compress(p_Source, p_Mask, std::span<T>(_retval.storage(), _retval.size()), p_Pool);
+  return _retval;
+}
+
+}
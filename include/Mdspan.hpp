@@ -0,0 +1,105 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "TensorView.hpp"
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+namespace TenSore {
+
+/**
+ * @brief Zero-copy mdspan of a caller-chosen type over a view
+ *
+ * @tparam M mdspan type to build, e.g. `std::mdspan<T, E, L>`,
+ * `Kokkos::mdspan<T, E, L>` or any type with the same nested types and
+ * a `(data_handle_type, const mapping_type&)` constructor
+ *
+ * @param p_View View to wrap
+ *
+ * @return mdspan sharing the view's elements
+ *
+ * @details
+ * Coordinates keep their order: `to_mdspan<M>(v)[i, j]` is `v.at({ i, j })`.
+ * Layouts whose mapping is constructible from extents and strides, such
+ * as layout_stride, take the view's strides as they are. Any other
+ * layout is built from the extents alone and must yield the view's
+ * strides, so a Tensor, which stores the first dimension fastest, fits
+ * layout_left. Throws std::invalid_argument when the extents do not fit
+ * the static extents of M, when a stride is negative or when the layout
+ * of M does not match the view.
+ */
+template<typename M, typename T, std::size_t Rank>
+M
+to_mdspan(TensorView<T, Rank> p_View)
+{
+  using extents_type = typename M::extents_type;
+  using mapping_type = typename M::mapping_type;
+  using index_type = typename extents_type::index_type;
+  static_assert(extents_type::rank() == Rank, "Rank of the mdspan type does not match");
+  static_assert(std::convertible_to<T*, typename M::data_handle_type>,
+                "Elements of the view are not accessible through the mdspan type");
+
+  std::array<index_type, Rank> _extents;
+  std::array<index_type, Rank> _strides;
+  for (std::size_t i = 0; i < Rank; ++i) {
+    const std::size_t _static = extents_type::static_extent(i);
+    if (_static != std::dynamic_extent && _static != p_View.dimensions()[i]) {
+      throw std::invalid_argument("Mismatched dimensions of views");
+    }
+    if (p_View.strides()[i] < 0) {
+      throw std::invalid_argument("mdspan layouts require non-negative strides");
+    }
+    _extents[i] = static_cast<index_type>(p_View.dimensions()[i]);
+    _strides[i] = static_cast<index_type>(p_View.strides()[i]);
+  }
+  const extents_type _exts(_extents);
+
+  if constexpr (std::constructible_from<mapping_type,
+                                        const extents_type&,
+                                        const std::array<index_type, Rank>&>) {
+    return M(p_View.storage(), mapping_type(_exts, _strides));
+  } else {
+    const mapping_type _mapping(_exts);
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (p_View.dimensions()[i] > 1 &&
+          static_cast<index_type>(_mapping.stride(i)) != _strides[i]) {
+        throw std::invalid_argument("Layout of the mdspan type does not match the view");
+      }
+    }
+    return M(p_View.storage(), _mapping);
+  }
+}
+
+/**
+ * @brief Zero-copy mdspan over a tensor or anything else accepted by
+ * as_view()
+ */
+template<typename M, typename V>
+  requires ViewLike<V>
+M
+to_mdspan(V& p_Source)
+{
+  return to_mdspan<M>(as_view(p_Source));
+}
+
+}
@@ -0,0 +1,322 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Hash.hpp"
+#include "Tensor.hpp"
+#include "TensorView.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @class MemoKey
+ * @brief Identity of an operation's result: its name, inputs and parameters
+ *
+ * @details
+ * Inputs enter the key by content hash, so two keys compare equal when
+ * the operation ran on tensors with equal contents, whatever their
+ * addresses. A collision of 64-bit content hashes would return a wrong
+ * cached result; it is as unlikely as for any 64-bit hash.
+ */
+class MemoKey
+{
+public:
+  MemoKey() = delete;
+
+  /**
+   * @brief Constructor of a key
+   *
+   * @param p_Operation Name of the operation
+   */
+  explicit MemoKey(std::string_view p_Operation)
+    : m_Operation(p_Operation)
+    , m_Hash(hash_bytes(std::as_bytes(std::span(p_Operation))))
+  {
+  }
+
+  /**
+   * @brief Adds a precomputed hash, e.g. an IncrementalHash::value()
+   */
+  MemoKey& add_hash(std::uint64_t p_Hash)
+  {
+    m_Parts.push_back(p_Hash);
+    m_Hash = hash_value(p_Hash, m_Hash);
+    return *this;
+  }
+
+  /**
+   * @brief Adds a tensor input by content hash
+   */
+  template<typename T, std::size_t Rank, Allocator A>
+  MemoKey& add(const Tensor<T, Rank, A>& p_Tensor)
+  {
+    return add_hash(content_hash(p_Tensor));
+  }
+
+  template<typename T, std::size_t Rank>
+  MemoKey& add(const TensorView<T, Rank>& p_View)
+  {
+    return add_hash(content_hash(p_View));
+  }
+
+  /**
+   * @brief Adds a contiguous range, e.g. a std::span, by its contents
+   */
+  template<std::ranges::contiguous_range R>
+    requires std::is_trivially_copyable_v<std::ranges::range_value_t<R>> &&
+             (!ViewLike<const R>)
+  MemoKey& add(const R& p_Range)
+  {
+    return add_hash(hash_bytes(std::as_bytes(
+      std::span(std::ranges::data(p_Range), std::ranges::size(p_Range)))));
+  }
+
+  /**
+   * @brief Adds a parameter by its bit pattern
+   *
+   * @details
+   * Pointers are rejected: their bit pattern is an address, and a key
+   * built from it would outlive changes to the data it points to. Pass a
+   * span or a view instead.
+   */
+  template<typename U>
+    requires std::is_trivially_copyable_v<U> && (!std::is_pointer_v<U>) &&
+             (!std::is_member_pointer_v<U>) && (!std::ranges::range<U>)
+  MemoKey& add(const U& p_Value)
+  {
+    return add_hash(hash_value(p_Value));
+  }
+
+  std::uint64_t hash() const noexcept { return m_Hash; }
+
+  friend bool operator==(const MemoKey& a, const MemoKey& b) noexcept
+  {
+    return a.m_Hash == b.m_Hash && a.m_Parts == b.m_Parts &&
+           a.m_Operation == b.m_Operation;
+  }
+
+private:
+  std::string m_Operation;
+  std::vector<std::uint64_t> m_Parts;
+  std::uint64_t m_Hash;
+};
+
+namespace detail {
+
+struct MemoKeyHash
+{
+  std::size_t operator()(const MemoKey& p_Key) const noexcept
+  {
+    return static_cast<std::size_t>(p_Key.hash());
+  }
+};
+
+/**
+ * @brief Memory held by a cached result
+ */
+template<typename R>
+std::size_t
+footprint(const R& p_Value) noexcept
+{
+  if constexpr (requires { p_Value.size(); p_Value.storage(); }) {
+    return sizeof(R) +
+           p_Value.size() * sizeof(std::remove_cvref_t<decltype(*p_Value.storage())>);
+  } else {
+    return sizeof(R);
+  }
+}
+
+}
+
+/**
+ * @class MemoCache
+ * @brief Memory-bounded LRU cache of operation results
+ *
+ * @details
+ * Results are shared immutably, so a cached tensor is never copied on a
+ * hit and stays alive for its holders after eviction. The footprint of a
+ * result is its `size() * sizeof(element)` for tensor-like types and its
+ * sizeof otherwise. Thread-safe; computations run outside the lock, so
+ * concurrent misses on one key may compute it more than once.
+ */
+class MemoCache
+{
+public:
+  struct Stats
+  {
+    std::size_t m_Hits = 0;
+    std::size_t m_Misses = 0;
+    std::size_t m_Evictions = 0;
+    std::size_t m_Entries = 0;
+    std::size_t m_Bytes = 0;
+  };
+
+  /**
+   * @brief Constructor of a cache
+   *
+   * @param p_BudgetBytes Memory the cached results may take
+   */
+  explicit MemoCache(std::size_t p_BudgetBytes = std::size_t{ 256 } << 20)
+    : m_Budget(p_BudgetBytes)
+  {
+  }
+
+  MemoCache(const MemoCache&) = delete;
+  MemoCache& operator=(const MemoCache&) = delete;
+
+  /**
+   * @brief Cached result of a key, computed and inserted on a miss
+   *
+   * @param p_Key Key of the result
+   * @param p_Fn Callable without arguments computing the result
+   *
+   * @return Shared result; results larger than the budget are returned
+   * without being cached
+   */
+  template<typename F>
+  std::shared_ptr<const std::invoke_result_t<F>> get_or_compute(const MemoKey& p_Key,
+                                                                 F&& p_Fn)
+  {
+    using R = std::invoke_result_t<F>;
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      const auto _found = m_Index.find(p_Key);
+      if (_found != m_Index.end() && _found->second->m_Type == typeid(R)) {
+        m_Entries.splice(m_Entries.begin(), m_Entries, _found->second);
+        ++m_Stats.m_Hits;
+        return std::static_pointer_cast<const R>(_found->second->m_Value);
+      }
+      ++m_Stats.m_Misses;
+    }
+    auto _value = std::make_shared<const R>(std::forward<F>(p_Fn)());
+    insert(p_Key, _value, typeid(R), detail::footprint(*_value));
+    return _value;
+  }
+
+  Stats stats() const
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+  }
+
+  std::size_t budget() const noexcept { return m_Budget; }
+
+  void clear()
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Index.clear();
+    m_Entries.clear();
+    m_Stats.m_Entries = 0;
+    m_Stats.m_Bytes = 0;
+  }
+
+  /**
+   * @brief Process-wide cache
+   */
+  static MemoCache& global()
+  {
+    static MemoCache _cache;
+    return _cache;
+  }
+
+private:
+  struct Entry
+  {
+    MemoKey m_Key;
+    std::shared_ptr<const void> m_Value;
+    std::type_index m_Type;
+    std::size_t m_Bytes;
+  };
+
+  void insert(const MemoKey& p_Key,
+              std::shared_ptr<const void> p_Value,
+              std::type_index p_Type,
+              std::size_t p_Bytes)
+  {
+    if (p_Bytes > m_Budget) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (const auto _found = m_Index.find(p_Key); _found != m_Index.end()) {
+      remove(_found->second);
+    }
+    while (m_Stats.m_Bytes + p_Bytes > m_Budget) {
+      remove(std::prev(m_Entries.end()));
+      ++m_Stats.m_Evictions;
+    }
+    m_Entries.push_front(Entry{ p_Key, std::move(p_Value), p_Type, p_Bytes });
+    m_Index.emplace(p_Key, m_Entries.begin());
+    ++m_Stats.m_Entries;
+    m_Stats.m_Bytes += p_Bytes;
+  }
+
+  void remove(std::list<Entry>::iterator p_Entry)
+  {
+    m_Stats.m_Bytes -= p_Entry->m_Bytes;
+    --m_Stats.m_Entries;
+    m_Index.erase(p_Entry->m_Key);
+    m_Entries.erase(p_Entry);
+  }
+
+  std::size_t m_Budget;
+  std::list<Entry> m_Entries;
+  std::unordered_map<MemoKey, std::list<Entry>::iterator, detail::MemoKeyHash> m_Index;
+  Stats m_Stats;
+  mutable std::mutex m_Mutex;
+};
+
+/**
+ * @brief Runs an operation through a cache
+ *
+ * @param p_Cache Cache to use
+ * @param p_Operation Name of the operation, distinguishing it from others
+ * @param p_Fn Callable invoked as `p_Fn(p_Args...)` on a miss
+ * @param p_Args Tensors, views, contiguous ranges and trivially copyable
+ * non-pointer parameters, all of which enter the key
+ *
+ * @return Shared result
+ *
+ * @details
+ * Hashing the inputs reads them once; this pays off for operations that
+ * do substantially more work than that, like GEMM or factorizations.
+ */
+template<typename F, typename... Args>
+auto
+memoize(MemoCache& p_Cache, std::string_view p_Operation, F&& p_Fn, const Args&... p_Args)
+{
+  MemoKey _key(p_Operation);
+  (_key.add(p_Args), ...);
+  return p_Cache.get_or_compute(_key, [&] { return std::invoke(p_Fn, p_Args...); });
+}
+
+}
@@ -0,0 +1,271 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "TensorView.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @class MemoryPlanner
+ * @brief Static placement of pipeline intermediates in a single slab
+ *
+ * @details
+ * A fixed sequence of operations is recorded once: every operation
+ * produces one intermediate buffer and consumes earlier ones. plan()
+ * derives the lifetime of each buffer (from its producer to its last
+ * consumer) and assigns offsets so that buffers with overlapping lifetimes
+ * never overlap in memory, using the greedy-by-size heuristic: buffers
+ * are placed largest first, each at the lowest aligned offset that does
+ * not collide with an already placed, simultaneously live buffer.
+ * allocate() then reserves the slab once, and view() hands out
+ * TensorView's into it, so steady-state execution does not allocate.
+ */
+class MemoryPlanner
+{
+public:
+  /**
+   * @brief Constructor of a planner
+   *
+   * @param p_Alignment Alignment of every buffer offset, in bytes
+   */
+  explicit MemoryPlanner(std::size_t p_Alignment = 64)
+    : m_Alignment(p_Alignment)
+  {
+    if (m_Alignment == 0 || (m_Alignment & (m_Alignment - 1)) != 0) {
+      throw std::invalid_argument("Alignment must be a power of two");
+    }
+  }
+
+  /**
+   * @brief Records an operation producing an intermediate buffer
+   *
+   * @param p_Bytes Size of the produced buffer
+   * @param p_Inputs Buffers consumed by the operation
+   *
+   * @return Identifier of the produced buffer
+   */
+  std::size_t record_bytes(std::size_t p_Bytes,
+                           std::initializer_list<std::size_t> p_Inputs = {})
+  {
+    const std::size_t _step = m_Buffers.size();
+    for (const auto& it : p_Inputs) {
+      if (it >= _step) {
+        throw std::out_of_range("Operation consumes an unrecorded buffer");
+      }
+      m_Buffers[it].m_Last = std::max(m_Buffers[it].m_Last, _step);
+    }
+    m_Buffers.push_back({ p_Bytes, _step, _step, 0 });
+    m_Planned = false;
+    return _step;
+  }
+
+  /**
+   * @brief Records an operation producing an intermediate tensor
+   *
+   * @tparam T The type of value of the produced tensor
+   *
+   * @param p_Dimensions Dimensions of the produced tensor
+   * @param p_Inputs Buffers consumed by the operation
+   *
+   * @return Identifier of the produced buffer
+   */
+  template<typename T, std::size_t Rank>
+  std::size_t record(const std::array<std::size_t, Rank>& p_Dimensions,
+                     std::initializer_list<std::size_t> p_Inputs = {})
+  {
+    std::size_t _size = 1;
+    for (const auto& it : p_Dimensions) {
+      _size *= it;
+    }
+    return record_bytes(_size * sizeof(T), p_Inputs);
+  }
+
+  /**
+   * @brief Keeps a buffer alive until the end of the pipeline
+   *
+   * @param p_Id Buffer that is a result of the pipeline
+   */
+  void keep(std::size_t p_Id)
+  {
+    m_Buffers.at(p_Id).m_Last = std::numeric_limits<std::size_t>::max();
+    m_Planned = false;
+  }
+
+  /**
+   * @brief Assigns offsets to all recorded buffers
+   *
+   * @return Size of the slab required, in bytes
+   */
+  std::size_t plan()
+  {
+    std::vector<std::size_t> _order(m_Buffers.size());
+    std::iota(_order.begin(), _order.end(), 0);
+    std::stable_sort(
+      _order.begin(), _order.end(), [this](std::size_t a, std::size_t b) {
+        return m_Buffers[a].m_Bytes > m_Buffers[b].m_Bytes;
+      });
+
+    std::vector<std::size_t> _placed;
+    _placed.reserve(m_Buffers.size());
+    m_Peak = 0;
+    for (const std::size_t _id : _order) {
+      Buffer& _buffer = m_Buffers[_id];
+      std::vector<const Buffer*> _conflicts;
+      for (const std::size_t _other : _placed) {
+        const Buffer& _o = m_Buffers[_other];
+        if (_o.m_First <= _buffer.m_Last && _buffer.m_First <= _o.m_Last) {
+          _conflicts.push_back(&_o);
+        }
+      }
+      std::sort(_conflicts.begin(),
+                _conflicts.end(),
+                [](const Buffer* a, const Buffer* b) {
+                  return a->m_Offset < b->m_Offset;
+                });
+      std::size_t _offset = 0;
+      for (const Buffer* _o : _conflicts) {
+        if (_offset + _buffer.m_Bytes <= _o->m_Offset) {
+          break;
+        }
+        _offset = std::max(_offset, align(_o->m_Offset + _o->m_Bytes));
+      }
+      _buffer.m_Offset = _offset;
+      m_Peak = std::max(m_Peak, align(_offset + _buffer.m_Bytes));
+      _placed.push_back(_id);
+    }
+    m_Planned = true;
+    return m_Peak;
+  }
+
+  /**
+   * @brief Reserves the slab, planning first if needed
+   *
+   * @details
+   * The slab is only reallocated if the plan outgrew it.
+   */
+  void allocate()
+  {
+    if (!m_Planned) {
+      plan();
+    }
+    if (m_Peak > m_Capacity) {
+      m_Slab.reset(static_cast<std::byte*>(
+        ::operator new(m_Peak, std::align_val_t(m_Alignment))));
+      m_Capacity = m_Peak;
+    }
+  }
+
+  /**
+   * @brief Tensor view of a planned buffer inside the slab
+   *
+   * @param p_Id Buffer identifier
+   * @param p_Dimensions Dimensions, must fit into the recorded size
+   *
+   * @return View valid until the slab is reallocated
+   */
+  template<typename T, std::size_t Rank>
+  TensorView<T, Rank> view(std::size_t p_Id,
+                           const std::array<std::size_t, Rank>& p_Dimensions)
+  {
+    if (!m_Slab || !m_Planned) {
+      throw std::runtime_error("Memory plan has not been allocated");
+    }
+    const Buffer& _buffer = m_Buffers.at(p_Id);
+    std::size_t _size = 1;
+    for (const auto& it : p_Dimensions) {
+      _size *= it;
+    }
+    if (_size * sizeof(T) > _buffer.m_Bytes) {
+      throw std::out_of_range("Tensor does not fit into the planned buffer");
+    }
+    return TensorView<T, Rank>(
+      reinterpret_cast<T*>(m_Slab.get() + _buffer.m_Offset),
+      p_Dimensions,
+      dense_strides(p_Dimensions));
+  }
+
+  /**
+   * @brief Offset of a planned buffer inside the slab, in bytes
+   */
+  std::size_t offset(std::size_t p_Id) const
+  {
+    return m_Buffers.at(p_Id).m_Offset;
+  }
+
+  /**
+   * @brief Size of the slab required by the plan, in bytes
+   */
+  std::size_t peak_bytes() const noexcept { return m_Peak; }
+
+  /**
+   * @brief Total size of all buffers if each was allocated separately
+   */
+  std::size_t naive_bytes() const noexcept
+  {
+    std::size_t _retval = 0;
+    for (const auto& it : m_Buffers) {
+      _retval += align(it.m_Bytes);
+    }
+    return _retval;
+  }
+
+private:
+  struct Buffer
+  {
+    std::size_t m_Bytes;
+    std::size_t m_First;
+    std::size_t m_Last;
+    std::size_t m_Offset;
+  };
+
+  struct SlabDeleter
+  {
+    std::size_t m_Alignment;
+
+    void operator()(std::byte* p_Ptr) const noexcept
+    {
+      ::operator delete(p_Ptr, std::align_val_t(m_Alignment));
+    }
+  };
+
+  std::size_t align(std::size_t p_Bytes) const noexcept
+  {
+    return (p_Bytes + m_Alignment - 1) & ~(m_Alignment - 1);
+  }
+
+  std::size_t m_Alignment;
+  std::vector<Buffer> m_Buffers;
+  bool m_Planned = false;
+  std::size_t m_Peak = 0;
+  std::size_t m_Capacity = 0;
+  std::unique_ptr<std::byte, SlabDeleter> m_Slab{ nullptr,
+                                                  SlabDeleter{ m_Alignment } };
+};
+
+}
@@ -0,0 +1,227 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Tensor.hpp"
+#include <array>
+#include <cstddef>
+#include <iterator>
+
+namespace TenSore {
+
+/**
+ * @brief Element yielded by NdIterator
+ *
+ * @tparam T The type of value, const-qualified for read-only traversal
+ * @tparam Rank Rank of the traversed tensor
+ *
+ * @details
+ * Supports structured bindings: `for (auto [coords, value] : indexed(T))`.
+ */
+template<typename T, std::size_t Rank>
+struct Indexed
+{
+  const std::array<std::size_t, Rank>& coords;
+  T& value;
+};
+
+/**
+ * @class NdIterator
+ * @brief Coordinate-aware iterator over a strided block of memory
+ *
+ * @tparam T The type of value, const-qualified for read-only traversal
+ * @tparam Rank Rank of the traversed tensor
+ *
+ * @details
+ * Coordinates are advanced as an odometer with carry, and the element
+ * pointer is advanced by the stride of the dimension that changed, so
+ * a step costs a single add and compare in the common (no carry) case.
+ * Dimension 0 is the fastest one, matching Tensor's layout.
+ */
+template<typename T, std::size_t Rank>
+class NdIterator
+{
+public:
+  using iterator_concept = std::input_iterator_tag;
+  using value_type = Indexed<T, Rank>;
+  using reference = Indexed<T, Rank>;
+  using difference_type = std::ptrdiff_t;
+
+  NdIterator() = default;
+
+  /**
+   * @brief Constructor of iterator
+   *
+   * @param p_Data Pointer to the element at coordinates (0, ..., 0)
+   * @param p_Dimensions Extent of each dimension
+   * @param p_Strides Distance in elements between neighbours along each dimension
+   */
+  NdIterator(T* p_Data,
+             const std::array<std::size_t, Rank>& p_Dimensions,
+             const std::array<std::ptrdiff_t, Rank>& p_Strides)
+    : m_Ptr(p_Data)
+    , m_Dimensions(p_Dimensions)
+    , m_Strides(p_Strides)
+    , m_Done(false)
+  {
+    m_Coords.fill(0);
+    for (std::size_t i = 0; i < Rank; ++i) {
+      m_Carry[i] = m_Strides[i] * static_cast<std::ptrdiff_t>(m_Dimensions[i]);
+      if (m_Dimensions[i] == 0) {
+        m_Done = true;
+      }
+    }
+  }
+
+  /**
+   * @brief Current coordinates
+   */
+  const std::array<std::size_t, Rank>& coords() const noexcept
+  {
+    return m_Coords;
+  }
+
+  /**
+   * @brief Pointer to the current element
+   */
+  T* pointer() const noexcept { return m_Ptr; }
+
+  reference operator*() const noexcept { return { m_Coords, *m_Ptr }; }
+
+  NdIterator& operator++() noexcept
+  {
+    m_Ptr += m_Strides[0];
+    if (++m_Coords[0] < m_Dimensions[0]) {
+      return *this;
+    }
+    for (std::size_t i = 0; i < Rank; ++i) {
+      m_Coords[i] = 0;
+      m_Ptr -= m_Carry[i];
+      if (i + 1 == Rank) {
+        m_Done = true;
+        break;
+      }
+      m_Ptr += m_Strides[i + 1];
+      if (++m_Coords[i + 1] < m_Dimensions[i + 1]) {
+        break;
+      }
+    }
+    return *this;
+  }
+
+  void operator++(int) noexcept { ++(*this); }
+
+  friend bool operator==(const NdIterator& it, std::default_sentinel_t) noexcept
+  {
+    return it.m_Done;
+  }
+
+private:
+  T* m_Ptr = nullptr;
+  std::array<std::size_t, Rank> m_Coords{};
+  std::array<std::size_t, Rank> m_Dimensions{};
+  std::array<std::ptrdiff_t, Rank> m_Strides{};
+  std::array<std::ptrdiff_t, Rank> m_Carry{};
+  bool m_Done = true;
+};
+
+/**
+ * @brief Range of (coordinates, element) pairs
+ *
+ * @tparam T The type of value, const-qualified for read-only traversal
+ * @tparam Rank Rank of the traversed tensor
+ */
+template<typename T, std::size_t Rank>
+class IndexedRange
+{
+public:
+  IndexedRange(T* p_Data,
+               const std::array<std::size_t, Rank>& p_Dimensions,
+               const std::array<std::ptrdiff_t, Rank>& p_Strides)
+    : m_Data(p_Data)
+    , m_Dimensions(p_Dimensions)
+    , m_Strides(p_Strides)
+  {
+  }
+
+  NdIterator<T, Rank> begin() const
+  {
+    return NdIterator<T, Rank>(m_Data, m_Dimensions, m_Strides);
+  }
+
+  std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+
+private:
+  T* m_Data;
+  std::array<std::size_t, Rank> m_Dimensions;
+  std::array<std::ptrdiff_t, Rank> m_Strides;
+};
+
+/**
+ * @brief Strides of a densely packed tensor with first-dimension-fastest layout
+ *
+ * @param p_Dimensions Dimensions of a tensor
+ *
+ * @return Strides in elements
+ */
+template<std::size_t Rank>
+std::array<std::ptrdiff_t, Rank>
+dense_strides(const std::array<std::size_t, Rank>& p_Dimensions) noexcept
+{
+  std::array<std::ptrdiff_t, Rank> _strides;
+  std::ptrdiff_t _multiplier = 1;
+  for (std::size_t i = 0; i < Rank; ++i) {
+    _strides[i] = _multiplier;
+    _multiplier *= static_cast<std::ptrdiff_t>(p_Dimensions[i]);
+  }
+  return _strides;
+}
+
+/**
+ * @brief Coordinate-aware traversal of a tensor
+ *
+ * @param p_Tensor Tensor to traverse
+ *
+ * @return Range yielding Indexed elements in storage order
+ */
+template<typename T, std::size_t Rank, Allocator A>
+IndexedRange<T, Rank>
+indexed(Tensor<T, Rank, A>& p_Tensor)
+{
+  return IndexedRange<T, Rank>(p_Tensor.storage(),
+                               p_Tensor.dimensions(),
+                               dense_strides(p_Tensor.dimensions()));
+}
+
+/**
+ * @brief Coordinate-aware traversal of a const tensor
+ *
+ * @param p_Tensor Tensor to traverse
+ *
+ * @return Range yielding Indexed const elements in storage order
+ */
+template<typename T, std::size_t Rank, Allocator A>
+IndexedRange<const T, Rank>
+indexed(const Tensor<T, Rank, A>& p_Tensor)
+{
+  return IndexedRange<const T, Rank>(p_Tensor.storage(),
+                                     p_Tensor.dimensions(),
+                                     dense_strides(p_Tensor.dimensions()));
+}
+
+}
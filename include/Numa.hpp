@@ -0,0 +1,288 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace TenSore {
+
+namespace detail {
+
+/**
+ * @brief Parses a sysfs list such as "0-3,8,10-11"
+ */
+inline std::vector<std::size_t>
+parse_cpu_list(const std::string& p_List)
+{
+  std::vector<std::size_t> _retval;
+  std::stringstream _stream(p_List);
+  std::string _range;
+  while (std::getline(_stream, _range, ',')) {
+    if (_range.empty() || _range == "\n") {
+      continue;
+    }
+    const std::size_t _dash = _range.find('-');
+    const std::size_t _first = std::stoul(_range.substr(0, _dash));
+    const std::size_t _last =
+      _dash == std::string::npos ? _first : std::stoul(_range.substr(_dash + 1));
+    for (std::size_t i = _first; i <= _last; ++i) {
+      _retval.push_back(i);
+    }
+  }
+  return _retval;
+}
+
+inline std::string
+read_line(const std::string& p_Path)
+{
+  std::ifstream _file(p_Path);
+  std::string _retval;
+  std::getline(_file, _retval);
+  return _retval;
+}
+
+}
+
+/**
+ * @class NumaTopology
+ * @brief NUMA nodes of the host and the CPUs available on each
+ *
+ * @details
+ * Read from /sys/devices/system/node on Linux and restricted to the CPUs
+ * of the process' affinity mask; nodes without usable CPUs are omitted.
+ * Elsewhere, or when sysfs is unavailable, the host is reported as a
+ * single node with no CPU list, and nothing is pinned.
+ */
+class NumaTopology
+{
+public:
+  struct Node
+  {
+    std::size_t m_Id;
+    std::vector<std::size_t> m_Cpus;
+  };
+
+  /**
+   * @brief Detects the topology of the host
+   */
+  static NumaTopology detect()
+  {
+    NumaTopology _retval;
+#if defined(__linux__)
+    cpu_set_t _allowed;
+    CPU_ZERO(&_allowed);
+    const bool _masked = sched_getaffinity(0, sizeof(_allowed), &_allowed) == 0;
+    const std::string _online = detail::read_line("/sys/devices/system/node/online");
+    for (const std::size_t _node : detail::parse_cpu_list(_online)) {
+      Node _entry{ _node, {} };
+      const std::string _cpus = detail::read_line(
+        "/sys/devices/system/node/node" + std::to_string(_node) + "/cpulist");
+      for (const std::size_t _cpu : detail::parse_cpu_list(_cpus)) {
+        if (!_masked || (_cpu < CPU_SETSIZE && CPU_ISSET(_cpu, &_allowed))) {
+          _entry.m_Cpus.push_back(_cpu);
+        }
+      }
+      if (!_entry.m_Cpus.empty()) {
+        _retval.m_Nodes.push_back(std::move(_entry));
+      }
+    }
+#endif
+    if (_retval.m_Nodes.empty()) {
+      _retval.m_Nodes.push_back({ 0, {} });
+    }
+    return _retval;
+  }
+
+  std::size_t node_count() const noexcept { return m_Nodes.size(); }
+
+  /**
+   * @brief Node by position, not by its system identifier
+   */
+  const Node& node(std::size_t p_Index) const { return m_Nodes.at(p_Index); }
+
+private:
+  std::vector<Node> m_Nodes;
+};
+
+/**
+ * @brief Restricts the calling thread to the given CPUs
+ *
+ * @return Whether affinity was set; an empty list is a no-op
+ */
+inline bool
+pin_current_thread(const std::vector<std::size_t>& p_Cpus)
+{
+#if defined(__linux__)
+  if (p_Cpus.empty()) {
+    return false;
+  }
+  cpu_set_t _set;
+  CPU_ZERO(&_set);
+  for (const std::size_t _cpu : p_Cpus) {
+    if (_cpu < CPU_SETSIZE) {
+      CPU_SET(_cpu, &_set);
+    }
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(_set), &_set) == 0;
+#else
+  (void)p_Cpus;
+  return false;
+#endif
+}
+
+/**
+ * @brief Prefers a NUMA node for the pages of a memory range
+ *
+ * @details
+ * Calls mbind(2) with MPOL_PREFERRED directly, so libnuma is not needed.
+ * The range must start on a page boundary. Failure (no NUMA support,
+ * restricted by a container) is reported, not thrown: placement then
+ * falls back to first touch.
+ *
+ * @return Whether the policy was applied
+ */
+inline bool
+prefer_node(void* p_Address, std::size_t p_Bytes, std::size_t p_Node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+  constexpr int k_MpolPreferred = 1;
+  constexpr std::size_t k_Bits = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> _mask(p_Node / k_Bits + 1, 0);
+  _mask[p_Node / k_Bits] = 1ul << (p_Node % k_Bits);
+  return syscall(SYS_mbind,
+                 p_Address,
+                 p_Bytes,
+                 k_MpolPreferred,
+                 _mask.data(),
+                 _mask.size() * k_Bits + 1,
+                 0) == 0;
+#else
+  (void)p_Address;
+  (void)p_Bytes;
+  (void)p_Node;
+  return false;
+#endif
+}
+
+/**
+ * @class NumaScheduler
+ * @brief One thread pool per NUMA node, with workers pinned to the node
+ *
+ * @details
+ * Tasks submitted for a node run on CPUs of that node, so memory it
+ * first-touches is allocated there and memory placed there is read
+ * without crossing the interconnect.
+ */
+class NumaScheduler
+{
+public:
+  /**
+   * @brief Constructor of a scheduler
+   *
+   * @param p_Topology Nodes to schedule on
+   */
+  explicit NumaScheduler(NumaTopology p_Topology = NumaTopology::detect())
+    : m_Topology(std::move(p_Topology))
+  {
+    const std::size_t _fallback = std::max(1u, std::thread::hardware_concurrency());
+    for (std::size_t i = 0; i < m_Topology.node_count(); ++i) {
+      const auto& _cpus = m_Topology.node(i).m_Cpus;
+      m_Pools.push_back(std::make_unique<ThreadPool>(
+        _cpus.empty() ? _fallback : _cpus.size(),
+        [_cpus](std::size_t) { pin_current_thread(_cpus); }));
+    }
+  }
+
+  const NumaTopology& topology() const noexcept { return m_Topology; }
+
+  std::size_t node_count() const noexcept { return m_Pools.size(); }
+
+  /**
+   * @brief Pool whose workers run on a node
+   *
+   * @param p_Node Node by position in the topology
+   */
+  ThreadPool& pool(std::size_t p_Node) { return *m_Pools.at(p_Node); }
+
+  /**
+   * @brief Runs tasks on their nodes and waits for all
+   *
+   * @param p_Count Amount of tasks
+   * @param p_NodeOf Callable mapping a task index to a node position
+   * @param p_Fn Callable invoked with a task index
+   *
+   * @details
+   * The first exception thrown by a task is rethrown after all finish.
+   */
+  template<typename N, typename F>
+  void parallel_for(std::size_t p_Count, N&& p_NodeOf, F&& p_Fn)
+  {
+    std::vector<std::future<void>> _futures;
+    _futures.reserve(p_Count);
+    for (std::size_t i = 0; i < p_Count; ++i) {
+      _futures.push_back(
+        pool(p_NodeOf(i) % node_count()).submit([&p_Fn, i] { p_Fn(i); }));
+    }
+    std::exception_ptr _error;
+    for (auto& it : _futures) {
+      try {
+        it.get();
+      } catch (...) {
+        if (!_error) {
+          _error = std::current_exception();
+        }
+      }
+    }
+    if (_error) {
+      std::rethrow_exception(_error);
+    }
+  }
+
+  /**
+   * @brief Process-wide scheduler over the detected topology
+   */
+  static NumaScheduler& global()
+  {
+    static NumaScheduler _scheduler;
+    return _scheduler;
+  }
+
+private:
+  NumaTopology m_Topology;
+  std::vector<std::unique_ptr<ThreadPool>> m_Pools;
+};
+
+}
@@ -0,0 +1,459 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Layout.hpp"
+#include "Numa.hpp"
+#include "Partition.hpp"
+#include "TensorView.hpp"
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace TenSore {
+
+/**
+ * @class NumaTensor
+ * @brief Tensor whose storage is partitioned across NUMA nodes
+ *
+ * @tparam T Trivial type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * Storage is a single contiguous mapping, so the tensor still converts to
+ * TensorView, but it is split along the outermost dimension into one
+ * segment per node. Each segment's pages are bound to its node with
+ * mbind(2) where permitted, and are first touched (zeroed) by workers
+ * pinned to that node, which places them there even without mbind.
+ * for_each_chunk() and parallel_reduce() then process every segment on
+ * its own node's workers.
+ */
+template<typename T, std::size_t Rank>
+class NumaTensor
+{
+  static_assert(std::is_trivially_copyable_v<T> &&
+                  std::is_trivially_default_constructible_v<T>,
+                "NumaTensor stores trivial types only");
+
+public:
+  struct Segment
+  {
+    std::size_t m_First;
+    std::size_t m_Last;
+    std::size_t m_Node;
+  };
+
+  NumaTensor() = delete;
+
+  /**
+   * @brief A constructor with an rvalue array
+   *
+   * @param p_Dimensions Array of dimensions
+   * @param p_Scheduler Scheduler owning the nodes to place segments on
+   */
+  NumaTensor(std::array<std::size_t, Rank>&& p_Dimensions,
+             NumaScheduler& p_Scheduler = NumaScheduler::global())
+    : m_DimensionsData(std::move(p_Dimensions))
+    , m_Scheduler(&p_Scheduler)
+  {
+    m_Size = 1;
+    for (const auto& it : m_DimensionsData) {
+      m_Size *= it;
+    }
+    construct([this](std::size_t i) {
+      const auto [_begin, _end] = segment_bytes(i);
+      std::memset(reinterpret_cast<std::byte*>(m_Data) + _begin, 0, _end - _begin);
+    });
+  }
+
+  /**
+   * @brief Copy contructor
+   *
+   * @details
+   * Segments are copied by workers of their nodes.
+   *
+   * @param p_Other Tensor to be copied from
+   */
+  NumaTensor(const NumaTensor& p_Other)
+    : m_DimensionsData(p_Other.m_DimensionsData)
+    , m_Size(p_Other.m_Size)
+    , m_Scheduler(p_Other.m_Scheduler)
+  {
+    construct([this, &p_Other](std::size_t i) {
+      const auto [_begin, _end] = segment_bytes(i);
+      std::memcpy(reinterpret_cast<std::byte*>(m_Data) + _begin,
+                  reinterpret_cast<const std::byte*>(p_Other.m_Data) + _begin,
+                  _end - _begin);
+    });
+  }
+
+  NumaTensor(NumaTensor&& p_Other) noexcept
+    : m_DimensionsData(p_Other.m_DimensionsData)
+    , m_Size(std::exchange(p_Other.m_Size, 0))
+    , m_Bytes(std::exchange(p_Other.m_Bytes, 0))
+    , m_Data(std::exchange(p_Other.m_Data, nullptr))
+    , m_Scheduler(p_Other.m_Scheduler)
+    , m_Segments(std::move(p_Other.m_Segments))
+  {
+  }
+
+  NumaTensor& operator=(NumaTensor p_Other) noexcept
+  {
+    std::swap(m_DimensionsData, p_Other.m_DimensionsData);
+    std::swap(m_Size, p_Other.m_Size);
+    std::swap(m_Bytes, p_Other.m_Bytes);
+    std::swap(m_Data, p_Other.m_Data);
+    std::swap(m_Scheduler, p_Other.m_Scheduler);
+    std::swap(m_Segments, p_Other.m_Segments);
+    return *this;
+  }
+
+  ~NumaTensor() { release(); }
+
+  std::size_t size() const noexcept { return m_Size; }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_DimensionsData;
+  }
+
+  T* storage() noexcept { return m_Data; }
+
+  const T* storage() const noexcept { return m_Data; }
+
+  NumaScheduler& scheduler() const noexcept { return *m_Scheduler; }
+
+  /**
+   * @brief Element access operator
+   *
+   * @param N Global index to access
+   *
+   * @return Element at index
+   */
+  T& operator[](std::size_t N)
+  {
+    if (N >= size()) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+    return m_Data[N];
+  }
+
+  const T& operator[](std::size_t N) const
+  {
+    if (N >= size()) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+    return m_Data[N];
+  }
+
+  T& at(const std::array<std::size_t, Rank>& p_Dims)
+  {
+    return m_Data[calculateIndex(p_Dims)];
+  }
+
+  const T& at(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return m_Data[calculateIndex(p_Dims)];
+  }
+
+  T& operator()(const std::array<std::size_t, Rank>& p_Dims) { return at(p_Dims); }
+
+  const T& operator()(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return at(p_Dims);
+  }
+
+  T* begin() noexcept { return m_Data; }
+  const T* begin() const noexcept { return m_Data; }
+  T* end() noexcept { return m_Data + m_Size; }
+  const T* end() const noexcept { return m_Data + m_Size; }
+
+  operator TensorView<T, Rank>() noexcept
+  {
+    return TensorView<T, Rank>(
+      m_Data, m_DimensionsData, dense_strides(m_DimensionsData));
+  }
+
+  operator TensorView<const T, Rank>() const noexcept
+  {
+    return TensorView<const T, Rank>(
+      m_Data, m_DimensionsData, dense_strides(m_DimensionsData));
+  }
+
+  std::size_t segment_count() const noexcept { return m_Segments.size(); }
+
+  /**
+   * @brief Range of the outermost dimension and the node of a segment
+   */
+  const Segment& segment_info(std::size_t p_Index) const
+  {
+    return m_Segments.at(p_Index);
+  }
+
+  /**
+   * @brief Slab of the tensor placed on one node
+   */
+  TensorView<T, Rank> segment(std::size_t p_Index)
+  {
+    return slab(static_cast<TensorView<T, Rank>>(*this), m_Segments.at(p_Index));
+  }
+
+  TensorView<const T, Rank> segment(std::size_t p_Index) const
+  {
+    return slab(static_cast<TensorView<const T, Rank>>(*this),
+                m_Segments.at(p_Index));
+  }
+
+private:
+  template<typename U>
+  static TensorView<U, Rank> slab(TensorView<U, Rank> p_View, const Segment& p_Segment)
+  {
+    std::array<std::size_t, Rank> _offsets{};
+    std::array<std::size_t, Rank> _extents = p_View.dimensions();
+    _offsets[Rank - 1] = p_Segment.m_First;
+    _extents[Rank - 1] = p_Segment.m_Last - p_Segment.m_First;
+    return p_View.subview(_offsets, _extents);
+  }
+
+  static std::size_t page_size() noexcept
+  {
+#if defined(__linux__)
+    return static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return 4096;
+#endif
+  }
+
+  /**
+   * @brief Page-aligned byte range of a segment
+   *
+   * @details
+   * A page straddling two segments goes to the earlier one, so the ranges
+   * tile the mapping exactly.
+   */
+  std::pair<std::size_t, std::size_t> segment_bytes(std::size_t p_Index) const
+  {
+    const std::size_t _page = page_size();
+    const std::size_t _slice = m_Size / std::max<std::size_t>(m_DimensionsData[Rank - 1], 1);
+    auto _boundary = [&](std::size_t p_Outer) {
+      const std::size_t _bytes = p_Outer * _slice * sizeof(T);
+      return std::min((_bytes + _page - 1) / _page * _page, m_Bytes);
+    };
+    const Segment& _segment = m_Segments[p_Index];
+    const std::size_t _begin = p_Index == 0 ? 0 : _boundary(_segment.m_First);
+    const std::size_t _end =
+      p_Index + 1 == m_Segments.size() ? m_Bytes : _boundary(_segment.m_Last);
+    return { _begin, _end };
+  }
+
+  void allocate()
+  {
+    m_Segments.clear();
+    const std::size_t _outer = m_DimensionsData[Rank - 1];
+    const std::size_t _nodes = m_Scheduler->node_count();
+    for (std::size_t i = 0; i < _nodes; ++i) {
+      const std::size_t _first = _outer * i / _nodes;
+      const std::size_t _last = _outer * (i + 1) / _nodes;
+      if (_last > _first) {
+        m_Segments.push_back({ _first, _last, i });
+      }
+    }
+    if (m_Segments.empty()) {
+      m_Segments.push_back({ 0, _outer, 0 });
+    }
+
+    const std::size_t _page = page_size();
+    m_Bytes = std::max<std::size_t>((m_Size * sizeof(T) + _page - 1) / _page * _page, _page);
+#if defined(__linux__)
+    void* _ptr = mmap(nullptr,
+                      m_Bytes,
+                      PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1,
+                      0);
+    if (_ptr == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+    m_Data = static_cast<T*>(_ptr);
+#else
+    m_Data = static_cast<T*>(::operator new(m_Bytes, std::align_val_t(_page)));
+#endif
+  }
+
+  /**
+   * @brief Binds every segment to its node and first-touches it there
+   */
+  template<typename F>
+  void place(F&& p_Touch)
+  {
+    for (std::size_t i = 0; i < m_Segments.size(); ++i) {
+      const auto [_begin, _end] = segment_bytes(i);
+      if (_end > _begin) {
+        prefer_node(reinterpret_cast<std::byte*>(m_Data) + _begin,
+                    _end - _begin,
+                    m_Scheduler->topology().node(m_Segments[i].m_Node).m_Id);
+      }
+    }
+    m_Scheduler->parallel_for(
+      m_Segments.size(),
+      [this](std::size_t i) { return m_Segments[i].m_Node; },
+      std::forward<F>(p_Touch));
+  }
+
+  /**
+   * @brief Allocates and places the elements, releasing them if placing throws
+   */
+  template<typename F>
+  void construct(F&& p_Touch)
+  {
+    allocate();
+    try {
+      place(std::forward<F>(p_Touch));
+    } catch (...) {
+      release();
+      throw;
+    }
+  }
+
+  void release() noexcept
+  {
+    if (!m_Data) {
+      return;
+    }
+#if defined(__linux__)
+    munmap(m_Data, m_Bytes);
+#else
+    ::operator delete(m_Data, std::align_val_t(page_size()));
+#endif
+    m_Data = nullptr;
+  }
+
+  std::size_t calculateIndex(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return detail::checked_index(p_Dims, m_DimensionsData);
+  }
+
+  std::array<std::size_t, Rank> m_DimensionsData;
+  std::size_t m_Size = 0;
+  std::size_t m_Bytes = 0;
+  T* m_Data = nullptr;
+  NumaScheduler* m_Scheduler;
+  std::vector<Segment> m_Segments;
+};
+
+/**
+ * @brief Processes every chunk of a NUMA tensor on its owning node
+ *
+ * @param p_Tensor Tensor to process
+ * @param p_Fn Callable invoked with a span and the chunk's index
+ *
+ * @details
+ * Every segment is partitioned into one chunk per worker of its node,
+ * with the alignment guarantees of partition().
+ */
+template<typename T, std::size_t Rank, typename F>
+void
+for_each_chunk(NumaTensor<T, Rank>& p_Tensor, F&& p_Fn)
+{
+  std::vector<std::span<T>> _chunks;
+  std::vector<std::size_t> _nodes;
+  for (std::size_t i = 0; i < p_Tensor.segment_count(); ++i) {
+    const std::size_t _node = p_Tensor.segment_info(i).m_Node;
+    for (const auto& it :
+         partition(p_Tensor.segment(i), p_Tensor.scheduler().pool(_node).size())) {
+      _chunks.push_back(it);
+      _nodes.push_back(_node);
+    }
+  }
+  p_Tensor.scheduler().parallel_for(
+    _chunks.size(),
+    [&](std::size_t i) { return _nodes[i]; },
+    [&](std::size_t i) { p_Fn(_chunks[i], i); });
+}
+
+template<typename T, std::size_t Rank, typename F>
+void
+for_each_chunk(const NumaTensor<T, Rank>& p_Tensor, F&& p_Fn)
+{
+  std::vector<std::span<const T>> _chunks;
+  std::vector<std::size_t> _nodes;
+  for (std::size_t i = 0; i < p_Tensor.segment_count(); ++i) {
+    const std::size_t _node = p_Tensor.segment_info(i).m_Node;
+    for (const auto& it :
+         partition(p_Tensor.segment(i), p_Tensor.scheduler().pool(_node).size())) {
+      _chunks.push_back(it);
+      _nodes.push_back(_node);
+    }
+  }
+  p_Tensor.scheduler().parallel_for(
+    _chunks.size(),
+    [&](std::size_t i) { return _nodes[i]; },
+    [&](std::size_t i) { p_Fn(_chunks[i], i); });
+}
+
+/**
+ * @brief Node-local parallel reduction
+ *
+ * @param p_Tensor Tensor to reduce
+ * @param p_Init Initial value, applied once
+ * @param p_Op Associative binary operation
+ *
+ * @return Reduction of all elements
+ */
+template<typename T, std::size_t Rank, typename R, typename Op>
+R
+parallel_reduce(const NumaTensor<T, Rank>& p_Tensor, R p_Init, Op p_Op)
+{
+  struct alignas(cache_line_bytes) Partial
+  {
+    std::optional<R> m_Value;
+  };
+  std::size_t _count = 0;
+  for (std::size_t i = 0; i < p_Tensor.segment_count(); ++i) {
+    _count += p_Tensor.scheduler().pool(p_Tensor.segment_info(i).m_Node).size();
+  }
+  std::vector<Partial> _partials(_count);
+  for_each_chunk(p_Tensor, [&](std::span<const T> p_Chunk, std::size_t i) {
+    R _acc = static_cast<R>(p_Chunk.front());
+    for (const T& it : p_Chunk.subspan(1)) {
+      _acc = p_Op(_acc, it);
+    }
+    _partials[i].m_Value = _acc;
+  });
+  R _retval = p_Init;
+  for (const auto& it : _partials) {
+    if (it.m_Value) {
+      _retval = p_Op(_retval, *it.m_Value);
+    }
+  }
+  return _retval;
+}
+
+}
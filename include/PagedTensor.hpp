@@ -0,0 +1,558 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "ElementIterator.hpp"
+#include "Layout.hpp"
+#include "Tensor.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TenSore {
+
+/**
+ * @class PagedTensor
+ * @brief Tensor backed by a file, with a bounded pool of resident blocks
+ *
+ * @tparam T Trivially copyable type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * Elements are stored in Tensor's linear order in a file and split into
+ * fixed-size blocks. Only as many blocks as fit in the memory budget are
+ * held in memory; the pool replaces them with the CLOCK algorithm and
+ * writes modified blocks back when they are evicted or on flush(). When
+ * blocks are missed in ascending order the following ones are announced
+ * to the kernel (POSIX_FADV_WILLNEED), so sequential scans read ahead.
+ *
+ * References returned by element access stay valid as long as no more
+ * than one other block is accessed in between. Mutable element access
+ * marks the block modified; iterators yield proxies that only do so when
+ * assigned to, so read-only algorithms over a non-const tensor write
+ * nothing back. A proxy is a prvalue, so mutable range-for loops bind
+ * it with `auto&&` (`auto&` does not compile):
+ * @code
+ * for (auto&& it : paged) {
+ *   it *= 2.0;
+ * }
+ * @endcode
+ * The class is not thread-safe.
+ */
+template<typename T, std::size_t Rank>
+class PagedTensor
+{
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Paged tensors store trivially copyable types only");
+
+public:
+  using Iterator = ElementIterator<PagedTensor, T, false>;
+  using ConstIterator = ElementIterator<PagedTensor, T, true>;
+
+  PagedTensor() = delete;
+
+  /**
+   * @brief A constructor with an rvalue array
+   *
+   * @param p_Dimensions Array of dimensions
+   * @param p_BudgetBytes Memory the pool may use for resident blocks
+   * @param p_BlockElements Elements per block
+   * @param p_Path Backing file, kept on destruction; a temporary file in
+   * $TMPDIR (or /tmp) that is removed right away when empty
+   *
+   * @details
+   * An existing backing file of the right size keeps its contents, so a
+   * tensor can be reopened; otherwise the file is resized and zero-filled.
+   * The budget is rounded to whole blocks and never below four blocks.
+   */
+  PagedTensor(std::array<std::size_t, Rank>&& p_Dimensions,
+              std::size_t p_BudgetBytes = std::size_t{ 64 } << 20,
+              std::size_t p_BlockElements = 65536,
+              const std::string& p_Path = "")
+    : m_DimensionsData(std::move(p_Dimensions))
+    , m_BlockElements(p_BlockElements)
+  {
+    if (m_BlockElements == 0) {
+      throw std::invalid_argument("Block size must be positive");
+    }
+    m_Size = 1;
+    for (const auto& it : m_DimensionsData) {
+      m_Size *= it;
+    }
+    open_file(p_Path);
+    const std::size_t _blocks = (m_Size + m_BlockElements - 1) / m_BlockElements;
+    const std::size_t _frames = std::min(
+      _blocks, std::max<std::size_t>(p_BudgetBytes / block_bytes(), k_MinFrames));
+    m_FrameOf.assign(_blocks, k_None);
+    m_Frames.resize(_frames);
+    m_Pool.resize(_frames * m_BlockElements);
+  }
+
+  /**
+   * @brief Copies a tensor to a new paged tensor
+   *
+   * @param p_Tensor Tensor to be copied
+   */
+  template<Allocator A>
+  explicit PagedTensor(const Tensor<T, Rank, A>& p_Tensor,
+                       std::size_t p_BudgetBytes = std::size_t{ 64 } << 20,
+                       std::size_t p_BlockElements = 65536,
+                       const std::string& p_Path = "")
+    : PagedTensor(std::array<std::size_t, Rank>(p_Tensor.dimensions()),
+                  p_BudgetBytes,
+                  p_BlockElements,
+                  p_Path)
+  {
+    for (std::size_t i = 0; i < block_count(); ++i) {
+      write_block(i, p_Tensor.storage() + i * m_BlockElements);
+    }
+  }
+
+  PagedTensor(const PagedTensor&) = delete;
+  PagedTensor& operator=(const PagedTensor&) = delete;
+
+  PagedTensor(PagedTensor&& p_Other) noexcept
+    : m_DimensionsData(p_Other.m_DimensionsData)
+    , m_Size(p_Other.m_Size)
+    , m_BlockElements(p_Other.m_BlockElements)
+    , m_Fd(std::exchange(p_Other.m_Fd, -1))
+    , m_Pool(std::move(p_Other.m_Pool))
+    , m_Frames(std::move(p_Other.m_Frames))
+    , m_FrameOf(std::move(p_Other.m_FrameOf))
+    , m_Hand(p_Other.m_Hand)
+    , m_Recent(p_Other.m_Recent)
+    , m_LastMiss(p_Other.m_LastMiss)
+    , m_Hits(p_Other.m_Hits)
+    , m_Misses(p_Other.m_Misses)
+    , m_WriteBacks(p_Other.m_WriteBacks)
+  {
+  }
+
+  PagedTensor& operator=(PagedTensor&& p_Other) noexcept
+  {
+    if (this != &p_Other) {
+      release();
+      m_DimensionsData = p_Other.m_DimensionsData;
+      m_Size = p_Other.m_Size;
+      m_BlockElements = p_Other.m_BlockElements;
+      m_Fd = std::exchange(p_Other.m_Fd, -1);
+      m_Pool = std::move(p_Other.m_Pool);
+      m_Frames = std::move(p_Other.m_Frames);
+      m_FrameOf = std::move(p_Other.m_FrameOf);
+      m_Hand = p_Other.m_Hand;
+      m_Recent = p_Other.m_Recent;
+      m_LastMiss = p_Other.m_LastMiss;
+      m_Hits = p_Other.m_Hits;
+      m_Misses = p_Other.m_Misses;
+      m_WriteBacks = p_Other.m_WriteBacks;
+    }
+    return *this;
+  }
+
+  /**
+   * @brief Destructor, writing back modified blocks
+   *
+   * @details
+   * Errors while writing back are swallowed; call flush() beforehand to
+   * observe them.
+   */
+  ~PagedTensor() { release(); }
+
+  std::size_t size() const noexcept { return m_Size; }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_DimensionsData;
+  }
+
+  std::size_t block_elements() const noexcept { return m_BlockElements; }
+
+  std::size_t block_count() const noexcept { return m_FrameOf.size(); }
+
+  /**
+   * @brief Maximal amount of blocks held in memory
+   */
+  std::size_t resident_limit() const noexcept { return m_Frames.size(); }
+
+  /**
+   * @brief Block accesses served from memory
+   */
+  std::size_t hits() const noexcept { return m_Hits; }
+
+  /**
+   * @brief Block accesses that had to read the file
+   */
+  std::size_t misses() const noexcept { return m_Misses; }
+
+  /**
+   * @brief Modified blocks written to the file so far
+   */
+  std::size_t write_backs() const noexcept { return m_WriteBacks; }
+
+  /**
+   * @brief Element access operator
+   *
+   * @param N Global index to access
+   *
+   * @return Element at index, see class details on its lifetime
+   */
+  T& operator[](std::size_t N)
+  {
+    check(N);
+    return element(N, true);
+  }
+
+  const T& operator[](std::size_t N) const
+  {
+    check(N);
+    return element(N, false);
+  }
+
+  T& at(const std::array<std::size_t, Rank>& p_Dims)
+  {
+    return element(calculateIndex(p_Dims), true);
+  }
+
+  const T& at(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return element(calculateIndex(p_Dims), false);
+  }
+
+  template<std::size_t... p_Dimensions>
+  T& operator()()
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Amount of indices must be equal to the rank");
+    return at({ p_Dimensions... });
+  }
+
+  template<std::size_t... p_Dimensions>
+  const T& operator()() const
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Amount of indices must be equal to the rank");
+    return at({ p_Dimensions... });
+  }
+
+  T& operator()(const std::array<std::size_t, Rank>& p_Dims) { return at(p_Dims); }
+
+  const T& operator()(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return at(p_Dims);
+  }
+
+  Iterator begin() noexcept { return Iterator(this, 0); }
+
+  ConstIterator begin() const noexcept { return ConstIterator(this, 0); }
+
+  Iterator end() noexcept { return Iterator(this, size()); }
+
+  ConstIterator end() const noexcept { return ConstIterator(this, size()); }
+
+  ConstIterator cbegin() const noexcept { return begin(); }
+
+  ConstIterator cend() const noexcept { return end(); }
+
+  /**
+   * @brief Writes every modified resident block to the file
+   */
+  void flush()
+  {
+    for (std::size_t f = 0; f < m_Frames.size(); ++f) {
+      write_back(f);
+    }
+  }
+
+  /**
+   * @brief Visits every block in order
+   *
+   * @param p_Fn Callable invoked with a std::span<T> (std::span<const T>
+   * on a const tensor) and the index of its first element
+   *
+   * @details
+   * The preferred way to run kernels over a paged tensor: each block is
+   * resolved once, and the ones after it are read ahead. Blocks passed
+   * to a non-const visitor are marked modified.
+   */
+  template<typename F>
+  void for_each_block(F&& p_Fn)
+  {
+    for (std::size_t i = 0; i < block_count(); ++i) {
+      advise(i + 1, k_ReadAhead);
+      T* _data = block(i, true);
+      p_Fn(std::span<T>(_data, block_size(i)), i * m_BlockElements);
+    }
+  }
+
+  template<typename F>
+  void for_each_block(F&& p_Fn) const
+  {
+    for (std::size_t i = 0; i < block_count(); ++i) {
+      advise(i + 1, k_ReadAhead);
+      const T* _data = block(i, false);
+      p_Fn(std::span<const T>(_data, block_size(i)), i * m_BlockElements);
+    }
+  }
+
+  /**
+   * @brief Reads the whole tensor into memory
+   */
+  Tensor<T, Rank> to_tensor() const
+  {
+    std::array<std::size_t, Rank> _dims = m_DimensionsData;
+    Tensor<T, Rank> _retval(std::move(_dims));
+    for_each_block([&](std::span<const T> p_Block, std::size_t p_Offset) {
+      std::copy(p_Block.begin(), p_Block.end(), _retval.storage() + p_Offset);
+    });
+    return _retval;
+  }
+
+private:
+  static constexpr std::size_t k_None = std::numeric_limits<std::size_t>::max();
+  static constexpr std::size_t k_MinFrames = 4;
+  static constexpr std::size_t k_ReadAhead = 4;
+
+  struct Frame
+  {
+    std::size_t m_Block = k_None;
+    bool m_Referenced = false;
+    bool m_Dirty = false;
+  };
+
+  std::size_t block_bytes() const noexcept { return m_BlockElements * sizeof(T); }
+
+  std::size_t block_size(std::size_t p_Block) const noexcept
+  {
+    return std::min(m_BlockElements, m_Size - p_Block * m_BlockElements);
+  }
+
+  void check(std::size_t N) const
+  {
+    if (N >= size()) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+  }
+
+  T& element(std::size_t N, bool p_Modify) const
+  {
+    return block(N / m_BlockElements, p_Modify)[N % m_BlockElements];
+  }
+
+  /**
+   * @brief Resident copy of a block, loading it if needed
+   */
+  T* block(std::size_t p_Block, bool p_Modify) const
+  {
+    std::size_t _frame = m_FrameOf[p_Block];
+    if (_frame == k_None) {
+      ++m_Misses;
+      _frame = victim();
+      write_back(_frame);
+      if (m_Frames[_frame].m_Block != k_None) {
+        m_FrameOf[m_Frames[_frame].m_Block] = k_None;
+      }
+      read_block(p_Block, m_Pool.data() + _frame * m_BlockElements);
+      m_Frames[_frame].m_Block = p_Block;
+      m_FrameOf[p_Block] = _frame;
+      if (m_LastMiss != k_None && p_Block == m_LastMiss + 1) {
+        advise(p_Block + 1, k_ReadAhead);
+      }
+      m_LastMiss = p_Block;
+    } else {
+      ++m_Hits;
+    }
+    Frame& _entry = m_Frames[_frame];
+    _entry.m_Referenced = true;
+    _entry.m_Dirty = _entry.m_Dirty || p_Modify;
+    if (m_Recent[0] != _frame) {
+      m_Recent[1] = std::exchange(m_Recent[0], _frame);
+    }
+    return m_Pool.data() + _frame * m_BlockElements;
+  }
+
+  /**
+   * @brief Frame to be reused, chosen by CLOCK
+   *
+   * @details
+   * The two most recently used frames are never chosen, keeping the
+   * references promised in the class details valid.
+   */
+  std::size_t victim() const
+  {
+    for (;;) {
+      const std::size_t _frame = m_Hand;
+      m_Hand = (m_Hand + 1) % m_Frames.size();
+      Frame& _entry = m_Frames[_frame];
+      if (_entry.m_Block == k_None) {
+        return _frame;
+      }
+      if (_frame == m_Recent[0] || _frame == m_Recent[1]) {
+        continue;
+      }
+      if (!_entry.m_Referenced) {
+        return _frame;
+      }
+      _entry.m_Referenced = false;
+    }
+  }
+
+  void write_back(std::size_t p_Frame) const
+  {
+    Frame& _entry = m_Frames[p_Frame];
+    if (_entry.m_Block != k_None && _entry.m_Dirty) {
+      write_block(_entry.m_Block, m_Pool.data() + p_Frame * m_BlockElements);
+      _entry.m_Dirty = false;
+      ++m_WriteBacks;
+    }
+  }
+
+  void read_block(std::size_t p_Block, T* p_Out) const
+  {
+    auto* _out = reinterpret_cast<char*>(p_Out);
+    const std::size_t _bytes = block_size(p_Block) * sizeof(T);
+    const auto _offset = static_cast<off_t>(p_Block * block_bytes());
+    for (std::size_t _done = 0; _done < _bytes;) {
+      const ssize_t _n = ::pread(m_Fd, _out + _done, _bytes - _done, _offset + _done);
+      if (_n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (_n < 0) {
+        throw std::system_error(errno, std::generic_category(), "pread");
+      }
+      if (_n == 0) {
+        throw std::runtime_error("Backing file of a paged tensor is truncated");
+      }
+      _done += static_cast<std::size_t>(_n);
+    }
+  }
+
+  void write_block(std::size_t p_Block, const T* p_In) const
+  {
+    const auto* _in = reinterpret_cast<const char*>(p_In);
+    const std::size_t _bytes = block_size(p_Block) * sizeof(T);
+    const auto _offset = static_cast<off_t>(p_Block * block_bytes());
+    for (std::size_t _done = 0; _done < _bytes;) {
+      const ssize_t _n = ::pwrite(m_Fd, _in + _done, _bytes - _done, _offset + _done);
+      if (_n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (_n < 0) {
+        throw std::system_error(errno, std::generic_category(), "pwrite");
+      }
+      _done += static_cast<std::size_t>(_n);
+    }
+  }
+
+  /**
+   * @brief Announces upcoming reads of non-resident blocks to the kernel
+   */
+  void advise(std::size_t p_First, std::size_t p_Count) const noexcept
+  {
+#if defined(POSIX_FADV_WILLNEED)
+    const std::size_t _last = std::min(p_First + p_Count, block_count());
+    for (std::size_t b = p_First; b < _last; ++b) {
+      if (m_FrameOf[b] == k_None) {
+        ::posix_fadvise(m_Fd,
+                        static_cast<off_t>(b * block_bytes()),
+                        static_cast<off_t>(block_size(b) * sizeof(T)),
+                        POSIX_FADV_WILLNEED);
+      }
+    }
+#else
+    (void)p_First;
+    (void)p_Count;
+#endif
+  }
+
+  void open_file(const std::string& p_Path)
+  {
+    if (p_Path.empty()) {
+      const char* _dir = std::getenv("TMPDIR");
+      std::string _template =
+        std::string(_dir && *_dir ? _dir : "/tmp") + "/tensore-paged-XXXXXX";
+      m_Fd = ::mkstemp(_template.data());
+      if (m_Fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "mkstemp");
+      }
+      ::unlink(_template.c_str());
+    } else {
+      m_Fd = ::open(p_Path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+      if (m_Fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open");
+      }
+    }
+    struct stat _stat;
+    const auto _bytes = static_cast<off_t>(m_Size * sizeof(T));
+    if (::fstat(m_Fd, &_stat) != 0 ||
+        (_stat.st_size != _bytes &&
+         (::ftruncate(m_Fd, 0) != 0 || ::ftruncate(m_Fd, _bytes) != 0))) {
+      const int _error = errno;
+      ::close(m_Fd);
+      m_Fd = -1;
+      throw std::system_error(_error, std::generic_category(), "ftruncate");
+    }
+  }
+
+  void release() noexcept
+  {
+    if (m_Fd < 0) {
+      return;
+    }
+    try {
+      flush();
+    } catch (...) {
+    }
+    ::close(m_Fd);
+    m_Fd = -1;
+  }
+
+  std::size_t calculateIndex(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return detail::checked_index(p_Dims, m_DimensionsData);
+  }
+
+  std::array<std::size_t, Rank> m_DimensionsData;
+  std::size_t m_Size = 0;
+  std::size_t m_BlockElements;
+  int m_Fd = -1;
+  mutable std::vector<T> m_Pool;
+  mutable std::vector<Frame> m_Frames;
+  mutable std::vector<std::size_t> m_FrameOf;
+  mutable std::size_t m_Hand = 0;
+  mutable std::array<std::size_t, 2> m_Recent{ k_None, k_None };
+  mutable std::size_t m_LastMiss = k_None;
+  mutable std::size_t m_Hits = 0;
+  mutable std::size_t m_Misses = 0;
+  mutable std::size_t m_WriteBacks = 0;
+};
+
+}
@@ -0,0 +1,231 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "TensorView.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @brief Size of a cache line, in bytes
+ */
+inline constexpr std::size_t cache_line_bytes = 64;
+
+/**
+ * @brief Width of the widest SIMD register targeted, in bytes
+ */
+inline constexpr std::size_t simd_bytes = 64;
+
+/**
+ * @brief Splits contiguous elements into chunks for parallel processing
+ *
+ * @param p_View Contiguous tensor or view
+ * @param p_Parts Amount of chunks
+ *
+ * @return At most `p_Parts` non-empty spans covering all elements
+ *
+ * @details
+ * Interior boundaries are placed on addresses aligned to both a cache
+ * line and a SIMD register, so that no two chunks share a cache line
+ * (no false sharing on writes) and every chunk but the first starts on
+ * an aligned vector load. Chunks are balanced to within one alignment
+ * granule. Throws std::invalid_argument on non-contiguous views.
+ */
+template<typename T, std::size_t Rank>
+std::vector<std::span<T>>
+partition(TensorView<T, Rank> p_View, std::size_t p_Parts)
+{
+  if (p_Parts == 0) {
+    throw std::invalid_argument("Amount of parts must be positive");
+  }
+  const std::span<T> _span = p_View.span();
+  const std::size_t _size = _span.size();
+  constexpr std::size_t _align = std::max(cache_line_bytes, simd_bytes);
+
+  std::size_t _head = 0;
+  std::size_t _granule = 1;
+  if constexpr (_align % sizeof(T) == 0) {
+    const auto _addr = reinterpret_cast<std::uintptr_t>(_span.data());
+    const std::size_t _misalign = (_align - _addr % _align) % _align;
+    if (_misalign % sizeof(T) == 0) {
+      _head = _misalign / sizeof(T);
+      _granule = _align / sizeof(T);
+    }
+  }
+
+  std::vector<std::span<T>> _retval;
+  _retval.reserve(p_Parts);
+  std::size_t _first = 0;
+  for (std::size_t i = 1; i <= p_Parts && _first < _size; ++i) {
+    std::size_t _last = _size;
+    if (i != p_Parts) {
+      const std::size_t _ideal = _size * i / p_Parts;
+      _last = _ideal < _head
+                ? _head
+                : _head + (_ideal - _head + _granule / 2) / _granule * _granule;
+      _last = std::min(_last, _size);
+    }
+    if (_last > _first) {
+      _retval.push_back(_span.subspan(_first, _last - _first));
+      _first = _last;
+    }
+  }
+  return _retval;
+}
+
+template<typename T, std::size_t Rank, Allocator A>
+std::vector<std::span<T>>
+partition(Tensor<T, Rank, A>& p_Tensor, std::size_t p_Parts)
+{
+  return partition(as_view(p_Tensor), p_Parts);
+}
+
+template<typename T, std::size_t Rank, Allocator A>
+std::vector<std::span<const T>>
+partition(const Tensor<T, Rank, A>& p_Tensor, std::size_t p_Parts)
+{
+  return partition(as_view(p_Tensor), p_Parts);
+}
+
+template<MdspanLike M>
+auto
+partition(const M& p_Span, std::size_t p_Parts)
+{
+  return partition(as_view(p_Span), p_Parts);
+}
+
+/**
+ * @brief Splits a tensor into slabs along an axis
+ *
+ * @param p_View Tensor or view to split
+ * @param p_Axis Axis along which to split
+ * @param p_Parts Amount of slabs
+ *
+ * @return At most `p_Parts` non-empty views with extents along the axis
+ * differing by at most one
+ *
+ * @details
+ * Splitting along the outermost axis yields contiguous slabs.
+ */
+template<typename T, std::size_t Rank>
+std::vector<TensorView<T, Rank>>
+split_along(TensorView<T, Rank> p_View, std::size_t p_Axis, std::size_t p_Parts)
+{
+  if (p_Axis >= Rank) {
+    throw std::out_of_range("Axis out of bounds");
+  }
+  if (p_Parts == 0) {
+    throw std::invalid_argument("Amount of parts must be positive");
+  }
+  const std::size_t _extent = p_View.dimensions()[p_Axis];
+  std::vector<TensorView<T, Rank>> _retval;
+  _retval.reserve(std::min(p_Parts, _extent));
+  std::array<std::size_t, Rank> _offsets{};
+  std::array<std::size_t, Rank> _extents = p_View.dimensions();
+  for (std::size_t i = 0; i < p_Parts; ++i) {
+    const std::size_t _first = _extent * i / p_Parts;
+    const std::size_t _last = _extent * (i + 1) / p_Parts;
+    if (_last == _first) {
+      continue;
+    }
+    _offsets[p_Axis] = _first;
+    _extents[p_Axis] = _last - _first;
+    _retval.push_back(p_View.subview(_offsets, _extents));
+  }
+  return _retval;
+}
+
+template<typename T, std::size_t Rank, Allocator A>
+std::vector<TensorView<T, Rank>>
+split_along(Tensor<T, Rank, A>& p_Tensor, std::size_t p_Axis, std::size_t p_Parts)
+{
+  return split_along(as_view(p_Tensor), p_Axis, p_Parts);
+}
+
+template<typename T, std::size_t Rank, Allocator A>
+std::vector<TensorView<const T, Rank>>
+split_along(const Tensor<T, Rank, A>& p_Tensor,
+            std::size_t p_Axis,
+            std::size_t p_Parts)
+{
+  return split_along(as_view(p_Tensor), p_Axis, p_Parts);
+}
+
+template<MdspanLike M>
+auto
+split_along(const M& p_Span, std::size_t p_Axis, std::size_t p_Parts)
+{
+  return split_along(as_view(p_Span), p_Axis, p_Parts);
+}
+
+/**
+ * @brief Splits a tensor into rectangular tiles
+ *
+ * @param p_Range Tensor or view to split
+ * @param p_Shape Dimensions of a tile, tiles at the upper borders are clipped
+ *
+ * @return Views of all tiles in first-dimension-fastest order
+ */
+template<typename R, std::size_t Rank>
+auto
+tiles(R&& p_Range, const std::array<std::size_t, Rank>& p_Shape)
+{
+  auto _tiles = std::forward<R>(p_Range) | views::tiles(p_Shape);
+  std::vector<std::ranges::range_value_t<decltype(_tiles)>> _retval;
+  _retval.reserve(std::ranges::size(_tiles));
+  for (const auto& it : _tiles) {
+    _retval.push_back(it);
+  }
+  return _retval;
+}
+
+/**
+ * @brief Processes every chunk on a thread pool and waits for completion
+ *
+ * @param p_Pool Pool to dispatch onto
+ * @param p_Chunks Chunks from partition(), split_along() or tiles()
+ * @param p_Fn Callable invoked as `p_Fn(chunk, chunk_index)`
+ */
+template<typename C, typename F>
+void
+for_each_chunk(ThreadPool& p_Pool, const std::vector<C>& p_Chunks, F&& p_Fn)
+{
+  p_Pool.parallel_for(p_Chunks.size(),
+                      [&](std::size_t i) { p_Fn(p_Chunks[i], i); });
+}
+
+/**
+ * @brief Processes every chunk on the global thread pool
+ */
+template<typename C, typename F>
+void
+for_each_chunk(const std::vector<C>& p_Chunks, F&& p_Fn)
+{
+  for_each_chunk(ThreadPool::global(), p_Chunks, std::forward<F>(p_Fn));
+}
+
+}
@@ -0,0 +1,456 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "TensorView.hpp"
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TenSore {
+
+/**
+ * @brief Header at the start of a shared tensor segment
+ *
+ * @details
+ * Layout is fixed so that processes built from different translation
+ * units agree on it. Elements start at `m_DataOffset`, aligned to 64.
+ */
+struct SharedTensorHeader
+{
+  static constexpr std::uint64_t k_Magic = 0x54656e536f726553ull;
+  static constexpr std::size_t k_MaxRank = 8;
+
+  enum class Kind : std::uint32_t
+  {
+    Floating,
+    Signed,
+    Unsigned,
+    Other
+  };
+
+  std::uint64_t m_Magic;
+  std::uint32_t m_ElementSize;
+  Kind m_Kind;
+  std::uint64_t m_Rank;
+  std::uint64_t m_Dimensions[k_MaxRank];
+  std::uint64_t m_DataOffset;
+  std::atomic<std::uint64_t> m_Version;
+
+  template<typename T>
+  static constexpr Kind kind_of() noexcept
+  {
+    if constexpr (std::is_floating_point_v<T>) {
+      return Kind::Floating;
+    } else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>) {
+      return Kind::Signed;
+    } else if constexpr (std::is_integral_v<T>) {
+      return Kind::Unsigned;
+    } else {
+      return Kind::Other;
+    }
+  }
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "Shared tensors require lock-free 64-bit atomics");
+
+/**
+ * @class SharedTensor
+ * @brief Tensor stored in POSIX shared memory
+ *
+ * @tparam T Trivially copyable type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * The segment holds a SharedTensorHeader followed by the elements, so a
+ * tensor created in one process is opened by handle() in another and
+ * accessed without copies through view(). Named segments come from
+ * shm_open(); anonymous ones from memfd_create(), whose handle is the
+ * /proc path of the creator's descriptor.
+ *
+ * The header's version is a sequence lock shared by all processes, the
+ * cross-process counterpart of Tensor's iterator version: write() makes
+ * it odd for the duration of an update, and read() retries until it
+ * observed an even, unchanged version, so readers never see a torn
+ * tensor. Direct access through storage() or view() bypasses it.
+ */
+template<typename T, std::size_t Rank>
+class SharedTensor
+{
+  static_assert(std::is_trivially_copyable_v<T>,
+                "Shared tensors store trivially copyable types only");
+  static_assert(Rank > 0 && Rank <= SharedTensorHeader::k_MaxRank,
+                "Unsupported rank of a shared tensor");
+
+public:
+  SharedTensor() = delete;
+
+  /**
+   * @brief Creates a named segment
+   *
+   * @param p_Name Name for shm_open(), starting with '/'
+   * @param p_Dimensions Array of dimensions
+   *
+   * @details
+   * Fails if the name exists. The name is unlinked when the creating
+   * object is destroyed; processes that already opened it keep access.
+   */
+  static SharedTensor create(const std::string& p_Name,
+                             std::array<std::size_t, Rank> p_Dimensions)
+  {
+    const int _fd = shm_open(p_Name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (_fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "shm_open");
+    }
+    try {
+      return SharedTensor(_fd, p_Name, p_Name, p_Dimensions);
+    } catch (...) {
+      shm_unlink(p_Name.c_str());
+      throw;
+    }
+  }
+
+#if defined(__linux__)
+  /**
+   * @brief Creates an anonymous segment backed by memfd_create()
+   *
+   * @param p_Dimensions Array of dimensions
+   *
+   * @details
+   * Lives while any process has it open or mapped; reachable by other
+   * processes of the same user through handle() while the creator lives.
+   */
+  static SharedTensor create_anonymous(std::array<std::size_t, Rank> p_Dimensions)
+  {
+    const int _fd = memfd_create("tensore", MFD_CLOEXEC);
+    if (_fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "memfd_create");
+    }
+    const std::string _handle = "/proc/" + std::to_string(getpid()) + "/fd/" +
+                                std::to_string(_fd);
+    return SharedTensor(_fd, _handle, std::string(), p_Dimensions);
+  }
+#endif
+
+  /**
+   * @brief Opens a segment created by another process
+   *
+   * @param p_Handle Handle returned by the creator's handle()
+   *
+   * @details
+   * Throws std::runtime_error if element type or rank do not match.
+   */
+  static SharedTensor open(const std::string& p_Handle)
+  {
+    const bool _path = p_Handle.rfind("/proc/", 0) == 0;
+    const int _fd = _path ? ::open(p_Handle.c_str(), O_RDWR | O_CLOEXEC)
+                          : shm_open(p_Handle.c_str(), O_RDWR, 0600);
+    if (_fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "open");
+    }
+    return SharedTensor(_fd, p_Handle);
+  }
+
+  SharedTensor(const SharedTensor&) = delete;
+  SharedTensor& operator=(const SharedTensor&) = delete;
+
+  SharedTensor(SharedTensor&& p_Other) noexcept
+    : m_Fd(std::exchange(p_Other.m_Fd, -1))
+    , m_Bytes(std::exchange(p_Other.m_Bytes, 0))
+    , m_Header(std::exchange(p_Other.m_Header, nullptr))
+    , m_Data(std::exchange(p_Other.m_Data, nullptr))
+    , m_DimensionsData(p_Other.m_DimensionsData)
+    , m_Size(p_Other.m_Size)
+    , m_Handle(std::move(p_Other.m_Handle))
+    , m_Unlink(std::move(p_Other.m_Unlink))
+  {
+    p_Other.m_Unlink.clear();
+  }
+
+  SharedTensor& operator=(SharedTensor&& p_Other) noexcept
+  {
+    if (this != &p_Other) {
+      release();
+      m_Fd = std::exchange(p_Other.m_Fd, -1);
+      m_Bytes = std::exchange(p_Other.m_Bytes, 0);
+      m_Header = std::exchange(p_Other.m_Header, nullptr);
+      m_Data = std::exchange(p_Other.m_Data, nullptr);
+      m_DimensionsData = p_Other.m_DimensionsData;
+      m_Size = p_Other.m_Size;
+      m_Handle = std::move(p_Other.m_Handle);
+      m_Unlink = std::move(p_Other.m_Unlink);
+      p_Other.m_Unlink.clear();
+    }
+    return *this;
+  }
+
+  ~SharedTensor() { release(); }
+
+  /**
+   * @brief Handle another process passes to open()
+   */
+  const std::string& handle() const noexcept { return m_Handle; }
+
+  std::size_t size() const noexcept { return m_Size; }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_DimensionsData;
+  }
+
+  T* storage() noexcept { return m_Data; }
+
+  const T* storage() const noexcept { return m_Data; }
+
+  /**
+   * @brief Zero-copy view of the shared elements
+   */
+  TensorView<T, Rank> view() noexcept
+  {
+    return TensorView<T, Rank>(
+      m_Data, m_DimensionsData, dense_strides(m_DimensionsData));
+  }
+
+  TensorView<const T, Rank> view() const noexcept
+  {
+    return TensorView<const T, Rank>(
+      m_Data, m_DimensionsData, dense_strides(m_DimensionsData));
+  }
+
+  /**
+   * @brief Current value of the sequence lock, odd during a write
+   */
+  std::uint64_t version() const noexcept
+  {
+    return m_Header->m_Version.load(std::memory_order_acquire);
+  }
+
+  /**
+   * @brief Updates the tensor under the sequence lock
+   *
+   * @param p_Fn Callable invoked with a TensorView<T, Rank>
+   *
+   * @details
+   * Writers in all processes are serialized by the lock itself.
+   */
+  template<typename F>
+  void write(F&& p_Fn)
+  {
+    auto& _version = m_Header->m_Version;
+    std::uint64_t _current = _version.load(std::memory_order_relaxed);
+    for (;;) {
+      if ((_current & 1) == 0 &&
+          _version.compare_exchange_weak(
+            _current, _current + 1, std::memory_order_acquire)) {
+        break;
+      }
+      std::this_thread::yield();
+      _current = _version.load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    try {
+      p_Fn(view());
+    } catch (...) {
+      _version.store(_current + 2, std::memory_order_release);
+      throw;
+    }
+    _version.store(_current + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Reads a consistent state of the tensor
+   *
+   * @param p_Fn Callable invoked with a TensorView<const T, Rank>;
+   * may be invoked several times and must only copy data out
+   *
+   * @return Version the successful read observed
+   */
+  template<typename F>
+  std::uint64_t read(F&& p_Fn) const
+  {
+    const auto& _version = m_Header->m_Version;
+    for (;;) {
+      const std::uint64_t _before = _version.load(std::memory_order_acquire);
+      if (_before & 1) {
+        std::this_thread::yield();
+        continue;
+      }
+      p_Fn(view());
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (_version.load(std::memory_order_relaxed) == _before) {
+        return _before;
+      }
+    }
+  }
+
+  /**
+   * @brief Consistent copy of the tensor
+   */
+  Tensor<T, Rank> snapshot() const
+  {
+    std::array<std::size_t, Rank> _dims = m_DimensionsData;
+    Tensor<T, Rank> _retval(std::move(_dims));
+    read([&](TensorView<const T, Rank> p_View) {
+      std::memcpy(_retval.storage(), p_View.storage(), m_Size * sizeof(T));
+    });
+    return _retval;
+  }
+
+private:
+  static std::size_t data_offset() noexcept
+  {
+    return (sizeof(SharedTensorHeader) + 63) / 64 * 64;
+  }
+
+  /**
+   * @brief Initializes a freshly created segment
+   */
+  SharedTensor(int p_Fd,
+               std::string p_Handle,
+               std::string p_Unlink,
+               const std::array<std::size_t, Rank>& p_Dimensions)
+    : m_Fd(p_Fd)
+    , m_DimensionsData(p_Dimensions)
+    , m_Handle(std::move(p_Handle))
+    , m_Unlink(std::move(p_Unlink))
+  {
+    m_Size = 1;
+    for (const auto& it : m_DimensionsData) {
+      m_Size *= it;
+    }
+    m_Bytes = data_offset() + m_Size * sizeof(T);
+    if (ftruncate(m_Fd, static_cast<off_t>(m_Bytes)) != 0) {
+      const int _error = errno;
+      ::close(m_Fd);
+      throw std::system_error(_error, std::generic_category(), "ftruncate");
+    }
+    map();
+    auto* _header = new (m_Header) SharedTensorHeader{};
+    _header->m_ElementSize = sizeof(T);
+    _header->m_Kind = SharedTensorHeader::kind_of<T>();
+    _header->m_Rank = Rank;
+    for (std::size_t i = 0; i < Rank; ++i) {
+      _header->m_Dimensions[i] = m_DimensionsData[i];
+    }
+    _header->m_DataOffset = data_offset();
+    _header->m_Version.store(0, std::memory_order_relaxed);
+    std::atomic_ref<std::uint64_t>(_header->m_Magic)
+      .store(SharedTensorHeader::k_Magic, std::memory_order_release);
+  }
+
+  /**
+   * @brief Attaches to an existing segment
+   */
+  SharedTensor(int p_Fd, std::string p_Handle)
+    : m_Fd(p_Fd)
+    , m_Handle(std::move(p_Handle))
+  {
+    struct stat _stat;
+    if (fstat(m_Fd, &_stat) != 0 ||
+        static_cast<std::size_t>(_stat.st_size) < sizeof(SharedTensorHeader)) {
+      ::close(m_Fd);
+      throw std::runtime_error("Shared segment is not a tensor");
+    }
+    m_Bytes = static_cast<std::size_t>(_stat.st_size);
+    map();
+    const SharedTensorHeader& _header = *m_Header;
+    std::string _error;
+    if (std::atomic_ref<std::uint64_t>(m_Header->m_Magic)
+          .load(std::memory_order_acquire) != SharedTensorHeader::k_Magic) {
+      _error = "Shared segment is not a tensor";
+    } else if (_header.m_ElementSize != sizeof(T) ||
+               _header.m_Kind != SharedTensorHeader::kind_of<T>()) {
+      _error = "Element type of a shared tensor does not match";
+    } else if (_header.m_Rank != Rank) {
+      _error = "Rank of a shared tensor does not match";
+    }
+    if (_error.empty()) {
+      m_Size = 1;
+      for (std::size_t i = 0; i < Rank; ++i) {
+        m_DimensionsData[i] = _header.m_Dimensions[i];
+        m_Size *= m_DimensionsData[i];
+      }
+      if (_header.m_DataOffset + m_Size * sizeof(T) > m_Bytes) {
+        _error = "Shared segment is smaller than its header claims";
+      }
+    }
+    if (!_error.empty()) {
+      release();
+      throw std::runtime_error(_error);
+    }
+    m_Data = reinterpret_cast<T*>(reinterpret_cast<std::byte*>(m_Header) +
+                                  _header.m_DataOffset);
+  }
+
+  void map()
+  {
+    void* _ptr = mmap(nullptr, m_Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, m_Fd, 0);
+    if (_ptr == MAP_FAILED) {
+      const int _error = errno;
+      ::close(m_Fd);
+      m_Fd = -1;
+      throw std::system_error(_error, std::generic_category(), "mmap");
+    }
+    m_Header = static_cast<SharedTensorHeader*>(_ptr);
+    m_Data = reinterpret_cast<T*>(static_cast<std::byte*>(_ptr) + data_offset());
+  }
+
+  void release() noexcept
+  {
+    if (m_Header) {
+      munmap(m_Header, m_Bytes);
+      m_Header = nullptr;
+      m_Data = nullptr;
+    }
+    if (m_Fd >= 0) {
+      ::close(m_Fd);
+      m_Fd = -1;
+    }
+    if (!m_Unlink.empty()) {
+      shm_unlink(m_Unlink.c_str());
+      m_Unlink.clear();
+    }
+  }
+
+  int m_Fd = -1;
+  std::size_t m_Bytes = 0;
+  SharedTensorHeader* m_Header = nullptr;
+  T* m_Data = nullptr;
+  std::array<std::size_t, Rank> m_DimensionsData{};
+  std::size_t m_Size = 0;
+  std::string m_Handle;
+  std::string m_Unlink;
+};
+
+}
@@ -0,0 +1,388 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Layout.hpp"
+#include "TensorView.hpp"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @class SmallTensor
+ * @brief Tensor with inline storage for a small amount of elements
+ *
+ * @tparam T The type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ * @tparam Capacity Amount of elements stored inside the object
+ * @tparam A The type of allocator used above the inline capacity
+ *
+ * @details
+ * Shares Tensor's element access and iteration API. Tensors of at most
+ * `Capacity` elements live entirely inside the object; larger ones fall
+ * back to a heap buffer. SmallTensor carries no mutex and no iterator
+ * versioning, iterators are plain pointers: it is meant for many tiny,
+ * thread-confined values, where those costs dominate.
+ */
+template<typename T,
+         std::size_t Rank,
+         std::size_t Capacity = 16,
+         Allocator A = std::allocator<T>>
+class SmallTensor
+{
+  static_assert(Capacity > 0, "Inline capacity of a small tensor must be positive");
+
+public:
+  using Iterator = T*;
+  using ConstIterator = const T*;
+  using ReverseIterator = std::reverse_iterator<Iterator>;
+  using ConstReverseIterator = std::reverse_iterator<ConstIterator>;
+
+  SmallTensor() = delete;
+
+  /**
+   * @brief A template constructor for initializer list
+   *
+   * @tparam p_Dimensions Dimensions of a tensor,
+   * amount of dimesnions provided must be equal to Rank
+   */
+  template<std::size_t... p_Dimensions>
+  SmallTensor()
+    : SmallTensor(std::array<std::size_t, Rank>{ { p_Dimensions... } })
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Misaligned dimensions of tensor in a constructor");
+  }
+
+  /**
+   * @brief A constructor with an rvalue array
+   *
+   * @param p_Dimensions Array of dimensions
+   */
+  SmallTensor(std::array<std::size_t, Rank>&& p_Dimensions)
+    : m_DimensionsData(std::move(p_Dimensions))
+  {
+    m_Size = 1;
+    for (const auto& it : m_DimensionsData) {
+      m_Size *= it;
+    }
+    construct([this] { std::uninitialized_value_construct_n(m_Data, m_Size); });
+  }
+
+  /**
+   * @brief Constructor copying a Tensor
+   *
+   * @param p_Tensor Tensor to be copied from
+   */
+  template<Allocator B>
+  explicit SmallTensor(const Tensor<T, Rank, B>& p_Tensor)
+    : m_DimensionsData(p_Tensor.dimensions())
+    , m_Size(p_Tensor.size())
+  {
+    construct([&] { std::uninitialized_copy_n(p_Tensor.storage(), m_Size, m_Data); });
+  }
+
+  /**
+   * @brief Copy contructor
+   *
+   * @param p_Other Tensor to be copied from
+   */
+  SmallTensor(const SmallTensor& p_Other)
+    : m_DimensionsData(p_Other.m_DimensionsData)
+    , m_Size(p_Other.m_Size)
+  {
+    construct([&] { std::uninitialized_copy_n(p_Other.m_Data, m_Size, m_Data); });
+  }
+
+  /**
+   * @brief Move contructor
+   *
+   * @details
+   * Steals the heap buffer, or moves elements one by one when inline.
+   *
+   * @param p_Other Tensor to be moved from
+   */
+  SmallTensor(SmallTensor&& p_Other) noexcept(
+    std::is_nothrow_move_constructible_v<T>)
+    : m_DimensionsData(p_Other.m_DimensionsData)
+    , m_Size(p_Other.m_Size)
+  {
+    steal(p_Other);
+  }
+
+  /**
+   * @brief Copy assign operator
+   *
+   * @param p_Other Tensor to be copied from
+   */
+  SmallTensor& operator=(const SmallTensor& p_Other)
+  {
+    if (this != &p_Other) {
+      SmallTensor _copy(p_Other);
+      release();
+      m_DimensionsData = _copy.m_DimensionsData;
+      m_Size = _copy.m_Size;
+      steal(_copy);
+    }
+    return *this;
+  }
+
+  /**
+   * @brief Move assign operator
+   *
+   * @param p_Other Tensor to be moved from
+   */
+  SmallTensor& operator=(SmallTensor&& p_Other) noexcept(
+    std::is_nothrow_move_constructible_v<T>)
+  {
+    if (this != &p_Other) {
+      release();
+      m_DimensionsData = p_Other.m_DimensionsData;
+      m_Size = p_Other.m_Size;
+      steal(p_Other);
+    }
+    return *this;
+  }
+
+  ~SmallTensor() { release(); }
+
+  /**
+   * @brief Whether elements are stored inside the object
+   */
+  bool is_inline() const noexcept { return m_Data == inline_data(); }
+
+  static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+  std::size_t size() const noexcept { return m_Size; }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_DimensionsData;
+  }
+
+  std::vector<T> data() const { return std::vector<T>(begin(), end()); }
+
+  T* storage() noexcept { return m_Data; }
+
+  const T* storage() const noexcept { return m_Data; }
+
+  /**
+   * @brief Element access operator
+   *
+   * @param N Global index to access
+   *
+   * @return Element at index
+   */
+  T& operator[](std::size_t N)
+  {
+    if (N >= size()) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+    return m_Data[N];
+  }
+
+  const T& operator[](std::size_t N) const
+  {
+    if (N >= size()) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+    return m_Data[N];
+  }
+
+  /**
+   * @brief Element access with calculated index
+   *
+   * @param p_Dims Dimension coordinates to access.
+   *
+   * @return Element at calculated index
+   */
+  T& at(const std::array<std::size_t, Rank>& p_Dims)
+  {
+    return m_Data[calculateIndex(p_Dims)];
+  }
+
+  const T& at(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return m_Data[calculateIndex(p_Dims)];
+  }
+
+  template<std::size_t... p_Dimensions>
+  T& operator()()
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Misaligned dimensions in tensor's `()` operator");
+    return at({ { p_Dimensions... } });
+  }
+
+  template<std::size_t... p_Dimensions>
+  const T& operator()() const
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Misaligned dimensions in tensor's `()` operator");
+    return at({ { p_Dimensions... } });
+  }
+
+  T& operator()(const std::array<std::size_t, Rank>& p_Dims) { return at(p_Dims); }
+
+  const T& operator()(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return at(p_Dims);
+  }
+
+  Iterator begin() noexcept { return m_Data; }
+  ConstIterator begin() const noexcept { return m_Data; }
+  Iterator end() noexcept { return m_Data + m_Size; }
+  ConstIterator end() const noexcept { return m_Data + m_Size; }
+  ConstIterator cbegin() const noexcept { return m_Data; }
+  ConstIterator cend() const noexcept { return m_Data + m_Size; }
+  ReverseIterator rbegin() noexcept { return ReverseIterator(end()); }
+  ConstReverseIterator rbegin() const noexcept { return ConstReverseIterator(end()); }
+  ReverseIterator rend() noexcept { return ReverseIterator(begin()); }
+  ConstReverseIterator rend() const noexcept { return ConstReverseIterator(begin()); }
+  ConstReverseIterator crbegin() const noexcept { return rbegin(); }
+  ConstReverseIterator crend() const noexcept { return rend(); }
+
+  operator TensorView<T, Rank>() noexcept
+  {
+    return TensorView<T, Rank>(
+      m_Data, m_DimensionsData, dense_strides(m_DimensionsData));
+  }
+
+  operator TensorView<const T, Rank>() const noexcept
+  {
+    return TensorView<const T, Rank>(
+      m_Data, m_DimensionsData, dense_strides(m_DimensionsData));
+  }
+
+  /**
+   * @brief Copy into a heap-backed Tensor
+   */
+  Tensor<T, Rank> to_tensor() const
+  {
+    std::array<std::size_t, Rank> _dims = m_DimensionsData;
+    Tensor<T, Rank> _retval(std::move(_dims));
+    std::copy_n(m_Data, m_Size, _retval.storage());
+    return _retval;
+  }
+
+private:
+  using traits = std::allocator_traits<A>;
+
+  T* inline_data() noexcept { return std::launder(reinterpret_cast<T*>(m_Inline)); }
+
+  const T* inline_data() const noexcept
+  {
+    return std::launder(reinterpret_cast<const T*>(m_Inline));
+  }
+
+  /**
+   * @brief Acquires storage and constructs elements into it
+   *
+   * @details
+   * The uninitialized algorithms destroy what they built when an element
+   * throws; the heap buffer is returned here before rethrowing.
+   */
+  template<typename F>
+  void construct(F&& p_Construct)
+  {
+    m_Data = m_Size <= Capacity ? inline_data() : traits::allocate(m_Allocator, m_Size);
+    try {
+      p_Construct();
+    } catch (...) {
+      if (!is_inline()) {
+        traits::deallocate(m_Allocator, m_Data, m_Size);
+      }
+      m_Data = inline_data();
+      m_Size = 0;
+      throw;
+    }
+  }
+
+  void release() noexcept
+  {
+    std::destroy_n(m_Data, m_Size);
+    if (!is_inline()) {
+      traits::deallocate(m_Allocator, m_Data, m_Size);
+    }
+    m_Data = inline_data();
+    m_Size = 0;
+  }
+
+  /**
+   * @brief Takes over the elements of another tensor, leaving it empty
+   *
+   * @details
+   * m_DimensionsData and m_Size must already be copied from p_Other.
+   */
+  void steal(SmallTensor& p_Other) noexcept(std::is_nothrow_move_constructible_v<T>)
+  {
+    if (p_Other.is_inline()) {
+      m_Data = inline_data();
+      std::uninitialized_move_n(p_Other.m_Data, m_Size, m_Data);
+      std::destroy_n(p_Other.m_Data, p_Other.m_Size);
+    } else {
+      m_Data = p_Other.m_Data;
+    }
+    p_Other.m_Data = p_Other.inline_data();
+    p_Other.m_Size = 0;
+    p_Other.m_DimensionsData.fill(0);
+  }
+
+  std::size_t calculateIndex(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return detail::checked_index(p_Dims, m_DimensionsData);
+  }
+
+  std::array<std::size_t, Rank> m_DimensionsData{};
+  std::size_t m_Size = 0;
+  T* m_Data = nullptr;
+  [[no_unique_address]] A m_Allocator;
+  alignas(T) std::byte m_Inline[Capacity * sizeof(T)];
+};
+
+/**
+ * @brief View over a whole small tensor
+ */
+template<typename T, std::size_t Rank, std::size_t Capacity, Allocator A>
+TensorView<T, Rank>
+as_view(SmallTensor<T, Rank, Capacity, A>& p_Tensor) noexcept
+{
+  return TensorView<T, Rank>(p_Tensor);
+}
+
+/**
+ * @brief Read-only view over a whole small tensor
+ */
+template<typename T, std::size_t Rank, std::size_t Capacity, Allocator A>
+TensorView<const T, Rank>
+as_view(const SmallTensor<T, Rank, Capacity, A>& p_Tensor) noexcept
+{
+  return TensorView<const T, Rank>(p_Tensor);
+}
+
+template<typename T, std::size_t Rank, std::size_t Capacity, Allocator A>
+void as_view(const SmallTensor<T, Rank, Capacity, A>&&) = delete;
+
+}
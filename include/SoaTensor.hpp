@@ -0,0 +1,565 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "Layout.hpp"
+#include "TensorView.hpp"
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace TenSore {
+
+namespace detail {
+
+/**
+ * @brief Placeholder convertible to any member type, used in unevaluated
+ * aggregate initialization only
+ */
+struct AnyField
+{
+  template<typename U>
+  operator U() const;
+};
+
+template<typename T, std::size_t... I>
+constexpr bool
+brace_constructible(std::index_sequence<I...>)
+{
+  return requires { T{ (static_cast<void>(I), AnyField{})... }; };
+}
+
+/**
+ * @brief Amount of members of an aggregate, up to 8
+ */
+template<typename T, std::size_t N = 8>
+constexpr std::size_t
+aggregate_arity()
+{
+  if constexpr (N == 0 || brace_constructible<T>(std::make_index_sequence<N>{})) {
+    return N;
+  } else {
+    return aggregate_arity<T, N - 1>();
+  }
+}
+
+/**
+ * @brief Tuple of references to the members of an aggregate
+ */
+template<std::size_t N, typename U>
+constexpr auto
+tie_members(U& p_Value)
+{
+  if constexpr (N == 1) {
+    auto& [a] = p_Value;
+    return std::tie(a);
+  } else if constexpr (N == 2) {
+    auto& [a, b] = p_Value;
+    return std::tie(a, b);
+  } else if constexpr (N == 3) {
+    auto& [a, b, c] = p_Value;
+    return std::tie(a, b, c);
+  } else if constexpr (N == 4) {
+    auto& [a, b, c, d] = p_Value;
+    return std::tie(a, b, c, d);
+  } else if constexpr (N == 5) {
+    auto& [a, b, c, d, e] = p_Value;
+    return std::tie(a, b, c, d, e);
+  } else if constexpr (N == 6) {
+    auto& [a, b, c, d, e, f] = p_Value;
+    return std::tie(a, b, c, d, e, f);
+  } else if constexpr (N == 7) {
+    auto& [a, b, c, d, e, f, g] = p_Value;
+    return std::tie(a, b, c, d, e, f, g);
+  } else {
+    static_assert(N == 8, "Aggregates of up to 8 members are supported");
+    auto& [a, b, c, d, e, f, g, h] = p_Value;
+    return std::tie(a, b, c, d, e, f, g, h);
+  }
+}
+
+template<typename Tuple>
+struct DecayTuple;
+
+template<typename... F>
+struct DecayTuple<std::tuple<F...>>
+{
+  using type = std::tuple<std::remove_cvref_t<F>...>;
+};
+
+}
+
+/**
+ * @brief Decomposition of an element type into its members
+ *
+ * @details
+ * The primary template handles aggregates of up to 8 non-static data
+ * members, detected through structured bindings. Other types may provide
+ * a specialization with the same members: `count`, `Fields` (a std::tuple
+ * of member types), `tie(T&)`, `tie(const T&)` and `make(F...)`.
+ */
+template<typename T>
+struct SoaTraits
+{
+  static_assert(std::is_aggregate_v<T>,
+                "Structure-of-arrays storage requires an aggregate type or "
+                "a SoaTraits specialization");
+
+  static constexpr std::size_t count = detail::aggregate_arity<T>();
+
+  static auto tie(T& p_Value) { return detail::tie_members<count>(p_Value); }
+
+  static auto tie(const T& p_Value)
+  {
+    return detail::tie_members<count>(p_Value);
+  }
+
+  using Fields = typename detail::DecayTuple<
+    decltype(detail::tie_members<count>(std::declval<T&>()))>::type;
+
+  template<typename... F>
+  static T make(F&&... p_Fields)
+  {
+    return T{ std::forward<F>(p_Fields)... };
+  }
+};
+
+/**
+ * @class SoaTensor
+ * @brief Tensor of composite elements stored as a structure of arrays
+ *
+ * @tparam T Aggregate element type
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ *
+ * @details
+ * Every member of T is kept in its own plane, an ordinary
+ * Tensor<Member, Rank> of the same dimensions, so kernels touching one
+ * member read only that member's memory. Element access goes through
+ * proxy references that gather a T on read and scatter it on assignment;
+ * individual members are reached through Reference::get<I>() without
+ * touching the other planes.
+ */
+template<typename T, std::size_t Rank>
+class SoaTensor
+{
+  using Traits = SoaTraits<T>;
+  using Fields = typename Traits::Fields;
+
+  template<typename Tuple>
+  struct PlanesOf;
+
+  template<typename... F>
+  struct PlanesOf<std::tuple<F...>>
+  {
+    using type = std::tuple<Tensor<F, Rank>...>;
+  };
+
+  using Planes = typename PlanesOf<Fields>::type;
+
+  static constexpr auto s_Indices = std::make_index_sequence<Traits::count>{};
+
+public:
+  /**
+   * @brief Amount of member planes
+   */
+  static constexpr std::size_t field_count = Traits::count;
+
+  template<std::size_t I>
+  using FieldType = std::tuple_element_t<I, Fields>;
+
+  /**
+   * @class BasicReference
+   * @brief Proxy to one element of a structure-of-arrays tensor
+   */
+  template<bool Const>
+  class BasicReference
+  {
+    using PlanesPtr = std::conditional_t<Const, const Planes*, Planes*>;
+
+  public:
+    BasicReference(PlanesPtr p_Planes, std::size_t p_Index) noexcept
+      : m_Planes(p_Planes)
+      , m_Index(p_Index)
+    {
+    }
+
+    BasicReference(const BasicReference&) = default;
+
+    /**
+     * @brief Reference to a single member of the element
+     *
+     * @tparam I Index of the member
+     */
+    template<std::size_t I>
+    auto& get() const noexcept
+    {
+      return std::get<I>(*m_Planes).storage()[m_Index];
+    }
+
+    /**
+     * @brief Gathers the element from all planes
+     */
+    operator T() const { return load(s_Indices); }
+
+    /**
+     * @brief Scatters a value into all planes
+     */
+    const BasicReference& operator=(const T& p_Value) const
+      requires(!Const)
+    {
+      store(Traits::tie(p_Value), s_Indices);
+      return *this;
+    }
+
+    /**
+     * @brief Assigns the referenced value, not the reference
+     */
+    const BasicReference& operator=(const BasicReference& p_Other) const
+      requires(!Const)
+    {
+      return *this = static_cast<T>(p_Other);
+    }
+
+    friend void swap(const BasicReference& a, const BasicReference& b)
+      requires(!Const)
+    {
+      T _tmp = a;
+      a = static_cast<T>(b);
+      b = _tmp;
+    }
+
+  private:
+    template<std::size_t... I>
+    T load(std::index_sequence<I...>) const
+    {
+      return Traits::make(get<I>()...);
+    }
+
+    template<typename Tied, std::size_t... I>
+    void store(const Tied& p_Tied, std::index_sequence<I...>) const
+    {
+      ((get<I>() = std::get<I>(p_Tied)), ...);
+    }
+
+    PlanesPtr m_Planes;
+    std::size_t m_Index;
+  };
+
+  using Reference = BasicReference<false>;
+  using ConstReference = BasicReference<true>;
+
+  /**
+   * @class BasicIterator
+   * @brief Random access iterator yielding proxy references
+   */
+  template<bool Const>
+  class BasicIterator
+  {
+    using PlanesPtr = std::conditional_t<Const, const Planes*, Planes*>;
+
+  public:
+    using iterator_concept = std::random_access_iterator_tag;
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using reference = BasicReference<Const>;
+
+    BasicIterator() = default;
+
+    BasicIterator(PlanesPtr p_Planes, std::size_t p_Index) noexcept
+      : m_Planes(p_Planes)
+      , m_Index(p_Index)
+    {
+    }
+
+    operator BasicIterator<true>() const noexcept
+      requires(!Const)
+    {
+      return BasicIterator<true>(m_Planes, m_Index);
+    }
+
+    reference operator*() const noexcept { return reference(m_Planes, m_Index); }
+
+    reference operator[](difference_type n) const noexcept
+    {
+      return reference(m_Planes, m_Index + n);
+    }
+
+    BasicIterator& operator++() noexcept
+    {
+      ++m_Index;
+      return *this;
+    }
+
+    BasicIterator operator++(int) noexcept
+    {
+      BasicIterator _tmp = *this;
+      ++m_Index;
+      return _tmp;
+    }
+
+    BasicIterator& operator--() noexcept
+    {
+      --m_Index;
+      return *this;
+    }
+
+    BasicIterator operator--(int) noexcept
+    {
+      BasicIterator _tmp = *this;
+      --m_Index;
+      return _tmp;
+    }
+
+    BasicIterator& operator+=(difference_type n) noexcept
+    {
+      m_Index += n;
+      return *this;
+    }
+
+    BasicIterator& operator-=(difference_type n) noexcept
+    {
+      m_Index -= n;
+      return *this;
+    }
+
+    friend BasicIterator operator+(BasicIterator it, difference_type n) noexcept
+    {
+      return it += n;
+    }
+
+    friend BasicIterator operator+(difference_type n, BasicIterator it) noexcept
+    {
+      return it += n;
+    }
+
+    friend BasicIterator operator-(BasicIterator it, difference_type n) noexcept
+    {
+      return it -= n;
+    }
+
+    friend difference_type operator-(const BasicIterator& a,
+                                     const BasicIterator& b) noexcept
+    {
+      return static_cast<difference_type>(a.m_Index) -
+             static_cast<difference_type>(b.m_Index);
+    }
+
+    friend bool operator==(const BasicIterator& a,
+                           const BasicIterator& b) noexcept
+    {
+      return a.m_Index == b.m_Index;
+    }
+
+    friend auto operator<=>(const BasicIterator& a,
+                            const BasicIterator& b) noexcept
+    {
+      return a.m_Index <=> b.m_Index;
+    }
+
+  private:
+    PlanesPtr m_Planes = nullptr;
+    std::size_t m_Index = 0;
+  };
+
+  using Iterator = BasicIterator<false>;
+  using ConstIterator = BasicIterator<true>;
+
+  SoaTensor() = delete;
+
+  /**
+   * @brief A template constructor for initializer list
+   *
+   * @tparam p_Dimensions Dimensions of a tensor,
+   * amount of dimesnions provided must be equal to Rank
+   */
+  template<std::size_t... p_Dimensions>
+  SoaTensor()
+    : SoaTensor(std::array<std::size_t, Rank>{ { p_Dimensions... } })
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Misaligned dimensions of tensor in a constructor");
+  }
+
+  /**
+   * @brief A constructor with an rvalue array
+   *
+   * @param p_Dimensions Array of dimensions
+   */
+  SoaTensor(std::array<std::size_t, Rank>&& p_Dimensions)
+    : m_Planes(make_planes(p_Dimensions, s_Indices))
+  {
+  }
+
+  /**
+   * @brief Converts an array-of-structs tensor
+   *
+   * @param p_Tensor Tensor to be copied from
+   */
+  template<Allocator A>
+  explicit SoaTensor(const Tensor<T, Rank, A>& p_Tensor)
+    : SoaTensor(std::array<std::size_t, Rank>(p_Tensor.dimensions()))
+  {
+    const T* _src = p_Tensor.storage();
+    for (std::size_t i = 0; i < size(); ++i) {
+      (*this)[i] = _src[i];
+    }
+  }
+
+  std::size_t size() const noexcept { return std::get<0>(m_Planes).size(); }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return std::get<0>(m_Planes).dimensions();
+  }
+
+  /**
+   * @brief Plane holding one member of every element
+   *
+   * @tparam I Index of the member
+   *
+   * @return Tensor of that member
+   */
+  template<std::size_t I>
+  Tensor<FieldType<I>, Rank>& plane() noexcept
+  {
+    return std::get<I>(m_Planes);
+  }
+
+  template<std::size_t I>
+  const Tensor<FieldType<I>, Rank>& plane() const noexcept
+  {
+    return std::get<I>(m_Planes);
+  }
+
+  /**
+   * @brief Element access operator
+   *
+   * @param N Global index to access
+   *
+   * @return Proxy to the element at index
+   */
+  Reference operator[](std::size_t N)
+  {
+    if (N >= size()) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+    return Reference(&m_Planes, N);
+  }
+
+  ConstReference operator[](std::size_t N) const
+  {
+    if (N >= size()) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+    return ConstReference(&m_Planes, N);
+  }
+
+  /**
+   * @brief Element access with calculated index
+   *
+   * @param p_Dims Dimension coordinates to access.
+   *
+   * @return Proxy to the element at calculated index
+   */
+  Reference at(const std::array<std::size_t, Rank>& p_Dims)
+  {
+    return Reference(&m_Planes, calculateIndex(p_Dims));
+  }
+
+  ConstReference at(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return ConstReference(&m_Planes, calculateIndex(p_Dims));
+  }
+
+  template<std::size_t... p_Dimensions>
+  Reference operator()()
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Misaligned dimensions in tensor's `()` operator");
+    return at({ { p_Dimensions... } });
+  }
+
+  template<std::size_t... p_Dimensions>
+  ConstReference operator()() const
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Misaligned dimensions in tensor's `()` operator");
+    return at({ { p_Dimensions... } });
+  }
+
+  Reference operator()(const std::array<std::size_t, Rank>& p_Dims)
+  {
+    return at(p_Dims);
+  }
+
+  ConstReference operator()(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return at(p_Dims);
+  }
+
+  Iterator begin() noexcept { return Iterator(&m_Planes, 0); }
+  ConstIterator begin() const noexcept { return ConstIterator(&m_Planes, 0); }
+  Iterator end() noexcept { return Iterator(&m_Planes, size()); }
+  ConstIterator end() const noexcept { return ConstIterator(&m_Planes, size()); }
+  ConstIterator cbegin() const noexcept { return begin(); }
+  ConstIterator cend() const noexcept { return end(); }
+
+  /**
+   * @brief Gathers all elements into a vector
+   */
+  std::vector<T> data() const { return std::vector<T>(begin(), end()); }
+
+  /**
+   * @brief Converts back into an array-of-structs tensor
+   */
+  Tensor<T, Rank> to_tensor() const
+  {
+    std::array<std::size_t, Rank> _dims = dimensions();
+    Tensor<T, Rank> _retval(std::move(_dims));
+    T* _dst = _retval.storage();
+    for (std::size_t i = 0; i < size(); ++i) {
+      _dst[i] = (*this)[i];
+    }
+    return _retval;
+  }
+
+private:
+  template<std::size_t... I>
+  static Planes make_planes(const std::array<std::size_t, Rank>& p_Dimensions,
+                            std::index_sequence<I...>)
+  {
+    return Planes(Tensor<FieldType<I>, Rank>(
+      std::array<std::size_t, Rank>(p_Dimensions))...);
+  }
+
+  std::size_t calculateIndex(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return detail::checked_index(p_Dims, dimensions());
+  }
+
+  Planes m_Planes;
+};
+
+}
@@ -50,6 +50,8 @@ class Tensor
 public:
   class Iterator;
   class ConstIterator;
+  using ReverseIterator = std::reverse_iterator<Iterator>;
+  using ConstReverseIterator = std::reverse_iterator<ConstIterator>;
 
   Tensor() = delete;
 
@@ -90,8 +92,10 @@ public:
    */
   Tensor(const Tensor& p_Other)
   {
+    std::shared_lock<std::shared_mutex> lock(p_Other.mutex());
     m_DimensionsData = p_Other.m_DimensionsData;
     m_Data = p_Other.m_Data;
+    m_Size = p_Other.m_Size;
   }
 
   /**
@@ -103,6 +107,7 @@ public:
   {
     m_DimensionsData = std::move(p_Other.m_DimensionsData);
     m_Data = std::move(p_Other.m_Data);
+    m_Size = std::exchange(p_Other.m_Size, 0);
   }
 
   /**
@@ -115,6 +120,8 @@ public:
     std::shared_lock<std::shared_mutex> lock(p_Other.mutex());
     m_DimensionsData = p_Other.m_DimensionsData;
     m_Data = p_Other.m_Data;
+    m_Size = p_Other.m_Size;
+    invalidate_iterators();
     return *this;
   }
 
@@ -128,6 +135,8 @@ public:
     std::shared_lock<std::shared_mutex> lock(p_Other.mutex());
     m_DimensionsData = std::move(p_Other.m_DimensionsData);
     m_Data = std::move(p_Other.m_Data);
+    m_Size = std::exchange(p_Other.m_Size, 0);
+    invalidate_iterators();
     return *this;
   }
 
@@ -172,6 +181,20 @@ public:
 
   const std::vector<T> data() const noexcept { return m_Data; }
 
+  /**
+   * @brief Pointer to the underlying contiguous storage
+   *
+   * @return Pointer to the first element
+   */
+  T* storage() noexcept { return m_Data.data(); }
+
+  /**
+   * @brief Const pointer to the underlying contiguous storage
+   *
+   * @return Const pointer to the first element
+   */
+  const T* storage() const noexcept { return m_Data.data(); }
+
   const std::array<std::size_t, Rank>& dimensions() const noexcept
   {
     return m_DimensionsData;
@@ -335,7 +358,7 @@ public:
    *
    * @return Constant iterator to the first element
    */
-  const ConstIterator cbegin() const noexcept
+  ConstIterator cbegin() const noexcept
   {
     return ConstIterator(this, 0, m_Version);
   }
@@ -345,7 +368,7 @@ public:
    *
    * @return Constant iterator to the last element
    */
-  const ConstIterator cend() const noexcept
+  ConstIterator cend() const noexcept
   {
     return ConstIterator(this, size(), m_Version);
   }
@@ -355,37 +378,37 @@ public:
    *
    * @return Reverse iterator to the first element
    */
-  Iterator rbegin() { return std::reverse_iterator<Iterator>(begin()); }
+  ReverseIterator rbegin() { return ReverseIterator(end()); }
 
   /**
    * @brief Const reverse iterator to the first element
    *
    * @return Const reverse iterator to the first element
    */
-  ConstIterator rbegin() const noexcept { return std::reverse_iterator<ConstIterator>(begin()); }
+  ConstReverseIterator rbegin() const noexcept { return ConstReverseIterator(end()); }
 
   /**
    * @brief Reverse iterator to the last element
    *
    * @return Reverse iterator to the last element
    */
-  Iterator rend() { return std::reverse_iterator<Iterator>(end()); }
+  ReverseIterator rend() { return ReverseIterator(begin()); }
 
   /**
    * @brief Const reverse iterator to the last element
    *
    * @return Const reverse iterator to the last element
    */
-  ConstIterator rend() const noexcept { return std::reverse_iterator<ConstIterator>(end()); }
+  ConstReverseIterator rend() const noexcept { return ConstReverseIterator(begin()); }
 
   /**
-   * @brief Constant reverse iterator to the last element
+   * @brief Constant reverse iterator to the first element
    *
-   * @return Constant reverse iterator to the last element
+   * @return Constant reverse iterator to the first element
    */
-  const ConstIterator crbegin() const
+  ConstReverseIterator crbegin() const noexcept
   {
-    return std::reverse_iterator<ConstIterator>(begin());
+    return ConstReverseIterator(end());
   }
 
   /**
@@ -393,9 +416,9 @@ public:
    *
    * @return Constant reverse iterator to the last element
    */
-  const ConstIterator crend() const
+  ConstReverseIterator crend() const noexcept
   {
-    return std::reverse_iterator<ConstIterator>(end());
+    return ConstReverseIterator(begin());
   }
 
 private:
@@ -456,17 +479,28 @@ public:
    * The Iterator class represents an iterator of Tensor. It contains
    * an index to which it points, and provides necessary operations
    * for STL integration, as well as thread-safety.
+   * Models std::contiguous_iterator.
    */
   class Iterator
   {
   public:
     using iterator_category = std::random_access_iterator_tag;
+    using iterator_concept = std::contiguous_iterator_tag;
     using value_type = T;
+    using element_type = T;
     using difference_type = std::ptrdiff_t;
     using pointer = T*;
     using reference = T&;
 
-    Iterator() = delete;
+    /**
+     * @brief Default constructor of a singular iterator
+     */
+    Iterator() noexcept
+      : m_TensorPtr(nullptr)
+      , m_Index(0)
+      , m_Version(0)
+    {
+    }
 
     /**
      * @brief Constructor of tensor
@@ -484,10 +518,12 @@ public:
 
     std::size_t index() const noexcept { return m_Index; }
 
-    const Tensor<T, Rank>& tensor() const noexcept { return *m_TensorPtr; }
+    const Tensor& tensor() const noexcept { return *m_TensorPtr; }
 
-    void test_for_invalidation()
+    void test_for_invalidation() const
     {
+      if (!m_TensorPtr)
+        throw std::runtime_error("Tensor has been destroyed");
       if (m_TensorPtr->m_Version != m_Version) {
         throw std::runtime_error("Iterator to a censor was invalidated");
       }
@@ -498,46 +534,23 @@ public:
      *
      * @return Element to which the iterator points
      */
-    reference operator*()
+    reference operator*() const
     {
       test_for_invalidation();
-      if (!m_TensorPtr)
-        throw std::runtime_error("Tensor has been destroyed");
-      return (*m_TensorPtr)[m_Index];
-    }
-
-    /**
-     * @brief Dereference operator to access the element
-     *
-     * @return Element to which the iterator points
-     */
-    const T& operator*() const
-    {
-      if (!m_TensorPtr)
-        throw std::runtime_error("Tensor has been destroyed");
       return (*m_TensorPtr)[m_Index];
     }
 
     /**
      * @brief pointer to the element to which the iterator points
      *
-     * @brief pointer to the element to which the iterator points
+     * @details
+     * Not bounds-checked, so that the past-the-end iterator
+     * can be converted to an address.
      */
-    [[nodiscard]] pointer operator->()
+    pointer operator->() const
     {
       test_for_invalidation();
-      return &(**this);
-    }
-
-    /**
-     * @brief pointer to the element to which the iterator points
-     *
-     * @brief pointer to the element to which the iterator points
-     */
-    const pointer operator->() const
-    {
-      test_for_invalidation();
-      return &(**this);
+      return m_TensorPtr->storage() + m_Index;
     }
 
     Iterator& operator++() noexcept
@@ -599,10 +612,11 @@ public:
 
     difference_type operator-(const Iterator& other) const noexcept
     {
-      return m_Index - other.m_Index;
+      return static_cast<difference_type>(m_Index) -
+             static_cast<difference_type>(other.m_Index);
     }
 
-    reference operator[](difference_type n)
+    reference operator[](difference_type n) const
     {
       test_for_invalidation();
       return *(*this + n);
@@ -613,14 +627,17 @@ public:
       return m_Index == other.m_Index;
     }
 
-    bool operator!=(const Iterator& other) const noexcept { return !(*this == other); }
-
-    auto operator<=>(const Iterator& other) const noexcept = default;
+    auto operator<=>(const Iterator& other) const noexcept
+    {
+      return m_Index <=> other.m_Index;
+    }
 
   private:
     Tensor* m_TensorPtr;
     std::size_t m_Index;
     std::size_t m_Version;
+
+    friend class ConstIterator;
   };
   /**
    * @brief Const iterator class of Tensor
@@ -629,17 +646,28 @@ public:
    * The ConstIterator class represents a const iterator of Tensor. It contains
    * an index to which it points, and provides necessary operations
    * for STL integration, as well as thread-safety.
+   * Models std::contiguous_iterator.
    */
   class ConstIterator
   {
   public:
     using iterator_category = std::random_access_iterator_tag;
+    using iterator_concept = std::contiguous_iterator_tag;
     using value_type = T;
+    using element_type = const T;
     using difference_type = std::ptrdiff_t;
     using pointer = const T*;
     using reference = const T&;
 
-    ConstIterator() = delete;
+    /**
+     * @brief Default constructor of a singular iterator
+     */
+    ConstIterator() noexcept
+      : m_TensorPtr(nullptr)
+      , m_Index(0)
+      , m_Version(0)
+    {
+    }
 
     /**
      * @brief Constructor of tensor
@@ -657,12 +685,26 @@ public:
     {
     }
 
+    /**
+     * @brief Conversion from a mutable iterator
+     *
+     * @param p_Other Iterator to convert
+     */
+    ConstIterator(const Iterator& p_Other) noexcept
+      : m_TensorPtr(p_Other.m_TensorPtr)
+      , m_Index(p_Other.m_Index)
+      , m_Version(p_Other.m_Version)
+    {
+    }
+
     std::size_t index() const noexcept { return m_Index; }
 
-    const Tensor<T, Rank>& tensor() const noexcept { return *m_TensorPtr; }
+    const Tensor& tensor() const noexcept { return *m_TensorPtr; }
 
     void test_for_invalidation() const
     {
+      if (!m_TensorPtr)
+        throw std::runtime_error("Tensor has been destroyed");
       if (m_TensorPtr->m_Version != m_Version) {
         throw std::runtime_error("ConstIterator to a censor was invalidated");
       }
@@ -683,12 +725,14 @@ public:
     /**
      * @brief pointer to the element to which the iterator points
      *
-     * @brief pointer to the element to which the iterator points
+     * @details
+     * Not bounds-checked, so that the past-the-end iterator
+     * can be converted to an address.
      */
-    [[nodiscard]] pointer operator->() const
+    pointer operator->() const
     {
       test_for_invalidation();
-      return &(**this);
+      return m_TensorPtr->storage() + m_Index;
     }
 
     ConstIterator& operator++() noexcept
@@ -750,7 +794,8 @@ public:
 
     difference_type operator-(const ConstIterator& other) const noexcept
     {
-      return m_Index - other.m_Index;
+      return static_cast<difference_type>(m_Index) -
+             static_cast<difference_type>(other.m_Index);
     }
 
     reference operator[](difference_type n) const 
@@ -764,13 +809,11 @@ public:
       return m_Index == other.m_Index;
     }
 
-    bool operator!=(const ConstIterator& other) const noexcept
+    auto operator<=>(const ConstIterator& other) const noexcept
     {
-      return !(*this == other);
+      return m_Index <=> other.m_Index;
     }
 
-    auto operator<=>(const ConstIterator& other) const = default;
-
   private:
     const Tensor* m_TensorPtr;
     std::size_t m_Index;
@@ -0,0 +1,680 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "NdIterator.hpp"
+#include "Tensor.hpp"
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <iterator>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace TenSore {
+
+/**
+ * @class TensorView
+ * @brief Non-owning strided view over elements of a tensor
+ *
+ * @tparam T The type of value, const-qualified for read-only views
+ * @tparam Rank Rank of the view
+ *
+ * @details
+ * A view is a pointer, dimensions and strides (in elements). It does not
+ * lock the viewed tensor and does not participate in its versioning:
+ * it is invalidated by any operation that reallocates the tensor.
+ * Models std::ranges::view, std::ranges::sized_range and
+ * std::ranges::forward_range.
+ */
+template<typename T, std::size_t Rank>
+class TensorView : public std::ranges::view_interface<TensorView<T, Rank>>
+{
+public:
+  class Iterator;
+
+  TensorView() noexcept = default;
+
+  /**
+   * @brief Constructor from raw layout
+   *
+   * @param p_Data Pointer to the element at coordinates (0, ..., 0)
+   * @param p_Dimensions Extent of each dimension
+   * @param p_Strides Distance in elements between neighbours along each dimension
+   */
+  TensorView(T* p_Data,
+             const std::array<std::size_t, Rank>& p_Dimensions,
+             const std::array<std::ptrdiff_t, Rank>& p_Strides) noexcept
+    : m_Data(p_Data)
+    , m_DimensionsData(p_Dimensions)
+    , m_Strides(p_Strides)
+  {
+  }
+
+  /**
+   * @brief Constructor of a view over a whole tensor
+   *
+   * @param p_Tensor Tensor to view
+   */
+  template<typename U, Allocator A>
+    requires std::same_as<std::remove_const_t<T>, U>
+  TensorView(Tensor<U, Rank, A>& p_Tensor) noexcept
+    : TensorView(p_Tensor.storage(),
+                 p_Tensor.dimensions(),
+                 dense_strides(p_Tensor.dimensions()))
+  {
+  }
+
+  /**
+   * @brief Constructor of a read-only view over a whole tensor
+   *
+   * @param p_Tensor Tensor to view
+   */
+  template<typename U, Allocator A>
+    requires std::same_as<T, const U>
+  TensorView(const Tensor<U, Rank, A>& p_Tensor) noexcept
+    : TensorView(p_Tensor.storage(),
+                 p_Tensor.dimensions(),
+                 dense_strides(p_Tensor.dimensions()))
+  {
+  }
+
+  /**
+   * @brief Conversion from a mutable view to a read-only one
+   *
+   * @param p_Other View to convert
+   */
+  template<typename U>
+    requires std::same_as<T, const U>
+  TensorView(const TensorView<U, Rank>& p_Other) noexcept
+    : TensorView(p_Other.storage(), p_Other.dimensions(), p_Other.strides())
+  {
+  }
+
+  /**
+   * @brief Total amount of elements in a view
+   */
+  std::size_t size() const noexcept
+  {
+    std::size_t _retval = 1;
+    for (const auto& it : m_DimensionsData) {
+      _retval *= it;
+    }
+    return _retval;
+  }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_DimensionsData;
+  }
+
+  const std::array<std::ptrdiff_t, Rank>& strides() const noexcept
+  {
+    return m_Strides;
+  }
+
+  /**
+   * @brief Pointer to the element at coordinates (0, ..., 0)
+   */
+  T* storage() const noexcept { return m_Data; }
+
+  /**
+   * @brief Whether the view is densely packed in first-dimension-fastest order
+   */
+  bool contiguous() const noexcept
+  {
+    std::ptrdiff_t _expected = 1;
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (m_DimensionsData[i] != 1 && m_Strides[i] != _expected) {
+        return false;
+      }
+      _expected *= static_cast<std::ptrdiff_t>(m_DimensionsData[i]);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Contiguous span of the viewed elements
+   *
+   * @return Span of all elements in storage order
+   */
+  std::span<T> span() const
+  {
+    if (!contiguous()) {
+      throw std::invalid_argument("Tensor view is not contiguous");
+    }
+    return std::span<T>(m_Data, size());
+  }
+
+  /**
+   * @brief Element access with calculated index
+   *
+   * @param p_Dims Dimension coordinates to access.
+   *
+   * @return Element at calculated index
+   */
+  T& at(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    std::ptrdiff_t _offset = 0;
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (p_Dims[i] >= m_DimensionsData[i]) {
+        throw std::out_of_range("Index out of bounds");
+      }
+      _offset += static_cast<std::ptrdiff_t>(p_Dims[i]) * m_Strides[i];
+    }
+    return m_Data[_offset];
+  }
+
+  /**
+   * @brief Element access operator with calculated index
+   *
+   * @param p_Dims Dimension coordinates to access.
+   *
+   * @return Element at calculated index
+   */
+  T& operator()(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return at(p_Dims);
+  }
+
+  /**
+   * @brief Hyperplane with a fixed coordinate along an axis
+   *
+   * @param p_Axis Axis to fix
+   * @param p_Index Coordinate along the axis
+   *
+   * @return View of rank `Rank - 1`
+   */
+  TensorView<T, Rank - 1> slice(std::size_t p_Axis, std::size_t p_Index) const
+    requires(Rank > 1)
+  {
+    if (p_Axis >= Rank || p_Index >= m_DimensionsData[p_Axis]) {
+      throw std::out_of_range("Slice out of bounds");
+    }
+    std::array<std::size_t, Rank - 1> _dims;
+    std::array<std::ptrdiff_t, Rank - 1> _strides;
+    for (std::size_t i = 0, j = 0; i < Rank; ++i) {
+      if (i != p_Axis) {
+        _dims[j] = m_DimensionsData[i];
+        _strides[j] = m_Strides[i];
+        ++j;
+      }
+    }
+    return TensorView<T, Rank - 1>(
+      m_Data + static_cast<std::ptrdiff_t>(p_Index) * m_Strides[p_Axis],
+      _dims,
+      _strides);
+  }
+
+  /**
+   * @brief Rectangular region of a view
+   *
+   * @param p_Offsets Coordinates of the first element of the region
+   * @param p_Extents Dimensions of the region
+   *
+   * @return View of the region
+   */
+  TensorView subview(const std::array<std::size_t, Rank>& p_Offsets,
+                     const std::array<std::size_t, Rank>& p_Extents) const
+  {
+    std::ptrdiff_t _offset = 0;
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (p_Offsets[i] + p_Extents[i] > m_DimensionsData[i]) {
+        throw std::out_of_range("Subview out of bounds");
+      }
+      _offset += static_cast<std::ptrdiff_t>(p_Offsets[i]) * m_Strides[i];
+    }
+    return TensorView(m_Data + _offset, p_Extents, m_Strides);
+  }
+
+  /**
+   * @brief Amount of one-dimensional lanes along an axis
+   *
+   * @param p_Axis Axis of lanes
+   */
+  std::size_t lane_count(std::size_t p_Axis) const
+  {
+    if (p_Axis >= Rank) {
+      throw std::out_of_range("Axis out of bounds");
+    }
+    return m_DimensionsData[p_Axis] ? size() / m_DimensionsData[p_Axis] : 0;
+  }
+
+  /**
+   * @brief One-dimensional lane along an axis
+   *
+   * @param p_Axis Axis of the lane
+   * @param p_Index Index of the lane, with the remaining axes
+   * enumerated in first-dimension-fastest order
+   *
+   * @return View of rank 1
+   */
+  TensorView<T, 1> lane(std::size_t p_Axis, std::size_t p_Index) const
+  {
+    if (p_Index >= lane_count(p_Axis)) {
+      throw std::out_of_range("Lane out of bounds");
+    }
+    std::ptrdiff_t _offset = 0;
+    for (std::size_t i = 0; i < Rank; ++i) {
+      if (i != p_Axis) {
+        _offset +=
+          static_cast<std::ptrdiff_t>(p_Index % m_DimensionsData[i]) * m_Strides[i];
+        p_Index /= m_DimensionsData[i];
+      }
+    }
+    return TensorView<T, 1>(
+      m_Data + _offset, { m_DimensionsData[p_Axis] }, { m_Strides[p_Axis] });
+  }
+
+  Iterator begin() const { return Iterator(*this, 0); }
+
+  Iterator end() const { return Iterator(size()); }
+
+  /**
+   * @brief Strided iterator over a TensorView
+   *
+   * @details
+   * Visits elements in first-dimension-fastest order, advancing
+   * with NdIterator's odometer, so no division is performed per step.
+   */
+  class Iterator
+  {
+  public:
+    using iterator_concept = std::forward_iterator_tag;
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::remove_const_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    Iterator() noexcept = default;
+
+    Iterator(const TensorView& p_View, std::size_t p_Pos)
+      : m_It(p_View.m_Data, p_View.m_DimensionsData, p_View.m_Strides)
+      , m_Pos(p_Pos)
+    {
+    }
+
+    explicit Iterator(std::size_t p_Pos) noexcept
+      : m_Pos(p_Pos)
+    {
+    }
+
+    /**
+     * @brief Coordinates of the current element
+     */
+    const std::array<std::size_t, Rank>& coords() const noexcept
+    {
+      return m_It.coords();
+    }
+
+    reference operator*() const noexcept { return *m_It.pointer(); }
+
+    pointer operator->() const noexcept { return m_It.pointer(); }
+
+    Iterator& operator++() noexcept
+    {
+      ++m_It;
+      ++m_Pos;
+      return *this;
+    }
+
+    Iterator operator++(int) noexcept
+    {
+      Iterator temp = *this;
+      ++(*this);
+      return temp;
+    }
+
+    bool operator==(const Iterator& other) const noexcept
+    {
+      return m_Pos == other.m_Pos;
+    }
+
+  private:
+    NdIterator<T, Rank> m_It;
+    std::size_t m_Pos = 0;
+  };
+
+private:
+  T* m_Data = nullptr;
+  std::array<std::size_t, Rank> m_DimensionsData{};
+  std::array<std::ptrdiff_t, Rank> m_Strides{};
+};
+
+template<typename T, std::size_t Rank, Allocator A>
+TensorView(Tensor<T, Rank, A>&) -> TensorView<T, Rank>;
+
+template<typename T, std::size_t Rank, Allocator A>
+TensorView(const Tensor<T, Rank, A>&) -> TensorView<const T, Rank>;
+
+/**
+ * @brief View over a whole tensor
+ */
+template<typename T, std::size_t Rank, Allocator A>
+TensorView<T, Rank>
+as_view(Tensor<T, Rank, A>& p_Tensor) noexcept
+{
+  return TensorView<T, Rank>(p_Tensor);
+}
+
+/**
+ * @brief Read-only view over a whole tensor
+ */
+template<typename T, std::size_t Rank, Allocator A>
+TensorView<const T, Rank>
+as_view(const Tensor<T, Rank, A>& p_Tensor) noexcept
+{
+  return TensorView<const T, Rank>(p_Tensor);
+}
+
+template<typename T, std::size_t Rank, Allocator A>
+void as_view(const Tensor<T, Rank, A>&&) = delete;
+
+template<typename T, std::size_t Rank>
+TensorView<T, Rank>
+as_view(TensorView<T, Rank> p_View) noexcept
+{
+  return p_View;
+}
+
+/**
+ * @brief A concept for std::mdspan and compatible implementations
+ *
+ * @details
+ * Satisfied by std::mdspan, the reference implementation
+ * (std::experimental::mdspan / Kokkos::mdspan) and any type exposing the
+ * same observers, whatever its layout policy.
+ */
+template<typename M>
+concept MdspanLike = requires(const M& m, std::size_t r) {
+  typename M::element_type;
+  { M::rank() } -> std::convertible_to<std::size_t>;
+  { m.extent(r) } -> std::convertible_to<std::size_t>;
+  { m.stride(r) } -> std::convertible_to<std::ptrdiff_t>;
+  { m.data_handle() } -> std::convertible_to<typename M::element_type*>;
+};
+
+/**
+ * @brief Zero-copy view over the elements of an mdspan
+ *
+ * @param p_Span Strided mdspan of any layout
+ *
+ * @return View sharing the mdspan's elements, with its strides
+ *
+ * @details
+ * Coordinates keep their order: `from_mdspan(m).at({ i, j })` is `m[i, j]`.
+ */
+template<MdspanLike M>
+TensorView<typename M::element_type, M::rank()>
+from_mdspan(const M& p_Span)
+{
+  constexpr std::size_t Rank = M::rank();
+  std::array<std::size_t, Rank> _dims;
+  std::array<std::ptrdiff_t, Rank> _strides;
+  for (std::size_t i = 0; i < Rank; ++i) {
+    _dims[i] = static_cast<std::size_t>(p_Span.extent(i));
+    _strides[i] = static_cast<std::ptrdiff_t>(p_Span.stride(i));
+  }
+  return TensorView<typename M::element_type, Rank>(
+    p_Span.data_handle(), _dims, _strides);
+}
+
+/**
+ * @brief View over an mdspan, so that mdspans are accepted by views::
+ * adaptors and every kernel that takes a tensor through as_view()
+ */
+template<MdspanLike M>
+TensorView<typename M::element_type, M::rank()>
+as_view(const M& p_Span)
+{
+  return from_mdspan(p_Span);
+}
+
+/**
+ * @brief A concept for tensors, views and mdspans accepted through as_view()
+ */
+template<typename V>
+concept ViewLike = requires(V& v) { as_view(v); };
+
+/**
+ * @brief Type of the view as_view() returns for a tensor-like type
+ */
+template<typename V>
+using view_t = decltype(as_view(std::declval<V&>()));
+
+/**
+ * @brief Coordinate-aware traversal of a view
+ *
+ * @param p_View View to traverse
+ *
+ * @return Range yielding Indexed elements in first-dimension-fastest order
+ */
+template<typename T, std::size_t Rank>
+IndexedRange<T, Rank>
+indexed(const TensorView<T, Rank>& p_View)
+{
+  return IndexedRange<T, Rank>(
+    p_View.storage(), p_View.dimensions(), p_View.strides());
+}
+
+/**
+ * @brief Copies the elements of one view into another of equal dimensions
+ *
+ * @param p_From Source view
+ * @param p_To Destination view, must not overlap the source
+ *
+ * @details
+ * Copies whole lanes along dimension 0 at a time, with a single block
+ * copy when both views are contiguous.
+ */
+template<typename U, typename T, std::size_t Rank>
+  requires std::is_same_v<std::remove_const_t<U>, T>
+void
+copy_view(const TensorView<U, Rank>& p_From, const TensorView<T, Rank>& p_To)
+{
+  if (p_From.dimensions() != p_To.dimensions()) {
+    throw std::invalid_argument("Mismatched dimensions of views");
+  }
+  const std::size_t _size = p_From.size();
+  if (_size == 0) {
+    return;
+  }
+  if (p_From.contiguous() && p_To.contiguous()) {
+    std::copy_n(p_From.storage(), _size, p_To.storage());
+    return;
+  }
+  const auto& _dims = p_From.dimensions();
+  const std::size_t _run = _dims[0];
+  const std::ptrdiff_t _from_step = p_From.strides()[0];
+  const std::ptrdiff_t _to_step = p_To.strides()[0];
+  std::array<std::size_t, Rank> _coords{};
+  std::ptrdiff_t _from = 0;
+  std::ptrdiff_t _to = 0;
+  for (std::size_t _lane = 0; _lane < _size / _run; ++_lane) {
+    const U* _src = p_From.storage() + _from;
+    T* _dst = p_To.storage() + _to;
+    if (_from_step == 1 && _to_step == 1) {
+      std::copy_n(_src, _run, _dst);
+    } else {
+      for (std::ptrdiff_t i = 0; i < static_cast<std::ptrdiff_t>(_run); ++i) {
+        _dst[i * _to_step] = _src[i * _from_step];
+      }
+    }
+    for (std::size_t d = 1; d < Rank; ++d) {
+      _from += p_From.strides()[d];
+      _to += p_To.strides()[d];
+      if (++_coords[d] < _dims[d]) {
+        break;
+      }
+      _from -= p_From.strides()[d] * static_cast<std::ptrdiff_t>(_dims[d]);
+      _to -= p_To.strides()[d] * static_cast<std::ptrdiff_t>(_dims[d]);
+      _coords[d] = 0;
+    }
+  }
+}
+
+/**
+ * @brief Lazy range adaptors over tensors and views
+ *
+ * @details
+ * Each adaptor accepts a Tensor (by reference) or a TensorView and
+ * yields a std::ranges::view, so it composes with std::views:
+ * `T | TenSore::views::lanes(0) | std::views::transform(f)`.
+ */
+namespace views {
+
+/**
+ * @brief Pipeable closure of a range adaptor
+ */
+template<typename F>
+struct Adaptor
+{
+  F m_Fn;
+
+  template<typename R>
+  auto operator()(R&& p_Range) const
+  {
+    return m_Fn(as_view(std::forward<R>(p_Range)));
+  }
+
+  template<typename R>
+  friend auto operator|(R&& p_Range, const Adaptor& p_Adaptor)
+  {
+    return p_Adaptor(std::forward<R>(p_Range));
+  }
+};
+
+template<typename F>
+Adaptor(F) -> Adaptor<F>;
+
+/**
+ * @brief Hyperplanes along an axis, each of rank `Rank - 1`
+ *
+ * @param p_Axis Axis along which to slice
+ */
+inline auto
+axis(std::size_t p_Axis)
+{
+  return Adaptor{ [p_Axis](auto p_View) {
+    if (p_Axis >= p_View.dimensions().size()) {
+      throw std::out_of_range("Axis out of bounds");
+    }
+    return std::views::iota(std::size_t{ 0 }, p_View.dimensions()[p_Axis]) |
+           std::views::transform([p_View, p_Axis](std::size_t i) {
+             return p_View.slice(p_Axis, i);
+           });
+  } };
+}
+
+/**
+ * @brief One-dimensional lanes along an axis
+ *
+ * @param p_Axis Axis of lanes
+ */
+inline auto
+lanes(std::size_t p_Axis)
+{
+  return Adaptor{ [p_Axis](auto p_View) {
+    return std::views::iota(std::size_t{ 0 }, p_View.lane_count(p_Axis)) |
+           std::views::transform([p_View, p_Axis](std::size_t i) {
+             return p_View.lane(p_Axis, i);
+           });
+  } };
+}
+
+/**
+ * @brief Contiguous spans of at most `p_Count` elements in storage order
+ *
+ * @param p_Count Elements per chunk
+ *
+ * @details
+ * Requires a contiguous view, throws std::invalid_argument otherwise.
+ */
+inline auto
+chunks(std::size_t p_Count)
+{
+  if (p_Count == 0) {
+    throw std::invalid_argument("Chunk size must be positive");
+  }
+  return Adaptor{ [p_Count](auto p_View) {
+    const auto _span = p_View.span();
+    const std::size_t _chunks = (_span.size() + p_Count - 1) / p_Count;
+    return std::views::iota(std::size_t{ 0 }, _chunks) |
+           std::views::transform([_span, p_Count](std::size_t i) {
+             const std::size_t _first = i * p_Count;
+             return _span.subspan(_first,
+                                  std::min(p_Count, _span.size() - _first));
+           });
+  } };
+}
+
+/**
+ * @brief Rectangular tiles covering a view
+ *
+ * @param p_Shape Dimensions of a tile, tiles at the upper borders are clipped
+ *
+ * @details
+ * Tiles are enumerated in first-dimension-fastest order.
+ */
+template<std::size_t Rank>
+auto
+tiles(const std::array<std::size_t, Rank>& p_Shape)
+{
+  for (const auto& it : p_Shape) {
+    if (it == 0) {
+      throw std::invalid_argument("Tile dimensions must be positive");
+    }
+  }
+  return Adaptor{ [p_Shape](auto p_View) {
+    static_assert(
+      std::tuple_size_v<std::remove_cvref_t<decltype(p_View.dimensions())>> ==
+        Rank,
+      "Misaligned rank of tile shape");
+    std::array<std::size_t, Rank> _grid;
+    std::size_t _count = 1;
+    for (std::size_t i = 0; i < Rank; ++i) {
+      _grid[i] = (p_View.dimensions()[i] + p_Shape[i] - 1) / p_Shape[i];
+      _count *= _grid[i];
+    }
+    return std::views::iota(std::size_t{ 0 }, _count) |
+           std::views::transform([p_View, p_Shape, _grid](std::size_t t) {
+             std::array<std::size_t, Rank> _offsets;
+             std::array<std::size_t, Rank> _extents;
+             for (std::size_t i = 0; i < Rank; ++i) {
+               _offsets[i] = (t % _grid[i]) * p_Shape[i];
+               _extents[i] =
+                 std::min(p_Shape[i], p_View.dimensions()[i] - _offsets[i]);
+               t /= _grid[i];
+             }
+             return p_View.subview(_offsets, _extents);
+           });
+  } };
+}
+
+}
+
+}
+
+template<typename T, std::size_t Rank>
+inline constexpr bool
+  std::ranges::enable_borrowed_range<TenSore::TensorView<T, Rank>> = true;
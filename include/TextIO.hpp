@@ -0,0 +1,607 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "NdIterator.hpp"
+#include "Tensor.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace TenSore {
+
+/**
+ * @brief Options of the text reader and writer
+ */
+struct TextFormat
+{
+  /**
+   * @brief Separator of values; when 0, the reader accepts runs of
+   * commas, semicolons, spaces and tabs and the writer uses commas.
+   * When set, fields are separated by exactly one delimiter and an empty
+   * field is a malformed value.
+   */
+  char m_Delimiter = 0;
+
+  /**
+   * @brief Lines skipped at the start of a file, e.g. a CSV header
+   */
+  std::size_t m_SkipRows = 0;
+
+  /**
+   * @brief Lines starting with this character are skipped; 0 disables it
+   */
+  char m_Comment = '#';
+
+  /**
+   * @brief Significant digits written for floating point values; when
+   * negative, the shortest representation that reads back exactly
+   */
+  int m_Precision = -1;
+};
+
+namespace detail {
+
+/**
+ * @brief Read-only mapping of a whole file
+ */
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string& p_Path)
+  {
+    const int _fd = ::open(p_Path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (_fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "open");
+    }
+    struct stat _stat;
+    if (::fstat(_fd, &_stat) != 0) {
+      const int _error = errno;
+      ::close(_fd);
+      throw std::system_error(_error, std::generic_category(), "fstat");
+    }
+    m_Size = static_cast<std::size_t>(_stat.st_size);
+    if (m_Size > 0) {
+      void* _ptr = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, _fd, 0);
+      if (_ptr == MAP_FAILED) {
+        const int _error = errno;
+        ::close(_fd);
+        throw std::system_error(_error, std::generic_category(), "mmap");
+      }
+      ::madvise(_ptr, m_Size, MADV_SEQUENTIAL);
+      m_Data = static_cast<const char*>(_ptr);
+    }
+    ::close(_fd);
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile()
+  {
+    if (m_Data) {
+      ::munmap(const_cast<char*>(m_Data), m_Size);
+    }
+  }
+
+  std::string_view text() const noexcept { return std::string_view(m_Data, m_Size); }
+
+private:
+  const char* m_Data = nullptr;
+  std::size_t m_Size = 0;
+};
+
+/**
+ * @brief Value count and line structure of one newline-aligned piece of text
+ */
+struct ScannedChunk
+{
+  std::size_t m_Values = 0;
+  std::vector<std::size_t> m_LineValues;
+  std::size_t m_Lines = 0;
+  std::size_t m_ErrorLine = 0;
+  std::string m_Error;
+};
+
+/**
+ * @brief Position after the line containing `p_Pos`
+ */
+inline std::size_t
+next_line(std::string_view p_Text, std::size_t p_Pos) noexcept
+{
+  const std::size_t _newline = p_Text.find('\n', p_Pos);
+  return _newline == std::string_view::npos ? p_Text.size() : _newline + 1;
+}
+
+/**
+ * @brief Walks the fields of a chunk, converting them when a sink is given
+ *
+ * @details
+ * Without a sink (`std::nullptr_t`) fields are only delimited and counted;
+ * with one every field is converted with std::from_chars and handed to
+ * it. Both walks see the same fields, so a count taken by the first fixes
+ * where the second stores each value.
+ */
+template<typename T, typename F>
+void
+parse_chunk(std::string_view p_Text, const TextFormat& p_Format, ScannedChunk& p_Out, F&& p_Sink)
+{
+  constexpr bool k_Convert = !std::is_same_v<std::remove_cvref_t<F>, std::nullptr_t>;
+  const char _delimiter = p_Format.m_Delimiter;
+  auto _space = [&](char c) {
+    return c != _delimiter && (c == ' ' || c == '\t' || c == '\r');
+  };
+  auto _separator = [&](char c) {
+    return _space(c) || (_delimiter ? c == _delimiter : c == ',' || c == ';');
+  };
+  const char* _it = p_Text.data();
+  const char* const _end = _it + p_Text.size();
+  const char* _eol = _end;
+  // Records the token at _it as malformed, an empty one included
+  auto _malformed = [&]() {
+    const char* _token_end = _it;
+    while (_token_end != _eol && !_separator(*_token_end)) {
+      ++_token_end;
+    }
+    p_Out.m_ErrorLine = p_Out.m_Lines;
+    p_Out.m_Error = "Malformed value \"" + std::string(_it, _token_end) + "\"";
+    return false;
+  };
+  auto _parse = [&]() {
+    if (_it != _eol && *_it == '+') {
+      ++_it;
+    }
+    if constexpr (k_Convert) {
+      T _value;
+      const auto _result = std::from_chars(_it, _eol, _value);
+      if (_result.ec != std::errc() || (_result.ptr != _eol && !_separator(*_result.ptr))) {
+        return _malformed();
+      }
+      p_Sink(_value);
+      _it = _result.ptr;
+    } else {
+      const char* _token = _it;
+      while (_token != _eol && !_separator(*_token)) {
+        ++_token;
+      }
+      if (_token == _it) {
+        return _malformed();
+      }
+      _it = _token;
+    }
+    ++p_Out.m_Values;
+    return true;
+  };
+  while (_it != _end) {
+    _eol = static_cast<const char*>(std::memchr(_it, '\n', _end - _it));
+    if (!_eol) {
+      _eol = _end;
+    }
+    std::size_t _count = 0;
+    if (!(p_Format.m_Comment && *_it == p_Format.m_Comment)) {
+      if (_delimiter) {
+        // Exactly one delimiter between fields, so empty fields are errors;
+        // only a blank line holds no fields.
+        while (_it != _eol && _space(*_it)) {
+          ++_it;
+        }
+        while (_it != _eol) {
+          while (_it != _eol && _space(*_it)) {
+            ++_it;
+          }
+          if (!_parse()) {
+            return;
+          }
+          ++_count;
+          while (_it != _eol && _space(*_it)) {
+            ++_it;
+          }
+          if (_it == _eol) {
+            break;
+          }
+          if (*_it != _delimiter || ++_it == _eol) {
+            _malformed();
+            return;
+          }
+        }
+      } else {
+        while (true) {
+          while (_it != _eol && _separator(*_it)) {
+            ++_it;
+          }
+          if (_it == _eol) {
+            break;
+          }
+          if (!_parse()) {
+            return;
+          }
+          ++_count;
+        }
+      }
+    }
+    if (_count) {
+      p_Out.m_LineValues.push_back(_count);
+    }
+    ++p_Out.m_Lines;
+    _it = _eol == _end ? _end : _eol + 1;
+  }
+}
+
+/**
+ * @brief Steps coordinates in row-major order (last dimension fastest),
+ * keeping the storage offset in step
+ */
+template<std::size_t Rank>
+void
+advance_c_order(std::array<std::size_t, Rank>& p_Coords,
+                std::ptrdiff_t& p_Offset,
+                const std::array<std::size_t, Rank>& p_Dimensions,
+                const std::array<std::ptrdiff_t, Rank>& p_Strides) noexcept
+{
+  for (std::size_t d = Rank; d-- > 0;) {
+    p_Offset += p_Strides[d];
+    if (++p_Coords[d] < p_Dimensions[d]) {
+      return;
+    }
+    p_Offset -= p_Strides[d] * static_cast<std::ptrdiff_t>(p_Dimensions[d]);
+    p_Coords[d] = 0;
+  }
+}
+
+/**
+ * @brief Coordinates and storage offset of a row-major position
+ */
+template<std::size_t Rank>
+std::ptrdiff_t
+c_order_position(std::size_t p_Index,
+                 std::array<std::size_t, Rank>& p_Coords,
+                 const std::array<std::size_t, Rank>& p_Dimensions,
+                 const std::array<std::ptrdiff_t, Rank>& p_Strides) noexcept
+{
+  std::ptrdiff_t _offset = 0;
+  for (std::size_t d = Rank; d-- > 0;) {
+    p_Coords[d] = p_Index % p_Dimensions[d];
+    p_Index /= p_Dimensions[d];
+    _offset += static_cast<std::ptrdiff_t>(p_Coords[d]) * p_Strides[d];
+  }
+  return _offset;
+}
+
+/**
+ * @brief Text split into newline-aligned chunks, with their value counts
+ */
+struct ScannedText
+{
+  std::string_view m_Text;
+  std::size_t m_FirstLine = 1;
+  std::vector<std::size_t> m_Bounds;
+  std::vector<ScannedChunk> m_Chunks;
+
+  std::string_view chunk(std::size_t i) const noexcept
+  {
+    return m_Text.substr(m_Bounds[i], m_Bounds[i + 1] - m_Bounds[i]);
+  }
+};
+
+/**
+ * @brief Throws the first error recorded in a chunk, with its file line
+ */
+inline void
+throw_error(const ScannedText& p_Text, const std::vector<ScannedChunk>& p_Chunks)
+{
+  std::size_t _line = p_Text.m_FirstLine;
+  for (std::size_t i = 0; i < p_Chunks.size(); ++i) {
+    if (!p_Chunks[i].m_Error.empty()) {
+      throw std::runtime_error(p_Chunks[i].m_Error + " at line " +
+                               std::to_string(_line + p_Chunks[i].m_ErrorLine));
+    }
+    _line += p_Text.m_Chunks[i].m_Lines;
+  }
+}
+
+/**
+ * @brief Splits text into chunks and counts their values in parallel
+ */
+inline ScannedText
+scan_text(std::string_view p_Text, const TextFormat& p_Format, ThreadPool& p_Pool)
+{
+  std::size_t _start = 0;
+  for (std::size_t i = 0; i < p_Format.m_SkipRows && _start < p_Text.size(); ++i) {
+    _start = next_line(p_Text, _start);
+  }
+  p_Text.remove_prefix(_start);
+
+  ScannedText _retval;
+  _retval.m_Text = p_Text;
+  _retval.m_FirstLine = p_Format.m_SkipRows + 1;
+  constexpr std::size_t k_MinChunk = std::size_t{ 1 } << 20;
+  const std::size_t _chunks = std::clamp<std::size_t>(
+    p_Text.size() / k_MinChunk, 1, std::max<std::size_t>(p_Pool.size() * 4, 1));
+  auto& _bounds = _retval.m_Bounds;
+  _bounds.push_back(0);
+  for (std::size_t i = 1; i < _chunks; ++i) {
+    const std::size_t _bound =
+      next_line(p_Text, std::max(_bounds.back(), p_Text.size() * i / _chunks));
+    if (_bound > _bounds.back() && _bound < p_Text.size()) {
+      _bounds.push_back(_bound);
+    }
+  }
+  _bounds.push_back(p_Text.size());
+
+  _retval.m_Chunks.resize(_bounds.size() - 1);
+  p_Pool.parallel_for(_retval.m_Chunks.size(), [&](std::size_t i) {
+    parse_chunk<void>(_retval.chunk(i), p_Format, _retval.m_Chunks[i], nullptr);
+  });
+  throw_error(_retval, _retval.m_Chunks);
+  return _retval;
+}
+
+/**
+ * @brief Converts the values of every chunk in parallel
+ *
+ * @param p_Sinks Callable returning, for a chunk index, the sink that
+ * stores the chunk's values in order
+ */
+template<typename T, typename F>
+void
+parse_text(const ScannedText& p_Text, const TextFormat& p_Format, ThreadPool& p_Pool, F&& p_Sinks)
+{
+  std::vector<ScannedChunk> _chunks(p_Text.m_Chunks.size());
+  p_Pool.parallel_for(_chunks.size(), [&](std::size_t i) {
+    if (p_Text.m_Chunks[i].m_Values) {
+      parse_chunk<T>(p_Text.chunk(i), p_Format, _chunks[i], p_Sinks(i));
+    }
+  });
+  throw_error(p_Text, _chunks);
+}
+
+}
+
+/**
+ * @brief Reads a tensor of known dimensions from a text file
+ *
+ * @param p_Path File of numbers separated by delimiters and newlines
+ * @param p_Dimensions Dimensions of the tensor
+ * @param p_Format Delimiters, header and comment lines
+ * @param p_Pool Pool parsing newline-aligned chunks in parallel
+ *
+ * @details
+ * Values are taken in text order as the elements in row-major order,
+ * i.e. with the last dimension fastest, which is how matrices are
+ * written as rows of text: line r of a matrix file holds row r. The file
+ * is mapped and split into newline-aligned chunks. A first parallel pass
+ * only delimits and counts the values of every chunk; a second converts
+ * them with std::from_chars and stores each one directly at its place in
+ * the preallocated tensor, so no intermediate copy of the values is
+ * held. Throws std::runtime_error naming the line of a malformed value,
+ * or if the amount of values differs from the tensor's size.
+ */
+template<typename T, std::size_t Rank>
+Tensor<T, Rank>
+read_text(const std::string& p_Path,
+          const std::array<std::size_t, Rank>& p_Dimensions,
+          const TextFormat& p_Format = {},
+          ThreadPool& p_Pool = ThreadPool::global())
+{
+  static_assert(std::is_arithmetic_v<T>, "Text files hold arithmetic types only");
+  const detail::MappedFile _file(p_Path);
+  const auto _text = detail::scan_text(_file.text(), p_Format, p_Pool);
+  const auto& _chunks = _text.m_Chunks;
+
+  std::array<std::size_t, Rank> _dims = p_Dimensions;
+  Tensor<T, Rank> _retval(std::move(_dims));
+  std::vector<std::size_t> _first(_chunks.size() + 1, 0);
+  for (std::size_t i = 0; i < _chunks.size(); ++i) {
+    _first[i + 1] = _first[i] + _chunks[i].m_Values;
+  }
+  if (_first.back() != _retval.size()) {
+    throw std::runtime_error("Text holds " + std::to_string(_first.back()) +
+                             " values, expected " + std::to_string(_retval.size()));
+  }
+  const auto _strides = dense_strides(p_Dimensions);
+  T* const _data = _retval.storage();
+  detail::parse_text<T>(_text, p_Format, p_Pool, [&](std::size_t i) {
+    std::array<std::size_t, Rank> _coords;
+    std::ptrdiff_t _offset =
+      detail::c_order_position(_first[i], _coords, p_Dimensions, _strides);
+    return [&, _coords, _offset](const T& p_Value) mutable {
+      _data[_offset] = p_Value;
+      detail::advance_c_order(_coords, _offset, p_Dimensions, _strides);
+    };
+  });
+  return _retval;
+}
+
+/**
+ * @brief Reads a vector or a matrix, inferring its dimensions
+ *
+ * @details
+ * A matrix has one row per non-empty line, and every row must hold as
+ * many values as the first one.
+ */
+template<typename T, std::size_t Rank>
+  requires(Rank == 1 || Rank == 2)
+Tensor<T, Rank>
+read_text(const std::string& p_Path,
+          const TextFormat& p_Format = {},
+          ThreadPool& p_Pool = ThreadPool::global())
+{
+  static_assert(std::is_arithmetic_v<T>, "Text files hold arithmetic types only");
+  const detail::MappedFile _file(p_Path);
+  const auto _text = detail::scan_text(_file.text(), p_Format, p_Pool);
+  const auto& _chunks = _text.m_Chunks;
+
+  std::size_t _rows = 0;
+  std::size_t _columns = 0;
+  std::size_t _total = 0;
+  for (const auto& it : _chunks) {
+    for (const std::size_t _count : it.m_LineValues) {
+      if (_rows++ == 0) {
+        _columns = _count;
+      } else if (Rank == 2 && _count != _columns) {
+        throw std::runtime_error("Row " + std::to_string(_rows) + " holds " +
+                                 std::to_string(_count) + " values, expected " +
+                                 std::to_string(_columns));
+      }
+    }
+    _total += it.m_Values;
+  }
+  std::array<std::size_t, Rank> _dims;
+  if constexpr (Rank == 1) {
+    _dims = { _total };
+  } else {
+    _dims = { _rows, _columns };
+  }
+  Tensor<T, Rank> _retval(std::move(_dims));
+  std::vector<std::size_t> _first(_chunks.size() + 1, 0);
+  for (std::size_t i = 0; i < _chunks.size(); ++i) {
+    _first[i + 1] = _first[i] + _chunks[i].m_Values;
+  }
+  T* const _data = _retval.storage();
+  detail::parse_text<T>(_text, p_Format, p_Pool, [&](std::size_t i) {
+    if constexpr (Rank == 1) {
+      return [_out = _data + _first[i]](const T& p_Value) mutable { *_out++ = p_Value; };
+    } else {
+      return [&, _row = _first[i] / _columns, _column = _first[i] % _columns](
+               const T& p_Value) mutable {
+        _data[_row + _rows * _column] = p_Value;
+        if (++_column == _columns) {
+          _column = 0;
+          ++_row;
+        }
+      };
+    }
+  });
+  return _retval;
+}
+
+/**
+ * @brief Writes a tensor as text, one line per lane of the last dimension
+ *
+ * @param p_Path File to write, replaced if it exists
+ * @param p_Tensor Tensor to write
+ * @param p_Format Delimiter and precision
+ * @param p_Pool Pool formatting groups of lines in parallel
+ *
+ * @details
+ * The inverse of read_text(): a matrix is written row by row. Lines are
+ * formatted with std::to_chars into one buffer per task, and the buffers
+ * are written in order.
+ */
+template<typename T, std::size_t Rank, Allocator A>
+void
+write_text(const std::string& p_Path,
+           const Tensor<T, Rank, A>& p_Tensor,
+           const TextFormat& p_Format = {},
+           ThreadPool& p_Pool = ThreadPool::global())
+{
+  static_assert(std::is_arithmetic_v<T>, "Text files hold arithmetic types only");
+  const auto& _dims = p_Tensor.dimensions();
+  const std::size_t _width = Rank ? _dims[Rank - 1] : 1;
+  const std::size_t _lines = _width ? p_Tensor.size() / _width : 0;
+  const std::ptrdiff_t _step = dense_strides(_dims)[Rank - 1];
+  const char _delimiter = p_Format.m_Delimiter ? p_Format.m_Delimiter : ',';
+
+  const auto _strides = dense_strides(_dims);
+  constexpr std::size_t k_MaxChars = 32;
+  const std::size_t _max_chars =
+    std::max<std::size_t>(k_MaxChars, std::max(p_Format.m_Precision, 0) + k_MaxChars);
+
+  const std::size_t _tasks = std::clamp<std::size_t>(
+    p_Tensor.size() / 65536, 1, std::max<std::size_t>(p_Pool.size() * 4, 1));
+  std::vector<std::string> _buffers(_tasks);
+  p_Pool.parallel_for(_tasks, [&](std::size_t t) {
+    const std::size_t _begin = _lines * t / _tasks;
+    const std::size_t _end = _lines * (t + 1) / _tasks;
+    std::string& _out = _buffers[t];
+    _out.resize((_end - _begin) * _width * 12 + _max_chars);
+    std::size_t _used = 0;
+    for (std::size_t _line = _begin; _line < _end; ++_line) {
+      std::array<std::size_t, Rank> _coords;
+      const T* _element =
+        p_Tensor.storage() + detail::c_order_position(_line * _width, _coords, _dims, _strides);
+      for (std::size_t j = 0; j < _width; ++j, _element += _step) {
+        if (_out.size() - _used < _max_chars + 2) {
+          _out.resize(_out.size() * 2);
+        }
+        char* _it = _out.data() + _used;
+        char* const _limit = _out.data() + _out.size();
+        if (j) {
+          *_it++ = _delimiter;
+        }
+        if constexpr (std::is_floating_point_v<T>) {
+          _it = p_Format.m_Precision < 0
+                  ? std::to_chars(_it, _limit, *_element).ptr
+                  : std::to_chars(_it,
+                                  _limit,
+                                  *_element,
+                                  std::chars_format::general,
+                                  p_Format.m_Precision)
+                      .ptr;
+        } else {
+          _it = std::to_chars(_it, _limit, *_element).ptr;
+        }
+        _used = _it - _out.data();
+      }
+      if (_out.size() == _used) {
+        _out.resize(_out.size() * 2);
+      }
+      _out[_used++] = '\n';
+    }
+    _out.resize(_used);
+  });
+
+  const int _fd = ::open(p_Path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (_fd < 0) {
+    throw std::system_error(errno, std::generic_category(), "open");
+  }
+  for (const auto& _buffer : _buffers) {
+    for (std::size_t _done = 0; _done < _buffer.size();) {
+      const ssize_t _n = ::write(_fd, _buffer.data() + _done, _buffer.size() - _done);
+      if (_n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (_n < 0) {
+        const int _error = errno;
+        ::close(_fd);
+        throw std::system_error(_error, std::generic_category(), "write");
+      }
+      _done += static_cast<std::size_t>(_n);
+    }
+  }
+  if (::close(_fd) != 0) {
+    throw std::system_error(errno, std::generic_category(), "close");
+  }
+}
+
+}
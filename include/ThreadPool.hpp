@@ -0,0 +1,184 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @class ThreadPool
+ * @brief Fixed-size pool of worker threads
+ *
+ * @details
+ * Workers are started on construction and joined on destruction,
+ * after the queue has been drained.
+ */
+class ThreadPool
+{
+public:
+  /**
+   * @brief Constructor of a pool
+   *
+   * @param p_Threads Amount of worker threads, hardware concurrency if 0
+   */
+  explicit ThreadPool(std::size_t p_Threads = 0)
+    : ThreadPool(p_Threads, nullptr)
+  {
+  }
+
+  /**
+   * @brief Constructor of a pool with a worker start hook
+   *
+   * @param p_Threads Amount of worker threads, hardware concurrency if 0
+   * @param p_OnStart Called on every worker with its index before it
+   * takes tasks, e.g. to set CPU affinity
+   */
+  ThreadPool(std::size_t p_Threads, std::function<void(std::size_t)> p_OnStart)
+  {
+    if (p_Threads == 0) {
+      p_Threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_Workers.reserve(p_Threads);
+    for (std::size_t i = 0; i < p_Threads; ++i) {
+      m_Workers.emplace_back([this, p_OnStart, i] {
+        if (p_OnStart) {
+          p_OnStart(i);
+        }
+        work();
+      });
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool()
+  {
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Stopping = true;
+    }
+    m_Condition.notify_all();
+    for (auto& it : m_Workers) {
+      it.join();
+    }
+  }
+
+  /**
+   * @brief Amount of worker threads
+   */
+  std::size_t size() const noexcept { return m_Workers.size(); }
+
+  /**
+   * @brief Enqueues a task
+   *
+   * @param p_Task Callable without arguments
+   *
+   * @return Future of the task's result
+   */
+  template<typename F>
+  std::future<std::invoke_result_t<F>> submit(F&& p_Task)
+  {
+    using R = std::invoke_result_t<F>;
+    auto _task =
+      std::make_shared<std::packaged_task<R()>>(std::forward<F>(p_Task));
+    std::future<R> _future = _task->get_future();
+    {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      m_Tasks.emplace([_task] { (*_task)(); });
+    }
+    m_Condition.notify_one();
+    return _future;
+  }
+
+  /**
+   * @brief Runs `p_Fn(i)` for every i in [0, p_Count) and waits for all
+   *
+   * @details
+   * The first exception thrown by a task is rethrown after all tasks finish.
+   * Must not be called from a worker of the same pool.
+   */
+  template<typename F>
+  void parallel_for(std::size_t p_Count, F&& p_Fn)
+  {
+    std::vector<std::future<void>> _futures;
+    _futures.reserve(p_Count);
+    for (std::size_t i = 0; i < p_Count; ++i) {
+      _futures.push_back(submit([&p_Fn, i] { p_Fn(i); }));
+    }
+    std::exception_ptr _error;
+    for (auto& it : _futures) {
+      try {
+        it.get();
+      } catch (...) {
+        if (!_error) {
+          _error = std::current_exception();
+        }
+      }
+    }
+    if (_error) {
+      std::rethrow_exception(_error);
+    }
+  }
+
+  /**
+   * @brief Process-wide pool sized to hardware concurrency
+   */
+  static ThreadPool& global()
+  {
+    static ThreadPool _pool;
+    return _pool;
+  }
+
+private:
+  void work()
+  {
+    for (;;) {
+      std::function<void()> _task;
+      {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Condition.wait(lock, [this] { return m_Stopping || !m_Tasks.empty(); });
+        if (m_Tasks.empty()) {
+          return;
+        }
+        _task = std::move(m_Tasks.front());
+        m_Tasks.pop();
+      }
+      _task();
+    }
+  }
+
+  std::vector<std::thread> m_Workers;
+  std::queue<std::function<void()>> m_Tasks;
+  std::mutex m_Mutex;
+  std::condition_variable m_Condition;
+  bool m_Stopping = false;
+};
+
+}
@@ -0,0 +1,415 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include "ElementIterator.hpp"
+#include "Layout.hpp"
+#include "NdIterator.hpp"
+#include "Tensor.hpp"
+#include "TensorView.hpp"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace TenSore {
+
+/**
+ * @class DirtyBitmap
+ * @brief One bit per block, set concurrently, collected in one go
+ *
+ * @details
+ * Bits are set with relaxed atomics after a plain check, so marking an
+ * already dirty block costs a load, and kernels on several threads may
+ * mark blocks of the same word.
+ */
+class DirtyBitmap
+{
+public:
+  explicit DirtyBitmap(std::size_t p_Blocks = 0)
+    : m_Blocks(p_Blocks)
+    , m_Words(std::make_unique<std::atomic<std::uint64_t>[]>((p_Blocks + 63) / 64))
+  {
+  }
+
+  DirtyBitmap(DirtyBitmap&&) noexcept = default;
+  DirtyBitmap& operator=(DirtyBitmap&&) noexcept = default;
+
+  /**
+   * @brief Amount of tracked blocks
+   */
+  std::size_t size() const noexcept { return m_Blocks; }
+
+  void mark(std::size_t p_Block) noexcept
+  {
+    auto& _word = m_Words[p_Block / 64];
+    const std::uint64_t _bit = std::uint64_t{ 1 } << (p_Block % 64);
+    if (!(_word.load(std::memory_order_relaxed) & _bit)) {
+      _word.fetch_or(_bit, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Marks blocks [p_First, p_Last)
+   */
+  void mark(std::size_t p_First, std::size_t p_Last) noexcept
+  {
+    while (p_First < p_Last) {
+      const std::size_t _bit = p_First % 64;
+      const std::size_t _bits = std::min<std::size_t>(64 - _bit, p_Last - p_First);
+      const std::uint64_t _mask =
+        (_bits == 64 ? ~std::uint64_t{ 0 } : (std::uint64_t{ 1 } << _bits) - 1) << _bit;
+      auto& _word = m_Words[p_First / 64];
+      if ((_word.load(std::memory_order_relaxed) & _mask) != _mask) {
+        _word.fetch_or(_mask, std::memory_order_relaxed);
+      }
+      p_First += _bits;
+    }
+  }
+
+  void mark_all() noexcept { mark(0, m_Blocks); }
+
+  bool test(std::size_t p_Block) const noexcept
+  {
+    return m_Words[p_Block / 64].load(std::memory_order_relaxed) >> (p_Block % 64) & 1;
+  }
+
+  /**
+   * @brief Amount of dirty blocks
+   */
+  std::size_t count() const noexcept
+  {
+    std::size_t _retval = 0;
+    for (std::size_t i = 0; i < word_count(); ++i) {
+      _retval += std::popcount(m_Words[i].load(std::memory_order_relaxed));
+    }
+    return _retval;
+  }
+
+  void clear() noexcept
+  {
+    for (std::size_t i = 0; i < word_count(); ++i) {
+      m_Words[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * @brief Clears the bitmap, returning the dirty blocks in ascending order
+   *
+   * @details
+   * Each word is exchanged atomically, so a block marked concurrently is
+   * either returned or stays marked for the next call.
+   */
+  std::vector<std::size_t> take()
+  {
+    std::vector<std::size_t> _retval;
+    for (std::size_t i = 0; i < word_count(); ++i) {
+      std::uint64_t _word = m_Words[i].exchange(0, std::memory_order_acq_rel);
+      while (_word) {
+        _retval.push_back(i * 64 + std::countr_zero(_word));
+        _word &= _word - 1;
+      }
+    }
+    return _retval;
+  }
+
+private:
+  std::size_t word_count() const noexcept { return (m_Blocks + 63) / 64; }
+
+  std::size_t m_Blocks;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> m_Words;
+};
+
+/**
+ * @class TrackedTensor
+ * @brief Tensor recording which fixed-size blocks were modified
+ *
+ * @tparam T The type of value contained in a tensor
+ * @tparam Rank Dimensions of a tensor (1 - vector, 2 - matrix, etc.)
+ * @tparam A Allocator of the underlying Tensor
+ *
+ * @details
+ * Blocks are runs of `block_elements()` elements in Tensor's linear order.
+ * Every mutable access path marks the blocks it may touch: element
+ * access marks one block, span() and view() mark the range they cover.
+ * Iterators yield proxies that mark a block only when assigned to, so
+ * read-only algorithms over a non-const tensor mark nothing; mutable
+ * range-for loops bind them with `auto&&`. The underlying tensor is
+ * reachable read-only, so writes cannot bypass tracking.
+ *
+ * Each consumer of the modifications owns a channel, a bitmap that every
+ * access marks and that only this consumer clears with take(). Channel 0
+ * always exists and is the one checkpoint writers use; others are added
+ * with add_channel(), e.g. by IncrementalHash.
+ */
+template<typename T, std::size_t Rank, Allocator A = std::allocator<T>>
+class TrackedTensor
+{
+public:
+  using Iterator = ElementIterator<TrackedTensor, T, false>;
+  using ConstIterator = ElementIterator<TrackedTensor, T, true>;
+
+  TrackedTensor() = delete;
+
+  /**
+   * @brief A constructor with an rvalue array
+   *
+   * @param p_Dimensions Array of dimensions
+   * @param p_BlockElements Elements per tracked block
+   *
+   * @details
+   * A new tensor starts with every block dirty, so that the first
+   * checkpoint holds all of it.
+   */
+  TrackedTensor(std::array<std::size_t, Rank>&& p_Dimensions,
+                std::size_t p_BlockElements = 16384)
+    : TrackedTensor(Tensor<T, Rank, A>(std::move(p_Dimensions)), p_BlockElements)
+  {
+  }
+
+  /**
+   * @brief Takes over a tensor
+   *
+   * @param p_Tensor Tensor to be tracked
+   * @param p_BlockElements Elements per tracked block
+   */
+  explicit TrackedTensor(Tensor<T, Rank, A>&& p_Tensor,
+                         std::size_t p_BlockElements = 16384)
+    : m_Tensor(std::move(p_Tensor))
+    , m_BlockElements(p_BlockElements)
+  {
+    if (m_BlockElements == 0) {
+      throw std::invalid_argument("Block size must be positive");
+    }
+    add_channel();
+  }
+
+  std::size_t size() const noexcept { return m_Tensor.size(); }
+
+  const std::array<std::size_t, Rank>& dimensions() const noexcept
+  {
+    return m_Tensor.dimensions();
+  }
+
+  std::size_t block_elements() const noexcept { return m_BlockElements; }
+
+  std::size_t block_count() const noexcept
+  {
+    return (m_Tensor.size() + m_BlockElements - 1) / m_BlockElements;
+  }
+
+  /**
+   * @brief Elements of a block
+   */
+  std::span<const T> block(std::size_t p_Block) const
+  {
+    if (p_Block >= block_count()) {
+      throw std::out_of_range("Block out of bounds");
+    }
+    const std::size_t _first = p_Block * m_BlockElements;
+    return std::span<const T>(storage() + _first,
+                              std::min(m_BlockElements, size() - _first));
+  }
+
+  /**
+   * @brief Dirty bitmap of a channel
+   *
+   * @param p_Channel Channel returned by add_channel(), 0 by default
+   */
+  DirtyBitmap& dirty(std::size_t p_Channel = 0) { return m_Channels.at(p_Channel); }
+
+  const DirtyBitmap& dirty(std::size_t p_Channel = 0) const
+  {
+    return m_Channels.at(p_Channel);
+  }
+
+  /**
+   * @brief Adds a channel with every block dirty
+   *
+   * @return Index of the channel
+   *
+   * @details
+   * Must not run concurrently with any access to the tensor.
+   */
+  std::size_t add_channel()
+  {
+    m_Channels.emplace_back(block_count());
+    m_Channels.back().mark_all();
+    return m_Channels.size() - 1;
+  }
+
+  /**
+   * @brief Underlying tensor, read-only
+   */
+  const Tensor<T, Rank, A>& tensor() const noexcept { return m_Tensor; }
+
+  const T* storage() const noexcept { return m_Tensor.storage(); }
+
+  T& operator[](std::size_t N)
+  {
+    check(N);
+    mark_elements(N, N + 1);
+    return m_Tensor.storage()[N];
+  }
+
+  const T& operator[](std::size_t N) const
+  {
+    check(N);
+    return storage()[N];
+  }
+
+  T& at(const std::array<std::size_t, Rank>& p_Dims)
+  {
+    const std::size_t _index = calculateIndex(p_Dims);
+    mark_elements(_index, _index + 1);
+    return m_Tensor.storage()[_index];
+  }
+
+  const T& at(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return storage()[calculateIndex(p_Dims)];
+  }
+
+  template<std::size_t... p_Dimensions>
+  T& operator()()
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Amount of indices must be equal to the rank");
+    return at({ p_Dimensions... });
+  }
+
+  template<std::size_t... p_Dimensions>
+  const T& operator()() const
+  {
+    static_assert(sizeof...(p_Dimensions) == Rank,
+                  "Amount of indices must be equal to the rank");
+    return at({ p_Dimensions... });
+  }
+
+  T& operator()(const std::array<std::size_t, Rank>& p_Dims) { return at(p_Dims); }
+
+  const T& operator()(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return at(p_Dims);
+  }
+
+  /**
+   * @brief Writable run of elements, marking its blocks
+   *
+   * @param p_First Index of the first element
+   * @param p_Count Amount of elements
+   */
+  std::span<T> span(std::size_t p_First, std::size_t p_Count)
+  {
+    if (p_First + p_Count > size()) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+    mark_elements(p_First, p_First + p_Count);
+    return std::span<T>(m_Tensor.storage() + p_First, p_Count);
+  }
+
+  /**
+   * @brief Writable view of the whole tensor, marking every block
+   */
+  TensorView<T, Rank> view()
+  {
+    mark_elements(0, size());
+    return TensorView<T, Rank>(m_Tensor);
+  }
+
+  TensorView<const T, Rank> view() const noexcept
+  {
+    return TensorView<const T, Rank>(m_Tensor);
+  }
+
+  /**
+   * @brief Writable view of a region, marking the blocks it spans
+   *
+   * @param p_Offsets Coordinates of the first element of the region
+   * @param p_Extents Dimensions of the region
+   *
+   * @details
+   * Marks every block between the region's first and last element in
+   * linear order, which is exact for regions spanning whole lanes of
+   * the leading dimensions and conservative otherwise.
+   */
+  TensorView<T, Rank> view(const std::array<std::size_t, Rank>& p_Offsets,
+                           const std::array<std::size_t, Rank>& p_Extents)
+  {
+    const auto _retval = TensorView<T, Rank>(m_Tensor).subview(p_Offsets, p_Extents);
+    if (_retval.size() != 0) {
+      std::array<std::size_t, Rank> _last;
+      for (std::size_t i = 0; i < Rank; ++i) {
+        _last[i] = p_Offsets[i] + p_Extents[i] - 1;
+      }
+      mark_elements(calculateIndex(p_Offsets), calculateIndex(_last) + 1);
+    }
+    return _retval;
+  }
+
+  Iterator begin() noexcept { return Iterator(this, 0); }
+
+  ConstIterator begin() const noexcept { return ConstIterator(this, 0); }
+
+  Iterator end() noexcept { return Iterator(this, size()); }
+
+  ConstIterator end() const noexcept { return ConstIterator(this, size()); }
+
+  ConstIterator cbegin() const noexcept { return begin(); }
+
+  ConstIterator cend() const noexcept { return end(); }
+
+private:
+  void check(std::size_t N) const
+  {
+    if (N >= size()) {
+      throw std::out_of_range("Accessed an element outside of tensor's size");
+    }
+  }
+
+  void mark_elements(std::size_t p_First, std::size_t p_Last) noexcept
+  {
+    if (p_First + 1 == p_Last) {
+      for (auto& it : m_Channels) {
+        it.mark(p_First / m_BlockElements);
+      }
+    } else if (p_First < p_Last) {
+      for (auto& it : m_Channels) {
+        it.mark(p_First / m_BlockElements, (p_Last - 1) / m_BlockElements + 1);
+      }
+    }
+  }
+
+  std::size_t calculateIndex(const std::array<std::size_t, Rank>& p_Dims) const
+  {
+    return detail::checked_index(p_Dims, dimensions());
+  }
+
+  Tensor<T, Rank, A> m_Tensor;
+  std::size_t m_BlockElements;
+  std::vector<DirtyBitmap> m_Channels;
+};
+
+}
@@ -0,0 +1,340 @@
+/*
+    TenSore, Mathematical tensor written in C++20
+    Copyright (C) 2024, Nikolay Gubankov (aka nikgub)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace TenSore {
+
+/**
+ * @class Transport
+ * @brief Point-to-point byte channel between the ranks of a job
+ *
+ * @details
+ * Collectives are written against this interface only, so backends are
+ * interchangeable. Messages between a pair of ranks arrive in order.
+ */
+class Transport
+{
+public:
+  virtual ~Transport() = default;
+
+  /**
+   * @brief Index of this process in the job
+   */
+  virtual std::size_t rank() const noexcept = 0;
+
+  /**
+   * @brief Amount of processes in the job
+   */
+  virtual std::size_t size() const noexcept = 0;
+
+  /**
+   * @brief Sends bytes to a peer, blocking until they are handed off
+   */
+  virtual void send(std::size_t p_Peer, const void* p_Data, std::size_t p_Bytes) = 0;
+
+  /**
+   * @brief Receives exactly `p_Bytes` bytes from a peer
+   */
+  virtual void recv(std::size_t p_Peer, void* p_Data, std::size_t p_Bytes) = 0;
+
+  /**
+   * @brief Sends to one peer while receiving from another
+   *
+   * @details
+   * Must not deadlock when every rank of a ring calls it at once, however
+   * large the messages are.
+   */
+  virtual void sendrecv(std::size_t p_To,
+                        const void* p_Send,
+                        std::size_t p_SendBytes,
+                        std::size_t p_From,
+                        void* p_Recv,
+                        std::size_t p_RecvBytes) = 0;
+};
+
+/**
+ * @class SelfTransport
+ * @brief Single-rank transport, for running distributed code in-process
+ */
+class SelfTransport : public Transport
+{
+public:
+  std::size_t rank() const noexcept override { return 0; }
+
+  std::size_t size() const noexcept override { return 1; }
+
+  void send(std::size_t, const void*, std::size_t) override
+  {
+    throw std::logic_error("A single-rank job has no peers");
+  }
+
+  void recv(std::size_t, void*, std::size_t) override
+  {
+    throw std::logic_error("A single-rank job has no peers");
+  }
+
+  void sendrecv(std::size_t,
+                const void* p_Send,
+                std::size_t p_SendBytes,
+                std::size_t,
+                void* p_Recv,
+                std::size_t p_RecvBytes) override
+  {
+    if (p_SendBytes != p_RecvBytes) {
+      throw std::invalid_argument("Mismatched exchange with self");
+    }
+    std::memmove(p_Recv, p_Send, p_SendBytes);
+  }
+};
+
+/**
+ * @class SocketTransport
+ * @brief Transport over a full mesh of Unix stream sockets
+ *
+ * @details
+ * Sockets are non-blocking and driven by poll(2), so sendrecv() makes
+ * progress on both directions at once regardless of socket buffer sizes.
+ */
+class SocketTransport : public Transport
+{
+public:
+  /**
+   * @brief Constructor of a transport
+   *
+   * @param p_Rank Index of this process
+   * @param p_Sockets Connected socket per peer, -1 at p_Rank; owned
+   */
+  SocketTransport(std::size_t p_Rank, std::vector<int> p_Sockets)
+    : m_Rank(p_Rank)
+    , m_Sockets(std::move(p_Sockets))
+  {
+    for (std::size_t i = 0; i < m_Sockets.size(); ++i) {
+      if (i != m_Rank) {
+        fcntl(m_Sockets[i], F_SETFL, fcntl(m_Sockets[i], F_GETFL) | O_NONBLOCK);
+      }
+    }
+  }
+
+  SocketTransport(const SocketTransport&) = delete;
+  SocketTransport& operator=(const SocketTransport&) = delete;
+
+  ~SocketTransport() override
+  {
+    for (const int _fd : m_Sockets) {
+      if (_fd >= 0) {
+        ::close(_fd);
+      }
+    }
+  }
+
+  std::size_t rank() const noexcept override { return m_Rank; }
+
+  std::size_t size() const noexcept override { return m_Sockets.size(); }
+
+  void send(std::size_t p_Peer, const void* p_Data, std::size_t p_Bytes) override
+  {
+    sendrecv(p_Peer, p_Data, p_Bytes, m_Rank, nullptr, 0);
+  }
+
+  void recv(std::size_t p_Peer, void* p_Data, std::size_t p_Bytes) override
+  {
+    sendrecv(m_Rank, nullptr, 0, p_Peer, p_Data, p_Bytes);
+  }
+
+  void sendrecv(std::size_t p_To,
+                const void* p_Send,
+                std::size_t p_SendBytes,
+                std::size_t p_From,
+                void* p_Recv,
+                std::size_t p_RecvBytes) override
+  {
+    if (p_To >= size() || p_From >= size()) {
+      throw std::out_of_range("Rank out of bounds");
+    }
+    if (p_To == m_Rank || p_From == m_Rank) {
+      if ((p_To == m_Rank && p_SendBytes != 0) || (p_From == m_Rank && p_RecvBytes != 0)) {
+        throw std::invalid_argument("Transport does not exchange with self");
+      }
+    }
+    const auto* _out = static_cast<const std::byte*>(p_Send);
+    auto* _in = static_cast<std::byte*>(p_Recv);
+    std::size_t _sent = 0;
+    std::size_t _received = 0;
+    while (_sent < p_SendBytes || _received < p_RecvBytes) {
+      pollfd _fds[2];
+      nfds_t _count = 0;
+      if (_sent < p_SendBytes) {
+        _fds[_count++] = { m_Sockets[p_To], POLLOUT, 0 };
+      }
+      if (_received < p_RecvBytes) {
+        _fds[_count++] = { m_Sockets[p_From], POLLIN, 0 };
+      }
+      if (poll(_fds, _count, -1) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        throw std::system_error(errno, std::generic_category(), "poll");
+      }
+      if (_sent < p_SendBytes) {
+        const ssize_t _n = ::send(
+          m_Sockets[p_To], _out + _sent, p_SendBytes - _sent, MSG_NOSIGNAL);
+        if (_n > 0) {
+          _sent += static_cast<std::size_t>(_n);
+        } else if (_n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+          throw std::system_error(errno, std::generic_category(), "send");
+        }
+      }
+      if (_received < p_RecvBytes) {
+        const ssize_t _n =
+          ::recv(m_Sockets[p_From], _in + _received, p_RecvBytes - _received, 0);
+        if (_n > 0) {
+          _received += static_cast<std::size_t>(_n);
+        } else if (_n == 0) {
+          throw std::runtime_error("Peer closed the connection");
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+          throw std::system_error(errno, std::generic_category(), "recv");
+        }
+      }
+    }
+  }
+
+private:
+  std::size_t m_Rank;
+  std::vector<int> m_Sockets;
+};
+
+/**
+ * @brief Runs a job of several processes on this host
+ *
+ * @param p_Ranks Amount of processes
+ * @param p_Fn Callable run by every process with its SocketTransport
+ *
+ * @details
+ * Forks one child per rank, connected pairwise by socketpair(2), and
+ * waits for all of them. The children leave through _exit(), so they
+ * must not rely on destructors of static objects; forking is only safe
+ * before this process has started threads (e.g. ThreadPool::global()).
+ * Throws std::runtime_error naming the first rank that failed.
+ */
+inline void
+run_local(std::size_t p_Ranks, const std::function<void(Transport&)>& p_Fn)
+{
+  if (p_Ranks == 0) {
+    throw std::invalid_argument("A job needs at least one rank");
+  }
+  std::vector<std::vector<int>> _sockets(p_Ranks, std::vector<int>(p_Ranks, -1));
+  auto _close_all = [&] {
+    for (auto& _row : _sockets) {
+      for (int& _fd : _row) {
+        if (_fd >= 0) {
+          ::close(_fd);
+          _fd = -1;
+        }
+      }
+    }
+  };
+  for (std::size_t i = 0; i < p_Ranks; ++i) {
+    for (std::size_t j = i + 1; j < p_Ranks; ++j) {
+      int _pair[2];
+      if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, _pair) != 0) {
+        const int _error = errno;
+        _close_all();
+        throw std::system_error(_error, std::generic_category(), "socketpair");
+      }
+      _sockets[i][j] = _pair[0];
+      _sockets[j][i] = _pair[1];
+    }
+  }
+
+  std::cout.flush();
+  std::fflush(nullptr);
+  std::vector<pid_t> _children;
+  for (std::size_t r = 0; r < p_Ranks; ++r) {
+    const pid_t _pid = fork();
+    if (_pid < 0) {
+      const int _error = errno;
+      _close_all();
+      for (const pid_t _child : _children) {
+        waitpid(_child, nullptr, 0);
+      }
+      throw std::system_error(_error, std::generic_category(), "fork");
+    }
+    if (_pid == 0) {
+      for (std::size_t i = 0; i < p_Ranks; ++i) {
+        if (i == r) {
+          continue;
+        }
+        for (const int _fd : _sockets[i]) {
+          if (_fd >= 0) {
+            ::close(_fd);
+          }
+        }
+      }
+      int _status = 0;
+      try {
+        SocketTransport _transport(r, std::move(_sockets[r]));
+        p_Fn(_transport);
+      } catch (const std::exception& e) {
+        std::cerr << "Rank " << r << ": " << e.what() << std::endl;
+        _status = 1;
+      } catch (...) {
+        _status = 1;
+      }
+      std::cout.flush();
+      std::fflush(nullptr);
+      _exit(_status);
+    }
+    _children.push_back(_pid);
+  }
+  _close_all();
+
+  std::string _failure;
+  for (std::size_t r = 0; r < p_Ranks; ++r) {
+    int _status = 0;
+    waitpid(_children[r], &_status, 0);
+    const bool _ok = WIFEXITED(_status) && WEXITSTATUS(_status) == 0;
+    if (!_ok && _failure.empty()) {
+      _failure = "Rank " + std::to_string(r) + " of a local job failed";
+    }
+  }
+  if (!_failure.empty()) {
+    throw std::runtime_error(_failure);
+  }
+}
+
+}